@@ -169,6 +169,16 @@ int main(int argc, char** argv) {
         return EXIT_FAILURE;
     }
 
+    // Spool the module's DMA transfers so the data file can be checked with
+    // list_mode_crc_validation.py.
+    if (!args.spool.empty()) {
+        r = verify_api_return_value(::PixieListModeSpoolOpen(0, args.spool.c_str()),
+                                    "PixieListModeSpoolOpen");
+        if (!r) {
+            return EXIT_FAILURE;
+        }
+    }
+
     // Start the data run
     std::cout << logging("INFO") << "Pixie16StartListModeRun" << std::endl;
     r = verify_api_return_value(::Pixie16StartListModeRun(0, 0x100, 1), "Pixie16StartListModeRun",
@@ -232,6 +242,9 @@ int main(int argc, char** argv) {
         stats_monitor_thread.join();
     }
 
+    if (!args.spool.empty()) {
+        verify_api_return_value(::PixieListModeSpoolClose(0), "PixieListModeSpoolClose");
+    }
 
     ::Pixie16ExitSystem(static_cast<unsigned short>(args.slots.size()));
     return EXIT_SUCCESS;
@@ -41,6 +41,9 @@ CliArguments ParseCliArguments(int argc, char** argv) {
     args::ValueFlag<std::string> slots(parser, "slots",
                                        "Comma-separated list of slots (e.g., -s 2,3,4,5)",
                                        args::Matcher{'s', "slots"});
+    args::ValueFlag<std::string> spool(parser, "spool",
+                                       "List-mode spool file with a CRC for each DMA transfer",
+                                       args::Matcher{"spool"});
 
     try {
         parser.ParseCLI(argc, argv);
@@ -74,6 +77,10 @@ CliArguments ParseCliArguments(int argc, char** argv) {
         parsed_args.firmware_path = fw_path.Get();
     }
 
+    if (spool) {
+        parsed_args.spool = spool.Get();
+    }
+
     return parsed_args;
 }
 
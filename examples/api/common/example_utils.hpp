@@ -36,6 +36,7 @@ struct CliArguments {
     std::string firmware_path;
     std::string parfile;
     std::vector<unsigned short> slots;
+    std::string spool;
 };
 
 std::string walltime_iso_string();
@@ -26,10 +26,11 @@
 #include <atomic>
 #include <cstdint>
 #include <deque>
-#include <forward_list>
 #include <iostream>
 #include <memory>
 #include <mutex>
+#include <new>
+#include <utility>
 #include <vector>
 
 #include <pixie/error.hpp>
@@ -65,9 +66,75 @@ using buffer_value = pixie::hw::word;
  */
 using buffer_value_ptr = pixie::hw::word_ptr;
 /**
- * @brief Defines a type for a vector of buffer words.
+ * @brief An allocator that places a vector's storage in a slot of a pool's
+ * slab.
+ *
+ * A request that fits the slot returns the slot and any other request, or an
+ * allocator without a slot, uses the heap. A copy of a container does not
+ * share the slot.
+ *
+ * Elements constructed without a value are default initialised so resizing a
+ * buffer of words does not zero its storage. A buffer is raw storage and a
+ * resize within its capacity is free.
+ */
+template<typename T>
+struct slab_allocator {
+    using value_type = T;
+
+    template<typename U>
+    struct rebind {
+        using other = slab_allocator<U>;
+    };
+
+    slab_allocator() noexcept : slot(nullptr), slot_size(0) {}
+    slab_allocator(T* slot_, size_t slot_size_) noexcept : slot(slot_), slot_size(slot_size_) {}
+    template<typename U>
+    slab_allocator(const slab_allocator<U>&) noexcept : slot(nullptr), slot_size(0) {}
+
+    T* allocate(size_t n) {
+        if (slot != nullptr && n <= slot_size) {
+            return slot;
+        }
+        return static_cast<T*>(::operator new(n * sizeof(T)));
+    }
+
+    void deallocate(T* p, size_t) noexcept {
+        if (p != slot) {
+            ::operator delete(p);
+        }
+    }
+
+    template<typename U>
+    void construct(U* p) {
+        ::new (static_cast<void*>(p)) U;
+    }
+
+    template<typename U, typename... Args>
+    void construct(U* p, Args&&... args) {
+        ::new (static_cast<void*>(p)) U(std::forward<Args>(args)...);
+    }
+
+    slab_allocator select_on_container_copy_construction() const {
+        return slab_allocator();
+    }
+
+    bool operator==(const slab_allocator& other) const {
+        return slot == other.slot;
+    }
+
+    bool operator!=(const slab_allocator& other) const {
+        return slot != other.slot;
+    }
+
+    T* slot;
+    size_t slot_size;
+};
+
+/**
+ * @brief Defines a type for a vector of buffer words. A pool's buffers are
+ * stored in the pool's slab.
 */
-using buffer = pixie::hw::words;
+using buffer = std::vector<buffer_value, slab_allocator<buffer_value>>;
 /**
  * @brief Defines a pointer to a vector of buffer words.
 */
@@ -77,17 +144,71 @@ using buffer_ptr = buffer*;
 */
 using handle = std::shared_ptr<buffer>;
 
+/**
+ * @brief A range of data in a pooled buffer lent to a reader.
+ *
+ * The buffer is returned to its pool when the last handle is released. The
+ * data is read in place and is not copied.
+ */
+struct lent {
+    handle buf;
+    size_t offset;
+    size_t length;
+
+    const buffer_value* data() const {
+        return buf->data() + offset;
+    }
+
+    size_t size() const {
+        return length;
+    }
+};
+/**
+ * @brief Defines a vector of lent buffers.
+ */
+using lent_buffers = std::vector<lent>;
+
 /**
  * @brief The buffer pool to manage the buffer workers.
+ *
+ * The buffers are stored in a single slab of memory. Each buffer starts on a
+ * cache line. The slab is backed by huge pages if the system has them and
+ * otherwise by normal pages, and it is bound to a NUMA node if one is
+ * provided. The slab's pages are touched when it is created so a worker
+ * filling the buffers does not take page faults.
+ *
+ * Requests and releases do not lock. The free buffers are held on a stack
+ * linked by index and the top of the stack is tagged so a buffer released
+ * and requested again while another thread is requesting is detected.
+ * Creating and destroying the pool must not be concurrent with requests or
+ * releases.
  */
 struct pool {
     pool();
     ~pool();
 
-    void create(const size_t number, const size_t size);
+    /**
+     * @brief Create the pool's buffers.
+     * @param number The number of buffers.
+     * @param size The capacity of each buffer in words.
+     * @param numa_node The NUMA node the slab is bound to, -1 for no binding.
+     */
+    void create(const size_t number, const size_t size, const int numa_node = -1);
     void destroy();
 
     handle request();
+    /**
+     * @brief Make a handle for a buffer requested with `request_buffer`.
+     * The buffer is returned to the pool when the handle is released.
+     */
+    handle make_handle(buffer_ptr buf);
+
+    /**
+     * @brief Request a buffer without a handle. The buffer is returned to
+     * the pool with `release`.
+     */
+    buffer_ptr request_buffer();
+    void release(buffer_ptr buf);
 
     bool valid() const {
         return number != 0;
@@ -108,15 +229,39 @@ struct pool {
     size_t number;
     size_t size;
 
+    /*
+     * The slab's NUMA node and if it is backed by huge pages.
+     */
+    int numa_node;
+    bool huge_pages;
+
     void output(std::ostream& out);
 
 private:
     struct releaser;
-    void release(buffer_ptr buf);
+
+    using link = std::atomic<uint32_t>;
+    using links = std::unique_ptr<link[]>;
 
     std::atomic_size_t count_;
 
-    std::forward_list<buffer_ptr> buffers;
+    /*
+     * The slab holds the buffers' storage. A buffer's stride in the slab is
+     * its size rounded up to a cache line.
+     */
+    void* slab;
+    size_t slab_size;
+    size_t stride;
+
+    std::vector<buffer> buffers;
+
+    /*
+     * The free stack. The top has the index of the top buffer in the lower
+     * 32 bits and a tag in the upper 32 bits. Each free buffer links to the
+     * next free buffer.
+     */
+    std::atomic_uint64_t top;
+    links next;
 
     lock_type lock;
 };
@@ -133,6 +278,7 @@ struct queue {
     handle pop();
 
     size_t copy(buffer& to);
+    size_t copy(pixie::hw::words& to);
     size_t copy(buffer_value_ptr to, const size_t to_move);
 
     void compact();
@@ -156,10 +302,110 @@ private:
     size_t size_;
 };
 
+/**
+ * @brief A single producer, single consumer ring of pooled buffers.
+ *
+ * The producer pushes buffers from the pool and the consumer copies the data
+ * out. There are no locks. The consumer holds a read cursor into the oldest
+ * buffer so a partial copy does not move the remaining data. A buffer is
+ * returned to the pool once it has been read and a newer buffer is in the
+ * ring.
+ *
+ * The producer can append data to the newest buffer while it has space. The
+ * consumer only reads the data the producer has committed and never returns
+ * the newest buffer to the pool. Appending keeps small transfers in one
+ * buffer so the ring does not need to be compacted.
+ *
+ * The ring has a slot for every buffer in the pool so a push cannot fail.
+ *
+ * The consumer can lend the buffers to a reader rather than copy the data.
+ * The newest buffer is sealed before it is lent so the producer does not
+ * append to it. A seal only succeeds if the producer is not appending and
+ * the producer pushes a new buffer when it finds the newest buffer sealed.
+ */
+struct ring {
+    ring();
+    ~ring();
+
+    /*
+     * Create and destroy the ring. The producer and consumer must not be
+     * active. Destroying the ring returns all buffers to the pool.
+     */
+    void create(pool& pool);
+    void destroy();
+
+    bool valid() const {
+        return slots_ != nullptr;
+    }
+
+    /*
+     * Producer.
+     *
+     * The space is the number of words that can be written to `space_data`
+     * and then committed to the newest buffer. A non-zero space starts an
+     * append and the append is finished by `commit`, `abort_append` or
+     * `push`. An aborted append leaves the newest buffer as it was.
+     */
+    size_t space();
+    buffer_value_ptr space_data();
+    void commit(const size_t words);
+    void abort_append();
+    void push(buffer_ptr buf, const size_t words);
+
+    /*
+     * Consumer.
+     */
+    size_t copy(buffer& to);
+    size_t copy(pixie::hw::words& to);
+    size_t copy(buffer_value_ptr to, const size_t to_move);
+    size_t lend(lent_buffers& buffers, const size_t max_buffers = 0);
+    void flush();
+
+    bool empty() const {
+        return size() == 0;
+    }
+
+    size_t size() const;
+    size_t count() const;
+
+    void output(std::ostream& out) const;
+
+private:
+    struct slot {
+        buffer_ptr buf;
+        std::atomic_size_t size;
+    };
+
+    void release_head(size_t head);
+
+    pool* pool_;
+    std::unique_ptr<slot[]> slots_;
+    size_t capacity;
+
+    /*
+     * The head is the oldest slot and owned by the consumer. The tail is the
+     * next free slot and owned by the producer. The word counts are owned by
+     * each side and the difference is the data in the ring.
+     */
+    std::atomic_size_t head;
+    std::atomic_size_t tail;
+    std::atomic_size_t produced;
+    std::atomic_size_t consumed;
+    size_t cursor;
+
+    /*
+     * The producer is appending to the newest buffer and the consumer has
+     * sealed the newest buffer to lend it.
+     */
+    std::atomic_bool appending;
+    std::atomic_bool sealed;
+};
+
 }  // namespace buffer
 }  // namespace xia
 
 std::ostream& operator<<(std::ostream& out, xia::buffer::pool& pool);
 std::ostream& operator<<(std::ostream& out, xia::buffer::queue& queue);
+std::ostream& operator<<(std::ostream& out, const xia::buffer::ring& ring);
 
 #endif  // PIXIE_BUFFER_H
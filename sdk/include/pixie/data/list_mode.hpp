@@ -24,6 +24,8 @@
 #define PIXIESDK_LIST_MODE_HPP
 
 #include <chrono>
+#include <cstddef>
+#include <iterator>
 #include <string>
 #include <vector>
 
@@ -107,9 +109,10 @@ struct record {
      */
     using energy_sums_type = std::vector<uint32_t>;
     /**
-     * @brief Defines the type of object used for the trace
+     * @brief Defines the type of object used for the trace. The ADC samples
+     * are 16-bit values.
      */
-    using trace_type = std::vector<uint32_t>;
+    using trace_type = std::vector<uint16_t>;
     /**
      * @brief Defines the type of object used for the QDCs.
      */
@@ -314,6 +317,342 @@ struct record {
  */
 using records = std::vector<record>;
 
+/**
+ * @brief A structure of arrays holding a block of decoded list-mode events.
+ *
+ * The batch holds the same information as a ::records vector but stores it
+ * in columns. Each event is a row index into the fixed-width columns. The
+ * variable length data (traces, energy sums and QDCs) is packed into shared
+ * arenas and each event holds an offset into its arena.
+ *
+ * Decoding into a batch clears the columns but keeps their capacity. Reusing
+ * the same batch for each data block means the decoder does not allocate
+ * memory per event once the columns have grown to the size of a typical block.
+ */
+struct record_batch {
+    /**
+     * @brief Defines the type used for a single trace sample.
+     */
+    using trace_value = uint16_t;
+    /**
+     * @brief Defines the type of the shared trace arena.
+     */
+    using trace_type = std::vector<trace_value>;
+    /**
+     * @brief Defines the type of the shared energy sums and QDC arena.
+     */
+    using sums_type = std::vector<uint32_t>;
+    /**
+     * @brief Defines the type of the columns holding times in seconds.
+     */
+    using time_column = std::vector<double>;
+    /**
+     * @brief Defines the type of the columns holding values such as the slot.
+     */
+    using value_column = std::vector<uint32_t>;
+    /**
+     * @brief Defines the type of the columns holding flags.
+     */
+    using flag_column = std::vector<uint8_t>;
+    /**
+     * @brief Defines the type of the columns holding offsets into an arena.
+     */
+    using offset_column = std::vector<size_t>;
+
+    /**
+     * @brief The offset value used when an event has no data in an arena.
+     */
+    static constexpr size_t no_offset = size_t(-1);
+
+    record_batch() = default;
+
+    /**
+     * @brief Removes all events from the batch. The memory is retained.
+     */
+    void clear();
+    /**
+     * @brief Reserves space in the columns and arenas.
+     * @param events The number of events to reserve.
+     * @param trace_samples The number of trace samples to reserve.
+     */
+    void reserve(size_t events, size_t trace_samples = 0);
+
+    /**
+     * @brief The number of events in the batch.
+     */
+    size_t size() const {
+        return slot_id.size();
+    }
+    /**
+     * @brief True if there are no events in the batch.
+     */
+    bool empty() const {
+        return slot_id.empty();
+    }
+
+    /**
+     * @brief Returns the number of trace samples stored for an event.
+     * @param index The event's index in the batch.
+     */
+    size_t trace_size(size_t index) const;
+    /**
+     * @brief Returns a pointer to the first trace sample of an event.
+     * @param index The event's index in the batch.
+     */
+    const trace_value* trace(size_t index) const;
+
+    /**
+     * @brief Copies an event out of the batch into a record.
+     * @param index The event's index in the batch.
+     * @param[out] rec The record to fill.
+     */
+    void get(size_t index, record& rec) const;
+
+    /*
+     * Fixed-width columns, one entry per event.
+     */
+    value_column crate_id;
+    value_column slot_id;
+    value_column channel_number;
+    value_column header_length;
+    value_column event_length;
+    value_column trace_length;
+    value_column cfd_trigger_source;
+    flag_column cfd_forced_trigger;
+    flag_column finish_code;
+    flag_column trace_out_of_range;
+    time_column time;
+    time_column filter_time;
+    time_column cfd_fractional_time;
+    time_column external_time;
+    std::vector<double> energy;
+    std::vector<double> filter_baseline;
+
+    /*
+     * Offsets into the arenas. An event without energy sums or QDCs has an
+     * offset of `no_offset`.
+     */
+    offset_column trace_offset;
+    offset_column energy_sums_offset;
+    offset_column qdc_offset;
+
+    /*
+     * Arenas shared by all events in the batch.
+     */
+    trace_type traces;
+    sums_type sums;
+};
+
+/**
+ * @brief A read-only span over the 16-bit trace samples of an event.
+ *
+ * The samples are packed two to a 32-bit word with the first sample in the low
+ * half of the word. The span points at the event's words and each sample is
+ * unpacked with shifts when it is accessed so the samples are the same on any
+ * host.
+ */
+struct trace_span {
+    /**
+     * @brief Defines the type of a trace sample.
+     */
+    using value_type = uint16_t;
+
+    /**
+     * @brief A random access iterator over the samples.
+     */
+    class const_iterator {
+    public:
+        using iterator_category = std::random_access_iterator_tag;
+        using value_type = trace_span::value_type;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = value_type;
+
+        const_iterator() : words(nullptr), index(0) {}
+        const_iterator(const uint32_t* words_, size_t index_) : words(words_), index(index_) {}
+
+        value_type operator*() const {
+            return sample(words, index);
+        }
+        value_type operator[](difference_type n) const {
+            return sample(words, size_t(difference_type(index) + n));
+        }
+        const_iterator& operator++() {
+            ++index;
+            return *this;
+        }
+        const_iterator operator++(int) {
+            auto it = *this;
+            ++index;
+            return it;
+        }
+        const_iterator& operator--() {
+            --index;
+            return *this;
+        }
+        const_iterator operator--(int) {
+            auto it = *this;
+            --index;
+            return it;
+        }
+        const_iterator& operator+=(difference_type n) {
+            index = size_t(difference_type(index) + n);
+            return *this;
+        }
+        const_iterator& operator-=(difference_type n) {
+            index = size_t(difference_type(index) - n);
+            return *this;
+        }
+        const_iterator operator+(difference_type n) const {
+            return const_iterator(words, size_t(difference_type(index) + n));
+        }
+        const_iterator operator-(difference_type n) const {
+            return const_iterator(words, size_t(difference_type(index) - n));
+        }
+        difference_type operator-(const const_iterator& other) const {
+            return difference_type(index) - difference_type(other.index);
+        }
+        bool operator==(const const_iterator& other) const {
+            return words == other.words && index == other.index;
+        }
+        bool operator!=(const const_iterator& other) const {
+            return !(*this == other);
+        }
+        bool operator<(const const_iterator& other) const {
+            return index < other.index;
+        }
+        bool operator>(const const_iterator& other) const {
+            return index > other.index;
+        }
+        bool operator<=(const const_iterator& other) const {
+            return index <= other.index;
+        }
+        bool operator>=(const const_iterator& other) const {
+            return index >= other.index;
+        }
+
+    private:
+        const uint32_t* words;
+        size_t index;
+    };
+
+    trace_span() : words(nullptr), length(0) {}
+    /**
+     * @param words_ The event's trace words.
+     * @param length_ The number of samples, two for each word.
+     */
+    trace_span(const uint32_t* words_, size_t length_) : words(words_), length(length_) {}
+
+    size_t size() const {
+        return length;
+    }
+    bool empty() const {
+        return length == 0;
+    }
+    const_iterator begin() const {
+        return const_iterator(words, 0);
+    }
+    const_iterator end() const {
+        return const_iterator(words, length);
+    }
+    value_type operator[](size_t index) const {
+        return sample(words, index);
+    }
+
+private:
+    static value_type sample(const uint32_t* words, size_t index) {
+        return value_type((words[index / 2] >> (16 * (index % 2))) & 0xFFFF);
+    }
+
+    const uint32_t* words;
+    size_t length;
+};
+
+/*
+ * The decoding layout of a firmware revision and frequency.
+ */
+struct decode_plan;
+
+/**
+ * @brief A lightweight view of a single event in a list-mode data block.
+ *
+ * The view holds a pointer to the event's words and the decoding layout of
+ * the firmware. No values are copied when a view is made. The header fields
+ * are decoded each time they are accessed and return the same values as the
+ * matching ::record fields. The times are in seconds.
+ *
+ * A view is only valid while the data it points to is valid. Views are made
+ * with ::view_record which validates the event header.
+ */
+struct record_view {
+    record_view();
+    record_view(const uint32_t* words_, const decode_plan& plan_, uint32_t revision_,
+                uint32_t frequency_);
+
+    /**
+     * @brief True if the view points to an event.
+     */
+    bool valid() const {
+        return words != nullptr;
+    }
+    /**
+     * @brief A pointer to the first word of the event.
+     */
+    const uint32_t* data() const {
+        return words;
+    }
+
+    uint32_t crate_id() const;
+    uint32_t slot_id() const;
+    uint32_t channel_number() const;
+    uint32_t header_length() const;
+    uint32_t event_length() const;
+    uint32_t trace_length() const;
+    uint32_t cfd_trigger_source() const;
+    bool cfd_forced_trigger() const;
+    bool finish_code() const;
+    bool trace_out_of_range() const;
+    double energy() const;
+    double time() const;
+    double filter_time() const;
+    double cfd_fractional_time() const;
+    /**
+     * @brief The external time in clock cycles or 0 if the event does not
+     * have the external time stamp words.
+     */
+    double external_time() const;
+    /**
+     * @brief The filter baseline or 0 if the event does not have energy sums.
+     */
+    double filter_baseline() const;
+    /**
+     * @brief A pointer to the 3 energy sums or nullptr if the event does not
+     * have energy sums.
+     */
+    const uint32_t* energy_sums() const;
+    /**
+     * @brief A pointer to the 8 QDC sums or nullptr if the event does not
+     * have QDC sums.
+     */
+    const uint32_t* qdc() const;
+    /**
+     * @brief The trace samples. The span is empty if the event has no trace.
+     */
+    trace_span trace() const;
+
+    /**
+     * @brief Copies the event into a record.
+     * @param[out] rec The record to fill.
+     */
+    void get(record& rec) const;
+
+private:
+    const uint32_t* words;
+    const decode_plan* plan;
+    uint32_t revision;
+    uint32_t frequency;
+};
+
 /**
  * @brief Converts a record object into a JSON string.
  * @param[in] rec The record that we want to convert into a string.
@@ -333,6 +672,23 @@ PIXIE_EXPORT void PIXIE_API json_to_record(const std::string& json_string, recor
  */
 using buffer = std::vector<uint32_t>;
 
+/**
+ * @brief The decoders available for the list-mode event headers.
+ */
+enum struct header_decoder {
+    /**
+     * @brief The firmware's header layout is resolved into a decode plan once
+     * per data block and the fields are extracted directly. This is the default.
+     */
+    plan,
+    /**
+     * @brief The firmware's header element descriptors are walked for each
+     * event. This is the reference decoder and is used to test and benchmark
+     * the plan decoder.
+     */
+    interpreter
+};
+
 /**
  * @brief Decodes a Pixie-16 list-mode data block.
  *
@@ -364,9 +720,11 @@ using buffer = std::vector<uint32_t>;
  *  data buffer, then we fill the leftovers buffer with the remaining data. This
  *  typically happens when you've passed in a partial record, or a data block
  *  that contains a partial record at the end.
+ * @param decoder The decoder used for the event headers.
  */
 PIXIE_EXPORT void PIXIE_API decode_data_block(uint32_t* data, size_t len, uint32_t revision,
-                                              uint32_t frequency, records& recs, buffer& leftovers);
+                                              uint32_t frequency, records& recs, buffer& leftovers,
+                                              header_decoder decoder = header_decoder::plan);
 
 /**
  * @brief Decodes a Pixie-16 list-mode data block.
@@ -398,6 +756,88 @@ PIXIE_EXPORT void PIXIE_API decode_data_block(uint32_t* data, size_t len, uint32
  */
 PIXIE_EXPORT void PIXIE_API decode_data_block(buffer data, uint32_t revision, uint32_t frequency,
                                               records& recs, buffer& leftovers);
+
+/**
+ * @brief Decodes a Pixie-16 list-mode data block into a record batch.
+ *
+ * The data is validated and the leftovers handled exactly as the records
+ * version of this function. The batch is cleared before decoding and the
+ * capacity of its columns is kept so a batch reused for each block does not
+ * allocate memory once it has grown to the size of the blocks.
+ *
+ * @param data A pointer to the array containing the data read out of the module.
+ *  The data block does not have to be an integer number of records.
+ * @param len The length of the data array.
+ * @param revision The firmware revision used to collect the data.
+ * @param frequency The module's ADC sampling frequency that collected the data.
+ * @param batch The batch to hold the decoded events.
+ * @param leftovers A vector to hold any remaining words that could not be decoded.
+ *  These values should be prepended to the next data buffer before passing it
+ *  to this function.
+ * @param decoder The decoder used for the event headers.
+ */
+PIXIE_EXPORT void PIXIE_API decode_data_block(uint32_t* data, size_t len, uint32_t revision,
+                                              uint32_t frequency, record_batch& batch,
+                                              buffer& leftovers,
+                                              header_decoder decoder = header_decoder::plan);
+
+/**
+ * @brief Makes a view of the event at the start of the data.
+ *
+ * The event header is checked as the decoders check it and the errors thrown
+ * are the same. No data is copied.
+ *
+ * @param data A pointer to the first word of an event.
+ * @param len The number of words available from `data`.
+ * @param revision The firmware revision used to collect the data.
+ * @param frequency The module's ADC sampling frequency that collected the data.
+ * @param[out] view The view of the event.
+ * @return True if a complete event is available. False if the event is not
+ *  complete in the `len` words, in which case the view is not changed.
+ * @throws xia::pixie::error::error if the event header is not valid.
+ */
+PIXIE_EXPORT bool PIXIE_API view_record(const uint32_t* data, size_t len, uint32_t revision,
+                                        uint32_t frequency, record_view& view);
+
+/**
+ * @brief Finds the first record boundary in a list-mode data block.
+ *
+ * The data blocks do not contain markers so a boundary is found by searching
+ * for a word whose header passes the decoder's header, event length, trace
+ * length and slot checks. The records that follow the candidate must also
+ * pass the checks. This lets a decoder start in the middle of a data stream.
+ *
+ * @param data A pointer to the data.
+ * @param len The number of words of data.
+ * @param revision The firmware revision used to collect the data.
+ * @param frequency The module's ADC sampling frequency that collected the data.
+ * @param chain The number of records following the candidate that are
+ *  checked. Records that run past the end of the data are not checked.
+ * @return The offset in words of the first record boundary, or `len` if there
+ *  is no boundary in the data.
+ */
+PIXIE_EXPORT size_t PIXIE_API find_record_start(const uint32_t* data, size_t len,
+                                                uint32_t revision, uint32_t frequency,
+                                                size_t chain = 4);
+
+/**
+ * @brief Encodes a record as a Pixie-16 list-mode event.
+ *
+ * This is the inverse of the decoder and is used to make list-mode data for
+ * simulations and tests. The event's header layout is the record's header
+ * length and the event length is the header length plus the packed trace.
+ * The time is encoded from the filter time and the CFD fractional time. Values
+ * wider than the firmware's fields are truncated to the fields.
+ *
+ * @param rec The record to encode.
+ * @param revision The firmware revision of the data.
+ * @param frequency The module's ADC sampling frequency.
+ * @param data The event's words are appended to this buffer.
+ * @throws xia::pixie::error::error if the revision, frequency, header length,
+ *  slot or the sizes of the trace, energy sums or QDC sums are not valid.
+ */
+PIXIE_EXPORT void PIXIE_API encode_record(const record& rec, uint32_t revision,
+                                          uint32_t frequency, buffer& data);
 }  // namespace list_mode
 }  // namespace data
 }  // namespace pixie
@@ -0,0 +1,223 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+
+/*
+ * Copyright 2021 XIA LLC, All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** @file list_mode_merge.hpp
+ * @brief Defines a time ordered merge of list-mode data streams.
+ */
+
+#ifndef PIXIESDK_LIST_MODE_MERGE_HPP
+#define PIXIESDK_LIST_MODE_MERGE_HPP
+
+#include <chrono>
+#include <vector>
+
+#include <pixie/data/list_mode.hpp>
+
+namespace xia {
+namespace pixie {
+namespace data {
+namespace list_mode {
+
+/**
+ * @brief Merges list-mode data streams into a single stream ordered by the
+ * event time.
+ *
+ * Each stream is usually a module's list-mode data. The data is decoded as it
+ * is pushed and any partial event at the end of a push is held until the next
+ * push. A module's events are close to time order but not in order, so each
+ * stream holds its events in a heap and the streams are merged with a k-way
+ * heap on the event time (`record::operator<`).
+ *
+ * An event is released once every active stream has seen an event later than
+ * the event's time plus the reorder window. A stream that has no data yet
+ * holds the release of all streams and the stream with the earliest latest
+ * event sets the horizon. A caller that knows a stream has no events before a
+ * time can set the stream's watermark to move it forward. A stream that has
+ * not had events or a watermark for the idle timeout does not hold the
+ * release. The number of events held is bounded. If the bound is reached the
+ * earliest events are released regardless of the window. A stream that has
+ * ended is finished so it no longer holds the release.
+ *
+ * An event pushed with a time earlier than an event already released is late.
+ * It is released by the next pull and counted.
+ */
+class merger {
+public:
+    /**
+     * @brief The default reorder window in seconds.
+     */
+    static constexpr double default_reorder_window = 100e-6;
+    /**
+     * @brief The default maximum number of events held.
+     */
+    static constexpr size_t default_max_events = 1000000;
+    /**
+     * @brief The default idle timeout in milliseconds.
+     */
+    static constexpr size_t default_idle_msecs = 1000;
+
+    /**
+     * @param idle_msecs The period a stream has no events before it is idle.
+     *  A period of 0 disables the timeout.
+     */
+    merger(record::time_type reorder_window = record::time_type(default_reorder_window),
+           size_t max_events = default_max_events, size_t idle_msecs = default_idle_msecs);
+
+    /**
+     * @brief Add a stream.
+     * @param revision The firmware revision used to collect the stream's data.
+     * @param frequency The ADC sampling frequency of the module.
+     * @return The stream's index.
+     */
+    size_t add_stream(uint32_t revision, uint32_t frequency);
+
+    /**
+     * @brief Decode the data and add the events to the stream.
+     * @throws xia::pixie::error::error if the stream is not valid or
+     *  finished or the data cannot be decoded. The events decoded before
+     *  bad data are kept and the rest of the data is dropped.
+     */
+    void push(size_t stream, const uint32_t* data, size_t len);
+    /**
+     * @brief Add decoded records to the stream. The records are moved.
+     */
+    void push(size_t stream, records& recs);
+    /**
+     * @brief The stream has ended. It no longer holds the release of events.
+     */
+    void finish(size_t stream);
+    /**
+     * @brief The stream has no events earlier than the time. The events held
+     * by the other streams up to the time less the reorder window can be
+     * released.
+     */
+    void watermark(size_t stream, record::time_type time);
+
+    /**
+     * @brief Append the events that have cleared the reorder window to the
+     * output in time order.
+     * @return The number of events appended.
+     */
+    size_t pull(records& out);
+    /**
+     * @brief Append all events to the output in time order.
+     * @return The number of events appended.
+     */
+    size_t flush(records& out);
+
+    size_t streams() const {
+        return streams_.size();
+    }
+
+    /**
+     * @brief The number of events held.
+     */
+    size_t size() const {
+        return events;
+    }
+
+    /**
+     * @brief The words of a partial event at the end of the stream's data.
+     */
+    const buffer& leftovers(size_t stream) const;
+
+    /**
+     * @brief The number of late events.
+     */
+    size_t late() const {
+        return late_events;
+    }
+
+    /**
+     * @brief The number of events released because the maximum number of
+     * events was held.
+     */
+    size_t forced() const {
+        return forced_events;
+    }
+
+    const record::time_type reorder_window;
+    const size_t max_events;
+    const size_t idle_msecs;
+
+private:
+    using clock = std::chrono::steady_clock;
+
+    struct stream {
+        uint32_t revision;
+        uint32_t frequency;
+        buffer leftovers;
+        records heap;
+        record::time_type latest;
+        clock::time_point active;
+        bool seen;
+        bool finished;
+
+        stream(uint32_t revision, uint32_t frequency);
+    };
+
+    stream& get(size_t stream);
+    void add(stream& strm, record& rec);
+    size_t release(records& out, bool all);
+
+    std::vector<stream> streams_;
+    buffer work;
+    records decoded;
+    size_t events;
+    record::time_type released_time;
+    bool released;
+    size_t late_events;
+    size_t forced_events;
+};
+
+/**
+ * @brief Groups time ordered events into coincidence windows.
+ *
+ * A group starts with an event and holds every event within the window of
+ * the first event. A group is complete when an event outside its window is
+ * pushed.
+ */
+class coincidence_grouper {
+public:
+    using group = records;
+    using groups = std::vector<group>;
+
+    coincidence_grouper(record::time_type window);
+
+    /**
+     * @brief Group the time ordered events. The events are moved.
+     * @return The number of complete groups appended to the output.
+     */
+    size_t push(records& recs, groups& out);
+    /**
+     * @brief Append the current group to the output.
+     * @return The number of groups appended.
+     */
+    size_t flush(groups& out);
+
+    const record::time_type window;
+
+private:
+    group current;
+};
+}  // namespace list_mode
+}  // namespace data
+}  // namespace pixie
+}  // namespace xia
+
+#endif  //PIXIESDK_LIST_MODE_MERGE_HPP
@@ -0,0 +1,106 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+
+/*
+ * Copyright 2021 XIA LLC, All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** @file list_mode_parallel.hpp
+ * @brief Defines functions to decode list-mode data using multiple threads.
+ */
+
+#ifndef PIXIESDK_LIST_MODE_PARALLEL_HPP
+#define PIXIESDK_LIST_MODE_PARALLEL_HPP
+
+#include <functional>
+#include <string>
+
+#include <pixie/data/list_mode.hpp>
+
+namespace xia {
+namespace pixie {
+namespace data {
+namespace list_mode {
+
+/**
+ * @brief The smallest range of words a thread is given to decode. Smaller
+ * blocks are decoded with fewer threads.
+ */
+static constexpr size_t min_parallel_range_words = 4096;
+
+/**
+ * @brief Defines a function that is passed the records decoded from each chunk
+ * of a file. The chunks are handled in file order.
+ */
+using record_handler = std::function<void(records& recs)>;
+
+/**
+ * @brief Decodes a Pixie-16 list-mode data block using multiple threads.
+ *
+ * The block is split into a range for each thread. Each thread finds the first
+ * record boundary in its range with ::find_record_start and the ranges are
+ * decoded in parallel. The records are merged in the order they are in the
+ * block.
+ *
+ * The result is identical to ::decode_data_block. A range is only used if the
+ * range before it ends exactly at its boundary. If the ranges do not chain or
+ * a range has an error the block is decoded from the start of that range with
+ * the serial decoder, so the records, leftovers and any error match the serial
+ * decoder.
+ *
+ * @param data A pointer to the array containing the data read out of the module.
+ * @param len The length of the data array.
+ * @param revision The firmware revision used to collect the data.
+ * @param frequency The module's ADC sampling frequency that collected the data.
+ * @param recs A vector to hold the decoded records.
+ * @param leftovers A vector to hold any remaining words that could not be decoded.
+ * @param threads The number of threads to use. If 0 the hardware concurrency
+ *  is used.
+ */
+PIXIE_EXPORT void PIXIE_API decode_data_block_parallel(uint32_t* data, size_t len,
+                                                       uint32_t revision, uint32_t frequency,
+                                                       records& recs, buffer& leftovers,
+                                                       size_t threads = 0);
+
+/**
+ * @brief Decodes a Pixie-16 list-mode data file using multiple threads.
+ *
+ * The file is read in chunks and each chunk is decoded with
+ * ::decode_data_block_parallel. The leftovers of a chunk are prepended to the
+ * next chunk. The records of each chunk are passed to the handler in file
+ * order.
+ *
+ * @param path The path of the list-mode data file.
+ * @param revision The firmware revision used to collect the data.
+ * @param frequency The module's ADC sampling frequency that collected the data.
+ * @param handler The function passed the records of each chunk.
+ * @param leftovers A vector to hold any words at the end of the file that
+ *  could not be decoded.
+ * @param threads The number of threads to use. If 0 the hardware concurrency
+ *  is used.
+ * @param chunk_words The number of words read from the file for each chunk.
+ *  If 0 a chunk of 1M words per thread is used.
+ * @throws xia::pixie::error::error if the file cannot be opened or the data
+ *  cannot be decoded.
+ */
+PIXIE_EXPORT void PIXIE_API decode_file(const std::string& path, uint32_t revision,
+                                        uint32_t frequency, const record_handler& handler,
+                                        buffer& leftovers, size_t threads = 0,
+                                        size_t chunk_words = 0);
+}  // namespace list_mode
+}  // namespace data
+}  // namespace pixie
+}  // namespace xia
+
+#endif  //PIXIESDK_LIST_MODE_PARALLEL_HPP
@@ -0,0 +1,130 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+
+/*
+ * Copyright 2021 XIA LLC, All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** @file list_mode_reader.hpp
+ * @brief Defines a memory mapped list-mode data file reader.
+ */
+
+#ifndef PIXIESDK_LIST_MODE_READER_HPP
+#define PIXIESDK_LIST_MODE_READER_HPP
+
+#include <string>
+
+#include <pixie/data/list_mode.hpp>
+
+namespace xia {
+namespace pixie {
+namespace data {
+namespace list_mode {
+
+/**
+ * @brief Reads the events in a list-mode data file without copying them.
+ *
+ * The file is mapped read-only into memory and each event is returned as a
+ * ::record_view pointing at the mapped words. Scanning a file to select
+ * events by channel or energy does not copy or allocate memory. The views
+ * are valid until the reader is closed.
+ *
+ * A file that ends with a partial event stops at the last complete event and
+ * the remaining words can be found with `remaining`. An invalid event header
+ * throws the decoder's error and leaves the position at the invalid event.
+ */
+class mapped_reader {
+public:
+    mapped_reader();
+    mapped_reader(const std::string& path, uint32_t revision, uint32_t frequency);
+    ~mapped_reader();
+
+    mapped_reader(const mapped_reader&) = delete;
+    mapped_reader& operator=(const mapped_reader&) = delete;
+
+    /**
+     * @brief Maps a file. Any open file is closed.
+     * @param path The path of the list-mode data file.
+     * @param revision The firmware revision used to collect the data.
+     * @param frequency The module's ADC sampling frequency that collected the data.
+     * @throws xia::pixie::error::error if the file cannot be opened or mapped.
+     */
+    void open(const std::string& path, uint32_t revision, uint32_t frequency);
+    /**
+     * @brief Unmaps the file. All views of the file are invalid.
+     */
+    void close();
+    /**
+     * @brief True if a file is mapped.
+     */
+    bool is_open() const;
+
+    /**
+     * @brief Returns the next event in the file.
+     * @param[out] view The view of the event.
+     * @return True if an event is returned, false at the end of the file.
+     * @throws xia::pixie::error::error if the event header is invalid.
+     */
+    bool next(record_view& view);
+    /**
+     * @brief Moves the position back to the start of the file.
+     */
+    void rewind();
+
+    /**
+     * @brief The mapped words. A partial word at the end of the file is not
+     * included.
+     */
+    const uint32_t* data() const {
+        return words;
+    }
+    /**
+     * @brief The number of mapped words.
+     */
+    size_t size() const {
+        return length;
+    }
+    /**
+     * @brief The word offset of the next event.
+     */
+    size_t position() const {
+        return offset;
+    }
+    /**
+     * @brief The number of words after the position.
+     */
+    size_t remaining() const {
+        return length - offset;
+    }
+
+    const std::string& path() const {
+        return file_path;
+    }
+
+private:
+    std::string file_path;
+    uint32_t revision;
+    uint32_t frequency;
+    const uint32_t* words;
+    size_t length;
+    size_t offset;
+    void* mapping;
+    size_t mapping_size;
+};
+}  // namespace list_mode
+}  // namespace data
+}  // namespace pixie
+}  // namespace xia
+
+#endif  //PIXIESDK_LIST_MODE_READER_HPP
@@ -0,0 +1,292 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+
+/*
+ * Copyright 2021 XIA LLC, All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** @file list_mode_spool.hpp
+ * @brief Defines a self-verifying list-mode data spool file.
+ */
+
+#ifndef PIXIESDK_LIST_MODE_SPOOL_HPP
+#define PIXIESDK_LIST_MODE_SPOOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <pixie/data/list_mode_reader.hpp>
+
+namespace xia {
+namespace pixie {
+namespace data {
+namespace list_mode {
+
+/**
+ * @brief The list-mode spool file format.
+ *
+ * A spool holds the FIFO data of one or more modules. Each DMA transfer
+ * is a frame with a header followed by the transfer's data words. The
+ * words are in host order.
+ *
+ * The file header is:
+ *
+ *  - Magic number (`spool_file_magic`)
+ *  - Version
+ *  - Frame header length in words
+ *  - Reserved, 0
+ *
+ * A frame header is:
+ *
+ *  - Magic number (`spool_frame_magic`)
+ *  - Slot
+ *  - Sequence number of the slot's transfer, starting at 0
+ *  - Data length in words
+ *  - Host timestamp low word, nsecs since the epoch
+ *  - Host timestamp high word
+ *  - CRC32 of the data
+ *  - CRC32 of the header's previous words
+ *
+ * A transfer that is not spooled still uses a sequence number so the
+ * verifier reports it as a gap.
+ */
+static constexpr uint32_t spool_file_magic = 0x4c505350; /* "PSPL" */
+static constexpr uint32_t spool_frame_magic = 0x4d524650; /* "PFRM" */
+static constexpr uint32_t spool_version = 1;
+static constexpr size_t spool_file_header_words = 4;
+static constexpr size_t spool_frame_header_words = 8;
+
+/**
+ * @brief The default limit of data words a writer queues for the file.
+ */
+static constexpr size_t spool_queue_words = 16 * 1024 * 1024;
+
+/**
+ * @brief A frame of a spool. The data points to the reader's mapped
+ * words.
+ */
+struct spool_frame {
+    uint32_t slot;
+    uint32_t sequence;
+    uint32_t words;
+    uint64_t timestamp;
+    uint32_t crc;
+    const uint32_t* data;
+
+    spool_frame();
+
+    /**
+     * @brief True if the CRC32 of the data matches the header's CRC.
+     */
+    bool valid() const;
+};
+
+/**
+ * @brief Writes DMA transfers to a spool file.
+ *
+ * A writer can be shared by the modules of a crate and each slot has its
+ * own sequence numbers. A write copies the data to a queue and the
+ * writer's thread writes the queue to the file so a caller, the FIFO
+ * worker, does not wait for the file. A write that would queue more than
+ * the queue limit of words is skipped.
+ */
+class spool_writer {
+public:
+    spool_writer(size_t queue_words = spool_queue_words);
+    spool_writer(const std::string& path, size_t queue_words = spool_queue_words);
+    ~spool_writer();
+
+    spool_writer(const spool_writer&) = delete;
+    spool_writer& operator=(const spool_writer&) = delete;
+
+    /**
+     * @brief Creates the spool file and writes the file header. Any open
+     * file is closed.
+     * @throws xia::pixie::error::error if the file cannot be created.
+     */
+    void open(const std::string& path);
+    /**
+     * @brief Writes the queued frames and closes the file.
+     * @throws xia::pixie::error::error if a write failed.
+     */
+    void close();
+    bool is_open() const;
+
+    /**
+     * @brief Queues the data as the slot's next frame.
+     * @throws xia::pixie::error::error if the file is not open or a
+     *  write to the file has failed.
+     */
+    void write(uint32_t slot, const uint32_t* data, size_t words);
+    /**
+     * @brief Uses the slot's next sequence number without writing a
+     * frame.
+     */
+    void skip(uint32_t slot);
+
+    /**
+     * @brief Waits until the queued frames are written to the file.
+     * @throws xia::pixie::error::error if a write failed.
+     */
+    void flush();
+
+    /**
+     * @brief The number of frames queued.
+     */
+    size_t frames() const {
+        return frames_.load();
+    }
+    /**
+     * @brief The number of data words queued.
+     */
+    size_t words() const {
+        return words_.load();
+    }
+    /**
+     * @brief The number of sequence numbers skipped, including writes
+     * skipped because the queue is full.
+     */
+    size_t skipped() const {
+        return skipped_.load();
+    }
+
+    const std::string& path() const {
+        return file_path;
+    }
+
+private:
+    struct queued_frame {
+        uint32_t header[spool_frame_header_words];
+        std::vector<uint32_t> data;
+    };
+
+    uint32_t next_sequence(uint32_t slot);
+    void check_failure();
+    void writer();
+
+    std::mutex lock_;
+    std::condition_variable queued;
+    std::condition_variable drained;
+    std::deque<queued_frame> queue;
+    size_t queue_limit;
+    size_t queued_words;
+    bool writing;
+    bool stopping;
+    std::string failure;
+    std::thread writer_thread;
+    std::ofstream output;
+    std::string file_path;
+    std::map<uint32_t, uint32_t> sequences;
+    std::atomic_size_t frames_;
+    std::atomic_size_t words_;
+    std::atomic_size_t skipped_;
+};
+
+using spool_writer_ptr = std::shared_ptr<spool_writer>;
+
+/**
+ * @brief Reads the frames of a spool file without copying them.
+ *
+ * The file is mapped read-only into memory. A frame's data is valid until
+ * the reader is closed. The frame's CRC is not checked by `next`, use
+ * `spool_frame::valid` or `verify_spool`.
+ */
+class spool_reader {
+public:
+    spool_reader();
+    spool_reader(const std::string& path);
+
+    /**
+     * @brief Maps a spool file and checks the file header.
+     * @throws xia::pixie::error::error if the file cannot be mapped or is
+     *  not a spool.
+     */
+    void open(const std::string& path);
+    void close();
+    bool is_open() const;
+
+    /**
+     * @brief Returns the next frame in the file.
+     * @return True if a frame is returned, false at the end of the file.
+     * @throws xia::pixie::error::error if the frame header is invalid or
+     *  the frame is truncated. The position is left at the frame.
+     */
+    bool next(spool_frame& frame);
+    /**
+     * @brief Moves the position back to the first frame.
+     */
+    void rewind();
+
+    /**
+     * @brief The word offset of the next frame.
+     */
+    size_t position() const {
+        return offset;
+    }
+    /**
+     * @brief The number of words after the position.
+     */
+    size_t remaining() const {
+        return mapped.size() - offset;
+    }
+
+private:
+    mapped_reader mapped;
+    size_t offset;
+};
+
+/**
+ * @brief The result of verifying a spool file.
+ */
+struct spool_verify_result {
+    size_t frames; /* Frames with a valid header */
+    size_t words; /* Data words of the frames */
+    size_t crc_errors; /* Frames with a data CRC error */
+    size_t header_errors; /* Invalid frame headers skipped */
+    size_t sequence_gaps; /* Sequence numbers missing across all slots */
+    size_t slots; /* Slots with frames */
+    bool truncated; /* The file ends inside a frame */
+
+    spool_verify_result();
+
+    /**
+     * @brief True if every frame is valid and no data is missing.
+     */
+    bool ok() const;
+
+    void output(std::ostream& out) const;
+};
+
+/**
+ * @brief Verifies every frame of a spool file. An invalid frame header is
+ * skipped by searching for the next valid frame header.
+ * @throws xia::pixie::error::error if the file cannot be mapped or is
+ *  not a spool.
+ */
+spool_verify_result verify_spool(const std::string& path);
+}  // namespace list_mode
+}  // namespace data
+}  // namespace pixie
+}  // namespace xia
+
+#endif  //PIXIESDK_LIST_MODE_SPOOL_HPP
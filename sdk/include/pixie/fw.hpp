@@ -77,6 +77,12 @@ using image = std::vector<uint8_t>;
  */
 using image_value_type = uint32_t;
 
+/**
+ * @brief A reference to a read-only image. Images are shared by the
+ *        firmware loaded from the same file or with the same contents.
+ */
+using image_ref = std::shared_ptr<const image>;
+
 /**
  * Releases are sematically managed and denote articfacts that are
  * are externally managed. Semantic versioning provides a systemantic
@@ -238,11 +244,16 @@ struct firmware {
     crc_type crc;
 
     /**
-     * @brief The image data is a char buffer.
+     * @brief The image data is a char buffer. It is not set until the
+     *        firmware is loaded.
      *
      * See @ref words for the number of words of data in the image.
      */
-    image data;
+    image_ref data;
+    /**
+     * The CRC checksum calculated when the image was loaded.
+     */
+    crc_type image_crc;
 
     /**
      * @brief The firmware's version, module revision (it can be loaded on) and
@@ -304,12 +315,14 @@ struct firmware {
     /**
      * @brief Update the CRC with the contents of this firmware if the
      *        firmware has has been loaded. If the firmware has not been
-     *        loaded the crc value passed in remains unchanged.
+     *        loaded the crc value passed in remains unchanged. The image's
+     *        CRC is combined so the image is not read.
      */
     void update_crc(util::crc::crc32& crc);
     /**
      * @brief Load firmware and check calculated CRC matches provided CRC.
-     *        Unload firmware if CRCs do not match.
+     *        Unload firmware if CRCs do not match. The CRC is calculated
+     *        once when the image is loaded.
      */
     bool validate_firmware();
 
@@ -651,6 +664,57 @@ struct find_filter {
 void find(
     firmware_set& firmware, const system& firmware_sets, const find_filter& filter);
 
+/**
+ * @brief Image cache statistics.
+ */
+struct image_cache_stats {
+    /**
+     * The number of images held by firmware and their total size in bytes.
+     */
+    size_t images;
+    size_t bytes;
+    /**
+     * Loads found in the cache.
+     */
+    size_t hits;
+    /**
+     * Loads read from disk.
+     */
+    size_t misses;
+    /**
+     * Loads read from disk with the same contents as a cached image.
+     */
+    size_t shared;
+
+    image_cache_stats();
+};
+
+/**
+ * @brief Load an image using the process wide image cache.
+ *
+ * The cache is keyed by the file's path, size and modification time. A
+ * file is read and its CRC calculated once and the image is shared by
+ * all the firmware that load it. A file with the same size and CRC as a
+ * cached image shares that image if the contents match. Concurrent loads
+ * of a file wait for the first load to finish. A changed file is read
+ * again. The cache does not hold the images and an image is released
+ * when the last firmware holding it is unloaded.
+ *
+ * @param[in] path The image's file
+ * @param[out] crc The CRC of the image's contents
+ * @return The read-only image
+ */
+image_ref load_image(const std::string& path, util::crc::crc32::value_type& crc);
+/**
+ * @brief Remove all images from the cache. Images held by firmware are
+ *        released when the firmware is unloaded.
+ */
+void clear_image_cache();
+/**
+ * @brief The image cache statistics.
+ */
+image_cache_stats get_image_cache_stats();
+
 /**
  * @brief Load firmware from disk and into a system.
  * @param[in] fw The firmware that we want to load
@@ -26,6 +26,7 @@
 #include <atomic>
 #include <list>
 #include <memory>
+#include <mutex>
 #include <sstream>
 
 #include <pixie/os_compat.h>
@@ -50,9 +51,16 @@ using log_mib_ptr = std::unique_ptr<log_mib>;
 struct outputter;
 using outputters = std::list<outputter>;
 using outputters_ptr = std::unique_ptr<outputters>;
+struct log_async;
+using log_async_ptr = std::unique_ptr<log_async>;
 struct log_handle {
     log_mib_ptr mibs;
+    /*
+     * The outputs lock is held to write to or change the outputs.
+     */
+    std::mutex outputs_lock;
     outputters_ptr outputs;
+    log_async_ptr async;
     log_handle();
     ~log_handle();
 };
@@ -117,6 +125,32 @@ void set_level_stamp(const std::string name, bool level);
 void set_datetime_stamp(const std::string name, bool datetime);
 void set_line_numbers(const std::string name, bool line_numbers);
 
+/*
+ * Asynchronous output. A log entry is queued on a ring owned by the
+ * logging thread and a worker writes the queued entries in batches. The
+ * overflow policy handles a full ring: drop discards the entry and block
+ * waits for the worker to make space. Stopping writes the queued
+ * entries. The counters are in the MIB as `log.async.*`.
+ */
+enum struct overflow_policy { drop, block };
+constexpr size_t default_async_ring_size = 4096;
+void start_async(
+    size_t ring_size = default_async_ring_size,
+    overflow_policy policy = overflow_policy::drop);
+void stop_async();
+bool async_logging();
+
+struct async_stats {
+    size_t queued;
+    size_t written;
+    size_t dropped;
+    size_t blocked;
+    size_t batches;
+
+    async_stats();
+};
+async_stats get_async_stats();
+
 /*
  * Check the currently active logging level
  */
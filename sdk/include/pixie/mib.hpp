@@ -915,6 +915,20 @@ void disable(const char* name);
 bool is_enabled(const name_type& name);
 bool is_enabled(const char* name);
 
+/**
+ * Find a number of MIBs with a single lookup of the index. A name that
+ * is not found is an invalid node.
+ */
+using names = std::vector<name_type>;
+void find(const names& names_, nodes& found);
+
+/**
+ * Get the values of a number of MIBs as strings. A name that is not
+ * found is an empty string.
+ */
+using values = std::vector<std::string>;
+void get(const names& names_, values& vals);
+
 /**
  * See if the MIB exists?
  */
@@ -927,6 +941,12 @@ bool contains(const char* name);
 using mib_walk_func = std::function<void(node& nod)>;
 void walk(mib_walk_func& walk_func);
 
+/**
+ * Walk the MIBs under a path. The path is a MIB name or the leading
+ * fields of MIB names, for example `module.0.run`.
+ */
+void walk(const name_type& path, mib_walk_func& walk_func);
+
 void mib_to_json(pixie::format::json& mib_json, std::string val, std::string names);
 
 } // mib
@@ -156,6 +156,13 @@ struct channel {
      */
     hw::adc_trace adc_trace;
 
+    /**
+     * The channel's histogram may hold data. A new run only clears the
+     * histograms that may hold data. The memory is not known after a
+     * boot so a channel starts dirty.
+     */
+    bool histogram_dirty;
+
     /**
      * @brief Default constructor
      * @param[in] module A channel must be part of a module.
@@ -180,6 +187,12 @@ struct channel {
      */
     void read_adc(hw::adc_word* buffer, size_t size);
 
+    /**
+     * @brief The DSP I/O buffer address of the channel's ADC trace. Two
+     * samples are packed into each word.
+     */
+    hw::address adc_trace_address() const;
+
     /**
      * @brief Reads a histogram from the channel.
      * @param[out] values Pointer to a data block to store the data.
@@ -25,6 +25,7 @@
 
 #include <atomic>
 #include <functional>
+#include <vector>
 
 #include <pixie/error.hpp>
 #include <pixie/fw.hpp>
@@ -150,6 +151,64 @@ public:
         boot_params();
     };
 
+    /**
+     * Boot report of the last crate boot. The periods are msecs.
+     *
+     * The modules boot in parallel so the modules period is the period
+     * of the slowest module. A module's profile has the period of each
+     * of its boot phases. The report is also in the MIB as
+     * `crate.boot.*` and `module.<slot>.boot.*`.
+     */
+    struct boot_report {
+        struct slot_report {
+            hw::slot_type slot;
+            bool online;
+            module::module::boot_profile profile;
+
+            slot_report(const hw::slot_type slot, const bool online,
+                        const module::module::boot_profile& profile);
+        };
+
+        std::vector<slot_report> slots; /** The booted slots */
+        double modules; /** Period to boot the modules */
+        double backplane; /** Period to reinitialise the backplane */
+        double total; /** Period of the crate boot */
+
+        boot_report();
+
+        void clear();
+
+        void output(std::ostream& out) const;
+    };
+
+    /**
+     * Offset adjustment report of the last crate adjustment. The periods
+     * are msecs.
+     *
+     * The modules adjust their offsets in parallel so the total is the
+     * period of the slowest module. A module's profile has its period
+     * and convergence.
+     */
+    struct offsets_report {
+        struct slot_report {
+            hw::slot_type slot;
+            bool ok;
+            module::module::offsets_profile profile;
+
+            slot_report(const hw::slot_type slot, const bool ok,
+                        const module::module::offsets_profile& profile);
+        };
+
+        std::vector<slot_report> slots; /** The adjusted slots */
+        double total; /** Period of the crate adjustment */
+
+        offsets_report();
+
+        void clear();
+
+        void output(std::ostream& out) const;
+    };
+
     /**
      * Crate revision
      */
@@ -293,6 +352,30 @@ public:
      */
     void boot(const boot_params params = boot_params());
 
+    /**
+     * @brief The report of the last boot.
+     */
+    boot_report get_boot_report();
+
+    /**
+     * @brief Adjust the offsets of the online modules. The modules are
+     * adjusted in parallel so the DAC settling periods of the modules
+     * overlap.
+     * @see xia::pixie::module::adjust_offsets
+     */
+    void adjust_offsets();
+
+    /**
+     * @brief The report of the last offset adjustment.
+     */
+    offsets_report get_offsets_report();
+
+    /**
+     * @brief Acquire the baselines of the online modules in parallel.
+     * @see xia::pixie::module::acquire_baselines
+     */
+    void acquire_baselines();
+
     /**
      * @brief Import a configuration. Returning a list of loaded modules.
      * @param[in] json_file The path to the JSON configuration file to load.
@@ -308,6 +391,37 @@ public:
      */
     void initialize_afe();
 
+    /**
+     * @brief Begin a parameter transaction on each online module.
+     * @see xia::pixie::module::param_transaction_begin
+     */
+    void param_transaction_begin();
+
+    /**
+     * @brief Commit the parameter transaction on each online module. The
+     * modules commit in parallel.
+     * @see xia::pixie::module::param_transaction_commit
+     */
+    void param_transaction_commit();
+
+    /**
+     * @brief Abort the parameter transaction on each online module.
+     * @see xia::pixie::module::param_transaction_abort
+     */
+    void param_transaction_abort();
+
+    /**
+     * @brief Spool the list-mode data of the online modules to a shared
+     * spool writer.
+     * @see xia::pixie::module::spool_attach
+     */
+    void spool_attach(data::list_mode::spool_writer_ptr writer);
+
+    /**
+     * @brief Stop spooling the modules' list-mode data.
+     */
+    void spool_detach();
+
     /**
      * @bief Reiunitialise the backplane. Call if the slots have
      *       changed state.
@@ -386,6 +500,12 @@ private:
      */
     void check_revision();
 
+    /*
+     * Boot report MIB.
+     */
+    void mib_boot_add();
+    void mib_boot_remove();
+
     /*
      * Crate lock
      */
@@ -400,6 +520,20 @@ private:
      * Number of active users in the
      */
     std::atomic_int users_;
+
+    /*
+     * Boot report and its MIB.
+     */
+    boot_report boot_report_;
+    std::atomic<double> boot_modules_period;
+    std::atomic<double> boot_backplane_period;
+    std::atomic<double> boot_total_period;
+    std::vector<mib::read_write<std::atomic<double>>> mibs_boot;
+
+    /*
+     * Offsets report.
+     */
+    offsets_report offsets_report_;
 };
 
 /**
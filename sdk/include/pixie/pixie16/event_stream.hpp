@@ -0,0 +1,124 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+
+/*
+ * Copyright 2021 XIA LLC, All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** @file event_stream.hpp
+ * @brief Defines a crate's time ordered list-mode event stream.
+ */
+
+#ifndef PIXIE_EVENT_STREAM_H
+#define PIXIE_EVENT_STREAM_H
+
+#include <pixie/buffer.hpp>
+
+#include <pixie/data/list_mode_merge.hpp>
+
+#include <pixie/pixie16/crate.hpp>
+
+namespace xia {
+namespace pixie {
+namespace crate {
+/**
+ * @brief A time ordered stream of the list-mode events of a crate's modules.
+ *
+ * Each module's FIFO data is read from its queue without copying, decoded
+ * and merged into a single stream ordered by the event time. The events are
+ * optionally grouped into coincidence windows. Add the modules before the
+ * run starts and read the stream while the run is active. When the run ends
+ * finish the stream to read the events held in the reorder window.
+ *
+ * @see xia::pixie::data::list_mode::merger
+ */
+struct event_stream {
+    using record = data::list_mode::record;
+    using records = data::list_mode::records;
+    using merger = data::list_mode::merger;
+    using groups = data::list_mode::coincidence_grouper::groups;
+
+    event_stream(crate& crate,
+                 record::time_type reorder_window =
+                     record::time_type(merger::default_reorder_window),
+                 record::time_type coincidence_window = record::time_type(0),
+                 size_t max_events = merger::default_max_events,
+                 size_t idle_msecs = merger::default_idle_msecs);
+
+    /**
+     * @brief Add a module's list-mode data to the stream. The data is decoded
+     * with the module's list-mode revision and ADC frequency.
+     * @param slot The module's slot.
+     * @return The module's stream index.
+     * @throws xia::pixie::error::error if the module is not online or has no
+     *  list-mode revision.
+     */
+    size_t add(hw::slot_type slot);
+
+    /**
+     * @brief Read the modules and append the events that have cleared the
+     * reorder window in time order.
+     * @return The number of events appended.
+     */
+    size_t read(records& out);
+    /**
+     * @brief Read the modules and append the complete coincidence groups.
+     * @return The number of groups appended.
+     * @throws xia::pixie::error::error if there is no coincidence window.
+     */
+    size_t read(groups& out);
+
+    /**
+     * @brief Read the modules and append all events in time order.
+     * @return The number of events appended.
+     */
+    size_t finish(records& out);
+    /**
+     * @brief Read the modules and append all coincidence groups.
+     * @return The number of groups appended.
+     * @throws xia::pixie::error::error if there is no coincidence window.
+     */
+    size_t finish(groups& out);
+
+    /**
+     * @brief The merger's statistics.
+     */
+    const merger& merged() const {
+        return merger_;
+    }
+
+    /**
+     * @brief The number of FIFO words read.
+     */
+    size_t words() const {
+        return words_;
+    }
+
+private:
+    void read_modules();
+    void check_grouping() const;
+
+    crate& crate_;
+    merger merger_;
+    data::list_mode::coincidence_grouper grouper;
+    module::modules modules;
+    buffer::lent_buffers lent;
+    records ordered;
+    size_t words_;
+};
+}  // namespace crate
+}  // namespace pixie
+}  // namespace xia
+
+#endif  // PIXIE_EVENT_STREAM_H
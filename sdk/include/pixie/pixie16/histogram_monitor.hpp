@@ -0,0 +1,209 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+
+/*
+ * Copyright 2021 XIA LLC, All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** @file histogram_monitor.hpp
+ * @brief Defines a monitor that publishes the changes in channel histograms.
+ */
+
+#ifndef PIXIE_HISTOGRAM_MONITOR_H
+#define PIXIE_HISTOGRAM_MONITOR_H
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include <pixie/stats.hpp>
+
+#include <pixie/pixie16/crate.hpp>
+
+namespace xia {
+namespace pixie {
+namespace crate {
+/**
+ * @brief Monitors channel histograms and publishes the bins that change.
+ *
+ * The monitor keeps the last histogram read for each watched channel. A
+ * read is compared to the last histogram and the changed bins are
+ * published to the subscribers as ranges of bins with their new counts. A
+ * channel's first update has the whole histogram. Small gaps between
+ * changed bins are joined into a range to limit the number of ranges.
+ *
+ * A channel is read at a period that collects about `target_counts` new
+ * counts at the channel's output count rate, limited to the minimum and
+ * maximum periods. An idle channel is read at the maximum period.
+ *
+ * Call `poll` to read the channels that are due or start the monitor's
+ * thread to poll. Subscribers are called from the polling thread with the
+ * monitor locked and must not call the monitor.
+ */
+struct histogram_monitor {
+    using clock = std::chrono::steady_clock;
+
+    /**
+     * @brief A range of changed bins.
+     */
+    struct range {
+        size_t start;
+        hw::words counts;
+    };
+
+    using ranges = std::vector<range>;
+
+    /**
+     * @brief The changes in a channel's histogram.
+     */
+    struct delta {
+        hw::slot_type slot;
+        size_t channel;
+        /**
+         * The channel's update number. Update 0 is the whole histogram.
+         */
+        size_t sequence;
+        /**
+         * The histogram length in bins.
+         */
+        size_t length;
+        /**
+         * The number of bins in the ranges.
+         */
+        size_t bins;
+        ranges changes;
+    };
+
+    using subscriber = std::function<void(const delta&)>;
+
+    static constexpr size_t default_max_gap = 8;
+    static constexpr double default_target_counts = 1000;
+
+    histogram_monitor(crate& crate,
+                      clock::duration min_period = std::chrono::milliseconds(100),
+                      clock::duration max_period = std::chrono::seconds(5));
+    ~histogram_monitor();
+
+    histogram_monitor(const histogram_monitor&) = delete;
+    histogram_monitor& operator=(const histogram_monitor&) = delete;
+
+    /**
+     * @brief Watch all of a module's channels or a channel.
+     * @throws xia::pixie::error::error if the module is not online or the
+     *  channel is not valid.
+     */
+    void watch(hw::slot_type slot);
+    void watch(hw::slot_type slot, size_t channel);
+
+    /**
+     * @brief Add a subscriber.
+     * @return The subscriber's handle.
+     */
+    size_t subscribe(subscriber func);
+    void unsubscribe(size_t handle);
+
+    /**
+     * @brief Read the channels that are due and publish their changes.
+     * @return The number of deltas published. A channel with no changes
+     *  is not published.
+     */
+    size_t poll();
+
+    /**
+     * @brief The time the next channel is due.
+     */
+    clock::time_point next_poll();
+
+    /**
+     * @brief Start and stop the polling thread.
+     */
+    void start();
+    void stop();
+    bool running() const {
+        return running_.load();
+    }
+
+    /**
+     * @brief Find the ranges of bins that differ. Gaps of up to `max_gap`
+     * unchanged bins are joined into a range.
+     * @return The number of bins in the ranges.
+     */
+    static size_t diff(const hw::words& previous, const hw::words& current, ranges& changes,
+                       size_t max_gap = default_max_gap);
+
+    /**
+     * The histogram words read and the words published.
+     */
+    size_t words_read() const {
+        return words_read_.load();
+    }
+    size_t words_published() const {
+        return words_published_.load();
+    }
+
+    /**
+     * The new counts a channel collects between reads and the largest gap
+     * joined into a range. Set before polling.
+     */
+    double target_counts;
+    size_t max_gap;
+
+    const clock::duration min_period;
+    const clock::duration max_period;
+
+private:
+    struct channel_state {
+        size_t number;
+        hw::words previous;
+        hw::words current;
+        size_t sequence;
+        clock::time_point due;
+    };
+
+    struct module_state {
+        module::module_ptr module;
+        std::vector<channel_state> channels;
+        stats::stats stats;
+        hw::words histograms;
+
+        module_state(module::module_ptr module);
+    };
+
+    module_state& find_module(hw::slot_type slot);
+    void update(module_state& mod, channel_state& chan, clock::time_point now);
+    clock::duration period(const stats::channel& stats) const;
+    void worker();
+
+    crate& crate_;
+    std::vector<module_state> modules;
+    std::vector<std::pair<size_t, subscriber>> subscribers;
+    size_t next_handle;
+    delta published;
+
+    std::atomic_size_t words_read_;
+    std::atomic_size_t words_published_;
+
+    std::recursive_mutex lock;
+    std::mutex wait_lock;
+    std::condition_variable wait_cv;
+    std::atomic_bool running_;
+    std::thread thread;
+};
+}  // namespace crate
+}  // namespace pixie
+}  // namespace xia
+
+#endif  // PIXIE_HISTOGRAM_MONITOR_H
@@ -24,6 +24,7 @@
 #define PIXIE_HW_H
 
 #include <array>
+#include <functional>
 #include <limits>
 #include <stdexcept>
 #include <vector>
@@ -316,6 +317,24 @@ inline void convert(I vin, O& vout) {
  */
 void wait(size_t microseconds);
 
+/**
+ * @brief Poll a status until it is ready or the timeout expires.
+ *
+ * The status is checked before the first wait. The period between
+ * checks starts at `first_usecs` and doubles up to `max_usecs` so a
+ * status that is ready quickly is seen quickly and a slow status is not
+ * polled excessively. The timeout is the elapsed time and not a count
+ * of waits so a wait that oversleeps does not extend it.
+ *
+ * @param ready Returns true when the status is ready.
+ * @param timeout_usecs The maximum time to poll.
+ * @param first_usecs The first period between checks.
+ * @param max_usecs The maximum period between checks.
+ * @return True if the status is ready.
+ */
+bool poll(const std::function<bool()>& ready, size_t timeout_usecs,
+          size_t first_usecs = 10, size_t max_usecs = 1000);
+
 /**
  * Bus interface calls.
  */
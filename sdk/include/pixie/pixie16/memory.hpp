@@ -24,6 +24,7 @@
 #define PIXIE_HW_MEMORY_H
 
 #include <cstdint>
+#include <memory>
 
 #include <pixie/error.hpp>
 #include <pixie/fw.hpp>
@@ -113,9 +114,11 @@ struct host_bus : public bus {
     void write(const size_t channel, const size_t offset, const address addr, const word value);
 
     /*
-     * Memory block write.
+     * Memory block write. The address auto-increments so a block is a
+     * single host bus request.
      */
     void write(const address addr, const words& values);
+    void write(const address addr, const_word_ptr values, const size_t length);
     void write(const size_t channel, const address addr, const words& values);
 
 private:
@@ -160,6 +163,11 @@ struct mca : public bus {
     void read(const address addr, word_ptr values, size_t size);
     void write(const address addr, const words& values);
     void write(const address addr, const_word_ptr values, const size_t size);
+
+    /*
+     * Zero a block of memory with a single transfer.
+     */
+    void clear(const address addr, const size_t size);
 };
 
 /**
@@ -167,6 +175,7 @@ struct mca : public bus {
  */
 struct fifo : public bus {
     fifo(module::module& module);
+    ~fifo();
 
     /**
      * Level of data currently in the FIFO in words
@@ -181,6 +190,23 @@ struct fifo : public bus {
     template<typename B>
     void read(B& values, const size_t length = 0);
     void read(word_ptr buffer, const size_t length);
+
+    /*
+     * Pipelined read. The start returns once the DMA is in flight and
+     * the wait returns when the buffer has the data. The bus is held
+     * from the start until the wait returns.
+     */
+    void read_start(word_ptr buffer, const size_t length);
+    void read_wait();
+
+    bool read_pending() const {
+        return dma_guard != nullptr;
+    }
+
+private:
+    void wait_watermark(const size_t length);
+
+    std::unique_ptr<module::module::bus_guard> dma_guard;
 };
 
 template<class B>
@@ -24,6 +24,7 @@
 #define PIXIE_MODULE_H
 
 #include <atomic>
+#include <chrono>
 #include <iomanip>
 #include <iostream>
 #include <map>
@@ -44,6 +45,8 @@
 #include <pixie/sync.hpp>
 #include <pixie/utils/time.hpp>
 
+#include <pixie/data/list_mode_spool.hpp>
+
 #include <pixie/pixie16/backplane.hpp>
 #include <pixie/pixie16/channel.hpp>
 #include <pixie/pixie16/hw.hpp>
@@ -201,6 +204,7 @@ public:
         std::atomic<double> bandwidth; /* Current bandwidth in MB/s*/
         std::atomic<double> max_bandwidth; /* Maximum bandwidth in MB/s */
         std::atomic<double> min_bandwidth; /* Minimum bandwidth in MB/s */
+        std::atomic<double> start_latency; /* Time to start the run in msecs */
 
         fifo_stats();
         fifo_stats(const fifo_stats& s);
@@ -235,6 +239,67 @@ public:
         size_t last_dma_in;
     };
 
+    /*
+     * Boot phase periods of the last boot. The periods are msecs and a
+     * phase not run by the boot is 0.
+     */
+    struct boot_profile {
+        std::atomic<double> validate; /* Validate the firmware and load the vars */
+        std::atomic<double> comms; /* Load the COMMS FPGA */
+        std::atomic<double> fippi; /* Load the FIPPI FPGA */
+        std::atomic<double> dsp; /* Load the DSP and wait for it to run */
+        std::atomic<double> init; /* Initialise the values, channels and FIFO */
+        std::atomic<double> afe; /* Program the FIPPI and boot the fixtures */
+        std::atomic<double> total; /* The boot */
+
+        /*
+         * Time the phases of a boot. The profile is cleared when
+         * constructed and a mark sets a phase's period to the time since
+         * the last mark. The total is set when destructed so a failed
+         * boot has a total.
+         */
+        class timer {
+            using clock = std::chrono::steady_clock;
+            boot_profile& profile;
+            clock::time_point start;
+            clock::time_point last;
+
+        public:
+            timer(boot_profile& profile);
+            ~timer();
+            void mark(std::atomic<double>& period);
+        };
+
+        boot_profile();
+        boot_profile(const boot_profile& p);
+
+        void clear();
+
+        boot_profile& operator=(const boot_profile& p);
+
+        std::string output() const;
+    };
+
+    /*
+     * Result of the last offset adjustment. The period is msecs. The
+     * converged channels are the channels at the target baseline when
+     * the last run measured the baselines. A channel moved by the last
+     * run is not converged. The DSP adjusts all channels in a single run
+     * and does not report the channels that converged so it is 0.
+     */
+    struct offsets_profile {
+        size_t runs; /* Baseline measurement runs */
+        size_t channels; /* Channels with an offset DAC */
+        size_t converged; /* Channels at the target baseline in the last run */
+        double period; /* The adjustment */
+
+        offsets_profile();
+
+        void clear();
+
+        std::string output() const;
+    };
+
     /**
      * @brief Test mode
      */
@@ -350,10 +415,13 @@ public:
     param::address_map param_addresses;
 
     /*
-     * Run and control task states.
+     * Run and control task states. The control task is the task running
+     * and the last control task is the task last started, which holds
+     * the results in the I/O buffer.
      */
     std::atomic<hw::run::run_task> run_task;
     std::atomic<hw::run::control_task> control_task;
+    std::atomic<hw::run::control_task> last_control_task;
 
     /**
      * Number of buffers in the FIFO pool. The buffers are fixed to the
@@ -409,12 +477,37 @@ public:
      */
     std::atomic_size_t fifo_bandwidth;
 
+    /**
+     * FIFO DMA pipeline. If true the worker starts the DMA of the next
+     * block into a second pooled buffer and queues the previous block
+     * while the transfer is in flight. The bus must support asynchronous
+     * DMA for the transfers to overlap.
+     */
+    std::atomic_bool fifo_dma_pipeline;
+
+    /**
+     * A failed FIFO DMA did not stop. The transfer's buffer may still be
+     * written so it is retired, the FIFO buffers are not released and
+     * the FIFO worker cannot be restarted.
+     */
+    std::atomic_bool fifo_dma_stuck;
+
     /*
      * Run stats, only updated when a run is active
      */
     util::time::timepoint run_interval; /* Period of the run */
     fifo_stats run_stats;
 
+    /*
+     * Boot phase periods of the last boot
+     */
+    boot_profile boot_stats;
+
+    /*
+     * Result of the last offset adjustment
+     */
+    offsets_profile offsets_stats;
+
     /*
      * Calls for reading/writing to hardware
      */
@@ -431,6 +524,13 @@ public:
      */
     int board_revision;
 
+    /**
+     * The firmware revision of the list-mode data. It is the FIPPI
+     * firmware's version, for example `r42081`, and 0 if the version is not
+     * a revision.
+     */
+    uint32_t list_mode_revision;
+
     /**
      * Diagnostics
      */
@@ -596,7 +696,9 @@ public:
      * for a module variable.
      *
      * `io` true reads the value from the DSP, false returns the
-     * module's copy.
+     * module's copy. A read-write variable is returned from the
+     * variables shadow when it is valid and no run or control task
+     * is active.
      */
     param::value_type read_var(const std::string& var, size_t channel, size_t offset = 0,
                                bool io = true);
@@ -624,12 +726,60 @@ public:
      */
     void sync_vars(const param::sync_mode sync_mode = param::sync_mode::to_hw);
 
+    /**
+     * The module's copy of the read-write variables shadows the DSP's
+     * variables. The shadow is loaded with block reads and is valid
+     * until a run or a control task that changes the DSP's variables
+     * starts. Writes update the shadow. A load does not change a value
+     * that has not been written to the DSP.
+     */
+    void vars_shadow_load();
+    void vars_shadow_invalidate();
+    bool vars_shadow_valid();
+
+    /**
+     * Read the read-only run-time variables into the module's copy with
+     * block reads. Read them with `io` false.
+     */
+    void read_runtime_vars();
+
     /**
      * Sync the hardware after the variables have been sync'ed with @ref sync_var and
      * the mode sync mode is @ref param::sync_mode::to_hw.
      */
     void sync_hw(const bool program_fippi = true, const bool program_dacs = true);
 
+    /**
+     * Parameter transactions. Parameter and variable writes in a
+     * transaction are validated and update the variables but are not
+     * written to the DSP, and reads return the written values. The
+     * commit writes the changed variables in bursts and then programs
+     * the FIPPI and sets the DACs once if a write requested it. A
+     * control task that is not held, for example the baselines a
+     * parameter write acquires, flushes the written variables and the
+     * held tasks first so the DSP sees the variables it is run with, and
+     * the transaction is suspended until the task ends. A run cannot be
+     * started in a transaction. An abort restores the variables to their
+     * values at the start of the transaction.
+     */
+    void param_transaction_begin();
+    void param_transaction_commit();
+    void param_transaction_abort();
+    bool param_transaction_active();
+
+    /**
+     * Returns true if the control task is held for the commit of the
+     * parameter transaction. A task that is not held flushes the
+     * transaction.
+     */
+    bool param_transaction_hold(hw::run::control_task task);
+
+    /**
+     * Resume a parameter transaction suspended to run a control task that
+     * is not held. The task is finished.
+     */
+    void param_transaction_resume();
+
     /*
      * Run control and status
      */
@@ -670,6 +820,23 @@ public:
      *                  already been run.
      */
     void read_adc(size_t channel, hw::adc_trace& buffer, bool run = true);
+    /**
+     * @brief Reads the ADC traces of all channels.
+     *
+     * The traces in the DSP's I/O buffer are read with a single block
+     * read. A trace that is not empty keeps its size so a set of traces
+     * can be reused without allocating. A trace longer than the
+     * channel's maximum ADC trace length throws an error and no trace is
+     * read.
+     *
+     * @param[out] traces The traces indexed by channel. It is resized to
+     *                  the number of channels and an empty trace is sized
+     *                  to the channel's maximum ADC trace length.
+     * @param[in] run If true, then we execute the control task to collect the
+     *                  ADC traces. If false, then we assume the control task has
+     *                  already been run.
+     */
+    void read_adc_all(hw::adc_traces& traces, bool run = true);
 
     /*
      * Find the baseline cut for the range of channels. Return the
@@ -686,11 +853,34 @@ public:
     void read_histogram(size_t channel, hw::word_ptr values, const size_t size);
 
     /*
-     * Read the module's list mode
+     * Read the histograms of all channels with a single transfer. Each
+     * channel's histogram is `max_histogram_length` words from the previous
+     * channel's histogram and the values hold `histograms_length()` words.
+     */
+    size_t histograms_length() const;
+    void read_histograms(hw::words& values);
+    void read_histograms(hw::word_ptr values, const size_t size);
+
+    /*
+     * Read the module's list mode. The size of the values is read and an
+     * error is thrown if there is not enough data.
      */
     size_t read_list_mode_level();
     size_t read_list_mode(hw::words& words);
     size_t read_list_mode(hw::word_ptr values, const size_t size);
+    /*
+     * Read the list mode data available up to the maximum size. Returns
+     * the number of words read.
+     */
+    size_t read_list_mode_available(hw::word_ptr values, const size_t max_size);
+    /*
+     * Lend the list mode data buffers to the caller without copying the
+     * data. The buffers are returned to the FIFO pool when the lent handles
+     * are released. All lent buffers must be released before the FIFO
+     * services are stopped or the module is closed. A `max_buffers` of 0
+     * lends all the buffers with data. Returns the number of words lent.
+     */
+    size_t read_list_mode(buffer::lent_buffers& buffers, const size_t max_buffers = 0);
 
     /**
      * Read the stats
@@ -711,6 +901,20 @@ public:
     void set_fifo_hold(const size_t hold);
     void set_fifo_dma_trigger_level(const size_t dma_trigger_level);
     void set_fifo_bandwidth(const size_t bandwidth);
+    void set_fifo_dma_pipeline(const bool pipeline);
+
+    /**
+     * Spool the FIFO worker's DMA transfers to a list-mode spool. Each
+     * transfer is a frame with the module's slot, a sequence number and
+     * the CRC32 of the data. A transfer the worker drops uses a sequence
+     * number so the gap is seen when the spool is verified. The writer
+     * can be shared by the modules of a crate. Detach the writer before
+     * closing it, a detach returns the detached writer once the FIFO
+     * worker is not using it.
+     */
+    void spool_attach(data::list_mode::spool_writer_ptr writer);
+    data::list_mode::spool_writer_ptr spool_detach();
+    bool spooling();
 
     /**
      * Select the module's port
@@ -740,6 +944,26 @@ public:
     virtual void dma_read(const hw::address source, hw::words& values);
     virtual void dma_read(const hw::address source, hw::word_ptr values, const size_t size);
 
+    /*
+     * Asynchronous DMA. Only one transfer can be in flight and the bus
+     * lock must be held from the start until the wait returns. If the bus
+     * does not support asynchronous DMA the start completes the transfer
+     * and the wait returns.
+     */
+    virtual void dma_read_start(const hw::address source, hw::word_ptr values, const size_t size);
+    virtual void dma_read_wait();
+
+    /*
+     * Returns true if the DMA engine is still transferring. A transfer
+     * that timed out may still write its destination.
+     */
+    virtual bool dma_read_busy();
+    /*
+     * Wait for a failed DMA to stop. Returns true if the DMA engine is
+     * idle and the destination can be reused.
+     */
+    bool dma_read_quiesce();
+
     /*
      * Revision tag operators to make comparisons of a version simpler to
      * code.
@@ -845,6 +1069,13 @@ protected:
     virtual void mib_enable();
     virtual void mib_disable();
 
+    /*
+     * Boot profile MIB. It is not disabled when offline so a failed
+     * boot can be profiled.
+     */
+    void mib_boot_add();
+    void mib_boot_remove();
+
     /*
      * Module parameter handlers.
      */
@@ -887,6 +1118,11 @@ protected:
      */
     void log_stats(const char* label, const fifo_stats& stats);
 
+    /*
+     * Record the time taken to start a run.
+     */
+    void run_started(util::time::timepoint& latency);
+
     /*
      * Request the worker to run and wait for to respond it has
      * completed the run.
@@ -909,7 +1145,14 @@ protected:
     sync::variable fifo_worker_resp;
 
     buffer::pool fifo_pool;
-    buffer::queue fifo_data;
+    buffer::ring fifo_data;
+
+    /*
+     * List-mode spool, the FIFO worker holds the lock while it writes a
+     * transfer.
+     */
+    std::mutex spool_lock;
+    data::list_mode::spool_writer_ptr spool;
 
     /*
      * Module lock
@@ -963,6 +1206,43 @@ protected:
      */
     bool vars_loaded;
 
+    /*
+     * The module's copy of the read-write variables matches the DSP.
+     */
+    bool vars_shadowed;
+
+    /*
+     * Parameter transaction and the control tasks held for the commit.
+     */
+    struct param_transaction {
+        bool active;
+        bool suspended;
+        bool program_fippi;
+        bool set_dacs;
+        bool sync_csrb;
+        bool flushed;
+        /*
+         * The read-write variables' values at the start.
+         */
+        std::vector<param::value_type> values;
+        std::vector<bool> dirty;
+
+        param_transaction();
+        void clear();
+    };
+    param_transaction param_trans;
+
+    /*
+     * Write the transaction's variables and run the held tasks.
+     */
+    void param_transaction_flush(param_transaction& pending);
+
+    /*
+     * Returns true if a read of the variable is served from the module's
+     * copy. The shadow is loaded if it is not valid.
+     */
+    bool var_shadowed(const param::rwrowr mode, const bool dirty);
+
     /*
      * Control CS shadow, it is a write-only register
      */
@@ -991,6 +1271,7 @@ protected:
      */
     mib_size_t_nodes mibs_size_t_rw;
     mib_double_nodes mibs_double_rw;
+    mib_double_nodes mibs_boot;
 };
 
 /**
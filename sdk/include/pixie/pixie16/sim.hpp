@@ -23,10 +23,18 @@
 #ifndef PIXIE_SDK_SYSTEM_SIMULATION_HPP
 #define PIXIE_SDK_SYSTEM_SIMULATION_HPP
 
+#include <atomic>
+#include <chrono>
+#include <future>
 #include <iostream>
+#include <map>
+#include <mutex>
+#include <random>
 
 #include <pixie/error.hpp>
 
+#include <pixie/data/list_mode.hpp>
+
 #include <pixie/pixie16/crate.hpp>
 #include <pixie/pixie16/module.hpp>
 
@@ -38,6 +46,98 @@ namespace pixie {
 namespace sim {
 using error = xia::pixie::error::error;
 
+/**
+ * @brief Generates list-mode data for a simulated module's external FIFO.
+ *
+ * Each enabled channel triggers as a Poisson process and the aggregate rate
+ * is shared equally by the channels. The events are encoded for the
+ * configured firmware revision and frequency with the configured header
+ * layout and trace length, and are in time order.
+ *
+ * A paced generator makes the events available as the wall clock passes
+ * their times. The FIFO holds `hw::fifo_size_words` and events that do not
+ * fit are dropped and counted as overflows. An unpaced generator keeps the
+ * FIFO full so a reader is limited only by how fast it can read.
+ */
+class list_mode_generator {
+public:
+    struct config {
+        /*
+         * The firmware revision and ADC frequency of the data. A frequency
+         * of 0 is the module's ADC frequency.
+         */
+        uint32_t revision;
+        uint32_t frequency;
+        /*
+         * The aggregate event rate in events per second.
+         */
+        double rate;
+        /*
+         * The channels that trigger. A mask of 0 is all channels.
+         */
+        uint32_t channel_mask;
+        /*
+         * The header layout.
+         */
+        bool energy_sums;
+        bool qdc;
+        bool external_time;
+        /*
+         * The trace length in samples. The length must be even.
+         */
+        size_t trace_length;
+        bool paced;
+        uint32_t seed;
+
+        config();
+    };
+
+    list_mode_generator(const config& cfg, int crate_id, int slot, size_t num_channels,
+                        uint32_t adc_msps);
+
+    /*
+     * The FIFO level and a read of the FIFO. A read of more than the level
+     * is zero filled.
+     */
+    size_t level();
+    void read(hw::word_ptr values, const size_t size);
+
+    size_t events() const;
+    size_t words() const;
+    size_t overflows() const;
+
+    const config cfg;
+    const uint32_t frequency;
+
+private:
+    using clock = std::chrono::steady_clock;
+
+    void generate(const double until, const size_t max_words);
+    size_t available() const {
+        return fifo.size() - fifo_offset;
+    }
+
+    data::list_mode::record event;
+    std::vector<uint32_t> channels;
+    std::vector<double> next_time;
+    double tick;
+
+    std::mt19937_64 random;
+    std::exponential_distribution<double> interval;
+    std::uniform_int_distribution<uint32_t> energy;
+
+    data::list_mode::buffer fifo;
+    size_t fifo_offset;
+
+    clock::time_point start;
+
+    size_t events_;
+    size_t words_;
+    size_t overflows_;
+
+    mutable std::mutex lock;
+};
+
 /**
  * @brief A Simulated a module derived from the module class.
  */
@@ -59,6 +159,8 @@ public:
         firmware::release_type& release, firmware::firmware_set::set_type& type) override;
     void init_values() override;
     void dma_read(const hw::address source, hw::word_ptr values, const size_t size) override;
+    void dma_read_start(const hw::address source, hw::word_ptr values, const size_t size) override;
+    void dma_read_wait() override;
 
     void load_var_defaults(const std::string& file);
     void load_var_defaults(std::istream& input);
@@ -72,6 +174,64 @@ public:
     bool init_online;
     void sim_reg(int reg, hw::word val);
     void sim_csr(hw::word val);
+
+    /*
+     * Attach a list-mode generator to the external FIFO. The FIFO worker
+     * reads the generated data. Detaching removes the generator and its
+     * data.
+     */
+    void list_mode_attach(const list_mode_generator::config& cfg);
+    void list_mode_detach();
+
+    /*
+     * Test hooks. Fail the asynchronous DMA wait numbered
+     * `dma_wait_fail`, the first wait is 1 and 0 never fails. A failed
+     * DMA is busy if `dma_busy` is set.
+     */
+    std::atomic_size_t dma_wait_fail;
+    std::atomic_bool dma_busy;
+    bool dma_read_busy() override;
+    size_t fifo_buffers_held() const {
+        return fifo_pool.count() + fifo_data.count();
+    }
+    bool fifo_worker_active() const {
+        return fifo_worker_running.load();
+    }
+
+    /*
+     * Test hook. Model the DSP's memory on the host bus and make the
+     * hardware accessible so variable reads and writes reach the model.
+     * `dsp_reads` counts the words read from the model. Detaching
+     * restores the register access and the hardware is not accessible.
+     */
+    void dsp_memory_attach();
+    void dsp_memory_detach();
+    std::map<hw::address, hw::word> dsp_memory;
+    size_t dsp_reads;
+
+    std::unique_ptr<list_mode_generator> list_mode;
+
+private:
+    /*
+     * The FIFO services were started by the list-mode generator.
+     */
+    bool list_mode_fifo_services;
+
+    /*
+     * An asynchronous DMA runs on its own thread.
+     */
+    std::future<void> dma_transfer;
+    size_t dma_waits;
+
+    /*
+     * The DSP memory model's host bus state.
+     */
+    xia::pixie::module::hw_read_func dsp_saved_read;
+    xia::pixie::module::hw_write_func dsp_saved_write;
+    bool dsp_model;
+    bool dsp_bus;
+    hw::address dsp_address;
+    hw::address dsp_dma_address;
 };
 
 /**
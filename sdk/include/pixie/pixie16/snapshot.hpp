@@ -0,0 +1,117 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+
+/*
+ * Copyright 2021 XIA LLC, All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** @file snapshot.hpp
+ * @brief Defines a snapshot of a crate's histograms and run statistics.
+ */
+
+#ifndef PIXIE_SNAPSHOT_H
+#define PIXIE_SNAPSHOT_H
+
+#include <chrono>
+
+#include <pixie/stats.hpp>
+
+#include <pixie/pixie16/crate.hpp>
+
+namespace xia {
+namespace pixie {
+namespace crate {
+/**
+ * @brief A snapshot of the histograms and run statistics of a crate's
+ * online modules.
+ *
+ * The modules are read in parallel and each module's histograms are read
+ * with a single transfer. The histograms are read into caller provided
+ * memory of `words()` words. A module's histograms are contiguous and the
+ * modules are in slot order. Create the snapshot after the crate is
+ * booted and read it as often as needed.
+ */
+struct snapshot {
+    using clock = std::chrono::system_clock;
+
+    struct module_snapshot {
+        hw::slot_type slot;
+        size_t num_channels;
+        /**
+         * The words from the start of a channel's histogram to the next
+         * channel's histogram.
+         */
+        size_t histogram_length;
+        /**
+         * The offset of the module's histograms in the snapshot's memory.
+         */
+        size_t offset;
+        /**
+         * The module's histograms in the memory of the last read.
+         */
+        hw::word_ptr histograms;
+        stats::stats stats;
+
+        module_snapshot(module::module& module, size_t offset);
+
+        hw::word_ptr histogram(size_t channel) const;
+    };
+
+    using module_snapshots = std::vector<module_snapshot>;
+
+    snapshot(crate& crate);
+
+    /**
+     * @brief Read the histograms and statistics of all modules.
+     * @param values The histogram memory of `words()` words.
+     * @throws xia::pixie::error::error if the memory is too small or a
+     *  module fails to read.
+     */
+    void read(hw::word_ptr values, const size_t size);
+    /**
+     * @brief Read into a word vector. An empty vector is resized.
+     */
+    void read(hw::words& values);
+
+    /**
+     * @brief The words of histogram memory the snapshot needs.
+     */
+    size_t words() const {
+        return words_;
+    }
+
+    /**
+     * @brief The module's snapshot.
+     * @throws xia::pixie::error::error if the slot is not in the snapshot.
+     */
+    const module_snapshot& find(hw::slot_type slot) const;
+
+    module_snapshots modules;
+
+    /**
+     * The time all modules started to be read and the period taken to read
+     * them in usecs.
+     */
+    clock::time_point time;
+    uint64_t period;
+
+private:
+    crate& crate_;
+    size_t words_;
+};
+}  // namespace crate
+}  // namespace pixie
+}  // namespace xia
+
+#endif  // PIXIE_SNAPSHOT_H
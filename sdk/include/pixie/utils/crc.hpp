@@ -55,7 +55,12 @@ struct crc32 {
     template<typename T>
     void update(const std::vector<T>& vals, const size_t start = 0) {
         const size_t so = ((vals.size() - start) * sizeof(typename std::vector<T>::value_type));
-        update(reinterpret_cast<const unsigned char*>(&vals[start]), int(so));
+        update(reinterpret_cast<const unsigned char*>(&vals[start]), so);
+    }
+
+    template<typename T>
+    void update(const T* vals, const size_t count) {
+        update(reinterpret_cast<const unsigned char*>(vals), count * sizeof(T));
     }
 
     template<typename T>
@@ -74,6 +79,14 @@ struct crc32 {
      */
     void file(const std::string path);
 
+    /**
+     * Update the CRC as if the data a CRC of `crc` was calculated over
+     * had been passed to `update`. The data's length is `len` bytes. The
+     * data is not needed so CRCs of buffers can be joined without
+     * reading the buffers again.
+     */
+    void combine(const value_type crc, const size_t len);
+
     /**
      * Return the CRC32 value as a hex string
      */
@@ -83,12 +96,20 @@ struct crc32 {
 
     void clear();
 
+    /**
+     * Update the CRC with the bytes of data.
+     */
+    void update(const unsigned char* data, size_t len);
+
 private:
-    void update(const unsigned char* data, int len);
     /**
      * A precomputed lookup table for the CRC32 bitwise algorithm
      */
     static const value_type table[256];
+    /**
+     * The slicing-by-8 lookup tables. The first table is `table`.
+     */
+    static const value_type* slices();
 };
 
 } // namespace crc
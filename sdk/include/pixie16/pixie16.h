@@ -74,6 +74,17 @@ struct module_fifo_stats {
     size_t hw_overflows;
 };
 
+/*
+ * A list-mode data buffer lent by the module's FIFO pool. The data is valid
+ * until the buffer is released with PixieReleaseFifoBuffers. The handle is
+ * owned by the API.
+ */
+struct module_fifo_buffer {
+    const unsigned int* data;
+    size_t words;
+    void* handle;
+};
+
 PIXIE_EXPORT double PIXIE_API IEEEFloating2Decimal(unsigned int IEEEFloatingNumber);
 
 PIXIE_EXPORT unsigned int PIXIE_API Decimal2IEEEFloating(double DecimalNumber);
@@ -240,6 +251,33 @@ PIXIE_EXPORT int PIXIE_API PixieSetFifoConfiguration(unsigned short mod_num,
 PIXIE_EXPORT int PIXIE_API PixieReadRunFifoStats(unsigned short mod_num,
                                                  struct module_fifo_stats* fifo_stats);
 
+PIXIE_EXPORT int PIXIE_API PixieReadFifoBuffers(unsigned short mod_num,
+                                                struct module_fifo_buffer* buffers,
+                                                unsigned int max_buffers,
+                                                unsigned int* num_buffers);
+
+PIXIE_EXPORT int PIXIE_API PixieReleaseFifoBuffers(struct module_fifo_buffer* buffers,
+                                                   unsigned int num_buffers);
+
+PIXIE_EXPORT int PIXIE_API PixieReadListModeData(unsigned short mod_num, unsigned int* data,
+                                                 unsigned int max_words,
+                                                 unsigned int* num_words);
+
+PIXIE_EXPORT int PIXIE_API PixieBeginParameterTransaction(unsigned short mod_num);
+
+PIXIE_EXPORT int PIXIE_API PixieCommitParameterTransaction(unsigned short mod_num);
+
+PIXIE_EXPORT int PIXIE_API PixieAbortParameterTransaction(unsigned short mod_num);
+
+PIXIE_EXPORT int PIXIE_API PixieListModeSpoolOpen(unsigned short mod_num, const char* path);
+
+PIXIE_EXPORT int PIXIE_API PixieListModeSpoolClose(unsigned short mod_num);
+
+PIXIE_EXPORT int PIXIE_API PixieReadHistogramsFromModule(unsigned int* histograms,
+                                                         unsigned int num_words,
+                                                         unsigned short mod_num,
+                                                         unsigned int* hist_length);
+
 enum PIXIE_INSTALL_PATH {
     PIXIE_PATH_FIRMWARE_DEFAULT
 };
@@ -252,6 +290,8 @@ enum PIXIE_SYSCTL_FORMAT {
 };
 
 PIXIE_EXPORT int PIXIE_API PixieSysControlOpen(const char* query, const enum PIXIE_SYSCTL_FORMAT format);
+PIXIE_EXPORT int PIXIE_API PixieSysControlOpenPath(const char* path,
+                                                   const enum PIXIE_SYSCTL_FORMAT format);
 PIXIE_EXPORT int PIXIE_API PixieSysControlRead(char* buffer, size_t* size);
 PIXIE_EXPORT int PIXIE_API PixieSysControlSize(size_t* size);
 PIXIE_EXPORT int PIXIE_API PixieSysControlClose(void);
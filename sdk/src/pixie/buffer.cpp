@@ -20,10 +20,20 @@
  * @brief Implements functions and data structures for creating threaded data buffers
  */
 
+#include <algorithm>
+#include <cerrno>
 #include <cstring>
 #include <iomanip>
 #include <iostream>
 
+#if defined(_WIN64) || defined(_WIN32)
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
 #include <pixie/buffer.hpp>
 #include <pixie/error.hpp>
 #include <pixie/log.hpp>
@@ -32,6 +42,102 @@ namespace xia {
 namespace buffer {
 static constexpr bool queue_trace = false;
 
+/*
+ * The pool's buffers start on a cache line.
+ */
+static constexpr size_t cache_line = 64;
+
+/*
+ * The size of a huge page. The slab is rounded up to this size if it is
+ * backed by huge pages.
+ */
+static constexpr size_t huge_page_size = 2 * 1024 * 1024;
+
+/*
+ * The end of the free stack.
+ */
+static constexpr uint32_t free_end = 0xffffffff;
+
+static size_t round_up(const size_t value, const size_t multiple) {
+    return ((value + multiple - 1) / multiple) * multiple;
+}
+
+#if defined(_WIN64) || defined(_WIN32)
+static void* slab_map(size_t& size, const int numa_node, bool& huge) {
+    huge = false;
+    void* addr;
+    if (numa_node >= 0) {
+        addr = ::VirtualAllocExNuma(::GetCurrentProcess(), nullptr, size,
+                                    MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE, DWORD(numa_node));
+    } else {
+        addr = ::VirtualAlloc(nullptr, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+    }
+    if (addr == nullptr) {
+        throw error(error::code::no_memory,
+                    "pool slab alloc: error " + std::to_string(::GetLastError()));
+    }
+    return addr;
+}
+
+static void slab_unmap(void* addr, size_t) {
+    ::VirtualFree(addr, 0, MEM_RELEASE);
+}
+#else
+static void slab_bind(void* addr, const size_t size, const int numa_node) {
+#ifdef SYS_mbind
+    /*
+     * Prefer the node so the slab can use other nodes if the node is out of
+     * memory.
+     */
+    static constexpr int mpol_preferred = 1;
+    static constexpr size_t max_nodes = 1024;
+    static constexpr size_t bits = sizeof(unsigned long) * 8;
+    if (numa_node >= 0 && size_t(numa_node) < max_nodes) {
+        unsigned long mask[max_nodes / bits] = {};
+        mask[numa_node / bits] = 1UL << (numa_node % bits);
+        if (::syscall(SYS_mbind, addr, size, mpol_preferred, mask, max_nodes, 0) < 0) {
+            xia_log(log::warning) << "pool slab: NUMA node " << numa_node
+                                  << " bind failed: " << std::strerror(errno);
+        }
+    }
+#else
+    (void) addr;
+    (void) size;
+    (void) numa_node;
+#endif
+}
+
+static void* slab_map(size_t& size, const int numa_node, bool& huge) {
+    huge = false;
+    void* addr = MAP_FAILED;
+#ifdef MAP_HUGETLB
+    auto huge_size = round_up(size, huge_page_size);
+    addr = ::mmap(nullptr, huge_size, PROT_READ | PROT_WRITE,
+                  MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (addr != MAP_FAILED) {
+        size = huge_size;
+        huge = true;
+    }
+#endif
+    if (addr == MAP_FAILED) {
+        addr = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (addr == MAP_FAILED) {
+            throw error(error::code::no_memory,
+                        std::string("pool slab map: ") + std::strerror(errno));
+        }
+#ifdef MADV_HUGEPAGE
+        ::madvise(addr, size, MADV_HUGEPAGE);
+#endif
+    }
+    slab_bind(addr, size, numa_node);
+    return addr;
+}
+
+static void slab_unmap(void* addr, size_t size) {
+    ::munmap(addr, size);
+}
+#endif
+
 struct pool::releaser {
     pool& pool_;
     releaser(pool& pool_);
@@ -44,7 +150,9 @@ void pool::releaser::operator()(buffer* buf) const {
     pool_.release(buf);
 }
 
-pool::pool() : number(0), size(0), count_(0) {}
+pool::pool()
+    : number(0), size(0), numa_node(-1), huge_pages(false), count_(0), slab(nullptr),
+      slab_size(0), stride(0), top(free_end) {}
 
 pool::~pool() {
     try {
@@ -54,20 +162,43 @@ pool::~pool() {
     }
 }
 
-void pool::create(const size_t number_, const size_t size_) {
-    xia_log(log::info) << "pool create: num=" << number_ << " size=" << size_;
+void pool::create(const size_t number_, const size_t size_, const int numa_node_) {
+    xia_log(log::info) << "pool create: num=" << number_ << " size=" << size_
+                       << " numa-node=" << numa_node_;
     lock_guard guard(lock);
     if (valid()) {
         throw error(error::code::buffer_pool_not_empty, "pool is already created");
     }
+    if (number_ >= free_end) {
+        throw error(error::code::invalid_value, "pool has too many buffers");
+    }
+    stride = round_up(size_ * sizeof(buffer_value), cache_line);
+    slab_size = number_ * stride;
+    huge_pages = false;
+    if (slab_size > 0) {
+        slab = slab_map(slab_size, numa_node_, huge_pages);
+        /*
+         * Touch the pages so the faults happen now and not when a worker
+         * fills the buffers.
+         */
+        std::memset(slab, 0, slab_size);
+    }
+    numa_node = numa_node_;
+    buffers.reserve(number_);
+    next.reset(new link[number_]);
+    auto base = static_cast<char*>(slab);
+    for (size_t n = 0; n < number_; ++n) {
+        auto slot = reinterpret_cast<buffer_value_ptr>(base + n * stride);
+        buffers.emplace_back(slab_allocator<buffer_value>(slot, size_));
+        buffers.back().reserve(size_);
+        next[n].store(n + 1 < number_ ? uint32_t(n + 1) : free_end, std::memory_order_relaxed);
+    }
+    top.store(number_ > 0 ? 0 : free_end);
     number = number_;
     size = size_;
-    for (size_t n = 0; n < number; ++n) {
-        buffer_ptr buf = new buffer;
-        buf->reserve(size);
-        buffers.push_front(buf);
-    }
     count_ = number;
+    xia_log(log::info) << "pool create: slab=" << slab_size << " stride=" << stride
+                       << " huge-pages=" << std::boolalpha << huge_pages;
 }
 
 void pool::destroy() {
@@ -77,37 +208,77 @@ void pool::destroy() {
         if (count_.load() != number) {
             throw error(error::code::buffer_pool_busy, "pool destroy made while busy");
         }
-        while (!buffers.empty()) {
-            buffer_ptr buf = buffers.front();
-            delete buf;
-            buffers.pop_front();
+        buffers.clear();
+        buffers.shrink_to_fit();
+        next.reset();
+        if (slab != nullptr) {
+            slab_unmap(slab, slab_size);
         }
+        slab = nullptr;
+        slab_size = 0;
+        stride = 0;
+        top = free_end;
         number = 0;
         size = 0;
+        numa_node = -1;
+        huge_pages = false;
         count_ = 0;
     }
 }
 
 handle pool::request() {
-    lock_guard guard(lock);
-    if (empty()) {
-        throw error(error::code::buffer_pool_empty, "no buffers available");
-    }
-    count_--;
-    buffer_ptr buf = buffers.front();
-    buffers.pop_front();
+    return make_handle(request_buffer());
+}
+
+handle pool::make_handle(buffer_ptr buf) {
     return handle(buf, releaser(*this));
 }
 
+buffer_ptr pool::request_buffer() {
+    /*
+     * Claim a buffer from the count before taking one from the stack. The
+     * count is only raised after a buffer is on the stack so a claim is
+     * always matched by a buffer.
+     */
+    auto available = count_.load();
+    do {
+        if (available == 0) {
+            throw error(error::code::buffer_pool_empty, "no buffers available");
+        }
+    } while (!count_.compare_exchange_weak(available, available - 1));
+    auto head = top.load(std::memory_order_acquire);
+    while (true) {
+        auto index = uint32_t(head);
+        auto tag = (head >> 32) + 1;
+        auto link = next[index].load(std::memory_order_relaxed);
+        if (top.compare_exchange_weak(head, (tag << 32) | link, std::memory_order_acq_rel,
+                                      std::memory_order_acquire)) {
+            return &buffers[index];
+        }
+    }
+}
+
 void pool::release(buffer_ptr buf) {
+    if (buf < buffers.data() || buf >= buffers.data() + buffers.size()) {
+        throw error(error::code::invalid_value, "buffer is not from the pool");
+    }
     buf->clear();
-    lock_guard guard(lock);
-    buffers.push_front(buf);
+    auto index = uint64_t(buf - buffers.data());
+    auto head = top.load(std::memory_order_relaxed);
+    while (true) {
+        auto tag = (head >> 32) + 1;
+        next[index].store(uint32_t(head), std::memory_order_relaxed);
+        if (top.compare_exchange_weak(head, (tag << 32) | index, std::memory_order_release,
+                                      std::memory_order_relaxed)) {
+            break;
+        }
+    }
     count_++;
 }
 
 void pool::output(std::ostream& out) {
-    out << "count=" << count_.load() << " num=" << number << " size=" << size;
+    out << "count=" << count_.load() << " num=" << number << " size=" << size
+        << " numa-node=" << numa_node << " huge-pages=" << std::boolalpha << huge_pages;
 }
 
 queue::queue() : size_(0) {}
@@ -153,6 +324,16 @@ size_t queue::copy(buffer& to) {
     return copy_unprotected(to.data(), to_move);
 }
 
+size_t queue::copy(pixie::hw::words& to) {
+    lock_guard guard(lock);
+    size_t to_move = to.size();
+    if (to_move == 0) {
+        to_move = size_;
+        to.resize(to_move);
+    }
+    return copy_unprotected(to.data(), to_move);
+}
+
 size_t queue::copy(buffer_value_ptr to, const size_t to_move) {
     lock_guard guard(lock);
     return copy_unprotected(to, to_move);
@@ -321,6 +502,280 @@ void queue::check(const char* label) {
     xia_log(log::debug) << "queue::check: " << label << ": found=" << csize << " has=" << size_
                         << " buffers=" << buffers.size() << " zero-pairs=" << zero_pairs;
 }
+
+ring::ring()
+    : pool_(nullptr), capacity(0), head(0), tail(0), produced(0), consumed(0), cursor(0),
+      appending(false), sealed(false) {}
+
+ring::~ring() {
+    try {
+        destroy();
+    } catch (...) {
+        /* any error will be logged */
+    }
+}
+
+void ring::create(pool& pool__) {
+    if (valid()) {
+        throw error(error::code::buffer_pool_not_empty, "ring is already created");
+    }
+    pool_ = &pool__;
+    capacity = pool__.number + 1;
+    slots_.reset(new slot[capacity]);
+    for (size_t s = 0; s < capacity; ++s) {
+        slots_[s].buf = nullptr;
+        slots_[s].size = 0;
+    }
+    head = 0;
+    tail = 0;
+    produced = 0;
+    consumed = 0;
+    cursor = 0;
+    appending = false;
+    sealed = false;
+}
+
+void ring::destroy() {
+    if (valid()) {
+        for (auto h = head.load(); h != tail.load(); ++h) {
+            release_head(h);
+        }
+        slots_.reset();
+        pool_ = nullptr;
+        capacity = 0;
+        head = 0;
+        tail = 0;
+        produced = 0;
+        consumed = 0;
+        cursor = 0;
+        appending = false;
+        sealed = false;
+    }
+}
+
+size_t ring::space() {
+    auto t = tail.load(std::memory_order_relaxed);
+    if (t == head.load(std::memory_order_acquire)) {
+        return 0;
+    }
+    /*
+     * Flag the append before checking the seal. The consumer sets the seal
+     * before checking the flag so only one side can win.
+     */
+    appending.store(true);
+    if (sealed.load()) {
+        appending.store(false);
+        return 0;
+    }
+    /*
+     * The slot's size is the fill level. The buffer is resized to its
+     * capacity for the append and back to the fill level when the append
+     * finishes. The resize does not move or zero the storage and the
+     * consumer does not use the buffer's size.
+     */
+    auto& newest = slots_[(t - 1) % capacity];
+    auto free = newest.buf->capacity() - newest.size.load(std::memory_order_relaxed);
+    if (free == 0) {
+        appending.store(false);
+    } else {
+        newest.buf->resize(newest.buf->capacity());
+    }
+    return free;
+}
+
+buffer_value_ptr ring::space_data() {
+    auto& newest = slots_[(tail.load(std::memory_order_relaxed) - 1) % capacity];
+    return newest.buf->data() + newest.size.load(std::memory_order_relaxed);
+}
+
+void ring::commit(const size_t words) {
+    auto& newest = slots_[(tail.load(std::memory_order_relaxed) - 1) % capacity];
+    auto filled = newest.size.load(std::memory_order_relaxed) + words;
+    newest.buf->resize(filled);
+    newest.size.store(filled, std::memory_order_release);
+    produced.fetch_add(words, std::memory_order_release);
+    appending.store(false);
+}
+
+void ring::abort_append() {
+    auto t = tail.load(std::memory_order_relaxed);
+    if (t != head.load(std::memory_order_acquire)) {
+        auto& newest = slots_[(t - 1) % capacity];
+        newest.buf->resize(newest.size.load(std::memory_order_relaxed));
+    }
+    appending.store(false);
+}
+
+void ring::push(buffer_ptr buf, const size_t words) {
+    auto t = tail.load(std::memory_order_relaxed);
+    if (t - head.load(std::memory_order_acquire) >= capacity) {
+        throw error(error::code::buffer_pool_busy, "ring is full");
+    }
+    /*
+     * An unfinished append leaves the newest buffer at its capacity.
+     */
+    if (appending.load() && t != head.load(std::memory_order_acquire)) {
+        auto& newest = slots_[(t - 1) % capacity];
+        newest.buf->resize(newest.size.load(std::memory_order_relaxed));
+    }
+    buf->resize(words);
+    auto& next = slots_[t % capacity];
+    next.buf = buf;
+    next.size.store(words, std::memory_order_relaxed);
+    appending.store(false);
+    sealed.store(false);
+    tail.store(t + 1, std::memory_order_release);
+    produced.fetch_add(words, std::memory_order_release);
+}
+
+size_t ring::copy(buffer& to) {
+    /*
+     * If the `to` size is 0 copy all the available data
+     */
+    size_t to_move = to.size();
+    if (to_move == 0) {
+        to_move = size();
+        to.resize(to_move);
+    }
+    return copy(to.data(), to_move);
+}
+
+size_t ring::copy(pixie::hw::words& to) {
+    size_t to_move = to.size();
+    if (to_move == 0) {
+        to_move = size();
+        to.resize(to_move);
+    }
+    return copy(to.data(), to_move);
+}
+
+size_t ring::copy(buffer_value_ptr to, const size_t to_move) {
+    if (to_move > size()) {
+        throw error(error::code::buffer_pool_not_enough, "not enough data in queue");
+    }
+    auto h = head.load(std::memory_order_relaxed);
+    size_t copied = 0;
+    while (copied < to_move) {
+        /*
+         * The tail is loaded before the slot's size. If the slot is not the
+         * newest the producer has finished with it and the size is final.
+         */
+        auto t = tail.load(std::memory_order_acquire);
+        if (h == t) {
+            break;
+        }
+        auto& oldest = slots_[h % capacity];
+        auto filled = oldest.size.load(std::memory_order_acquire);
+        auto words = std::min(filled - cursor, to_move - copied);
+        if (words > 0) {
+            std::memcpy(to + copied, oldest.buf->data() + cursor, words * sizeof(*to));
+            cursor += words;
+            copied += words;
+        }
+        if (cursor < filled || h + 1 == t) {
+            if (words == 0) {
+                break;
+            }
+            continue;
+        }
+        release_head(h);
+        cursor = 0;
+        head.store(++h, std::memory_order_release);
+    }
+    consumed.fetch_add(copied, std::memory_order_release);
+    return copied;
+}
+
+size_t ring::lend(lent_buffers& buffers, const size_t max_buffers) {
+    auto h = head.load(std::memory_order_relaxed);
+    size_t lent_words = 0;
+    size_t count = 0;
+    while (max_buffers == 0 || count < max_buffers) {
+        auto t = tail.load(std::memory_order_acquire);
+        if (h == t) {
+            break;
+        }
+        auto& oldest = slots_[h % capacity];
+        if (h + 1 == t) {
+            if (oldest.size.load(std::memory_order_acquire) == cursor) {
+                break;
+            }
+            /*
+             * Seal the newest buffer. If the producer is appending the
+             * buffer stays in the ring and is lent by a later call.
+             */
+            sealed.store(true);
+            if (appending.load()) {
+                sealed.store(false);
+                break;
+            }
+        }
+        /*
+         * The size is loaded after the seal so it is final.
+         */
+        auto filled = oldest.size.load(std::memory_order_acquire);
+        if (filled > cursor) {
+            buffers.push_back({pool_->make_handle(oldest.buf), cursor, filled - cursor});
+            lent_words += filled - cursor;
+            ++count;
+        } else {
+            pool_->release(oldest.buf);
+        }
+        oldest.buf = nullptr;
+        oldest.size.store(0, std::memory_order_relaxed);
+        cursor = 0;
+        head.store(++h, std::memory_order_release);
+    }
+    consumed.fetch_add(lent_words, std::memory_order_release);
+    return lent_words;
+}
+
+void ring::flush() {
+    auto available = size();
+    auto h = head.load(std::memory_order_relaxed);
+    size_t dropped = 0;
+    while (dropped < available) {
+        auto t = tail.load(std::memory_order_acquire);
+        if (h == t) {
+            break;
+        }
+        auto filled = slots_[h % capacity].size.load(std::memory_order_acquire);
+        auto words = std::min(filled - cursor, available - dropped);
+        cursor += words;
+        dropped += words;
+        if (cursor < filled || h + 1 == t) {
+            break;
+        }
+        release_head(h);
+        cursor = 0;
+        head.store(++h, std::memory_order_release);
+    }
+    consumed.fetch_add(dropped, std::memory_order_release);
+}
+
+size_t ring::size() const {
+    /*
+     * Load the consumed count first so the size is never negative.
+     */
+    auto out = consumed.load(std::memory_order_acquire);
+    return produced.load(std::memory_order_acquire) - out;
+}
+
+size_t ring::count() const {
+    auto h = head.load(std::memory_order_acquire);
+    return tail.load(std::memory_order_acquire) - h;
+}
+
+void ring::output(std::ostream& out) const {
+    out << "count=" << count() << " size=" << size();
+}
+
+void ring::release_head(size_t h) {
+    auto& oldest = slots_[h % capacity];
+    pool_->release(oldest.buf);
+    oldest.buf = nullptr;
+    oldest.size.store(0, std::memory_order_relaxed);
+}
 }  // namespace buffer
 }  // namespace xia
 
@@ -333,3 +788,8 @@ std::ostream& operator<<(std::ostream& out, xia::buffer::queue& queue) {
     queue.output(out);
     return out;
 }
+
+std::ostream& operator<<(std::ostream& out, const xia::buffer::ring& ring) {
+    ring.output(out);
+    return out;
+}
@@ -20,6 +20,11 @@
  * @brief Defines classes and functions useful for list-mode data processing.
  */
 
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <type_traits>
+
 #include <pixie/error.hpp>
 #include <pixie/format.hpp>
 #include <pixie/utils/io.hpp>
@@ -165,6 +170,103 @@ void record::output(std::ostream& out) const {
         << " energy: " << energy;
 }
 
+void record_batch::clear() {
+    crate_id.clear();
+    slot_id.clear();
+    channel_number.clear();
+    header_length.clear();
+    event_length.clear();
+    trace_length.clear();
+    cfd_trigger_source.clear();
+    cfd_forced_trigger.clear();
+    finish_code.clear();
+    trace_out_of_range.clear();
+    time.clear();
+    filter_time.clear();
+    cfd_fractional_time.clear();
+    external_time.clear();
+    energy.clear();
+    filter_baseline.clear();
+    trace_offset.clear();
+    energy_sums_offset.clear();
+    qdc_offset.clear();
+    traces.clear();
+    sums.clear();
+}
+
+void record_batch::reserve(size_t events, size_t trace_samples) {
+    crate_id.reserve(events);
+    slot_id.reserve(events);
+    channel_number.reserve(events);
+    header_length.reserve(events);
+    event_length.reserve(events);
+    trace_length.reserve(events);
+    cfd_trigger_source.reserve(events);
+    cfd_forced_trigger.reserve(events);
+    finish_code.reserve(events);
+    trace_out_of_range.reserve(events);
+    time.reserve(events);
+    filter_time.reserve(events);
+    cfd_fractional_time.reserve(events);
+    external_time.reserve(events);
+    energy.reserve(events);
+    filter_baseline.reserve(events);
+    trace_offset.reserve(events);
+    energy_sums_offset.reserve(events);
+    qdc_offset.reserve(events);
+    traces.reserve(trace_samples);
+}
+
+size_t record_batch::trace_size(size_t index) const {
+    if (index >= size()) {
+        throw error(error::code::invalid_value,
+                    "record batch index out of range: " + std::to_string(index));
+    }
+    return 2 * size_t(event_length[index] - header_length[index]);
+}
+
+const record_batch::trace_value* record_batch::trace(size_t index) const {
+    if (trace_size(index) == 0) {
+        return nullptr;
+    }
+    return &traces[trace_offset[index]];
+}
+
+void record_batch::get(size_t index, record& rec) const {
+    auto samples = trace_size(index);
+    rec.cfd_forced_trigger = cfd_forced_trigger[index] != 0;
+    rec.cfd_fractional_time = record::time_type(cfd_fractional_time[index]);
+    rec.cfd_trigger_source = cfd_trigger_source[index];
+    rec.channel_number = channel_number[index];
+    rec.crate_id = crate_id[index];
+    rec.energy = energy[index];
+    rec.event_length = event_length[index];
+    rec.external_time = record::time_type(external_time[index]);
+    rec.filter_baseline = filter_baseline[index];
+    rec.filter_time = record::time_type(filter_time[index]);
+    rec.finish_code = finish_code[index] != 0;
+    rec.header_length = header_length[index];
+    rec.slot_id = slot_id[index];
+    rec.time = record::time_type(time[index]);
+    rec.trace_length = trace_length[index];
+    rec.trace_out_of_range = trace_out_of_range[index] != 0;
+    rec.energy_sums.clear();
+    if (energy_sums_offset[index] != no_offset) {
+        auto* esums = &sums[energy_sums_offset[index]];
+        rec.energy_sums.assign(esums, esums + num_esum_words - 1);
+    }
+    rec.qdc.clear();
+    if (qdc_offset[index] != no_offset) {
+        auto* qdcs = &sums[qdc_offset[index]];
+        rec.qdc.assign(qdcs, qdcs + num_qdc_words);
+    }
+    rec.trace.clear();
+    if (trace_length[index] > 0) {
+        auto* samples_start = &traces[trace_offset[index]];
+        rec.trace.assign(samples_start, samples_start + samples);
+    }
+}
+
 
 /**
  * @brief A structure defining the information regarding a data mask.
@@ -388,27 +490,37 @@ static double make_u64_double(const uint32_t high, const uint32_t low) {
     return double(make_u64(high, low));
 }
 
-static void make_time(record& rec, const uint32_t freq, const uint32_t filter_low,
-                      const uint32_t filter_high, const double cfd_time) {
+/**
+ * @brief The times of an event in seconds.
+ */
+struct event_times {
+    double cfd_fractional_time;
+    double filter_time;
+    double time;
+};
+
+static event_times make_time(const uint32_t freq, const uint32_t filter_low,
+                             const uint32_t filter_high, const double cfd_time,
+                             const uint32_t cfd_trigger_source) {
+    event_times times;
     double filter_conv;
     switch (freq) {
         case 250:
             filter_conv = 8e-9;
-            rec.cfd_fractional_time =
-                record::time_type((cfd_time - double(rec.cfd_trigger_source)) * 4e-9);
+            times.cfd_fractional_time = (cfd_time - double(cfd_trigger_source)) * 4e-9;
             break;
         case 500:
             filter_conv = 10e-9;
-            rec.cfd_fractional_time =
-                record::time_type((cfd_time + double(rec.cfd_trigger_source) - 1) * 2e-9);
+            times.cfd_fractional_time = (cfd_time + double(cfd_trigger_source) - 1) * 2e-9;
             break;
         default:
             filter_conv = 10e-9;
-            rec.cfd_fractional_time = record::time_type(cfd_time * 10e-9);
+            times.cfd_fractional_time = cfd_time * 10e-9;
             break;
     }
-    rec.filter_time = record::time_type(make_u64_double(filter_high, filter_low) * filter_conv);
-    rec.time = rec.cfd_fractional_time + rec.filter_time;
+    times.filter_time = make_u64_double(filter_high, filter_low) * filter_conv;
+    times.time = times.cfd_fractional_time + times.filter_time;
+    return times;
 }
 
 static const descriptor_list& find_element_set(uint32_t rev, uint32_t freq) {
@@ -479,6 +591,125 @@ static double cfd_multiplier(const uint32_t rev, const uint32_t freq) {
     }
 }
 
+/**
+ * @brief The location of a field in the event header words.
+ *
+ * A field the firmware does not record has a zero mask and decodes as 0.
+ */
+struct field_desc {
+    field_desc() : mask(0), shift(0), index(0) {}
+
+    uint32_t get(const uint32_t* data) const {
+        return (data[index] & mask) >> shift;
+    }
+
+    uint32_t mask;
+    uint32_t shift;
+    uint32_t index;
+};
+
+/**
+ * @brief A decode plan resolves a firmware's element descriptors once into
+ * fixed field locations so the event headers can be decoded with straight-line
+ * field extraction.
+ */
+struct decode_plan {
+    decode_plan(const descriptor_list& elements_, const uint32_t rev, const uint32_t freq)
+        : elements(elements_), cfd_scale(cfd_multiplier(rev, freq)) {
+        for (const auto& ele : elements) {
+            field_desc* field;
+            switch (ele.type) {
+                case element::cfd_forced_trigger_bit:
+                    field = &cfd_forced_trigger;
+                    break;
+                case element::cfd_fractional_time:
+                    field = &cfd_fractional_time;
+                    break;
+                case element::cfd_trigger_source_bit:
+                    field = &cfd_trigger_source;
+                    break;
+                case element::channel_number:
+                    field = &channel_number;
+                    break;
+                case element::crate_id:
+                    field = &crate_id;
+                    break;
+                case element::energy:
+                    field = &energy;
+                    break;
+                case element::event_length:
+                    field = &event_length;
+                    break;
+                case element::event_time_high:
+                    field = &event_time_high;
+                    break;
+                case element::event_time_low:
+                    field = &event_time_low;
+                    break;
+                case element::finish_code:
+                    field = &finish_code;
+                    break;
+                case element::header_length:
+                    field = &header_length;
+                    break;
+                case element::slot_id:
+                    field = &slot_id;
+                    break;
+                case element::trace_length:
+                    field = &trace_length;
+                    break;
+                case element::trace_out_of_range_flag:
+                    field = &trace_out_of_range;
+                    break;
+                default:
+                    throw error(error::code::invalid_element, "Unknown data element encountered");
+            }
+            field->mask = ele.value;
+            field->shift = ele.start_bit;
+            field->index = ele.header_index;
+        }
+    }
+
+    const descriptor_list& elements;
+    const double cfd_scale;
+
+    field_desc cfd_forced_trigger;
+    field_desc cfd_fractional_time;
+    field_desc cfd_trigger_source;
+    field_desc channel_number;
+    field_desc crate_id;
+    field_desc energy;
+    field_desc event_length;
+    field_desc event_time_high;
+    field_desc event_time_low;
+    field_desc finish_code;
+    field_desc header_length;
+    field_desc slot_id;
+    field_desc trace_length;
+    field_desc trace_out_of_range;
+};
+
+/*
+ * A plan for each descriptor list. The revision and frequency are the first
+ * the descriptors apply to.
+ */
+static const decode_plan decode_plans[] = {
+    {descriptors_17562_100, 17562, 100}, {descriptors_29432_100, 29432, 100},
+    {descriptors_30474_100, 30474, 100}, {descriptors_34688_100, 34688, 100},
+    {descriptors_20466_250, 20466, 250}, {descriptors_27361_250, 27361, 250},
+    {descriptors_29432_250, 29432, 250}, {descriptors_30474_250, 30474, 250},
+    {descriptors_34688_250, 34688, 250}, {descriptors_46540_250, 46540, 250},
+    {descriptors_29432_500, 29432, 500}, {descriptors_34688_500, 34688, 500}};
+
+static const decode_plan& find_plan(const descriptor_list& elements) {
+    for (const auto& plan : decode_plans) {
+        if (&plan.elements == &elements) {
+            return plan;
+        }
+    }
+    throw error(error::code::internal_failure, "no decode plan for the element set");
+}
+
 struct header_config {
     header_config() {
         ets_offset = 0;
@@ -490,7 +721,7 @@ struct header_config {
         valid = false;
     }
 
-    void generate(uint32_t len, uint32_t rev, record& rec) {
+    void generate(uint32_t len, uint32_t rev) {
         if (rev < 30980) {
             switch (len) {
                 case header_length::header_ets:
@@ -542,7 +773,6 @@ struct header_config {
                             "unknown header length: " + std::to_string(len));
         }
         valid = true;
-        rec.header_length = len;
     }
 
     uint32_t ets_offset;
@@ -554,15 +784,512 @@ struct header_config {
     bool valid;
 };
 
-void fill_remainder(uint32_t* data, uint32_t* data_end, buffer& leftovers) {
+void fill_remainder(const uint32_t* data, const uint32_t* data_end, buffer& leftovers) {
     while (data < data_end) {
         leftovers.push_back(*data);
         data += 1;
     }
 }
 
-PIXIE_EXPORT void PIXIE_API decode_data_block(
-    uint32_t* data, size_t len, uint32_t revision, uint32_t frequency, records& recs, buffer& leftovers) {
+/**
+ * @brief The values decoded from the header words of a single event.
+ */
+struct event_header {
+    event_header()
+        : cfd_forced_trigger(false), cfd_fractional_time(0), cfd_trigger_source(0),
+          channel_number(0), crate_id(0), energy(0), event_length(0), event_time_high(0),
+          event_time_low(0), finish_code(false), header_length(0), slot_id(0), trace_length(0),
+          trace_out_of_range(false) {}
+
+    header_config config;
+    bool cfd_forced_trigger;
+    double cfd_fractional_time;
+    uint32_t cfd_trigger_source;
+    uint32_t channel_number;
+    uint32_t crate_id;
+    uint32_t energy;
+    uint32_t event_length;
+    uint32_t event_time_high;
+    uint32_t event_time_low;
+    bool finish_code;
+    uint32_t header_length;
+    uint32_t slot_id;
+    uint32_t trace_length;
+    bool trace_out_of_range;
+};
+
+/*
+ * Decode and validate the header of the event at `data`. Returns false if the
+ * event is not complete in the remaining data. Any validation errors fill the
+ * leftovers with the remaining data and throw.
+ */
+static bool decode_header(const descriptor_list& core_elements, uint32_t* data,
+                          uint32_t* data_end, size_t remaining_len, uint32_t revision,
+                          uint32_t frequency, buffer& leftovers, event_header& hdr) {
+    /*
+     * This for loops over the element tables above, which define the order in which we expect
+     * to parse the elements. This order is reflected in the switch case ordering to make it
+     * consistent with the definitions in the element descriptors. The order allows us to
+     * ensure that we fail on the first error we encounter. Subsequent steps (and case checks)
+     * depend upon having valid data. The order of header length, event length, then trace
+     * length must be maintained.
+     */
+    for (const auto& ele : core_elements) {
+        auto val = (data[ele.header_index] & ele.value) >> ele.start_bit;
+        switch (ele.type) {
+            case element::header_length:
+                hdr.config.generate(val, revision);
+                hdr.header_length = val;
+                break;
+            case element::event_length:
+                if (val == 0) {
+                    fill_remainder(data, data_end, leftovers);
+                    throw error(error::code::invalid_event_length, "bad event length: 0");
+                }
+                hdr.event_length = val;
+                if (remaining_len < val) {
+                    return false;
+                }
+                break;
+            case element::trace_length:
+                /*
+                 * The trace length is stored as the number of samples, so we need to
+                 * divide by two to when comparing with the event length, which is
+                 * provided as the number of 32-bit words.
+                 */
+                if (hdr.event_length != hdr.header_length + val / 2) {
+                    fill_remainder(data, data_end, leftovers);
+                    std::stringstream msg;
+                    msg << "event does not match header and trace: "
+                        << "crate=" << hdr.crate_id << ", slot=" << hdr.slot_id
+                        << ", chan=" << hdr.channel_number
+                        << ", event_length=" << hdr.event_length
+                        << ", header_length=" << hdr.header_length
+                        << ", trace_length=" << hdr.trace_length;
+                    throw error(error::code::invalid_event_length, msg.str());
+                }
+                hdr.trace_length = val;
+                break;
+            case element::cfd_forced_trigger_bit:
+                hdr.cfd_forced_trigger = val != 0;
+                break;
+            case element::cfd_fractional_time:
+                /*
+                 * We could treat this as not an error and just force the CFD time to be zero instead.
+                 * The downside to that would be it masks issues in the firmware. We've chosen to make it a
+                 * hard kill at this time.
+                 */
+                if (hdr.cfd_forced_trigger && val != 0) {
+                    fill_remainder(data, data_end, leftovers);
+                    throw error(error::code::invalid_cfd_time,
+                                "data corruption: cfd was forced but still recorded a time");
+                }
+                hdr.cfd_fractional_time = double(val) / cfd_multiplier(revision, frequency);
+                break;
+            case element::cfd_trigger_source_bit:
+                hdr.cfd_trigger_source = val;
+                break;
+            case element::channel_number:
+                hdr.channel_number = val;
+                break;
+            case element::crate_id:
+                hdr.crate_id = val;
+                break;
+            case element::energy:
+                hdr.energy = val;
+                break;
+            case element::event_time_high:
+                hdr.event_time_high = uint32_t(val);
+                break;
+            case element::event_time_low:
+                hdr.event_time_low = uint32_t(val);
+                break;
+            case element::finish_code:
+                hdr.finish_code = val != 0;
+                break;
+            case element::slot_id:
+                if (val < min_slot_id || val > max_slot_id) {
+                    fill_remainder(data, data_end, leftovers);
+                    throw error(error::code::invalid_slot_id,
+                                "bad slot id: " + std::to_string(val));
+                }
+                hdr.slot_id = val;
+                break;
+            case element::trace_out_of_range_flag:
+                hdr.trace_out_of_range = val != 0;
+                break;
+            default:
+                fill_remainder(data, data_end, leftovers);
+                throw error(error::code::invalid_element, "Unknown data element encountered");
+        }
+    }
+    return true;
+}
+
+/*
+ * Decode and validate the header of the event at `data` using a decode plan.
+ * The checks are made in the same order as the element descriptors so the
+ * errors match the interpreted decoder.
+ */
+static bool decode_header(const decode_plan& plan, const uint32_t* data, const uint32_t* data_end,
+                          size_t remaining_len, uint32_t revision, buffer& leftovers,
+                          event_header& hdr) {
+    auto header_length = plan.header_length.get(data);
+    hdr.config.generate(header_length, revision);
+    hdr.header_length = header_length;
+
+    auto event_length = plan.event_length.get(data);
+    if (event_length == 0) {
+        fill_remainder(data, data_end, leftovers);
+        throw error(error::code::invalid_event_length, "bad event length: 0");
+    }
+    hdr.event_length = event_length;
+    if (remaining_len < event_length) {
+        return false;
+    }
+
+    auto trace_length = plan.trace_length.get(data);
+    if (event_length != header_length + trace_length / 2) {
+        fill_remainder(data, data_end, leftovers);
+        std::stringstream msg;
+        msg << "event does not match header and trace: "
+            << "crate=" << hdr.crate_id << ", slot=" << hdr.slot_id
+            << ", chan=" << hdr.channel_number
+            << ", event_length=" << hdr.event_length
+            << ", header_length=" << hdr.header_length
+            << ", trace_length=" << hdr.trace_length;
+        throw error(error::code::invalid_event_length, msg.str());
+    }
+    hdr.trace_length = trace_length;
+
+    hdr.cfd_forced_trigger = plan.cfd_forced_trigger.get(data) != 0;
+    auto cfd_fractional_time = plan.cfd_fractional_time.get(data);
+    if (hdr.cfd_forced_trigger && cfd_fractional_time != 0) {
+        fill_remainder(data, data_end, leftovers);
+        throw error(error::code::invalid_cfd_time,
+                    "data corruption: cfd was forced but still recorded a time");
+    }
+    hdr.cfd_fractional_time = double(cfd_fractional_time) / plan.cfd_scale;
+
+    auto slot_id = plan.slot_id.get(data);
+    if (slot_id < min_slot_id || slot_id > max_slot_id) {
+        fill_remainder(data, data_end, leftovers);
+        throw error(error::code::invalid_slot_id, "bad slot id: " + std::to_string(slot_id));
+    }
+    hdr.slot_id = slot_id;
+
+    hdr.cfd_trigger_source = plan.cfd_trigger_source.get(data);
+    hdr.channel_number = plan.channel_number.get(data);
+    hdr.crate_id = plan.crate_id.get(data);
+    hdr.energy = plan.energy.get(data);
+    hdr.event_time_high = plan.event_time_high.get(data);
+    hdr.event_time_low = plan.event_time_low.get(data);
+    hdr.finish_code = plan.finish_code.get(data) != 0;
+    hdr.trace_out_of_range = plan.trace_out_of_range.get(data) != 0;
+
+    return true;
+}
+
+static bool host_little_endian() {
+    const uint32_t value = 1;
+    uint8_t first;
+    std::memcpy(&first, &value, sizeof(first));
+    return first == 1;
+}
+
+/*
+ * Unpack the trace words into 16-bit samples. The first sample is in the low
+ * half of each word. This is the memory order of the samples on a
+ * little-endian host and the words are copied as a block with the widest
+ * vector moves the host has. Other hosts split each word.
+ */
+static void unpack_trace(const uint32_t* words, size_t count, uint16_t* samples) {
+    if (host_little_endian()) {
+        std::memcpy(samples, words, count * sizeof(uint32_t));
+    } else {
+        for (size_t w = 0; w < count; ++w) {
+            *samples++ = uint16_t(words[w] & 0xFFFF);
+            *samples++ = uint16_t((words[w] >> 16) & 0xFFFF);
+        }
+    }
+}
+
+static void fill_record(record& evt, const uint32_t* data, const event_header& hdr,
+                        const uint32_t frequency) {
+    evt.cfd_forced_trigger = hdr.cfd_forced_trigger;
+    evt.cfd_trigger_source = hdr.cfd_trigger_source;
+    evt.channel_number = hdr.channel_number;
+    evt.crate_id = hdr.crate_id;
+    evt.energy = double(hdr.energy);
+    evt.event_length = hdr.event_length;
+    evt.finish_code = hdr.finish_code;
+    evt.header_length = hdr.header_length;
+    evt.slot_id = hdr.slot_id;
+    evt.trace_length = hdr.trace_length;
+    evt.trace_out_of_range = hdr.trace_out_of_range;
+
+    auto times = make_time(frequency, hdr.event_time_low, hdr.event_time_high,
+                           hdr.cfd_fractional_time, hdr.cfd_trigger_source);
+    evt.cfd_fractional_time = record::time_type(times.cfd_fractional_time);
+    evt.filter_time = record::time_type(times.filter_time);
+    evt.time = record::time_type(times.time);
+
+    if (hdr.config.ets) {
+        evt.external_time = record::time_type(
+            make_u64_double(data[hdr.config.ets_offset + 1], data[hdr.config.ets_offset]));
+    }
+
+    if (hdr.config.esums) {
+        for (unsigned int i = 0; i < num_esum_words; i++) {
+            if (i != num_esum_words - 1) {
+                evt.energy_sums.push_back(data[hdr.config.esums_offset + i]);
+            } else {
+                evt.filter_baseline =
+                    util::numerics::ieee_float(data[hdr.config.esums_offset + num_esum_words - 1]);
+            }
+        }
+    }
+
+    if (hdr.config.qdc) {
+        for (unsigned int i = 0; i < num_qdc_words; i++) {
+            evt.qdc.push_back(data[hdr.config.qdc_offset + i]);
+        }
+    }
+
+    if (evt.trace_length > 0) {
+        evt.trace.resize(2 * (evt.event_length - evt.header_length));
+        unpack_trace(&data[evt.header_length], evt.event_length - evt.header_length,
+                     evt.trace.data());
+    }
+}
+
+static void add_event(records& recs, const uint32_t* data, const event_header& hdr,
+                      const uint32_t frequency) {
+    recs.emplace_back();
+    fill_record(recs.back(), data, hdr, frequency);
+}
+
+static void add_event(record_batch& batch, const uint32_t* data, const event_header& hdr,
+                      const uint32_t frequency) {
+    auto times = make_time(frequency, hdr.event_time_low, hdr.event_time_high,
+                           hdr.cfd_fractional_time, hdr.cfd_trigger_source);
+
+    batch.crate_id.push_back(hdr.crate_id);
+    batch.slot_id.push_back(hdr.slot_id);
+    batch.channel_number.push_back(hdr.channel_number);
+    batch.header_length.push_back(hdr.header_length);
+    batch.event_length.push_back(hdr.event_length);
+    batch.trace_length.push_back(hdr.trace_length);
+    batch.cfd_trigger_source.push_back(hdr.cfd_trigger_source);
+    batch.cfd_forced_trigger.push_back(hdr.cfd_forced_trigger);
+    batch.finish_code.push_back(hdr.finish_code);
+    batch.trace_out_of_range.push_back(hdr.trace_out_of_range);
+    batch.time.push_back(times.time);
+    batch.filter_time.push_back(times.filter_time);
+    batch.cfd_fractional_time.push_back(times.cfd_fractional_time);
+    batch.energy.push_back(double(hdr.energy));
+
+    if (hdr.config.ets) {
+        batch.external_time.push_back(
+            make_u64_double(data[hdr.config.ets_offset + 1], data[hdr.config.ets_offset]));
+    } else {
+        batch.external_time.push_back(0);
+    }
+
+    if (hdr.config.esums) {
+        auto* esums = &data[hdr.config.esums_offset];
+        batch.energy_sums_offset.push_back(batch.sums.size());
+        batch.sums.insert(batch.sums.end(), esums, esums + num_esum_words - 1);
+        batch.filter_baseline.push_back(util::numerics::ieee_float(esums[num_esum_words - 1]));
+    } else {
+        batch.energy_sums_offset.push_back(record_batch::no_offset);
+        batch.filter_baseline.push_back(0);
+    }
+
+    if (hdr.config.qdc) {
+        auto* qdcs = &data[hdr.config.qdc_offset];
+        batch.qdc_offset.push_back(batch.sums.size());
+        batch.sums.insert(batch.sums.end(), qdcs, qdcs + num_qdc_words);
+    } else {
+        batch.qdc_offset.push_back(record_batch::no_offset);
+    }
+
+    batch.trace_offset.push_back(batch.traces.size());
+    if (hdr.trace_length > 0) {
+        auto offset = batch.traces.size();
+        batch.traces.resize(offset + 2 * (hdr.event_length - hdr.header_length));
+        unpack_trace(&data[hdr.header_length], hdr.event_length - hdr.header_length,
+                     &batch.traces[offset]);
+    }
+}
+
+/*
+ * Check the header at `data` is consistent without throwing. This makes the
+ * same checks as the decoders. The event length is returned in `event_length`.
+ */
+static bool valid_header(const decode_plan& plan, const uint32_t* data, uint32_t revision,
+                         uint32_t& event_length) {
+    auto hdr_length = plan.header_length.get(data);
+    switch (hdr_length) {
+        case header_length::header:
+        case header_length::header_esum:
+        case header_length::header_qdc:
+        case header_length::header_esum_qdc:
+            break;
+        case header_length::header_ets:
+        case header_length::header_esum_ets:
+        case header_length::header_qdc_ets:
+        case header_length::header_esum_qdc_ets:
+            if (revision < 30980) {
+                return false;
+            }
+            break;
+        default:
+            return false;
+    }
+    event_length = plan.event_length.get(data);
+    if (event_length == 0 || event_length != hdr_length + plan.trace_length.get(data) / 2) {
+        return false;
+    }
+    if (plan.cfd_forced_trigger.get(data) != 0 && plan.cfd_fractional_time.get(data) != 0) {
+        return false;
+    }
+    auto slot_id = plan.slot_id.get(data);
+    return slot_id >= min_slot_id && slot_id <= max_slot_id;
+}
+
+/*
+ * The fewest and the most events of the same length that are decoded as a
+ * uniform run. Longer runs are split so the event words stay in the cache
+ * while each column is filled.
+ */
+static constexpr size_t min_uniform_run = 8;
+static constexpr size_t max_uniform_run = 128;
+
+/*
+ * Count the complete events from `data` with valid headers and the same
+ * header and event length as the first event.
+ */
+static size_t uniform_run_length(const decode_plan& plan, const uint32_t* data,
+                                 size_t remaining_len, uint32_t revision) {
+    uint32_t event_length;
+    if (remaining_len < min_words || !valid_header(plan, data, revision, event_length) ||
+        event_length > remaining_len) {
+        return 0;
+    }
+    const auto hdr_length = plan.header_length.get(data);
+    const auto max_run = std::min(remaining_len / event_length, max_uniform_run);
+    size_t run = 1;
+    for (auto* evt = data + event_length; run < max_run; evt += event_length, ++run) {
+        uint32_t length;
+        if (!valid_header(plan, evt, revision, length) || length != event_length ||
+            plan.header_length.get(evt) != hdr_length) {
+            break;
+        }
+    }
+    return run;
+}
+
+/*
+ * Add a uniform run of events to the batch. The events have the same layout
+ * so each column is filled for all the events in a single strided pass.
+ */
+static void add_uniform_run(record_batch& batch, const decode_plan& plan, const uint32_t* data,
+                            size_t run, uint32_t revision, uint32_t frequency) {
+    const auto hdr_length = plan.header_length.get(data);
+    const auto event_length = plan.event_length.get(data);
+    const auto trace_length = plan.trace_length.get(data);
+    header_config config;
+    config.generate(hdr_length, revision);
+
+    const auto first = batch.size();
+    const auto last = first + run;
+
+    auto extract = [data, event_length, first, last](auto& column, const field_desc& field) {
+        column.resize(last);
+        auto* evt = data;
+        for (size_t e = first; e < last; ++e, evt += event_length) {
+            column[e] = typename std::decay<decltype(column)>::type::value_type(field.get(evt));
+        }
+    };
+    extract(batch.crate_id, plan.crate_id);
+    extract(batch.slot_id, plan.slot_id);
+    extract(batch.channel_number, plan.channel_number);
+    extract(batch.cfd_trigger_source, plan.cfd_trigger_source);
+    extract(batch.cfd_forced_trigger, plan.cfd_forced_trigger);
+    extract(batch.finish_code, plan.finish_code);
+    extract(batch.trace_out_of_range, plan.trace_out_of_range);
+    extract(batch.energy, plan.energy);
+    batch.header_length.resize(last, hdr_length);
+    batch.event_length.resize(last, event_length);
+    batch.trace_length.resize(last, trace_length);
+
+    batch.time.resize(last);
+    batch.filter_time.resize(last);
+    batch.cfd_fractional_time.resize(last);
+    auto* evt = data;
+    for (size_t e = first; e < last; ++e, evt += event_length) {
+        auto times = make_time(frequency, plan.event_time_low.get(evt),
+                               plan.event_time_high.get(evt),
+                               double(plan.cfd_fractional_time.get(evt)) / plan.cfd_scale,
+                               batch.cfd_trigger_source[e]);
+        batch.time[e] = times.time;
+        batch.filter_time[e] = times.filter_time;
+        batch.cfd_fractional_time[e] = times.cfd_fractional_time;
+    }
+
+    batch.external_time.resize(last, 0);
+    if (config.ets) {
+        evt = data;
+        for (size_t e = first; e < last; ++e, evt += event_length) {
+            batch.external_time[e] =
+                make_u64_double(evt[config.ets_offset + 1], evt[config.ets_offset]);
+        }
+    }
+
+    const auto esum_words = config.esums ? num_esum_words - 1 : 0;
+    const auto qdc_words = config.qdc ? num_qdc_words : 0;
+    auto sums_offset = batch.sums.size();
+    batch.sums.resize(sums_offset + run * (esum_words + qdc_words));
+    batch.energy_sums_offset.resize(last, record_batch::no_offset);
+    batch.qdc_offset.resize(last, record_batch::no_offset);
+    batch.filter_baseline.resize(last, 0);
+    if (config.esums || config.qdc) {
+        evt = data;
+        for (size_t e = first; e < last; ++e, evt += event_length) {
+            if (config.esums) {
+                auto* esums = &evt[config.esums_offset];
+                batch.energy_sums_offset[e] = sums_offset;
+                std::memcpy(&batch.sums[sums_offset], esums, esum_words * sizeof(uint32_t));
+                sums_offset += esum_words;
+                batch.filter_baseline[e] = util::numerics::ieee_float(esums[num_esum_words - 1]);
+            }
+            if (config.qdc) {
+                batch.qdc_offset[e] = sums_offset;
+                std::memcpy(&batch.sums[sums_offset], &evt[config.qdc_offset],
+                            qdc_words * sizeof(uint32_t));
+                sums_offset += qdc_words;
+            }
+        }
+    }
+
+    const auto trace_words = trace_length > 0 ? event_length - hdr_length : 0;
+    auto trace_offset = batch.traces.size();
+    batch.traces.resize(trace_offset + run * 2 * trace_words);
+    batch.trace_offset.resize(last);
+    evt = data;
+    for (size_t e = first; e < last; ++e, evt += event_length) {
+        batch.trace_offset[e] = trace_offset;
+        if (trace_words > 0) {
+            unpack_trace(&evt[hdr_length], trace_words, &batch.traces[trace_offset]);
+            trace_offset += 2 * trace_words;
+        }
+    }
+}
+
+template<typename Events>
+static void decode_block(uint32_t* data, size_t len, uint32_t revision, uint32_t frequency,
+                         Events& events, buffer& leftovers, header_decoder decoder) {
     if (data == nullptr) {
         throw error(error::code::invalid_buffer, "buffer pointed to an invalid location");
     }
@@ -574,12 +1301,13 @@ PIXIE_EXPORT void PIXIE_API decode_data_block(
                     "minimum supported firmware rev is " + std::to_string(min_rev));
     }
 
-    recs.clear();
+    events.clear();
     leftovers.clear();
     auto* data_start = data;
     auto* data_end = data_start + len;
     auto remaining_len = len;
     auto& core_elements = find_element_set(revision, frequency);
+    auto& plan = find_plan(core_elements);
 
     /*
      * We check to see if the data buffer meets the minimum size requirement for a complete record.
@@ -591,164 +1319,411 @@ PIXIE_EXPORT void PIXIE_API decode_data_block(
      */
     bool have_record = remaining_len >= min_words;
 
+    /*
+     * Events not checked for a uniform run because a shorter run was found.
+     */
+    size_t run_skip = 0;
+
     while (data < data_end) {
         if (!have_record) {
             fill_remainder(data, data_end, leftovers);
             break;
         }
 
-        record evt;
-        uint32_t event_time_low = 0;
-        uint32_t event_time_high = 0;
-        double cfd_fractional_time = 0;
-        header_config header_config;
-
-        /*
-         * This for loops over the element tables above, which define the order in which we expect
-         * to parse the elements. This order is reflected in the switch case ordering to make it
-         * consistent with the definitions in the element descriptors. The order allows us to
-         * ensure that we fail on the first error we encounter. Subsequent steps (and case checks)
-         * depend upon having valid data. The order of header length, event length, then trace
-         * length must be maintained.
-         */
-        for (const auto& ele : core_elements) {
-            if (!have_record) {
-                break;
-            }
-            auto val = (data[ele.header_index] & ele.value) >> ele.start_bit;
-            switch (ele.type) {
-                case element::header_length:
-                    header_config.generate(val, revision, evt);
-                    break;
-                case element::event_length:
-                    if (val == 0) {
-                        fill_remainder(data, data_end, leftovers);
-                        throw error(error::code::invalid_event_length, "bad event length: 0");
-                    }
-                    if (remaining_len < val) {
-                        have_record = false;
-                    }
-                    evt.event_length = val;
-                    break;
-                case element::trace_length:
-                    /*
-                     * The trace length is stored as the number of samples, so we need to
-                     * divide by two to when comparing with the event length, which is
-                     * provided as the number of 32-bit words.
-                     */
-                    if (evt.event_length != evt.header_length + val / 2) {
-                        fill_remainder(data, data_end, leftovers);
-                        std::stringstream msg;
-                        msg << "event does not match header and trace: "
-                            << "crate=" << evt.crate_id << ", slot=" << evt.slot_id
-                            << ", chan=" << evt.channel_number
-                            << ", event_length=" << evt.event_length
-                            << ", header_length=" << evt.header_length
-                            << ", trace_length=" << evt.trace_length;
-                        throw error(error::code::invalid_event_length, msg.str());
-                    }
-                    evt.trace_length = val;
-                    break;
-                case element::cfd_forced_trigger_bit:
-                    evt.cfd_forced_trigger = val != 0;
-                    break;
-                case element::cfd_fractional_time:
-                    /*
-                     * We could treat this as not an error and just force the CFD time to be zero instead.
-                     * The downside to that would be it masks issues in the firmware. We've chosen to make it a
-                     * hard kill at this time.
-                     */
-                    if (evt.cfd_forced_trigger && val != 0) {
-                        fill_remainder(data, data_end, leftovers);
-                        throw error(error::code::invalid_cfd_time,
-                                    "data corruption: cfd was forced but still recorded a time");
+        if constexpr (std::is_same<Events, record_batch>::value) {
+            if (decoder == header_decoder::plan) {
+                if (run_skip == 0) {
+                    auto run = uniform_run_length(plan, data, remaining_len, revision);
+                    if (run >= min_uniform_run) {
+                        add_uniform_run(events, plan, data, run, revision, frequency);
+                        auto words = run * plan.event_length.get(data);
+                        data += words;
+                        remaining_len -= words;
+                        continue;
                     }
-                    cfd_fractional_time = double(val) / cfd_multiplier(revision, frequency);
-                    break;
-                case element::cfd_trigger_source_bit:
-                    evt.cfd_trigger_source = val;
-                    break;
-                case element::channel_number:
-                    evt.channel_number = val;
-                    break;
-                case element::crate_id:
-                    evt.crate_id = val;
-                    break;
-                case element::energy:
-                    evt.energy = double(val);
-                    break;
-                case element::event_time_high:
-                    event_time_high = uint32_t(val);
-                    break;
-                case element::event_time_low:
-                    event_time_low = uint32_t(val);
-                    break;
-                case element::finish_code:
-                    evt.finish_code = val != 0;
-                    break;
-                case element::slot_id:
-                    if (val < min_slot_id || val > max_slot_id) {
-                        fill_remainder(data, data_end, leftovers);
-                        throw error(error::code::invalid_slot_id,
-                                    "bad slot id: " + std::to_string(val));
-                    }
-                    evt.slot_id = val;
-                    break;
-                case element::trace_out_of_range_flag:
-                    evt.trace_out_of_range = val != 0;
-                    break;
-                default:
-                    fill_remainder(data, data_end, leftovers);
-                    throw error(error::code::invalid_element, "Unknown data element encountered");
+                    run_skip = run > 0 ? run - 1 : 0;
+                } else {
+                    --run_skip;
+                }
             }
         }
 
+        event_header hdr;
+        if (decoder == header_decoder::plan) {
+            have_record =
+                decode_header(plan, data, data_end, remaining_len, revision, leftovers, hdr);
+        } else {
+            have_record = decode_header(core_elements, data, data_end, remaining_len, revision,
+                                        frequency, leftovers, hdr);
+        }
         if (!have_record) {
             continue;
         }
 
-        make_time(evt, frequency, event_time_low, event_time_high, cfd_fractional_time);
+        add_event(events, data, hdr, frequency);
 
-        if (header_config.ets) {
-            evt.external_time = record::time_type(make_u64_double(
-                data[header_config.ets_offset + 1], data[header_config.ets_offset]));
-        }
+        data += hdr.event_length;
+        remaining_len -= hdr.event_length;
+    }
+}
 
-        if (header_config.esums) {
-            for (unsigned int i = 0; i < num_esum_words; i++) {
-                if (i != num_esum_words - 1) {
-                    evt.energy_sums.push_back(data[header_config.esums_offset + i]);
-                } else {
-                    evt.filter_baseline =
-                        util::numerics::ieee_float(data[header_config.esums_offset + num_esum_words - 1]);
-                }
+PIXIE_EXPORT size_t PIXIE_API find_record_start(const uint32_t* data, size_t len,
+                                                uint32_t revision, uint32_t frequency,
+                                                size_t chain) {
+    if (data == nullptr) {
+        throw error(error::code::invalid_buffer, "buffer pointed to an invalid location");
+    }
+    if (revision < min_rev) {
+        throw error(error::code::invalid_revision,
+                    "minimum supported firmware rev is " + std::to_string(min_rev));
+    }
+    auto& plan = find_plan(find_element_set(revision, frequency));
+    for (size_t start = 0; start + min_words <= len; ++start) {
+        /*
+         * A start is accepted if the header and the headers of the records
+         * that follow it are consistent or the records reach the end of the
+         * data.
+         */
+        size_t offset = start;
+        size_t checked = 0;
+        bool valid = true;
+        while (valid && checked <= chain && offset + min_words <= len) {
+            uint32_t event_length = 0;
+            valid = valid_header(plan, &data[offset], revision, event_length);
+            if (valid) {
+                offset += event_length;
             }
+            ++checked;
         }
-
-        if (header_config.qdc) {
-            for (unsigned int i = 0; i < num_qdc_words; i++) {
-                evt.qdc.push_back(data[header_config.qdc_offset + i]);
-            }
+        if (valid) {
+            return start;
         }
+    }
+    return len;
+}
 
-        if (evt.trace_length > 0) {
-            for (uint32_t w = evt.header_length; w < evt.event_length; ++w) {
-                evt.trace.push_back(data[w] & 0xFFFF);
-                evt.trace.push_back((data[w] >> 16) & 0xFFFF);
-            }
-        }
+record_view::record_view() : words(nullptr), plan(nullptr), revision(0), frequency(0) {}
+
+record_view::record_view(const uint32_t* words_, const decode_plan& plan_, uint32_t revision_,
+                         uint32_t frequency_)
+    : words(words_), plan(&plan_), revision(revision_), frequency(frequency_) {}
+
+uint32_t record_view::crate_id() const {
+    return plan->crate_id.get(words);
+}
+
+uint32_t record_view::slot_id() const {
+    return plan->slot_id.get(words);
+}
+
+uint32_t record_view::channel_number() const {
+    return plan->channel_number.get(words);
+}
+
+uint32_t record_view::header_length() const {
+    return plan->header_length.get(words);
+}
+
+uint32_t record_view::event_length() const {
+    return plan->event_length.get(words);
+}
+
+uint32_t record_view::trace_length() const {
+    return plan->trace_length.get(words);
+}
+
+uint32_t record_view::cfd_trigger_source() const {
+    return plan->cfd_trigger_source.get(words);
+}
+
+bool record_view::cfd_forced_trigger() const {
+    return plan->cfd_forced_trigger.get(words) != 0;
+}
+
+bool record_view::finish_code() const {
+    return plan->finish_code.get(words) != 0;
+}
+
+bool record_view::trace_out_of_range() const {
+    return plan->trace_out_of_range.get(words) != 0;
+}
+
+double record_view::energy() const {
+    return double(plan->energy.get(words));
+}
+
+double record_view::time() const {
+    return make_time(frequency, plan->event_time_low.get(words),
+                     plan->event_time_high.get(words),
+                     double(plan->cfd_fractional_time.get(words)) / plan->cfd_scale,
+                     cfd_trigger_source())
+        .time;
+}
 
-        data += evt.event_length;
-        remaining_len -= evt.event_length;
-        recs.push_back(evt);
+double record_view::filter_time() const {
+    return make_time(frequency, plan->event_time_low.get(words),
+                     plan->event_time_high.get(words), 0, 0)
+        .filter_time;
+}
+
+double record_view::cfd_fractional_time() const {
+    return make_time(frequency, 0, 0,
+                     double(plan->cfd_fractional_time.get(words)) / plan->cfd_scale,
+                     cfd_trigger_source())
+        .cfd_fractional_time;
+}
+
+double record_view::external_time() const {
+    auto len = header_length();
+    switch (len) {
+        case header_length::header_ets:
+        case header_length::header_esum_ets:
+        case header_length::header_qdc_ets:
+        case header_length::header_esum_qdc_ets:
+            return make_u64_double(words[len - num_ext_ts_words + 1],
+                                   words[len - num_ext_ts_words]);
+        default:
+            return 0;
+    }
+}
+
+double record_view::filter_baseline() const {
+    auto* esums = energy_sums();
+    if (esums == nullptr) {
+        return 0;
+    }
+    return util::numerics::ieee_float(esums[num_esum_words - 1]);
+}
+
+/*
+ * The energy sums follow the 4 core header words and the QDCs follow the
+ * energy sums. The external time stamp is always last.
+ */
+const uint32_t* record_view::energy_sums() const {
+    switch (header_length()) {
+        case header_length::header_esum:
+        case header_length::header_esum_ets:
+        case header_length::header_esum_qdc:
+        case header_length::header_esum_qdc_ets:
+            return &words[header_length::header];
+        default:
+            return nullptr;
+    }
+}
+
+const uint32_t* record_view::qdc() const {
+    switch (header_length()) {
+        case header_length::header_qdc:
+        case header_length::header_qdc_ets:
+            return &words[header_length::header];
+        case header_length::header_esum_qdc:
+        case header_length::header_esum_qdc_ets:
+            return &words[header_length::header + num_esum_words];
+        default:
+            return nullptr;
     }
 }
 
+trace_span record_view::trace() const {
+    if (trace_length() == 0) {
+        return {};
+    }
+    auto len = header_length();
+    return {&words[len], 2 * size_t(event_length() - len)};
+}
+
+void record_view::get(record& rec) const {
+    event_header hdr;
+    buffer unused;
+    decode_header(*plan, words, words, event_length(), revision, unused, hdr);
+    rec = record();
+    fill_record(rec, words, hdr, frequency);
+}
+
+PIXIE_EXPORT bool PIXIE_API view_record(const uint32_t* data, size_t len, uint32_t revision,
+                                        uint32_t frequency, record_view& view) {
+    if (data == nullptr) {
+        throw error(error::code::invalid_buffer, "buffer pointed to an invalid location");
+    }
+    if (revision < min_rev) {
+        throw error(error::code::invalid_revision,
+                    "minimum supported firmware rev is " + std::to_string(min_rev));
+    }
+    auto& plan = find_plan(find_element_set(revision, frequency));
+    if (len < min_words) {
+        return false;
+    }
+    uint32_t event_length;
+    if (!valid_header(plan, data, revision, event_length)) {
+        /*
+         * Decode the header to throw the decoder's error. The event may not
+         * be complete, which is checked before some of the errors.
+         */
+        event_header hdr;
+        buffer unused;
+        decode_header(plan, data, data, len, revision, unused, hdr);
+        return false;
+    }
+    if (event_length > len) {
+        return false;
+    }
+    view = record_view(data, plan, revision, frequency);
+    return true;
+}
+
+PIXIE_EXPORT void PIXIE_API decode_data_block(
+    uint32_t* data, size_t len, uint32_t revision, uint32_t frequency, records& recs, buffer& leftovers,
+    header_decoder decoder) {
+    decode_block(data, len, revision, frequency, recs, leftovers, decoder);
+}
+
 PIXIE_EXPORT void PIXIE_API decode_data_block(
     buffer data, uint32_t revision, uint32_t frequency, records& recs, buffer& leftovers) {
     decode_data_block(data.data(), data.size(), revision, frequency, recs, leftovers);
 }
 
+PIXIE_EXPORT void PIXIE_API decode_data_block(uint32_t* data, size_t len, uint32_t revision,
+                                              uint32_t frequency, record_batch& batch,
+                                              buffer& leftovers, header_decoder decoder) {
+    decode_block(data, len, revision, frequency, batch, leftovers, decoder);
+}
+
+PIXIE_EXPORT void PIXIE_API encode_record(const record& rec, uint32_t revision,
+                                          uint32_t frequency, buffer& data) {
+    if (revision < min_rev) {
+        throw error(error::code::invalid_revision,
+                    "minimum supported firmware rev is " + std::to_string(min_rev));
+    }
+    const auto& elements = find_element_set(revision, frequency);
+    header_config config;
+    config.generate(rec.header_length, revision);
+    if (rec.slot_id < min_slot_id || rec.slot_id > max_slot_id) {
+        throw error(error::code::invalid_slot_id, "bad slot id: " + std::to_string(rec.slot_id));
+    }
+    if (rec.trace.size() % 2 != 0) {
+        throw error(error::code::invalid_value,
+                    "trace length is not even: " + std::to_string(rec.trace.size()));
+    }
+    if (config.esums && rec.energy_sums.size() != num_esum_words - 1) {
+        throw error(error::code::invalid_value,
+                    "energy sums size: " + std::to_string(rec.energy_sums.size()));
+    }
+    if (config.qdc && rec.qdc.size() != num_qdc_words) {
+        throw error(error::code::invalid_value, "QDC sums size: " + std::to_string(rec.qdc.size()));
+    }
+
+    /*
+     * Invert `make_time`.
+     */
+    double filter_conv;
+    double cfd_time;
+    switch (frequency) {
+        case 250:
+            filter_conv = 8e-9;
+            cfd_time = rec.cfd_fractional_time.count() / 4e-9 + double(rec.cfd_trigger_source);
+            break;
+        case 500:
+            filter_conv = 10e-9;
+            cfd_time =
+                rec.cfd_fractional_time.count() / 2e-9 - double(rec.cfd_trigger_source) + 1;
+            break;
+        default:
+            filter_conv = 10e-9;
+            cfd_time = rec.cfd_fractional_time.count() / 10e-9;
+            break;
+    }
+    auto ticks = uint64_t(std::llround(rec.filter_time.count() / filter_conv));
+    uint32_t cfd = 0;
+    if (!rec.cfd_forced_trigger) {
+        cfd = uint32_t(std::llround(cfd_time * cfd_multiplier(revision, frequency)));
+    }
+
+    const auto trace_words = rec.trace.size() / 2;
+    const auto event_length = rec.header_length + uint32_t(trace_words);
+    const auto start = data.size();
+    data.resize(start + event_length, 0);
+    auto* words = &data[start];
+
+    for (const auto& ele : elements) {
+        uint32_t val;
+        switch (ele.type) {
+            case element::cfd_forced_trigger_bit:
+                val = rec.cfd_forced_trigger ? 1 : 0;
+                break;
+            case element::cfd_fractional_time:
+                val = cfd;
+                break;
+            case element::cfd_trigger_source_bit:
+                val = rec.cfd_trigger_source;
+                break;
+            case element::channel_number:
+                val = rec.channel_number;
+                break;
+            case element::crate_id:
+                val = rec.crate_id;
+                break;
+            case element::energy:
+                val = uint32_t(rec.energy);
+                break;
+            case element::event_length:
+                val = event_length;
+                break;
+            case element::event_time_high:
+                val = uint32_t(ticks >> 32);
+                break;
+            case element::event_time_low:
+                val = uint32_t(ticks);
+                break;
+            case element::finish_code:
+                val = rec.finish_code ? 1 : 0;
+                break;
+            case element::header_length:
+                val = rec.header_length;
+                break;
+            case element::slot_id:
+                val = rec.slot_id;
+                break;
+            case element::trace_length:
+                val = uint32_t(rec.trace.size());
+                break;
+            case element::trace_out_of_range_flag:
+                val = rec.trace_out_of_range ? 1 : 0;
+                break;
+            default:
+                throw error(error::code::invalid_element, "Unknown data element encountered");
+        }
+        words[ele.header_index] |= (val << ele.start_bit) & ele.value;
+    }
+
+    if (config.ets) {
+        auto ets = uint64_t(rec.external_time.count());
+        words[config.ets_offset] = uint32_t(ets);
+        words[config.ets_offset + 1] = uint32_t(ets >> 32);
+    }
+    if (config.esums) {
+        for (uint32_t i = 0; i < num_esum_words - 1; ++i) {
+            words[config.esums_offset + i] = rec.energy_sums[i];
+        }
+        words[config.esums_offset + num_esum_words - 1] =
+            util::numerics::ieee_float(rec.filter_baseline);
+    }
+    if (config.qdc) {
+        for (uint32_t i = 0; i < num_qdc_words; ++i) {
+            words[config.qdc_offset + i] = rec.qdc[i];
+        }
+    }
+    if (trace_words > 0) {
+        auto* trace = &words[rec.header_length];
+        if (host_little_endian()) {
+            std::memcpy(trace, rec.trace.data(), trace_words * sizeof(uint32_t));
+        } else {
+            for (size_t w = 0; w < trace_words; ++w) {
+                trace[w] = uint32_t(rec.trace[2 * w]) | (uint32_t(rec.trace[2 * w + 1]) << 16);
+            }
+        }
+    }
+}
+
 }  // namespace list_mode
 }  // namespace data
 }  // namespace pixie
@@ -0,0 +1,261 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+
+/*
+ * Copyright 2021 XIA LLC, All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** @file list_mode_merge.cpp
+ * @brief Implements a time ordered merge of list-mode data streams.
+ */
+
+#include <algorithm>
+
+#include <pixie/error.hpp>
+
+#include <pixie/data/list_mode_merge.hpp>
+
+namespace xia {
+namespace pixie {
+namespace data {
+namespace list_mode {
+
+/*
+ * The heaps hold the earliest event at the top. The record's `operator>` is
+ * not a strict ordering so it cannot be used.
+ */
+static bool later(const record& a, const record& b) {
+    return b < a;
+}
+
+merger::stream::stream(uint32_t revision_, uint32_t frequency_)
+    : revision(revision_), frequency(frequency_), latest(0), active(clock::now()), seen(false),
+      finished(false) {}
+
+merger::merger(record::time_type reorder_window_, size_t max_events_, size_t idle_msecs_)
+    : reorder_window(reorder_window_), max_events(max_events_), idle_msecs(idle_msecs_),
+      events(0), released_time(0), released(false), late_events(0), forced_events(0) {
+    if (max_events == 0) {
+        throw error(error::code::invalid_value, "list-mode merge: max events cannot be 0");
+    }
+}
+
+size_t merger::add_stream(uint32_t revision, uint32_t frequency) {
+    streams_.emplace_back(revision, frequency);
+    return streams_.size() - 1;
+}
+
+merger::stream& merger::get(size_t strm) {
+    if (strm >= streams_.size()) {
+        throw error(error::code::invalid_value,
+                    "list-mode merge: invalid stream: " + std::to_string(strm));
+    }
+    auto& s = streams_[strm];
+    if (s.finished) {
+        throw error(error::code::invalid_value,
+                    "list-mode merge: stream finished: " + std::to_string(strm));
+    }
+    return s;
+}
+
+const buffer& merger::leftovers(size_t strm) const {
+    if (strm >= streams_.size()) {
+        throw error(error::code::invalid_value,
+                    "list-mode merge: invalid stream: " + std::to_string(strm));
+    }
+    return streams_[strm].leftovers;
+}
+
+void merger::add(stream& strm, record& rec) {
+    if (released && rec.time < released_time) {
+        ++late_events;
+    }
+    if (!strm.seen || strm.latest < rec.time) {
+        strm.latest = rec.time;
+        strm.seen = true;
+    }
+    strm.heap.push_back(std::move(rec));
+    std::push_heap(strm.heap.begin(), strm.heap.end(), later);
+    ++events;
+}
+
+void merger::push(size_t strm, const uint32_t* data, size_t len) {
+    auto& s = get(strm);
+    if (len == 0) {
+        return;
+    }
+    /*
+     * The decoder does not write to the data. A partial event from the last
+     * push is joined with the data in the work buffer.
+     */
+    uint32_t* words = const_cast<uint32_t*>(data);
+    if (!s.leftovers.empty()) {
+        work.clear();
+        work.reserve(s.leftovers.size() + len);
+        work.insert(work.end(), s.leftovers.begin(), s.leftovers.end());
+        work.insert(work.end(), data, data + len);
+        words = work.data();
+        len = work.size();
+    }
+    try {
+        decode_data_block(words, len, s.revision, s.frequency, decoded, s.leftovers);
+    } catch (...) {
+        /*
+         * Keep the events decoded before the bad word and drop the rest of
+         * the data so the next push starts clean.
+         */
+        s.leftovers.clear();
+        push(strm, decoded);
+        throw;
+    }
+    push(strm, decoded);
+}
+
+void merger::push(size_t strm, records& recs) {
+    auto& s = get(strm);
+    if (recs.empty()) {
+        return;
+    }
+    s.active = clock::now();
+    s.heap.reserve(s.heap.size() + recs.size());
+    for (auto& rec : recs) {
+        add(s, rec);
+    }
+    recs.clear();
+}
+
+void merger::finish(size_t strm) {
+    get(strm).finished = true;
+}
+
+void merger::watermark(size_t strm, record::time_type time) {
+    auto& s = get(strm);
+    if (!s.seen || s.latest < time) {
+        s.latest = time;
+        s.seen = true;
+    }
+    s.active = clock::now();
+}
+
+size_t merger::release(records& out, bool all) {
+    /*
+     * The horizon is the earliest of the latest event times of the active
+     * streams. An active stream with no events yet holds the release. A
+     * stream that is idle is not active.
+     */
+    const auto now = clock::now();
+    const auto idle = std::chrono::milliseconds(idle_msecs);
+    bool hold = false;
+    bool active = false;
+    record::time_type horizon(0);
+    for (auto& s : streams_) {
+        if (s.finished || (idle_msecs != 0 && now - s.active >= idle)) {
+            continue;
+        }
+        if (!s.seen) {
+            hold = true;
+            break;
+        }
+        if (!active || s.latest < horizon) {
+            horizon = s.latest;
+        }
+        active = true;
+    }
+    if (!active && !hold) {
+        all = true;
+    }
+    const auto limit = horizon - reorder_window;
+
+    /*
+     * A k-way merge of the streams using a heap of the stream indices
+     * ordered by the earliest event in each stream.
+     */
+    auto earlier_stream = [this](size_t a, size_t b) {
+        return later(streams_[a].heap.front(), streams_[b].heap.front());
+    };
+    std::vector<size_t> order;
+    order.reserve(streams_.size());
+    for (size_t s = 0; s < streams_.size(); ++s) {
+        if (!streams_[s].heap.empty()) {
+            order.push_back(s);
+        }
+    }
+    std::make_heap(order.begin(), order.end(), earlier_stream);
+
+    size_t count = 0;
+    while (!order.empty()) {
+        auto& s = streams_[order.front()];
+        auto& next = s.heap.front();
+        bool ready = all || (!hold && !(limit < next.time));
+        if (!ready) {
+            if (events <= max_events) {
+                break;
+            }
+            ++forced_events;
+        }
+        std::pop_heap(order.begin(), order.end(), earlier_stream);
+        std::pop_heap(s.heap.begin(), s.heap.end(), later);
+        if (!released || released_time < s.heap.back().time) {
+            released_time = s.heap.back().time;
+            released = true;
+        }
+        out.push_back(std::move(s.heap.back()));
+        s.heap.pop_back();
+        --events;
+        ++count;
+        if (s.heap.empty()) {
+            order.pop_back();
+        } else {
+            std::push_heap(order.begin(), order.end(), earlier_stream);
+        }
+    }
+    return count;
+}
+
+size_t merger::pull(records& out) {
+    return release(out, false);
+}
+
+size_t merger::flush(records& out) {
+    return release(out, true);
+}
+
+coincidence_grouper::coincidence_grouper(record::time_type window_) : window(window_) {}
+
+size_t coincidence_grouper::push(records& recs, groups& out) {
+    size_t count = 0;
+    for (auto& rec : recs) {
+        if (!current.empty() && window < rec.time - current.front().time) {
+            out.push_back(std::move(current));
+            current.clear();
+            ++count;
+        }
+        current.push_back(std::move(rec));
+    }
+    recs.clear();
+    return count;
+}
+
+size_t coincidence_grouper::flush(groups& out) {
+    if (current.empty()) {
+        return 0;
+    }
+    out.push_back(std::move(current));
+    current.clear();
+    return 1;
+}
+}  // namespace list_mode
+}  // namespace data
+}  // namespace pixie
+}  // namespace xia
@@ -0,0 +1,236 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+
+/*
+ * Copyright 2021 XIA LLC, All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** @file list_mode_parallel.cpp
+ * @brief Implements functions to decode list-mode data using multiple threads.
+ */
+
+#include <algorithm>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <iterator>
+#include <thread>
+
+#include <pixie/error.hpp>
+#include <pixie/utils/thread.hpp>
+
+#include <pixie/data/list_mode_parallel.hpp>
+
+namespace xia {
+namespace pixie {
+namespace data {
+namespace list_mode {
+
+/*
+ * The words read from a file for each thread when a chunk size is not
+ * provided.
+ */
+static constexpr size_t default_thread_chunk_words = 1024 * 1024;
+
+/*
+ * The period in msecs the workers are polled for completion.
+ */
+static constexpr size_t worker_poll_period = 1;
+
+/*
+ * The result of decoding a range of a block.
+ */
+struct range_result {
+    size_t start;
+    size_t end;
+    records recs;
+    buffer leftovers;
+    std::exception_ptr error;
+
+    range_result() : start(0), end(0) {}
+};
+
+using range_results = std::vector<range_result>;
+
+static size_t thread_count(size_t threads) {
+    if (threads == 0) {
+        threads = std::thread::hardware_concurrency();
+    }
+    return std::max(threads, size_t(1));
+}
+
+static void append(records& to, records& from) {
+    to.insert(to.end(), std::make_move_iterator(from.begin()),
+              std::make_move_iterator(from.end()));
+}
+
+/*
+ * Run the function for each range on a worker and wait for them to finish.
+ * The function must handle its errors.
+ */
+static void run_ranges(range_results& ranges, const std::function<void(range_result&)>& func) {
+    util::thread::workers workers;
+    workers.reserve(ranges.size());
+    for (auto& range : ranges) {
+        workers.emplace_back([&range, &func]() { func(range); });
+    }
+    for (auto& w : workers) {
+        w.start();
+    }
+    util::thread::wait_until_finished(workers, worker_poll_period);
+}
+
+PIXIE_EXPORT void PIXIE_API decode_data_block_parallel(uint32_t* data, size_t len,
+                                                       uint32_t revision, uint32_t frequency,
+                                                       records& recs, buffer& leftovers,
+                                                       size_t threads) {
+    threads = std::min(thread_count(threads), len / min_parallel_range_words);
+    if (threads <= 1) {
+        decode_data_block(data, len, revision, frequency, recs, leftovers);
+        return;
+    }
+
+    /*
+     * Check the arguments in this thread so the errors match the serial
+     * decoder.
+     */
+    find_record_start(data, 0, revision, frequency);
+
+    recs.clear();
+    leftovers.clear();
+
+    /*
+     * Find the first record boundary in each range. The first range starts at
+     * the start of the block.
+     */
+    range_results ranges(threads);
+    const auto range_words = len / threads;
+    for (size_t r = 0; r < threads; ++r) {
+        ranges[r].start = r * range_words;
+    }
+    run_ranges(ranges, [data, len, revision, frequency](range_result& range) {
+        if (range.start != 0) {
+            try {
+                range.start = range.start +
+                    find_record_start(&data[range.start], len - range.start, revision, frequency);
+            } catch (...) {
+                range.error = std::current_exception();
+            }
+        }
+    });
+    for (size_t r = 0; r < threads; ++r) {
+        if (ranges[r].error) {
+            std::rethrow_exception(ranges[r].error);
+        }
+        if (r > 0) {
+            ranges[r].start = std::max(ranges[r].start, ranges[r - 1].start);
+            ranges[r - 1].end = ranges[r].start;
+        }
+    }
+    ranges.back().end = len;
+
+    run_ranges(ranges, [data, revision, frequency](range_result& range) {
+        if (range.end > range.start) {
+            try {
+                decode_data_block(&data[range.start], range.end - range.start, revision,
+                                  frequency, range.recs, range.leftovers);
+            } catch (...) {
+                range.error = std::current_exception();
+            }
+        }
+    });
+
+    /*
+     * Merge the ranges in order. A range that has leftovers or an error did
+     * not end on the next range's boundary or contains bad data. The serial
+     * decoder is used from the start of that range so the results match.
+     */
+    size_t total = 0;
+    for (auto& range : ranges) {
+        total += range.recs.size();
+    }
+    recs.reserve(total);
+    for (size_t r = 0; r < threads; ++r) {
+        auto& range = ranges[r];
+        bool last = range.end == len;
+        if (range.start == range.end) {
+            continue;
+        }
+        if (last || (!range.error && range.leftovers.empty())) {
+            append(recs, range.recs);
+            if (last) {
+                leftovers = std::move(range.leftovers);
+                if (range.error) {
+                    std::rethrow_exception(range.error);
+                }
+            }
+            continue;
+        }
+        records tail;
+        try {
+            decode_data_block(&data[range.start], len - range.start, revision, frequency, tail,
+                              leftovers);
+        } catch (...) {
+            append(recs, tail);
+            throw;
+        }
+        append(recs, tail);
+        break;
+    }
+}
+
+PIXIE_EXPORT void PIXIE_API decode_file(const std::string& path, uint32_t revision,
+                                        uint32_t frequency, const record_handler& handler,
+                                        buffer& leftovers, size_t threads, size_t chunk_words) {
+    threads = thread_count(threads);
+    if (chunk_words == 0) {
+        chunk_words = threads * default_thread_chunk_words;
+    }
+
+    std::ifstream input(path, std::ios::in | std::ios::binary);
+    if (!input) {
+        throw error(error::code::file_open_failure,
+                    "list-mode file open: " + path + ": " + std::strerror(errno));
+    }
+
+    leftovers.clear();
+
+    buffer data;
+    buffer remainder;
+    records recs;
+    while (true) {
+        data.resize(remainder.size() + chunk_words);
+        std::copy(remainder.begin(), remainder.end(), data.begin());
+        input.read(reinterpret_cast<char*>(&data[remainder.size()]),
+                   std::streamsize(chunk_words * sizeof(uint32_t)));
+        if (input.bad()) {
+            throw error(error::code::file_read_failure,
+                        "list-mode file read: " + path + ": " + std::strerror(errno));
+        }
+        auto words = size_t(input.gcount()) / sizeof(uint32_t);
+        if (words == 0) {
+            break;
+        }
+        data.resize(remainder.size() + words);
+        decode_data_block_parallel(data.data(), data.size(), revision, frequency, recs,
+                                   remainder, threads);
+        handler(recs);
+    }
+
+    leftovers = std::move(remainder);
+}
+}  // namespace list_mode
+}  // namespace data
+}  // namespace pixie
+}  // namespace xia
@@ -0,0 +1,185 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+
+/*
+ * Copyright 2021 XIA LLC, All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** @file list_mode_reader.cpp
+ * @brief Implements a memory mapped list-mode data file reader.
+ */
+
+#include <cerrno>
+#include <cstring>
+
+#if defined(_WIN64) || defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <pixie/error.hpp>
+
+#include <pixie/data/list_mode_reader.hpp>
+
+namespace xia {
+namespace pixie {
+namespace data {
+namespace list_mode {
+
+#if defined(_WIN64) || defined(_WIN32)
+static std::string system_error() {
+    return "error " + std::to_string(::GetLastError());
+}
+
+static void* map_file(const std::string& path, size_t& size) {
+    auto file = ::CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        throw error(error::code::file_open_failure,
+                    "list-mode file open: " + path + ": " + system_error());
+    }
+    LARGE_INTEGER file_size;
+    if (!::GetFileSizeEx(file, &file_size)) {
+        auto what = system_error();
+        ::CloseHandle(file);
+        throw error(error::code::file_read_failure, "list-mode file size: " + path + ": " + what);
+    }
+    size = size_t(file_size.QuadPart);
+    if (size == 0) {
+        ::CloseHandle(file);
+        return nullptr;
+    }
+    /*
+     * The view holds a reference to the mapping so the handles can be closed.
+     */
+    auto mapping = ::CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    ::CloseHandle(file);
+    if (mapping == nullptr) {
+        throw error(error::code::file_read_failure,
+                    "list-mode file map: " + path + ": " + system_error());
+    }
+    auto addr = ::MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    ::CloseHandle(mapping);
+    if (addr == nullptr) {
+        throw error(error::code::file_read_failure,
+                    "list-mode file map: " + path + ": " + system_error());
+    }
+    return addr;
+}
+
+static void unmap_file(void* addr, size_t) {
+    ::UnmapViewOfFile(addr);
+}
+#else
+static void* map_file(const std::string& path, size_t& size) {
+    auto fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw error(error::code::file_open_failure,
+                    "list-mode file open: " + path + ": " + std::strerror(errno));
+    }
+    struct stat st;
+    if (::fstat(fd, &st) < 0) {
+        auto what = std::strerror(errno);
+        ::close(fd);
+        throw error(error::code::file_read_failure, "list-mode file stat: " + path + ": " + what);
+    }
+    size = size_t(st.st_size);
+    if (size == 0) {
+        ::close(fd);
+        return nullptr;
+    }
+    /*
+     * The mapping holds a reference to the file so it can be closed.
+     */
+    auto addr = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    auto what = std::strerror(errno);
+    ::close(fd);
+    if (addr == MAP_FAILED) {
+        throw error(error::code::file_read_failure, "list-mode file map: " + path + ": " + what);
+    }
+#ifdef MADV_SEQUENTIAL
+    ::madvise(addr, size, MADV_SEQUENTIAL);
+#endif
+    return addr;
+}
+
+static void unmap_file(void* addr, size_t size) {
+    ::munmap(addr, size);
+}
+#endif
+
+mapped_reader::mapped_reader()
+    : revision(0), frequency(0), words(nullptr), length(0), offset(0), mapping(nullptr),
+      mapping_size(0) {}
+
+mapped_reader::mapped_reader(const std::string& path, uint32_t revision_, uint32_t frequency_)
+    : mapped_reader() {
+    open(path, revision_, frequency_);
+}
+
+mapped_reader::~mapped_reader() {
+    close();
+}
+
+void mapped_reader::open(const std::string& path, uint32_t revision_, uint32_t frequency_) {
+    close();
+    size_t size = 0;
+    mapping = map_file(path, size);
+    mapping_size = size;
+    file_path = path;
+    revision = revision_;
+    frequency = frequency_;
+    words = static_cast<const uint32_t*>(mapping);
+    length = size / sizeof(uint32_t);
+    offset = 0;
+}
+
+void mapped_reader::close() {
+    if (mapping != nullptr) {
+        unmap_file(mapping, mapping_size);
+    }
+    file_path.clear();
+    words = nullptr;
+    length = 0;
+    offset = 0;
+    mapping = nullptr;
+    mapping_size = 0;
+}
+
+bool mapped_reader::is_open() const {
+    return !file_path.empty();
+}
+
+bool mapped_reader::next(record_view& view) {
+    if (offset >= length) {
+        return false;
+    }
+    if (!view_record(&words[offset], length - offset, revision, frequency, view)) {
+        return false;
+    }
+    offset += view.event_length();
+    return true;
+}
+
+void mapped_reader::rewind() {
+    offset = 0;
+}
+}  // namespace list_mode
+}  // namespace data
+}  // namespace pixie
+}  // namespace xia
@@ -0,0 +1,388 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+
+/*
+ * Copyright 2021 XIA LLC, All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** @file list_mode_spool.cpp
+ * @brief Implements a self-verifying list-mode data spool file.
+ */
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <ostream>
+#include <utility>
+
+#include <pixie/error.hpp>
+#include <pixie/utils/crc.hpp>
+
+#include <pixie/data/list_mode_spool.hpp>
+
+namespace xia {
+namespace pixie {
+namespace data {
+namespace list_mode {
+
+/*
+ * Frame header word offsets.
+ */
+enum frame_word {
+    fw_magic = 0,
+    fw_slot,
+    fw_sequence,
+    fw_words,
+    fw_timestamp_lo,
+    fw_timestamp_hi,
+    fw_crc,
+    fw_header_crc
+};
+
+static uint32_t header_crc(const uint32_t* header) {
+    util::crc::crc32 crc;
+    crc.update(header, size_t(fw_header_crc));
+    return crc.value;
+}
+
+static uint32_t data_crc(const uint32_t* data, size_t words) {
+    util::crc::crc32 crc;
+    if (words > 0) {
+        crc.update(data, words);
+    }
+    return crc.value;
+}
+
+static bool valid_header(const uint32_t* header) {
+    return header[fw_magic] == spool_frame_magic && header[fw_header_crc] == header_crc(header);
+}
+
+static void decode_header(const uint32_t* header, spool_frame& frame) {
+    frame.slot = header[fw_slot];
+    frame.sequence = header[fw_sequence];
+    frame.words = header[fw_words];
+    frame.timestamp =
+        uint64_t(header[fw_timestamp_lo]) | (uint64_t(header[fw_timestamp_hi]) << 32);
+    frame.crc = header[fw_crc];
+    frame.data = &header[spool_frame_header_words];
+}
+
+spool_frame::spool_frame()
+    : slot(0), sequence(0), words(0), timestamp(0), crc(0), data(nullptr) {}
+
+bool spool_frame::valid() const {
+    return crc == data_crc(data, words);
+}
+
+spool_writer::spool_writer(size_t queue_words)
+    : queue_limit(queue_words), queued_words(0), writing(false), stopping(false), frames_(0),
+      words_(0), skipped_(0) {}
+
+spool_writer::spool_writer(const std::string& path, size_t queue_words)
+    : spool_writer(queue_words) {
+    open(path);
+}
+
+spool_writer::~spool_writer() {
+    try {
+        close();
+    } catch (...) {
+    }
+}
+
+void spool_writer::open(const std::string& path) {
+    close();
+    std::lock_guard<std::mutex> guard(lock_);
+    output.open(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!output) {
+        throw error(error::code::file_create_failure,
+                    "list-mode spool create: " + path + ": " + std::strerror(errno));
+    }
+    const uint32_t header[spool_file_header_words] = {
+        spool_file_magic, spool_version, uint32_t(spool_frame_header_words), 0};
+    output.write(reinterpret_cast<const char*>(header), sizeof(header));
+    file_path = path;
+    sequences.clear();
+    failure.clear();
+    stopping = false;
+    frames_ = 0;
+    words_ = 0;
+    skipped_ = 0;
+    writer_thread = std::thread(&spool_writer::writer, this);
+}
+
+void spool_writer::close() {
+    {
+        std::lock_guard<std::mutex> guard(lock_);
+        stopping = true;
+        queued.notify_all();
+    }
+    if (writer_thread.joinable()) {
+        writer_thread.join();
+    }
+    std::lock_guard<std::mutex> guard(lock_);
+    if (output.is_open()) {
+        output.close();
+        if (!output && failure.empty()) {
+            failure = "list-mode spool close: " + file_path;
+        }
+    }
+    file_path.clear();
+    if (!failure.empty()) {
+        std::string what;
+        what.swap(failure);
+        throw error(error::code::file_close_failure, what);
+    }
+}
+
+bool spool_writer::is_open() const {
+    return !file_path.empty();
+}
+
+uint32_t spool_writer::next_sequence(uint32_t slot) {
+    auto& sequence = sequences[slot];
+    return sequence++;
+}
+
+void spool_writer::check_failure() {
+    if (!failure.empty()) {
+        throw error(error::code::file_create_failure, failure);
+    }
+}
+
+void spool_writer::writer() {
+    std::unique_lock<std::mutex> guard(lock_);
+    while (true) {
+        queued.wait(guard, [this] { return (stopping || !queue.empty()) && !writing; });
+        if (queue.empty()) {
+            break;
+        }
+        auto frame = std::move(queue.front());
+        queue.pop_front();
+        writing = true;
+        guard.unlock();
+        /*
+         * The file is used without the lock by the thread that sets
+         * `writing`.
+         */
+        output.write(reinterpret_cast<const char*>(frame.header), sizeof(frame.header));
+        output.write(reinterpret_cast<const char*>(frame.data.data()),
+                     std::streamsize(frame.data.size() * sizeof(uint32_t)));
+        const bool ok = bool(output);
+        const auto err = errno;
+        guard.lock();
+        writing = false;
+        queued_words -= frame.data.size();
+        if (!ok && failure.empty()) {
+            failure = "list-mode spool write: " + file_path + ": " + std::strerror(err);
+            queue.clear();
+            queued_words = 0;
+        }
+        if (queue.empty()) {
+            drained.notify_all();
+        }
+    }
+    drained.notify_all();
+}
+
+void spool_writer::write(uint32_t slot, const uint32_t* data, size_t words) {
+    const auto timestamp = uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+    /*
+     * The CRC and the copy are made before taking the lock so writers of
+     * different slots only serialise on the queue.
+     */
+    queued_frame frame;
+    auto& header = frame.header;
+    header[fw_magic] = spool_frame_magic;
+    header[fw_slot] = slot;
+    header[fw_words] = uint32_t(words);
+    header[fw_timestamp_lo] = uint32_t(timestamp);
+    header[fw_timestamp_hi] = uint32_t(timestamp >> 32);
+    header[fw_crc] = data_crc(data, words);
+    frame.data.assign(data, data + words);
+    std::lock_guard<std::mutex> guard(lock_);
+    if (file_path.empty() || stopping) {
+        throw error(error::code::file_create_failure, "list-mode spool not open");
+    }
+    check_failure();
+    header[fw_sequence] = next_sequence(slot);
+    if (queued_words + words > queue_limit) {
+        ++skipped_;
+        return;
+    }
+    header[fw_header_crc] = header_crc(header);
+    queued_words += words;
+    queue.push_back(std::move(frame));
+    queued.notify_one();
+    ++frames_;
+    words_ += words;
+}
+
+void spool_writer::flush() {
+    std::unique_lock<std::mutex> guard(lock_);
+    drained.wait(guard, [this] { return queue.empty() && !writing; });
+    check_failure();
+    if (output.is_open()) {
+        writing = true;
+        guard.unlock();
+        output.flush();
+        guard.lock();
+        writing = false;
+        queued.notify_all();
+    }
+}
+
+void spool_writer::skip(uint32_t slot) {
+    std::lock_guard<std::mutex> guard(lock_);
+    next_sequence(slot);
+    ++skipped_;
+}
+
+spool_reader::spool_reader() : offset(0) {}
+
+spool_reader::spool_reader(const std::string& path) : spool_reader() {
+    open(path);
+}
+
+void spool_reader::open(const std::string& path) {
+    close();
+    /*
+     * The mapped reader maps the file. Its list-mode decoding is not used
+     * so the revision and frequency are not needed.
+     */
+    mapped.open(path, 0, 0);
+    if (mapped.size() < spool_file_header_words || mapped.data()[0] != spool_file_magic) {
+        mapped.close();
+        throw error(error::code::invalid_buffer, "list-mode spool: not a spool: " + path);
+    }
+    if (mapped.data()[1] != spool_version ||
+        mapped.data()[2] != spool_frame_header_words) {
+        mapped.close();
+        throw error(error::code::invalid_buffer,
+                    "list-mode spool: unsupported version: " + path);
+    }
+    offset = spool_file_header_words;
+}
+
+void spool_reader::close() {
+    mapped.close();
+    offset = 0;
+}
+
+bool spool_reader::is_open() const {
+    return mapped.is_open();
+}
+
+bool spool_reader::next(spool_frame& frame) {
+    const auto length = mapped.size();
+    if (offset >= length) {
+        return false;
+    }
+    if (length - offset < spool_frame_header_words) {
+        throw error(error::code::invalid_buffer_length, "list-mode spool: truncated frame header");
+    }
+    const auto* header = &mapped.data()[offset];
+    if (!valid_header(header)) {
+        throw error(error::code::invalid_buffer, "list-mode spool: invalid frame header");
+    }
+    if (length - offset - spool_frame_header_words < header[fw_words]) {
+        throw error(error::code::invalid_buffer_length, "list-mode spool: truncated frame");
+    }
+    decode_header(header, frame);
+    offset += spool_frame_header_words + frame.words;
+    return true;
+}
+
+void spool_reader::rewind() {
+    offset = is_open() ? spool_file_header_words : 0;
+}
+
+spool_verify_result::spool_verify_result()
+    : frames(0), words(0), crc_errors(0), header_errors(0), sequence_gaps(0), slots(0),
+      truncated(false) {}
+
+bool spool_verify_result::ok() const {
+    return crc_errors == 0 && header_errors == 0 && sequence_gaps == 0 && !truncated;
+}
+
+void spool_verify_result::output(std::ostream& out) const {
+    out << "frames=" << frames << " words=" << words << " crc-errors=" << crc_errors
+        << " header-errors=" << header_errors << " sequence-gaps=" << sequence_gaps
+        << " slots=" << slots << " truncated=" << std::boolalpha << truncated;
+}
+
+spool_verify_result verify_spool(const std::string& path) {
+    spool_verify_result result;
+    mapped_reader mapped(path, 0, 0);
+    const auto* words = mapped.data();
+    const auto length = mapped.size();
+    if (length < spool_file_header_words || words[0] != spool_file_magic ||
+        words[1] != spool_version || words[2] != spool_frame_header_words) {
+        throw error(error::code::invalid_buffer, "list-mode spool: not a spool: " + path);
+    }
+    std::map<uint32_t, uint32_t> sequences;
+    size_t offset = spool_file_header_words;
+    bool resync = false;
+    while (offset < length) {
+        if (length - offset < spool_frame_header_words) {
+            result.truncated = !resync;
+            break;
+        }
+        const auto* header = &words[offset];
+        if (!valid_header(header)) {
+            /*
+             * Count the invalid header once and search for the next
+             * valid header.
+             */
+            if (!resync) {
+                ++result.header_errors;
+                resync = true;
+            }
+            ++offset;
+            continue;
+        }
+        resync = false;
+        spool_frame frame;
+        decode_header(header, frame);
+        if (length - offset - spool_frame_header_words < frame.words) {
+            result.truncated = true;
+            break;
+        }
+        ++result.frames;
+        result.words += frame.words;
+        if (!frame.valid()) {
+            ++result.crc_errors;
+        }
+        auto expected = sequences.find(frame.slot);
+        if (expected == sequences.end()) {
+            result.sequence_gaps += frame.sequence;
+        } else if (frame.sequence > expected->second) {
+            result.sequence_gaps += frame.sequence - expected->second;
+        } else if (frame.sequence < expected->second) {
+            /*
+             * A repeated or out of order frame.
+             */
+            ++result.sequence_gaps;
+        }
+        sequences[frame.slot] = frame.sequence + 1;
+        offset += spool_frame_header_words + frame.words;
+    }
+    result.slots = sequences.size();
+    return result;
+}
+}  // namespace list_mode
+}  // namespace data
+}  // namespace pixie
+}  // namespace xia
@@ -22,6 +22,7 @@
 
 #include <algorithm>
 #include <cctype>
+#include <cerrno>
 #include <cstring>
 #include <fstream>
 #include <iomanip>
@@ -61,6 +62,67 @@ using files = std::vector<std::string>;
  */
 static std::atomic_size_t total_image_size;
 
+/*
+ * The image cache. An entry has a lock so loads of different files run
+ * concurrently and loads of the same file wait for the first load. The
+ * contents index finds images with the same size and CRC. The cache does
+ * not hold the images. An image is released when the last firmware holding
+ * it is unloaded and its cache references expire.
+ */
+using image_weak_ref = std::weak_ptr<const image>;
+
+struct image_cache_entry {
+    using lock_type = std::mutex;
+    using lock_guard = std::lock_guard<lock_type>;
+
+    lock_type lock;
+    size_t size;
+    time_t mtime;
+    long mtime_nsecs;
+    util::crc::crc32::value_type crc;
+    image_weak_ref img;
+
+    image_cache_entry() : size(0), mtime(0), mtime_nsecs(0), crc(0) {}
+};
+
+using image_cache_entry_ref = std::shared_ptr<image_cache_entry>;
+
+struct image_cache {
+    using lock_type = std::mutex;
+    using lock_guard = std::lock_guard<lock_type>;
+    using content_key = std::pair<util::crc::crc32::value_type, size_t>;
+
+    lock_type lock;
+    std::map<std::string, image_cache_entry_ref> entries;
+    std::multimap<content_key, image_weak_ref> contents;
+    image_cache_stats stats;
+
+    void prune();
+};
+
+/*
+ * Remove the expired images from the contents index and count the images
+ * still held. The cache lock must be held.
+ */
+void image_cache::prune() {
+    stats.images = 0;
+    stats.bytes = 0;
+    for (auto ci = contents.begin(); ci != contents.end();) {
+        if (ci->second.expired()) {
+            ci = contents.erase(ci);
+        } else {
+            ++stats.images;
+            stats.bytes += ci->first.second;
+            ++ci;
+        }
+    }
+}
+
+static image_cache& get_image_cache() {
+    static image_cache cache;
+    return cache;
+}
+
 /**
  * The system firmware path.
  */
@@ -228,32 +290,37 @@ firmware::firmware(
     const device_detail& device_, const std::string version_, const mask_type mask_,
     const size_t instance_)
     : tag(device_.tag()), release(not_released), version(version_), mask(mask_),
-      instance(instance_), device(device_), crc(0) {}
+      instance(instance_), device(device_), crc(0), image_crc(0) {}
 
 firmware::firmware(
     const device_detail& device_, const std::string release_, const std::string version_,
     const mask_type mask_, const size_t instance_)
     : tag(device_.tag()), release(release_), version(version_), mask(mask_),
-      instance(instance_), device(device_), crc(0) {}
+      instance(instance_), device(device_), crc(0), image_crc(0) {}
 
 firmware::firmware(
     const device_detail& device_, const release_type& release_, const std::string version_,
     const mask_type mask_, const size_t instance_)
     : tag(device_.tag()), release(release_), version(version_), mask(mask_),
-      instance(instance_), device(device_), crc(0) {}
+      instance(instance_), device(device_), crc(0), image_crc(0) {}
 
 firmware::firmware(const firmware& orig) :
     tag(orig.tag), release(orig.release), version(orig.version), mask(orig.mask),
-    instance(orig.instance), device(orig.device), filename(orig.filename), crc(orig.crc) {
+    instance(orig.instance), device(orig.device), filename(orig.filename), crc(orig.crc),
+    image_crc(0) {
 }
 
 firmware::firmware(firmware&& from)
     : tag(from.tag), release(from.release), version(from.version), mask(from.mask),
-      instance(from.instance), device(from.device), filename(from.filename), crc(from.crc) {
+      instance(from.instance), device(from.device), filename(from.filename), crc(from.crc),
+      image_crc(0) {
     lock_guard guard(from.lock);
+    data = std::move(from.data);
+    image_crc = from.image_crc;
     from.filename.clear();
-    from.data.clear();
+    from.data.reset();
     from.crc = 0;
+    from.image_crc = 0;
 }
 
 bool firmware::valid() const {
@@ -277,43 +344,21 @@ void firmware::check() const {
 
 void firmware::load() {
     lock_guard guard(lock);
-    if (data.empty()) {
+    if (!data) {
         util::time::timepoint load_time(true);
-        /*
-         * Use C and the standard file system interfaces. They are faster
-         * than the C++ stream interface
-         */
-        util::io::file file;
         try {
-            file.open(filename, file.flag::ro);
-            struct stat sb;
-            ::fstat(file.handle, &sb);
-            size_t size = size_t(sb.st_size);
-            data.resize(size);
-            file.read(data, size);
-            file.close();
-            total_image_size += size;
+            data = load_image(filename, image_crc);
         } catch (pixie::error::error& e) {
-            if (file.valid()) {
-                file.close();
-            }
             std::stringstream error_tag;
             error_tag << e.what() <<  ": " << tag << ": " << filename;
             throw error(e.type, error_tag.str());
-        } catch (...) {
-            if (file.valid()) {
-                file.close();
-            }
-            throw;
         }
-
-        util::crc::crc32 crc_;
-        crc_.update(data);
+        total_image_size += data->size();
 
         xia_log(log::info) << "firmware: load: tag=" << tag
                            << " release=" << release.to_string()
                            << std::hex << std::showbase << std::internal
-                           << " crc=" << crc_.value
+                           << " crc=" << image_crc
                            << " time=" << load_time
                            << " total=" << total_image_size.load();
     }
@@ -321,10 +366,10 @@ void firmware::load() {
 
 void firmware::unload() {
     lock_guard guard(lock);
-    if (!data.empty()) {
-        total_image_size -= data.size();
-        data.clear();
-        data.shrink_to_fit();
+    if (data) {
+        total_image_size -= data->size();
+        data.reset();
+        image_crc = 0;
     }
 }
 
@@ -334,26 +379,28 @@ size_t firmware::words() {
      * Size of the vector should be uint32_t aligned so rounding there
      * should be redundant, but it does not harm so lets keep it.
      */
-    return ((size_t(data.size()) - 1) / sizeof(image_value_type)) + 1;
+    size_t size = data ? data->size() : 0;
+    return ((size - 1) / sizeof(image_value_type)) + 1;
 }
 
 void firmware::update_crc(util::crc::crc32& crc_) {
     lock_guard guard(lock);
-    if (!data.empty()) {
-        crc_.update(data);
+    if (data && !data->empty()) {
+        crc_.combine(image_crc, data->size());
     }
 }
 
 bool firmware::validate_firmware() {
-    util::crc::crc32 cal_crc;
     load();
-    update_crc(cal_crc);
-    if (cal_crc.value == crc) {
-        return true;
-    } else {
+    bool valid;
+    {
+        lock_guard guard(lock);
+        valid = image_crc == crc;
+    }
+    if (!valid) {
         unload();
-        return false;
     }
+    return valid;
 }
 
 bool firmware::operator==(const firmware& other) const {
@@ -380,7 +427,7 @@ void firmware::output(T& out) const {
     if (width > 1) {
         out << std::endl << std::setw(width) << ' ';
     }
-    out << " size:" << data.size()
+    out << " size:" << (data ? data->size() : 0)
         << " file:" << filename;
 }
 
@@ -1132,6 +1179,102 @@ void find(
     find(firmware, std::get<1>(*fwsi), filter);
 }
 
+image_cache_stats::image_cache_stats()
+    : images(0), bytes(0), hits(0), misses(0), shared(0) {}
+
+image_ref load_image(const std::string& path, util::crc::crc32::value_type& crc) {
+    auto& cache = get_image_cache();
+    image_cache_entry_ref entry;
+    {
+        image_cache::lock_guard guard(cache.lock);
+        auto& ce = cache.entries[path];
+        if (!ce) {
+            ce = std::make_shared<image_cache_entry>();
+        }
+        entry = ce;
+    }
+
+    image_cache_entry::lock_guard entry_guard(entry->lock);
+
+    /*
+     * Use C and the standard file system interfaces. They are faster
+     * than the C++ stream interface
+     */
+    util::io::file file;
+    file.open(path, file.flag::ro);
+    struct stat sb;
+    if (::fstat(file.handle, &sb) != 0) {
+        throw error(error::code::file_open_failure,
+                    "firmware: image: stat: " + path + ": " + std::strerror(errno));
+    }
+    size_t size = size_t(sb.st_size);
+    time_t mtime = sb.st_mtime;
+#if defined(_WIN64) || defined(_WIN32)
+    long mtime_nsecs = 0;
+#else
+    long mtime_nsecs = sb.st_mtim.tv_nsec;
+#endif
+
+    if (entry->size == size && entry->mtime == mtime && entry->mtime_nsecs == mtime_nsecs) {
+        auto cached = entry->img.lock();
+        if (cached) {
+            file.close();
+            crc = entry->crc;
+            image_cache::lock_guard guard(cache.lock);
+            ++cache.stats.hits;
+            return cached;
+        }
+    }
+
+    auto img = std::make_shared<image>(size);
+    file.read(*img, size);
+    file.close();
+
+    util::crc::crc32 crc_;
+    crc_.update(*img);
+
+    image_ref ref = img;
+    image_cache::lock_guard guard(cache.lock);
+    ++cache.stats.misses;
+    const image_cache::content_key key(crc_.value, size);
+    auto range = cache.contents.equal_range(key);
+    for (auto ci = range.first; ci != range.second; ++ci) {
+        auto cached = ci->second.lock();
+        if (cached && *cached == *img) {
+            ref = cached;
+            ++cache.stats.shared;
+            break;
+        }
+    }
+    if (ref == img) {
+        cache.contents.emplace(key, ref);
+    }
+    cache.prune();
+    entry->size = size;
+    entry->mtime = mtime;
+    entry->mtime_nsecs = mtime_nsecs;
+    entry->crc = crc_.value;
+    entry->img = ref;
+    crc = crc_.value;
+    return ref;
+}
+
+void clear_image_cache() {
+    auto& cache = get_image_cache();
+    image_cache::lock_guard guard(cache.lock);
+    cache.entries.clear();
+    cache.contents.clear();
+    cache.stats.images = 0;
+    cache.stats.bytes = 0;
+}
+
+image_cache_stats get_image_cache_stats() {
+    auto& cache = get_image_cache();
+    image_cache::lock_guard guard(cache.lock);
+    cache.prune();
+    return cache.stats;
+}
+
 void load(system& sys_fw) {
     for (auto& fw_sets : sys_fw) {
         for (auto fw : fw_sets.second) {
@@ -20,8 +20,10 @@
  * @brief Implements logging infrastructure components.
  */
 
+#include <algorithm>
 #include <cerrno>
 #include <chrono>
+#include <condition_variable>
 #include <cstring>
 #include <ctime>
 #include <fstream>
@@ -53,6 +55,20 @@ using log_time = std::chrono::time_point<std::chrono::system_clock>;
  */
 static std::atomic<log::level> log_level(xia::log::warning);
 
+/*
+ * Asynchronous log entry. The time is when the entry is logged and the
+ * sequence orders the entries logged by all threads.
+ */
+struct async_entry {
+    size_t sequence;
+    log::level level;
+    log_time time;
+    std::string text;
+
+    async_entry();
+};
+using async_entries = std::vector<async_entry>;
+
 /*
  * Log entry, the values for finding and formatted entry
  */
@@ -119,9 +135,8 @@ struct log_mib {
 };
 
 /*
- * Synchronous outputter.
- *
- * Can be made asynchronous with a fixed size queue and worker thread.
+ * Outputter. Entries are written as they are logged or in batches by the
+ * asynchronous worker.
  */
 struct outputter {
     using lock_type = std::mutex;
@@ -157,12 +172,94 @@ struct outputter {
 
     void write(const log& entry);
     void write(const log::level entry_level, const std::string& entry);
+    void write(const async_entries& entries);
 
 private:
+    void format(const log::level entry_level, const log_time& time, const std::string& entry);
+
     std::shared_ptr<std::ofstream> outfile;
     std::ostream out;
 };
 
+/*
+ * Asynchronous log entry ring. The thread that owns the ring is the only
+ * producer and the worker is the only consumer so the ring is lock free.
+ * The size is a power of 2.
+ */
+struct async_ring {
+    async_entries slots;
+    const size_t mask;
+    std::atomic_size_t head;
+    std::atomic_size_t tail;
+
+    async_ring(size_t size);
+
+    bool push(async_entry& entry);
+    size_t pop(async_entries& entries);
+
+    size_t used() const;
+};
+
+/*
+ * Asynchronous logging. Each logging thread has a ring and the worker
+ * drains the rings in batches. The entries in a batch are sorted by the
+ * sequence so the output order is the logging order.
+ */
+struct log_async {
+    using ring_ptr = std::shared_ptr<async_ring>;
+    using rings = std::vector<ring_ptr>;
+    using lock_type = std::mutex;
+    using lock_guard = std::lock_guard<lock_type>;
+    using counter = std::atomic_size_t;
+    using counter_nodes = std::vector<mib::read_write<counter>>;
+
+    /*
+     * The period the worker waits for entries.
+     */
+    static constexpr size_t worker_period_msecs = 10;
+
+    log_handle& handle;
+
+    std::atomic_bool active;
+    counter session;
+    counter in_flight;
+    counter sequence;
+    size_t ring_size;
+    overflow_policy policy;
+
+    counter queued;
+    counter written;
+    counter dropped;
+    counter blocked;
+    counter batches;
+
+    lock_type rings_lock;
+    rings rings_;
+
+    lock_type wake_lock;
+    std::condition_variable wake_cv;
+    bool wake;
+    bool running;
+    std::thread worker;
+
+    async_entries batch;
+    counter_nodes mibs;
+
+    log_async(log_handle& handle);
+    ~log_async();
+
+    void start(size_t ring_size, overflow_policy policy);
+    void stop();
+
+    bool enqueue(const log::level entry_level, const std::string& entry);
+
+private:
+    ring_ptr get_ring();
+    void notify();
+    void run();
+    size_t drain();
+};
+
 /*
  * The log handle is shared by each module that includes the log. This
  * holds the log mib and outputters open until all code modules have
@@ -172,7 +269,8 @@ static log_handle_ptr log_handles;
 
 log_handle::log_handle()
     : mibs(std::make_unique<log_mib>()),
-      outputs(std::make_unique<outputters>()) {
+      outputs(std::make_unique<outputters>()),
+      async(std::make_unique<log_async>(*this)) {
 }
 
 log_handle::~log_handle() {
@@ -197,7 +295,7 @@ static void log_format_counter(
     out << std::setw(count_length) << counter;
 }
 
-static void log_format_time(std::ostream& out, log_time& time) {
+static void log_format_time(std::ostream& out, const log_time& time) {
     using us = std::chrono::microseconds;
     auto as_time_t = std::chrono::system_clock::to_time_t(time);
     const auto time_us =
@@ -262,6 +360,24 @@ void outputter::write(const log& entry) {
 
 void outputter::write(const log::level entry_level, const std::string& entry) {
     std::lock_guard<lock_type> guard(lock);
+    format(entry_level, std::chrono::system_clock::now(), entry);
+    if (linefeed || flush) {
+        out << std::flush;
+    }
+}
+
+void outputter::write(const async_entries& entries) {
+    std::lock_guard<lock_type> guard(lock);
+    for (auto& entry : entries) {
+        format(entry.level, entry.time, entry.text);
+    }
+    if (linefeed || flush) {
+        out << std::flush;
+    }
+}
+
+void outputter::format(
+    const log::level entry_level, const log_time& time, const std::string& entry) {
     log::level current_level = log_level.load();
 
     ++counter;
@@ -281,7 +397,6 @@ void outputter::write(const log::level entry_level, const std::string& entry) {
     }
 
     if (show_datetime) {
-        auto time = std::chrono::system_clock::now();
         log_format_time(out, time);
         out << ' ';
     }
@@ -289,12 +404,229 @@ void outputter::write(const log::level entry_level, const std::string& entry) {
     out << entry;
 
     if (linefeed) {
-        out << std::endl;
+        out << '\n';
     }
+}
 
-    if (flush) {
-        out << std::flush;
+async_entry::async_entry() : sequence(0), level(log::level::off) {}
+
+async_ring::async_ring(size_t size)
+    : mask(size - 1), head(0), tail(0) {
+    slots.resize(size);
+}
+
+bool async_ring::push(async_entry& entry) {
+    auto at = tail.load(std::memory_order_relaxed);
+    if (at - head.load(std::memory_order_acquire) >= slots.size()) {
+        return false;
     }
+    slots[at & mask] = std::move(entry);
+    tail.store(at + 1, std::memory_order_release);
+    return true;
+}
+
+size_t async_ring::pop(async_entries& entries) {
+    const auto start = head.load(std::memory_order_relaxed);
+    const auto end = tail.load(std::memory_order_acquire);
+    for (auto at = start; at != end; ++at) {
+        entries.push_back(std::move(slots[at & mask]));
+    }
+    head.store(end, std::memory_order_release);
+    return end - start;
+}
+
+size_t async_ring::used() const {
+    return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+}
+
+/*
+ * The thread's ring. The session is the async session the ring was
+ * created for.
+ */
+struct async_thread_ring {
+    size_t session;
+    log_async::ring_ptr ring;
+
+    async_thread_ring() : session(0) {}
+};
+static thread_local async_thread_ring thread_ring;
+
+log_async::log_async(log_handle& handle_)
+    : handle(handle_), active(false), session(0), in_flight(0), sequence(0),
+      ring_size(default_async_ring_size), policy(overflow_policy::drop), queued(0),
+      written(0), dropped(0), blocked(0), batches(0), wake(false), running(false) {
+    mibs.reserve(5);
+    mibs.emplace_back("log.async.queued", queued);
+    mibs.emplace_back("log.async.written", written);
+    mibs.emplace_back("log.async.dropped", dropped);
+    mibs.emplace_back("log.async.blocked", blocked);
+    mibs.emplace_back("log.async.batches", batches);
+}
+
+log_async::~log_async() {
+    stop();
+}
+
+void log_async::start(size_t ring_size_, overflow_policy policy_) {
+    if (running) {
+        return;
+    }
+    size_t size = 2;
+    while (size < ring_size_) {
+        size <<= 1;
+    }
+    ring_size = size;
+    policy = policy_;
+    queued = 0;
+    written = 0;
+    dropped = 0;
+    blocked = 0;
+    batches = 0;
+    ++session;
+    wake = false;
+    running = true;
+    worker = std::thread([this]() { run(); });
+    active = true;
+}
+
+void log_async::stop() {
+    if (!running) {
+        return;
+    }
+    /*
+     * New entries are written directly. Wait for the entries being queued
+     * with the worker running so a blocked entry can complete.
+     */
+    active = false;
+    while (in_flight.load() != 0) {
+        notify();
+        std::this_thread::yield();
+    }
+    {
+        std::lock_guard<lock_type> guard(wake_lock);
+        running = false;
+    }
+    wake_cv.notify_one();
+    worker.join();
+    while (drain() != 0) {
+    }
+    lock_guard guard(rings_lock);
+    rings_.clear();
+}
+
+bool log_async::enqueue(const log::level entry_level, const std::string& entry) {
+    if (!active.load(std::memory_order_acquire)) {
+        return false;
+    }
+    ++in_flight;
+    if (!active.load(std::memory_order_acquire)) {
+        --in_flight;
+        return false;
+    }
+    auto ring = get_ring();
+    async_entry aentry;
+    aentry.sequence = sequence++;
+    aentry.level = entry_level;
+    aentry.time = std::chrono::system_clock::now();
+    aentry.text = entry;
+    bool pushed = ring->push(aentry);
+    if (!pushed && policy == overflow_policy::block) {
+        ++blocked;
+        while (!pushed) {
+            notify();
+            std::this_thread::yield();
+            pushed = ring->push(aentry);
+        }
+    }
+    if (pushed) {
+        ++queued;
+        /*
+         * Wake the worker when the ring is half full or an error is logged
+         * so errors are seen promptly.
+         */
+        if (ring->used() >= ring->slots.size() / 2 || entry_level == log::error) {
+            notify();
+        }
+    } else {
+        ++dropped;
+    }
+    --in_flight;
+    return true;
+}
+
+log_async::ring_ptr log_async::get_ring() {
+    auto current = session.load();
+    if (!thread_ring.ring || thread_ring.session != current) {
+        thread_ring.ring = std::make_shared<async_ring>(ring_size);
+        thread_ring.session = current;
+        lock_guard guard(rings_lock);
+        rings_.push_back(thread_ring.ring);
+    }
+    return thread_ring.ring;
+}
+
+void log_async::notify() {
+    {
+        std::lock_guard<lock_type> guard(wake_lock);
+        wake = true;
+    }
+    wake_cv.notify_one();
+}
+
+void log_async::run() {
+    while (true) {
+        {
+            std::unique_lock<lock_type> guard(wake_lock);
+            wake_cv.wait_for(
+                guard, std::chrono::milliseconds(worker_period_msecs),
+                [this] { return wake || !running; });
+            wake = false;
+            if (!running) {
+                break;
+            }
+        }
+        drain();
+    }
+}
+
+size_t log_async::drain() {
+    batch.clear();
+    {
+        lock_guard guard(rings_lock);
+        for (auto& ring : rings_) {
+            ring->pop(batch);
+        }
+        /*
+         * A ring only held here belongs to a thread that has exited.
+         */
+        rings_.erase(
+            std::remove_if(
+                rings_.begin(), rings_.end(),
+                [](const ring_ptr& ring) {
+                    return ring.use_count() == 1 && ring->used() == 0;
+                }),
+            rings_.end());
+    }
+    if (batch.empty()) {
+        return 0;
+    }
+    std::sort(
+        batch.begin(), batch.end(),
+        [](const async_entry& a, const async_entry& b) {
+            return a.sequence < b.sequence;
+        });
+    {
+        std::lock_guard<std::mutex> guard(handle.outputs_lock);
+        for (auto& output : *(handle.outputs)) {
+            output.write(batch);
+        }
+    }
+    for (auto& entry : batch) {
+        handle.mibs->add(entry.level, entry.text);
+    }
+    written += batch.size();
+    ++batches;
+    return batch.size();
 }
 
 
@@ -606,8 +938,14 @@ size_t log_mib::next_entry(size_t index) const {
 
 static void write(const log& entry) {
     if (log_handles) {
-        for (auto& output : *(log_handles->outputs)) {
-            output.write(entry);
+        if (log_handles->async->enqueue(entry.get_level(), entry.get_entry())) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> guard(log_handles->outputs_lock);
+            for (auto& output : *(log_handles->outputs)) {
+                output.write(entry);
+            }
         }
         log_handles->mibs->add(entry);
     }
@@ -615,8 +953,14 @@ static void write(const log& entry) {
 
 static void write(const log::level entry_level, const std::string& entry) {
     if (log_handles) {
-        for (auto& output : *(log_handles->outputs)) {
-            output.write(entry_level, entry);
+        if (log_handles->async->enqueue(entry_level, entry)) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> guard(log_handles->outputs_lock);
+            for (auto& output : *(log_handles->outputs)) {
+                output.write(entry_level, entry);
+            }
         }
         log_handles->mibs->add(entry_level, entry);
     }
@@ -628,6 +972,7 @@ void start(const std::string name, const std::string file, bool append) {
          * If the log exists quietly return. Could be the API init call is
          * called again.
          */
+        std::lock_guard<std::mutex> guard(log_handles->outputs_lock);
         for (auto& output : *(log_handles->outputs)) {
             if (output.name == name) {
                 return;
@@ -639,6 +984,7 @@ void start(const std::string name, const std::string file, bool append) {
 
 void stop(const std::string name) {
     if (log_handles) {
+        std::lock_guard<std::mutex> guard(log_handles->outputs_lock);
         for (auto it = log_handles->outputs->begin();
              it != log_handles->outputs->end(); ++it) {
             if ((*it).name == name) {
@@ -651,12 +997,48 @@ void stop(const std::string name) {
         error::code::internal_failure, "invalid log output name in stop");
 }
 
+void start_async(size_t ring_size, overflow_policy policy) {
+    if (log_handles) {
+        log_handles->async->start(ring_size, policy);
+    }
+}
+
+void stop_async() {
+    if (log_handles) {
+        log_handles->async->stop();
+    }
+}
+
+bool async_logging() {
+    if (log_handles) {
+        return log_handles->async->active.load();
+    }
+    return false;
+}
+
+async_stats::async_stats()
+    : queued(0), written(0), dropped(0), blocked(0), batches(0) {}
+
+async_stats get_async_stats() {
+    async_stats stats;
+    if (log_handles) {
+        auto& async = *log_handles->async;
+        stats.queued = async.queued.load();
+        stats.written = async.written.load();
+        stats.dropped = async.dropped.load();
+        stats.blocked = async.blocked.load();
+        stats.batches = async.batches.load();
+    }
+    return stats;
+}
+
 void set_level(log::level level) {
     log_level = level;
 }
 
 void set_level_stamp(const std::string name, bool level) {
     if (log_handles) {
+        std::lock_guard<std::mutex> guard(log_handles->outputs_lock);
         for (auto& output : *(log_handles->outputs)) {
             if (output.name == name) {
                 output.show_level = level;
@@ -671,6 +1053,7 @@ void set_level_stamp(const std::string name, bool level) {
 
 void set_datetime_stamp(const std::string name, bool datetime) {
     if (log_handles) {
+        std::lock_guard<std::mutex> guard(log_handles->outputs_lock);
         for (auto& output : *(log_handles->outputs)) {
             if (output.name == name) {
                 output.show_datetime = datetime;
@@ -685,6 +1068,7 @@ void set_datetime_stamp(const std::string name, bool datetime) {
 
 void set_line_numbers(const std::string name, bool line_numbers) {
     if (log_handles) {
+        std::lock_guard<std::mutex> guard(log_handles->outputs_lock);
         for (auto& output : *(log_handles->outputs)) {
             if (output.name == name) {
                 output.show_counts = line_numbers;
@@ -20,12 +20,15 @@
  * @brief Implements functions and data structures for the MIB
  */
 
+#include <atomic>
 #include <chrono>
 #include <cstring>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
 #include <map>
+#include <memory>
+#include <thread>
 
 #include <pixie/log.hpp>
 #include <pixie/mib.hpp>
@@ -58,11 +61,76 @@ static void next_field(
     len = end - pos;
 }
 
+/**
+ * A hash index of the MIB nodes. The index is an open addressing table
+ * with linear probing. The index holds weak references so it does not
+ * count as a reference to a node when the node is removed.
+ */
+struct hash_index {
+    struct entry {
+        bool used;
+        size_t hash;
+        std::weak_ptr<node_base> base;
+
+        entry() : used(false), hash(0) {}
+    };
+    using entries = std::vector<entry>;
+
+    const size_t generation;
+    size_t mask;
+    entries table;
+
+    template<typename N> hash_index(size_t generation, const N& nodes);
+
+    node_base_ptr find(const name_type& name, size_t hash) const;
+};
+
+template<typename N> hash_index::hash_index(size_t generation_, const N& nodes)
+    : generation(generation_) {
+    /*
+     * Keep the table at most half full.
+     */
+    size_t size = 16;
+    while (size < nodes.size() * 2) {
+        size <<= 1;
+    }
+    mask = size - 1;
+    table.resize(size);
+    for (auto& [name, base] : nodes) {
+        auto hash = std::hash<name_type>()(name);
+        auto slot = hash & mask;
+        while (table[slot].used) {
+            slot = (slot + 1) & mask;
+        }
+        table[slot].used = true;
+        table[slot].hash = hash;
+        table[slot].base = base;
+    }
+}
+
+node_base_ptr hash_index::find(const name_type& name, size_t hash) const {
+    for (auto slot = hash & mask; table[slot].used; slot = (slot + 1) & mask) {
+        if (table[slot].hash == hash) {
+            auto base = table[slot].base.lock();
+            if (base && base->name == name) {
+                return base;
+            }
+        }
+    }
+    return {};
+}
+
 /**
  * The MIB is held in a single map with each MIB node holding its
  * complete path. With the low number of nodes and the size of the
  * full paths it is simpler than adding complexity to hold the MIB as
- * a tree structure.
+ * a tree structure. The map's order keeps the nodes under a path
+ * together so a path is walked from its first node.
+ *
+ * Lookups use the hash index without taking the lock. An add or remove
+ * makes the index out of date and the next lookup rebuilds it under the
+ * lock, so registering a module's nodes rebuilds the index once. A
+ * replaced index is freed when no lookups are using an index.
  */
 struct mib_nodes {
     struct name_cmp {
@@ -117,12 +185,32 @@ struct mib_nodes {
     using nodes_type = std::map<name_type, node_base_ptr, name_cmp>;
     using lock_type = std::mutex;
     using lock_guard = std::lock_guard<lock_type>;
+    using index_ptr = std::unique_ptr<hash_index>;
+    using retired_indexes = std::vector<index_ptr>;
+
+    /*
+     * Count the lookups using an index.
+     */
+    struct lookup_guard {
+        std::atomic_size_t& lookups;
+        lookup_guard(std::atomic_size_t& lookups_) : lookups(lookups_) {
+            ++lookups;
+        }
+        ~lookup_guard() {
+            --lookups;
+        }
+    };
 
     lock_type lock;
     nodes_type nodes;
 
+    std::atomic_size_t generation;
+    std::atomic<hash_index*> index;
+    std::atomic_size_t lookups;
+    retired_indexes retired;
+
     mib_nodes();
-    ~mib_nodes() = default;
+    ~mib_nodes();
 
     mib_nodes(const mib_nodes& ) = delete;
     mib_nodes(const mib_nodes&& ) = delete;
@@ -135,8 +223,15 @@ struct mib_nodes {
     void remove(node_base_ptr& base);
     node_base_ptr find(const name_type& name);
     node_base_ptr find(const char* name);
+    void find(const names& names_, mib::nodes& found);
     bool contains(const name_type& name);
     void walk(mib_walk_func& walk_func);
+    void walk(const name_type& path, mib_walk_func& walk_func);
+
+private:
+    node_base_ptr lookup(const name_type& name);
+    node_base_ptr locked_lookup(const name_type& name);
+    void update_index();
 };
 
 /*
@@ -152,7 +247,11 @@ PIXIE_EXPORT mib_nodes_ptr PIXIE_API make_mib_nodes() {
     return mib;
 }
 
-mib_nodes::mib_nodes() {}
+mib_nodes::mib_nodes() : generation(0), index(nullptr), lookups(0) {}
+
+mib_nodes::~mib_nodes() {
+    delete index.load();
+}
 
 node_base_ptr mib_nodes::add(const name_type& name, const type type_, const bool enabled) {
     if (name.empty()) {
@@ -165,6 +264,7 @@ node_base_ptr mib_nodes::add(const name_type& name, const type type_, const bool
           error::code::invalid_value,
           "mib::add: mib already registered: " + name);
     }
+    ++generation;
     return (*ni.first).second;
 }
 
@@ -187,6 +287,7 @@ node_base_ptr mib_nodes::add(const name_type& name, const T& val, const bool ena
           error::code::invalid_value,
           "mib::add: mib already registered: " + name);
     }
+    ++generation;
     return (*ni.first).second;
 }
 
@@ -200,6 +301,16 @@ void mib_nodes::remove(node_base_ptr& base) {
             error::code::internal_failure,
             "mib::remove: mib not found: " + base->name);
     }
+    /*
+     * Lookups do not take the lock and hold a reference to a node while
+     * checking its name. Make the index out of date so new lookups wait
+     * for the lock and let the lookups using the index finish so their
+     * references are not counted.
+     */
+    ++generation;
+    while (lookups.load() != 0) {
+        std::this_thread::yield();
+    }
     /*
      * Chekc if the base passed in is the one in the container. It
      * should never be possible but changes could let it happen.
@@ -220,12 +331,11 @@ node_base_ptr mib_nodes::find(const name_type& name) {
     if (name.empty()) {
         throw error(error::code::invalid_value, "mib::add: name empty");
     }
-    lock_guard guard(lock);
-    auto ni = nodes.find(name);
-    if (ni == nodes.end()) {
+    auto base = lookup(name);
+    if (!base) {
         throw error(error::code::invalid_value, "mib::find: mib not found: " + name);
     }
-    return (*ni).second;
+    return base;
 }
 
 node_base_ptr mib_nodes::find(const char* name) {
@@ -235,13 +345,44 @@ node_base_ptr mib_nodes::find(const char* name) {
     return find(std::string(name));
 }
 
+void mib_nodes::find(const names& names_, mib::nodes& found) {
+    found.clear();
+    found.reserve(names_.size());
+    {
+        lookup_guard guard(lookups);
+        auto idx = index.load();
+        if (idx != nullptr && idx->generation == generation.load()) {
+            for (auto& name : names_) {
+                found.emplace_back(idx->find(name, std::hash<name_type>()(name)));
+            }
+            return;
+        }
+    }
+    lock_guard guard(lock);
+    update_index();
+    for (auto& name : names_) {
+        found.emplace_back(locked_lookup(name));
+    }
+}
+
 bool mib_nodes::contains(const name_type& name) {
     if (name.empty()) {
         return false;
     }
+    /*
+     * Do not return a reference to the node. The caller would hold it
+     * after the lookup and a concurrent remove would count it.
+     */
+    {
+        lookup_guard guard(lookups);
+        auto idx = index.load();
+        if (idx != nullptr && idx->generation == generation.load()) {
+            return bool(idx->find(name, std::hash<name_type>()(name)));
+        }
+    }
     lock_guard guard(lock);
-    auto ni = nodes.find(name);
-    return ni != nodes.end();
+    update_index();
+    return nodes.find(name) != nodes.end();
 }
 
 void mib_nodes::walk(mib_walk_func& walk_func) {
@@ -254,6 +395,68 @@ void mib_nodes::walk(mib_walk_func& walk_func) {
    }
 }
 
+void mib_nodes::walk(const name_type& path, mib_walk_func& walk_func) {
+    auto prefix = path;
+    while (!prefix.empty() && prefix.back() == mibsep) {
+        prefix.pop_back();
+    }
+    if (prefix.empty()) {
+        walk(walk_func);
+        return;
+    }
+    lock_guard guard(lock);
+    for (auto ni = nodes.lower_bound(prefix); ni != nodes.end(); ++ni) {
+        auto& name = (*ni).first;
+        if (name.compare(0, prefix.size(), prefix) != 0 ||
+            (name.size() > prefix.size() && name[prefix.size()] != mibsep)) {
+            break;
+        }
+        auto n = node((*ni).second);
+        if (n.is_enabled()) {
+            walk_func(n);
+        }
+    }
+}
+
+node_base_ptr mib_nodes::lookup(const name_type& name) {
+    {
+        lookup_guard guard(lookups);
+        auto idx = index.load();
+        if (idx != nullptr && idx->generation == generation.load()) {
+            return idx->find(name, std::hash<name_type>()(name));
+        }
+    }
+    lock_guard guard(lock);
+    update_index();
+    return locked_lookup(name);
+}
+
+node_base_ptr mib_nodes::locked_lookup(const name_type& name) {
+    auto ni = nodes.find(name);
+    if (ni == nodes.end()) {
+        return {};
+    }
+    return (*ni).second;
+}
+
+void mib_nodes::update_index() {
+    auto current = generation.load();
+    auto idx = index.load();
+    if (idx != nullptr && idx->generation == current) {
+        return;
+    }
+    auto old = index.exchange(new hash_index(current, nodes));
+    if (old != nullptr) {
+        retired.emplace_back(old);
+    }
+    /*
+     * A lookup that started after the exchange uses the new index.
+     */
+    if (lookups.load() == 0) {
+        retired.clear();
+    }
+}
+
 data_type::data_type()
     : s() {
 }
@@ -1049,6 +1252,24 @@ bool is_enabled(const char* name) {
     return is_enabled(name_type(name));
 }
 
+void find(const names& names_, nodes& found) {
+    mib->find(names_, found);
+}
+
+void get(const names& names_, values& vals) {
+    nodes found;
+    mib->find(names_, found);
+    vals.clear();
+    vals.reserve(found.size());
+    for (auto& n : found) {
+        if (n.valid()) {
+            vals.emplace_back(n.str());
+        } else {
+            vals.emplace_back();
+        }
+    }
+}
+
 bool contains(const name_type& name) {
     return mib->contains(name);
 }
@@ -1064,6 +1285,10 @@ void walk(mib_walk_func& walk_func) {
     mib->walk(walk_func);
 }
 
+void walk(const name_type& path, mib_walk_func& walk_func) {
+    mib->walk(path, walk_func);
+}
+
 void mib_to_json(xia::pixie::format::json& mib_json, std::string val, std::string names) {
     if (!names.empty()) {
         auto n = names.find_first_of(mib::mibsep);
@@ -738,7 +738,7 @@ void load(firmware::firmware_ref& firmware, module_var_descs& module_var_descrip
     if (firmware->device.name != "var") {
         throw error(error::code::device_image_failure, "invalid image type");
     }
-    if (firmware->data.empty()) {
+    if (!firmware->data || firmware->data->empty()) {
         throw error(error::code::device_image_failure, "no image loaded");
     }
 
@@ -747,8 +747,12 @@ void load(firmware::firmware_ref& firmware, module_var_descs& module_var_descrip
             this->setg(base, base, base + size);
         }
     };
-    char* data = static_cast<char*>(static_cast<void*>(firmware->data.data()));
-    membuf sbuf(data, firmware->data.size());
+    /*
+     * The image is shared and read-only. The stream only reads it.
+     */
+    auto& image = *firmware->data;
+    char* data = const_cast<char*>(reinterpret_cast<const char*>(image.data()));
+    membuf sbuf(data, std::ptrdiff_t(image.size()));
     std::istream input(&sbuf);
     load(input, module_var_descriptors, channel_var_descriptors);
 }
@@ -236,15 +236,17 @@ void baseline::compute_cut(size_t num) {
     }
 }
 
-channel::channel(module::module& module_) : number(-1), module(module_) {}
+channel::channel(module::module& module_)
+    : number(-1), module(module_), histogram_dirty(true) {}
 
 channel::channel(channel&& orig)
     : number(orig.number), module(std::move(orig.module)), vars(std::move(orig.vars)),
-      adc_trace(std::move(orig.adc_trace)) {}
+      adc_trace(std::move(orig.adc_trace)), histogram_dirty(orig.histogram_dirty) {}
 
 channel& channel::operator=(const channel& c) {
     number = c.number;
     module = c.module;
+    histogram_dirty = c.histogram_dirty;
     std::copy(c.vars.begin(), c.vars.end(), std::back_inserter(vars));
     return *this;
 }
@@ -257,10 +259,7 @@ mib::name_type channel::get_mib_base() const {
 void channel::read_adc(hw::adc_word* buffer, size_t size) {
     module::module& mod = module.get();
     if (mod.run_config.dsp_get_traces) {
-        const hw::address addr =
-            static_cast<hw::address>(
-                hw::memory::IO_BUFFER_ADDR +
-                (number * (fixture->config.max_adc_trace_length / 2)));
+        const hw::address addr = adc_trace_address();
 
         hw::memory::dsp dsp(module);
         hw::adc_trace_buffer adc_trace;
@@ -276,6 +275,11 @@ void channel::read_adc(hw::adc_word* buffer, size_t size) {
     }
 }
 
+hw::address channel::adc_trace_address() const {
+    return static_cast<hw::address>(
+        hw::memory::IO_BUFFER_ADDR + (number * (fixture->config.max_adc_trace_length / 2)));
+}
+
 void channel::read_histogram(hw::word_ptr values, const size_t size) {
     if (size != 0) {
         const hw::address addr =
@@ -21,6 +21,7 @@
  */
 
 #include <algorithm>
+#include <chrono>
 #include <future>
 #include <iomanip>
 #include <numeric>
@@ -28,6 +29,7 @@
 
 #include <pixie/config.hpp>
 #include <pixie/log.hpp>
+#include <pixie/utils/io.hpp>
 #include <pixie/utils/thread.hpp>
 
 #include <pixie/pixie16/backplane.hpp>
@@ -36,6 +38,28 @@
 namespace xia {
 namespace pixie {
 namespace crate {
+/*
+ * The longest period the boot blocks on a module before checking the
+ * others.
+ */
+static constexpr size_t boot_wait_msecs = 20;
+
+/*
+ * Block on a worker rather than sleeping so a wait ends as soon as the
+ * last worker has finished. The wait is bounded so the workers are
+ * checked in any order.
+ */
+static util::thread::waiter_func worker_waiter(util::thread::workers& workers) {
+    return [&workers](util::thread::workers::size_type ) {
+        for (auto& w : workers) {
+            if (w.future.valid()) {
+                w.future.wait_for(std::chrono::milliseconds(boot_wait_msecs));
+                break;
+            }
+        }
+    };
+}
+
 static void check_firmware(const firmware::system& firmware, const firmware::tag_type& tag) {
     if (!firmware::check(firmware, tag)) {
         throw error(error::code::module_invalid_firmware, "firmware not found: " + tag);
@@ -56,13 +80,71 @@ crate::boot_params::boot_params()
     : force(true), boot_comms(true), boot_fippi(true), boot_dsp(true) {
 }
 
+crate::boot_report::slot_report::slot_report(
+    const hw::slot_type slot_, const bool online_,
+    const module::module::boot_profile& profile_)
+    : slot(slot_), online(online_), profile(profile_) {
+}
+
+crate::boot_report::boot_report() {
+    clear();
+}
+
+void crate::boot_report::clear() {
+    slots.clear();
+    modules = 0;
+    backplane = 0;
+    total = 0;
+}
+
+crate::offsets_report::slot_report::slot_report(
+    const hw::slot_type slot_, const bool ok_,
+    const module::module::offsets_profile& profile_)
+    : slot(slot_), ok(ok_), profile(profile_) {
+}
+
+crate::offsets_report::offsets_report() {
+    clear();
+}
+
+void crate::offsets_report::clear() {
+    slots.clear();
+    total = 0;
+}
+
+void crate::offsets_report::output(std::ostream& out) const {
+    util::io::ostream_guard oguard(out);
+    out << std::fixed << std::setprecision(3)
+        << "adjust offsets: total=" << total << "ms" << std::endl;
+    for (auto& sr : slots) {
+        out << " slot " << std::setw(2) << sr.slot
+            << ": ok=" << std::boolalpha << sr.ok
+            << ' ' << sr.profile.output() << std::endl;
+    }
+}
+
+void crate::boot_report::output(std::ostream& out) const {
+    util::io::ostream_guard oguard(out);
+    out << std::fixed << std::setprecision(3)
+        << "boot: modules=" << modules << "ms backplane=" << backplane
+        << "ms total=" << total << "ms" << std::endl;
+    for (auto& sr : slots) {
+        out << " slot " << std::setw(2) << sr.slot
+            << ": online=" << std::boolalpha << sr.online
+            << ' ' << sr.profile.output() << std::endl;
+    }
+}
+
 crate::crate() :
     revision(-1), num_slots(0), num_present(0), num_online(0), num_offline(0),
-    ready_(false), users_(0) {
+    ready_(false), users_(0), boot_modules_period(0), boot_backplane_period(0),
+    boot_total_period(0) {
     event_funcs_clear();
 }
 
-crate::~crate() {}
+crate::~crate() {
+    mib_boot_remove();
+}
 
 void crate::ready() {
     if (!ready_.load()) {
@@ -164,6 +246,8 @@ void crate::initialize(bool reg_trace) {
         }
 
         backplane.init(hw::max_slots, num_present);
+
+        mib_boot_add();
     } catch (...) {
         ready_ = false;
         throw;
@@ -189,6 +273,7 @@ void crate::shutdown() {
         }
     }
     crate_event_call(crate_event::shutdown_end);
+    mib_boot_remove();
     if (num_online > 0) {
         throw error(error::code::module_total_invalid, "crate shutdown online count not 0");
     }
@@ -304,12 +389,20 @@ void crate::boot(const crate::boot_params params) {
     ready();
     lock_guard guard(lock_);
 
+    using clock = std::chrono::steady_clock;
+    using msecs = std::chrono::duration<double, std::milli>;
+
+    auto boot_start = clock::now();
+
     module::module_states state;
     capture_state(*this, state);
 
     crate_event_call(crate_event::boot_begin);
 
+    boot_report_.clear();
+
     util::thread::workers workers;
+    std::vector<module::module_ptr> booting;
 
     for (auto slot : slot_nums) {
         auto module = slots[slot];
@@ -320,6 +413,7 @@ void crate::boot(const crate::boot_params params) {
         auto fw_tag = module->get_fw_tag();
         check_firmware(firmware, fw_tag);
         slot_event_call(module->slot, slot_event::boot);
+        booting.push_back(module);
         workers.emplace_back([&self = *this, module, fw_tag = fw_tag, &params]() {
             module::module::boot_params mod_params;
             mod_params.boot_comms = params.boot_comms;
@@ -328,12 +422,19 @@ void crate::boot(const crate::boot_params params) {
             module->boot(mod_params, self.firmware);
         });
     }
+    auto modules_start = clock::now();
     for (auto& w : workers) {
         w.start();
     }
-    auto first_error = util::thread::wait_until_finished(workers, 20);
+    util::thread::waiter_func waiter = worker_waiter(workers);
+    util::thread::finished_func finished;
+    util::thread::error_func on_error;
+    auto first_error =
+        util::thread::wait_until_finished(workers, waiter, finished, on_error, "");
+    auto modules_end = clock::now();
 
     backplane_reinit();
+    auto backplane_end = clock::now();
 
     for (size_t slot = 0; slot < num_slots; ++slot) {
         auto& module = slots[slot];
@@ -350,6 +451,20 @@ void crate::boot(const crate::boot_params params) {
         }
     }
 
+    for (auto& module : booting) {
+        boot_report_.slots.emplace_back(module->slot, module->online(), module->boot_stats);
+    }
+    boot_report_.modules = msecs(modules_end - modules_start).count();
+    boot_report_.backplane = msecs(backplane_end - modules_end).count();
+    boot_report_.total = msecs(clock::now() - boot_start).count();
+    boot_modules_period = boot_report_.modules;
+    boot_backplane_period = boot_report_.backplane;
+    boot_total_period = boot_report_.total;
+
+    std::ostringstream oss;
+    boot_report_.output(oss);
+    xia_log(log::info) << "crate: " << oss.str();
+
     crate_event_call(crate_event::boot_end);
 
     if (first_error != error::code::success) {
@@ -357,6 +472,94 @@ void crate::boot(const crate::boot_params params) {
     }
 }
 
+crate::boot_report crate::get_boot_report() {
+    lock_guard guard(lock_);
+    return boot_report_;
+}
+
+void crate::adjust_offsets() {
+    xia_log(log::info) << "crate: adjust offsets";
+
+    ready();
+    lock_guard guard(lock_);
+
+    using clock = std::chrono::steady_clock;
+    using msecs = std::chrono::duration<double, std::milli>;
+    auto start = clock::now();
+
+    offsets_report_.clear();
+
+    util::thread::workers workers;
+    std::vector<module::module_ptr> adjusting;
+    for (size_t slot = 0; slot < num_slots; ++slot) {
+        auto module = slots[slot];
+        if (!module->online()) {
+            continue;
+        }
+        adjusting.push_back(module);
+        workers.emplace_back([module] {
+            module->adjust_offsets();
+        });
+    }
+    for (auto& w : workers) {
+        w.start();
+    }
+    std::vector<bool> failed(workers.size(), false);
+    util::thread::waiter_func waiter = worker_waiter(workers);
+    util::thread::finished_func finished;
+    util::thread::error_func on_error =
+        [&failed](util::thread::workers::size_type w, error::code) {
+            failed[w] = true;
+        };
+    auto first_error =
+        util::thread::wait_until_finished(workers, waiter, finished, on_error, "");
+
+    for (size_t m = 0; m < adjusting.size(); ++m) {
+        auto& module = adjusting[m];
+        offsets_report_.slots.emplace_back(module->slot, !failed[m], module->offsets_stats);
+    }
+    offsets_report_.total = msecs(clock::now() - start).count();
+
+    std::ostringstream oss;
+    offsets_report_.output(oss);
+    xia_log(log::info) << "crate: " << oss.str();
+
+    if (first_error != error::code::success) {
+        throw error(first_error, "crate adjust offsets error; see log");
+    }
+}
+
+crate::offsets_report crate::get_offsets_report() {
+    lock_guard guard(lock_);
+    return offsets_report_;
+}
+
+void crate::acquire_baselines() {
+    xia_log(log::info) << "crate: acquire baselines";
+
+    ready();
+    lock_guard guard(lock_);
+
+    util::thread::workers workers;
+    for (size_t slot = 0; slot < num_slots; ++slot) {
+        auto module = slots[slot];
+        if (!module->online()) {
+            continue;
+        }
+        workers.emplace_back([module] {
+            module->acquire_baselines();
+        });
+    }
+    for (auto& w : workers) {
+        w.start();
+    }
+    util::thread::waiter_func waiter = worker_waiter(workers);
+    util::thread::finished_func finished;
+    util::thread::error_func on_error;
+    util::thread::wait_until_finished(workers, waiter, finished, on_error,
+                                      "crate acquire baselines error; see log");
+}
+
 void crate::import_config(const std::string json_file, module::number_slots& loaded) {
     xia_log(log::info) << "crate: import configuration";
     ready();
@@ -395,6 +598,131 @@ void crate::initialize_afe() {
     util::thread::wait_until_finished(workers, 20, "crate AFE intialize error; see log");
 }
 
+void crate::param_transaction_begin() {
+    xia_log(log::info) << "crate: param transaction: begin";
+
+    ready();
+    lock_guard guard(lock_);
+
+    /*
+     * A failure aborts the transactions this call began so no module is
+     * left in a transaction.
+     */
+    std::vector<module::module_ptr> begun;
+    try {
+        for (size_t slot = 0; slot < num_slots; ++slot) {
+            auto module = slots[slot];
+            if (module->online()) {
+                module->param_transaction_begin();
+                begun.push_back(module);
+            }
+        }
+    } catch (...) {
+        for (auto& module : begun) {
+            try {
+                module->param_transaction_abort();
+            } catch (error& e) {
+                xia_log(log::error) << "crate: param transaction: begin: abort: slot="
+                                    << module->slot << ": " << e.what();
+            }
+        }
+        throw;
+    }
+}
+
+void crate::param_transaction_commit() {
+    xia_log(log::info) << "crate: param transaction: commit";
+
+    ready();
+    lock_guard guard(lock_);
+
+    util::thread::workers workers;
+    for (size_t slot = 0; slot < num_slots; ++slot) {
+        auto module = slots[slot];
+        if (!module->online()) {
+            continue;
+        }
+        workers.emplace_back([module] {
+            module->param_transaction_commit();
+        });
+    }
+    for (auto& w : workers) {
+        w.start();
+    }
+    util::thread::wait_until_finished(workers, 20, "crate param transaction commit error; see log");
+}
+
+void crate::param_transaction_abort() {
+    xia_log(log::info) << "crate: param transaction: abort";
+
+    ready();
+    lock_guard guard(lock_);
+
+    /*
+     * Every module aborts its transaction even if another fails.
+     */
+    util::thread::workers workers;
+    for (size_t slot = 0; slot < num_slots; ++slot) {
+        auto module = slots[slot];
+        if (!module->online()) {
+            continue;
+        }
+        workers.emplace_back([module] {
+            module->param_transaction_abort();
+        });
+    }
+    for (auto& w : workers) {
+        w.start();
+    }
+    util::thread::wait_until_finished(workers, 20, "crate param transaction abort error; see log");
+}
+
+void crate::spool_attach(data::list_mode::spool_writer_ptr writer) {
+    xia_log(log::info) << "crate: spool: attach";
+
+    ready();
+    lock_guard guard(lock_);
+
+    for (size_t slot = 0; slot < num_slots; ++slot) {
+        auto module = slots[slot];
+        if (module->online()) {
+            module->spool_attach(writer);
+        }
+    }
+}
+
+void crate::spool_detach() {
+    xia_log(log::info) << "crate: spool: detach";
+
+    ready();
+    lock_guard guard(lock_);
+
+    for (size_t slot = 0; slot < num_slots; ++slot) {
+        slots[slot]->spool_detach();
+    }
+}
+
+void crate::mib_boot_add() {
+    /*
+     * The nodes reference their container's elements so reserve the
+     * space before adding them.
+     */
+    mibs_boot.clear();
+    mibs_boot.reserve(3);
+    mibs_boot.emplace_back("crate.boot.modules", boot_modules_period);
+    mibs_boot.emplace_back("crate.boot.backplane", boot_backplane_period);
+    mibs_boot.emplace_back("crate.boot.total", boot_total_period);
+}
+
+void crate::mib_boot_remove() {
+    if (!mibs_boot.empty()) {
+        mibs_boot.clear();
+        mib::remove("crate.boot.total");
+        mib::remove("crate.boot.backplane");
+        mib::remove("crate.boot.modules");
+    }
+}
+
 void crate::backplane_reinit() {
     backplane.reinit(slots, num_present);
 }
@@ -630,9 +630,12 @@ void module::adjust_offsets() {
      * Run while the baseline of a channel is outside the percent+noise margin
      */
     bool run_again = true;
-    for (int run = 0; run_again && run < runs; ++run) {
+    int run = 0;
+    size_t converged = 0;
+    for (; run_again && run < runs; ++run) {
         log(log::debug) << log_leader << "adjust-offsets: run=" << run;
         run_again = false;
+        converged = 0;
         baseline::channels baselines;
         analyze_channel_baselines(baselines, 1);
         for (size_t chan = 0; chan < module_.num_channels; ++chan) {
@@ -717,6 +720,8 @@ void module::adjust_offsets() {
                     offsetdacs[chan] = std::make_pair(dac, std::get<0>(offsetdac));
                     channel.fixture->set_dac(dac);
                     run_again = true;
+                } else {
+                    ++converged;
                 }
             }
         }
@@ -731,6 +736,10 @@ void module::adjust_offsets() {
         module_.write_var(
             param::channel_var::OffsetDAC, std::get<0>(offsetdacs[chan]), chan);
     }
+    module_.offsets_stats.runs = size_t(run);
+    module_.offsets_stats.channels =
+        size_t(std::count(has_offset_dacs.begin(), has_offset_dacs.end(), true));
+    module_.offsets_stats.converged = converged;
     log(log::debug) << log_leader
                     << "adjust-offsets: duration=" << tp;
 }
@@ -765,12 +774,11 @@ void module::analyze_channel_baselines(
     for (auto& channel : module_.channels) {
         baselines[channel.number].start(channel.number, channel.fixture->config.adc_bits);
     }
+    xia::pixie::hw::adc_traces adc_traces;
     for (int t = 0; t < traces; ++t) {
-        module_.get_traces();
+        module_.read_adc_all(adc_traces);
         for (auto& channel : module_.channels) {
-            xia::pixie::hw::adc_trace trace;
-            module_.read_adc(channel.number, trace, false);
-            baselines[channel.number].update(trace);
+            baselines[channel.number].update(adc_traces[channel.number]);
         }
     }
     for (auto& bl : baselines) {
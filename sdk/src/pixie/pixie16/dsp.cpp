@@ -75,6 +75,11 @@ namespace xia {
 namespace pixie {
 namespace hw {
 namespace dsp {
+/*
+ * The time the DSP has to set PowerUpInitDone after it is loaded.
+ */
+static constexpr size_t init_done_timeout_usecs = 10000;
+
 dsp::dsp(module::module& module_, bool trace_)
     : module(module_), online(false), trace(trace_), hbr(module_, false) {}
 
@@ -213,16 +218,9 @@ void dsp::boot(const firmware::image& image, int retries) {
              * internal memory.
              */
             guard.unlock();
-            size_t retry = 10;
-            while (--retry > 0) {
-                if (init_done()) {
-                    running = true;
-                    break;
-                }
-                wait(1000);
-            }
+            running = poll([this] { return init_done(); }, init_done_timeout_usecs);
             guard.lock();
-            if (retry == 0) {
+            if (!running) {
                 throw error(error::code::device_boot_failure, make_what("DSP failed to start"));
             }
         } catch (error& e) {
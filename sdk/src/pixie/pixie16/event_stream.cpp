@@ -0,0 +1,105 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+
+/*
+ * Copyright 2021 XIA LLC, All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** @file event_stream.cpp
+ * @brief Implements a crate's time ordered list-mode event stream.
+ */
+
+#include <pixie/log.hpp>
+
+#include <pixie/pixie16/event_stream.hpp>
+
+namespace xia {
+namespace pixie {
+namespace crate {
+event_stream::event_stream(crate& crate__, record::time_type reorder_window,
+                           record::time_type coincidence_window, size_t max_events,
+                           size_t idle_msecs)
+    : crate_(crate__), merger_(reorder_window, max_events, idle_msecs),
+      grouper(coincidence_window), words_(0) {}
+
+size_t event_stream::add(hw::slot_type slot) {
+    auto module = crate_.find(slot);
+    if (!module->online()) {
+        throw error(pixie::error::code::module_offline,
+                    "event stream: module not online: slot=" + std::to_string(slot));
+    }
+    if (module->eeprom.configs.empty()) {
+        throw error(pixie::error::code::module_invalid_operation,
+                    "event stream: module has no ADC config: slot=" + std::to_string(slot));
+    }
+    auto revision = module->list_mode_revision;
+    if (revision == 0) {
+        throw error(pixie::error::code::module_invalid_firmware,
+                    "event stream: module has no list-mode revision: slot=" +
+                        std::to_string(slot));
+    }
+    auto frequency = uint32_t(module->eeprom.configs[0].adc_msps);
+    auto index = merger_.add_stream(revision, frequency);
+    modules.push_back(module);
+    xia_log(log::info) << "event stream: add: slot=" << slot << " stream=" << index
+                       << " revision=" << revision << " frequency=" << frequency;
+    return index;
+}
+
+void event_stream::read_modules() {
+    for (size_t m = 0; m < modules.size(); ++m) {
+        lent.clear();
+        modules[m]->read_list_mode(lent);
+        for (auto& buf : lent) {
+            merger_.push(m, buf.data(), buf.size());
+            words_ += buf.size();
+        }
+        lent.clear();
+    }
+}
+
+void event_stream::check_grouping() const {
+    if (grouper.window == record::time_type(0)) {
+        throw error(pixie::error::code::invalid_value,
+                    "event stream: no coincidence window");
+    }
+}
+
+size_t event_stream::read(records& out) {
+    read_modules();
+    return merger_.pull(out);
+}
+
+size_t event_stream::read(groups& out) {
+    check_grouping();
+    ordered.clear();
+    read(ordered);
+    return grouper.push(ordered, out);
+}
+
+size_t event_stream::finish(records& out) {
+    read_modules();
+    return merger_.flush(out);
+}
+
+size_t event_stream::finish(groups& out) {
+    check_grouping();
+    ordered.clear();
+    finish(ordered);
+    auto count = grouper.push(ordered, out);
+    return count + grouper.flush(out);
+}
+}  // namespace crate
+}  // namespace pixie
+}  // namespace xia
@@ -33,6 +33,13 @@ namespace xia {
 namespace pixie {
 namespace hw {
 namespace fpga {
+/*
+ * The time an FPGA has to clear and to report done after it is
+ * programmed. The status is polled adaptively within the timeout.
+ */
+static constexpr size_t clear_timeout_usecs = 25000;
+static constexpr size_t done_timeout_usecs = 25000;
+
 /*
  * The module bus lock is not held here. Hold at the
  * FPGA instance level.
@@ -69,7 +76,6 @@ void control::load(const firmware::image& image, int& backoff, int retries) {
         uint32_t data;
 
         bool cleared = false;
-        int timeout_msec = 25;
 
         while (!cleared) {
             xia_log(log::debug) << "fpga-" << name << " [slot " << module.slot
@@ -96,29 +102,21 @@ void control::load(const firmware::image& image, int& backoff, int retries) {
             data |= load_ctrl.set;
             bus_write(reg.CTRLCS, data, backoff);
 
-            while (true) {
-                wait(1000);
-                data = bus_read(reg.RDCS);
-                if ((data & clear_ctrl.done) == clear_ctrl.done) {
-                    /*
-                     * Clear
-                     */
-                    cleared = true;
-                    break;
-                }
-                --timeout_msec;
-                if (timeout_msec <= 0) {
-                    --retries;
-                    if (retries <= 0) {
-                        throw error(
-                            error::code::device_load_failure, make_what("clear failure"));
-                    }
-                    backoff += backoff_step;
-                    xia_log(log::debug) << "fpga-" << name
-                                        << " [slot " << module.slot
-                                        << "] retry: backoff=" << backoff;
-                    break;
+            cleared = poll(
+                [this] {
+                    return (bus_read(reg.RDCS) & clear_ctrl.done) == clear_ctrl.done;
+                },
+                clear_timeout_usecs);
+            if (!cleared) {
+                --retries;
+                if (retries <= 0) {
+                    throw error(
+                        error::code::device_load_failure, make_what("clear failure"));
                 }
+                backoff += backoff_step;
+                xia_log(log::debug) << "fpga-" << name
+                                    << " [slot " << module.slot
+                                    << "] retry: backoff=" << backoff;
             }
         }
 
@@ -142,31 +140,17 @@ void control::load(const firmware::image& image, int& backoff, int retries) {
         xia_log(log::debug) << "fpga-" << name
                             << " [slot " << module.slot << "] waiting for done";
 
-        timeout_msec = 25;
-
-        while (true) {
-            wait(1000);
-            auto is_done = done();
-            if (is_done) {
-                /*
-                 * Programmed
-                 */
-                programmed = true;
-                break;
-            }
-            --timeout_msec;
-            if (timeout_msec <= 0) {
-                --retries;
-                if (retries <= 0) {
-                    throw error(
-                        error::code::device_load_failure, make_what("programming failure"));
-                }
-                backoff += backoff_step;
-                xia_log(log::debug) << "fpga-" << name
-                                    << " [slot " << module.slot
-                                    << "] retry: backoff=" << backoff;
-                break;
+        programmed = poll([this] { return done(); }, done_timeout_usecs);
+        if (!programmed) {
+            --retries;
+            if (retries <= 0) {
+                throw error(
+                    error::code::device_load_failure, make_what("programming failure"));
             }
+            backoff += backoff_step;
+            xia_log(log::debug) << "fpga-" << name
+                                << " [slot " << module.slot
+                                << "] retry: backoff=" << backoff;
         }
     }
 
@@ -0,0 +1,275 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+
+/*
+ * Copyright 2021 XIA LLC, All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** @file histogram_monitor.cpp
+ * @brief Implements a monitor that publishes the changes in channel histograms.
+ */
+
+#include <algorithm>
+
+#include <pixie/log.hpp>
+
+#include <pixie/pixie16/histogram_monitor.hpp>
+
+namespace xia {
+namespace pixie {
+namespace crate {
+histogram_monitor::module_state::module_state(module::module_ptr module_)
+    : module(module_), stats(*module_) {}
+
+histogram_monitor::histogram_monitor(crate& crate__, clock::duration min_period_,
+                                     clock::duration max_period_)
+    : target_counts(default_target_counts), max_gap(default_max_gap), min_period(min_period_),
+      max_period(max_period_), crate_(crate__), next_handle(1), words_read_(0),
+      words_published_(0), running_(false) {
+    if (min_period > max_period) {
+        throw error(pixie::error::code::invalid_value,
+                    "histogram monitor: minimum period greater than the maximum period");
+    }
+}
+
+histogram_monitor::~histogram_monitor() {
+    stop();
+}
+
+histogram_monitor::module_state& histogram_monitor::find_module(hw::slot_type slot) {
+    for (auto& mod : modules) {
+        if (mod.module->slot == slot) {
+            return mod;
+        }
+    }
+    crate_.ready();
+    auto module = crate_.find(slot);
+    if (!module->online()) {
+        throw error(pixie::error::code::module_offline,
+                    "histogram monitor: module not online: slot=" + std::to_string(slot));
+    }
+    modules.emplace_back(module);
+    return modules.back();
+}
+
+void histogram_monitor::watch(hw::slot_type slot) {
+    std::lock_guard<std::recursive_mutex> guard(lock);
+    auto& mod = find_module(slot);
+    for (size_t channel = 0; channel < mod.module->num_channels; ++channel) {
+        watch(slot, channel);
+    }
+}
+
+void histogram_monitor::watch(hw::slot_type slot, size_t channel) {
+    std::lock_guard<std::recursive_mutex> guard(lock);
+    auto& mod = find_module(slot);
+    mod.module->channel_check(channel);
+    for (auto& chan : mod.channels) {
+        if (chan.number == channel) {
+            return;
+        }
+    }
+    channel_state chan;
+    chan.number = channel;
+    chan.sequence = 0;
+    chan.due = clock::now();
+    mod.channels.push_back(std::move(chan));
+    std::sort(mod.channels.begin(), mod.channels.end(),
+              [](const channel_state& a, const channel_state& b) { return a.number < b.number; });
+    xia_log(log::info) << "histogram monitor: watch: slot=" << slot << " channel=" << channel;
+}
+
+size_t histogram_monitor::subscribe(subscriber func) {
+    std::lock_guard<std::recursive_mutex> guard(lock);
+    auto handle = next_handle++;
+    subscribers.emplace_back(handle, func);
+    return handle;
+}
+
+void histogram_monitor::unsubscribe(size_t handle) {
+    std::lock_guard<std::recursive_mutex> guard(lock);
+    subscribers.erase(std::remove_if(subscribers.begin(), subscribers.end(),
+                                     [handle](const std::pair<size_t, subscriber>& sub) {
+                                         return sub.first == handle;
+                                     }),
+                      subscribers.end());
+}
+
+size_t histogram_monitor::poll() {
+    std::lock_guard<std::recursive_mutex> guard(lock);
+    const auto now = clock::now();
+    size_t deltas = 0;
+    for (auto& mod : modules) {
+        size_t due = 0;
+        for (auto& chan : mod.channels) {
+            if (chan.due <= now) {
+                ++due;
+            }
+        }
+        if (due == 0) {
+            continue;
+        }
+        auto& module = *mod.module;
+        module.read_stats(mod.stats);
+        /*
+         * Read all of the module's histograms with one transfer if all of
+         * its channels are due.
+         */
+        const bool all = due == module.num_channels;
+        if (all) {
+            mod.histograms.resize(module.histograms_length());
+            module.read_histograms(mod.histograms);
+            words_read_ += mod.histograms.size();
+        }
+        for (auto& chan : mod.channels) {
+            if (chan.due > now) {
+                continue;
+            }
+            const auto length = module.channels[chan.number].fixture->config.max_histogram_length;
+            chan.current.resize(length);
+            if (all) {
+                auto first = mod.histograms.begin() +
+                    ptrdiff_t(chan.number * module.max_histogram_length);
+                std::copy(first, first + ptrdiff_t(std::min(length, module.max_histogram_length)),
+                          chan.current.begin());
+            } else {
+                module.read_histogram(chan.number, chan.current);
+                words_read_ += length;
+            }
+            update(mod, chan, now);
+            if (published.bins > 0) {
+                ++deltas;
+            }
+        }
+    }
+    return deltas;
+}
+
+void histogram_monitor::update(module_state& mod, channel_state& chan, clock::time_point now) {
+    published.slot = mod.module->slot;
+    published.channel = chan.number;
+    published.sequence = chan.sequence;
+    published.length = chan.current.size();
+    published.changes.clear();
+    if (chan.sequence == 0 || chan.previous.size() != chan.current.size()) {
+        published.sequence = chan.sequence = 0;
+        published.changes.push_back({0, chan.current});
+        published.bins = chan.current.size();
+    } else {
+        published.bins = diff(chan.previous, chan.current, published.changes, max_gap);
+    }
+    if (published.bins > 0) {
+        for (auto& sub : subscribers) {
+            sub.second(published);
+        }
+        words_published_ += published.bins;
+        ++chan.sequence;
+    }
+    std::swap(chan.previous, chan.current);
+    chan.due = now + period(mod.stats.chans[chan.number]);
+}
+
+histogram_monitor::clock::duration histogram_monitor::period(
+    const stats::channel& stats) const {
+    const auto rate = stats.output_count_rate();
+    if (!(rate > 0)) {
+        return max_period;
+    }
+    auto wanted = std::chrono::duration_cast<clock::duration>(
+        std::chrono::duration<double>(target_counts / rate));
+    return std::max(min_period, std::min(max_period, wanted));
+}
+
+histogram_monitor::clock::time_point histogram_monitor::next_poll() {
+    std::lock_guard<std::recursive_mutex> guard(lock);
+    auto next = clock::now() + max_period;
+    for (auto& mod : modules) {
+        for (auto& chan : mod.channels) {
+            next = std::min(next, chan.due);
+        }
+    }
+    return next;
+}
+
+size_t histogram_monitor::diff(const hw::words& previous, const hw::words& current,
+                               ranges& changes, size_t max_gap_) {
+    if (previous.size() != current.size()) {
+        throw error(pixie::error::code::invalid_value,
+                    "histogram monitor: diff: histogram lengths do not match");
+    }
+    size_t bins = 0;
+    size_t bin = 0;
+    const size_t length = current.size();
+    while (bin < length) {
+        if (previous[bin] == current[bin]) {
+            ++bin;
+            continue;
+        }
+        /*
+         * The range ends at the last changed bin before a gap of more than
+         * the maximum gap.
+         */
+        const size_t start = bin;
+        size_t end = bin + 1;
+        size_t next = end;
+        while (next < length && next - end <= max_gap_) {
+            if (previous[next] != current[next]) {
+                end = next + 1;
+            }
+            ++next;
+        }
+        changes.push_back({start, hw::words(current.begin() + ptrdiff_t(start),
+                                            current.begin() + ptrdiff_t(end))});
+        bins += end - start;
+        bin = end;
+    }
+    return bins;
+}
+
+void histogram_monitor::start() {
+    if (!running_.exchange(true)) {
+        thread = std::thread(&histogram_monitor::worker, this);
+    }
+}
+
+void histogram_monitor::stop() {
+    {
+        std::lock_guard<std::mutex> guard(wait_lock);
+        running_ = false;
+    }
+    wait_cv.notify_all();
+    if (thread.joinable()) {
+        thread.join();
+    }
+}
+
+void histogram_monitor::worker() {
+    xia_log(log::info) << "histogram monitor: running";
+    while (running_.load()) {
+        auto next = clock::now() + min_period;
+        try {
+            poll();
+            next = next_poll();
+        } catch (pixie::error::error& e) {
+            xia_log(log::error) << "histogram monitor: " << e.what();
+            next = clock::now() + max_period;
+        }
+        std::unique_lock<std::mutex> wait_guard(wait_lock);
+        wait_cv.wait_until(wait_guard, next, [this] { return !running_.load(); });
+    }
+    xia_log(log::info) << "histogram monitor: stopped";
+}
+}  // namespace crate
+}  // namespace pixie
+}  // namespace xia
@@ -20,6 +20,7 @@
  * @brief Implements hardware specific data for the Pixie-16 modules.
  */
 
+#include <algorithm>
 #include <chrono>
 #include <thread>
 
@@ -105,6 +106,26 @@ void wait(size_t microseconds) {
         std::this_thread::sleep_for(std::chrono::microseconds(microseconds));
     }
 }
+
+bool poll(const std::function<bool()>& ready, size_t timeout_usecs,
+          size_t first_usecs, size_t max_usecs) {
+    const auto start = std::chrono::steady_clock::now();
+    const auto timeout = std::chrono::microseconds(timeout_usecs);
+    size_t period = std::max(first_usecs, size_t(1));
+    while (true) {
+        if (ready()) {
+            return true;
+        }
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        if (elapsed >= timeout) {
+            return false;
+        }
+        auto remaining = std::chrono::duration_cast<std::chrono::microseconds>(
+            timeout - elapsed);
+        wait(std::min(period, size_t(remaining.count()) + 1));
+        period = std::min(period * 2, std::max(max_usecs, first_usecs));
+    }
+}
 };  // namespace hw
 };  // namespace pixie
 };  // namespace xia
@@ -137,6 +137,7 @@ void settings::write(module::module& module) {
     hw::words regs(dsp_mem);
     regs.resize(DSP_IO_BORDER);
     dsp.write(addresses.full.start, regs);
+    module.vars_shadow_invalidate();
 }
 
 param::value_type settings::read_var(param::module_var var, int module, size_t offset) const {
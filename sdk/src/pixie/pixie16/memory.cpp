@@ -120,11 +120,15 @@ void host_bus::write(const size_t channel, const size_t offset, const address ad
 }
 
 void host_bus::write(const address addr, const words& values) {
+    write(addr, values.data(), values.size());
+}
+
+void host_bus::write(const address addr, const_word_ptr values, const size_t length) {
     module::module::bus_guard guard(module);
     hbr::host_bus_request hbr(module, access);
     bus_write(hw::device::EXT_MEM_TEST, addr);
-    for (auto value : values) {
-        bus_write(hw::device::WRT_DSP_MMA, value);
+    for (size_t w = 0; w < length; ++w) {
+        bus_write(hw::device::WRT_DSP_MMA, values[w]);
     }
 }
 
@@ -225,8 +229,32 @@ void mca::write(const address addr, const_word_ptr values, const size_t size) {
     }
 }
 
+void mca::clear(const address addr, const size_t size) {
+    module::module::bus_guard guard(module);
+
+    /*
+     * Guard the PCI active  bit, so it is cleared when we exit.
+     */
+    csr::set_clear csr(module, 1 << hw::bit::PCIACTIVE);
+
+    bus_write(hw::device::WRT_EXT_MEM, addr);
+    for (size_t i = 0; i < size; i++) {
+        bus_write(MCA_MEM_DATA, 0);
+    }
+}
+
 fifo::fifo(module::module& module_) : bus(module_) {}
 
+fifo::~fifo() {
+    if (read_pending()) {
+        try {
+            read_wait();
+        } catch (...) {
+            /* any error will be logged */
+        }
+    }
+}
+
 size_t fifo::level() {
     module::module::bus_guard guard(module);
     return size_t(bus_read(hw::device::RD_WRT_FIFO_WML));
@@ -234,7 +262,32 @@ size_t fifo::level() {
 
 void fifo::read(word_ptr buffer, const size_t length) {
     module::module::bus_guard guard(module);
+    wait_watermark(length);
+    module.dma_read(FIFO_MEM_DMA, buffer, length);
+}
 
+void fifo::read_start(word_ptr buffer, const size_t length) {
+    if (read_pending()) {
+        throw module::error(module.number, module.slot, module::error::code::device_fifo_failure,
+                            "FIFO read already in flight");
+    }
+    auto guard = std::make_unique<module::module::bus_guard>(module);
+    wait_watermark(length);
+    module.dma_read_start(FIFO_MEM_DMA, buffer, length);
+    dma_guard = std::move(guard);
+}
+
+void fifo::read_wait() {
+    if (read_pending()) {
+        /*
+         * Release the bus even if the transfer failed.
+         */
+        auto guard = std::move(dma_guard);
+        module.dma_read_wait();
+    }
+}
+
+void fifo::wait_watermark(const size_t length) {
     bus_write(hw::device::SET_EXT_FIFO, hw::word(length));
 
     size_t polls = 1000;
@@ -247,8 +300,6 @@ void fifo::read(word_ptr buffer, const size_t length) {
         throw module::error(module.number, module.slot, module::error::code::device_fifo_failure,
                             "FIFO failed to reach watermark");
     }
-
-    module.dma_read(FIFO_MEM_DMA, buffer, length);
 }
 };  // namespace memory
 };  // namespace hw
@@ -23,8 +23,10 @@
 #include <algorithm>
 #include <cctype>
 #include <cmath>
+#include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <limits>
 #include <sstream>
 
 #include <pixie/log.hpp>
@@ -199,6 +201,12 @@ struct pci_bus_handle {
     PLX_DEVICE_KEY key;
     PLX_DMA_PROP dma;
 
+    /*
+     * Asynchronous DMA completion.
+     */
+    PLX_NOTIFY_OBJECT dma_notify;
+    bool dma_pending;
+
     uint32_t mailboxes[num_mailboxes];
 
     pci_bus_handle();
@@ -208,6 +216,11 @@ struct pci_bus_handle {
     unsigned int pci_bus() const;
     unsigned int pci_slot() const;
 
+    /*
+     * The NUMA node of the device, -1 if not known.
+     */
+    int numa_node() const;
+
     /*
      * Read the mailboxes
      */
@@ -316,21 +329,24 @@ static void plx_mailbox_write(
     }
 }
 
-pci_bus_handle::pci_bus_handle() : device_number(-1) {
+pci_bus_handle::pci_bus_handle() : device_number(-1), dma_pending(false) {
     ::memset(&key, PCI_FIELD_IGNORE, sizeof(PLX_DEVICE_KEY));
+    ::memset(&dma_notify, 0, sizeof(PLX_NOTIFY_OBJECT));
 }
 
 pci_bus_handle::pci_bus_handle(int number, PLX_DEVICE_KEY key_)
-     : device_number(number)  {
+     : device_number(number), dma_pending(false)  {
     ::memcpy(&key, &key_, sizeof(PLX_DEVICE_KEY));
     ::memset(&dma, 0, sizeof(PLX_DMA_PROP));
+    ::memset(&dma_notify, 0, sizeof(PLX_NOTIFY_OBJECT));
     ::memset(mailboxes, 0, sizeof(mailboxes));
 }
 
 pci_bus_handle::pci_bus_handle(const pci_bus_handle& other)
-     : device_number(other.device_number)  {
+     : device_number(other.device_number), dma_pending(false)  {
     ::memcpy(&key, &other.key, sizeof(PLX_DEVICE_KEY));
     ::memset(&dma, 0, sizeof(PLX_DMA_PROP));
+    ::memset(&dma_notify, 0, sizeof(PLX_NOTIFY_OBJECT));
     ::memset(mailboxes, 0, sizeof(mailboxes));
 }
 
@@ -349,6 +365,23 @@ unsigned int pci_bus_handle::pci_slot() const {
     return val;
 }
 
+int pci_bus_handle::numa_node() const {
+    int node = -1;
+#if !defined(_WIN64) && !defined(_WIN32)
+    if (device_number >= 0) {
+        std::ostringstream path;
+        path << "/sys/bus/pci/devices/" << std::hex << std::setfill('0') << std::setw(4)
+             << pci_domain() << ':' << std::setw(2) << pci_bus() << ':' << std::setw(2)
+             << pci_slot() << '.' << int(key.function) << "/numa_node";
+        std::ifstream input(path.str());
+        if (!(input >> node)) {
+            node = -1;
+        }
+    }
+#endif
+    return node;
+}
+
 void pci_bus_handle::read_mailboxes(const hw::slot_type slot) {
     for (size_t mb = 0; mb < num_mailboxes; ++mb) {
         mailboxes[mb] = plx_mailbox_read(*this, slot, mb);
@@ -538,7 +571,7 @@ module::fifo_stats::fifo_stats(const module::fifo_stats& s)
       overflows(s.overflows.load()), dropped(s.dropped.load()),
       hw_overflows(s.hw_overflows.load()), bandwidth(s.bandwidth.load()),
       max_bandwidth(s.max_bandwidth.load()), min_bandwidth(s.min_bandwidth.load()),
-      last_update(0), last_dma_in(0) {
+      start_latency(s.start_latency.load()), last_update(0), last_dma_in(0) {
 }
 
 void module::fifo_stats::start() {
@@ -567,6 +600,7 @@ void module::fifo_stats::clear() {
     bandwidth = 0;
     max_bandwidth = 0;
     min_bandwidth = 0;
+    start_latency = 0;
     interval.reset();
     last_update = 0;
     last_dma_in = 0;
@@ -585,6 +619,7 @@ module::fifo_stats& module::fifo_stats::operator=(const module::fifo_stats& s) {
     bandwidth = s.bandwidth.load();
     max_bandwidth = s.max_bandwidth.load();
     min_bandwidth = s.min_bandwidth.load();
+    start_latency = s.start_latency.load();
     return *this;
 }
 
@@ -618,7 +653,102 @@ std::string module::fifo_stats::output() const {
         << " out=" << get_out_bytes()
         << " dma-in=" << get_dma_in_bytes()
         << " overflows=" << overflows.load() << " dropped=" << dropped.load()
-        << " hw-overflows=" << hw_overflows.load();
+        << " hw-overflows=" << hw_overflows.load()
+        << " start-latency=" << start_latency.load() << "ms";
+    return oss.str();
+}
+
+module::boot_profile::timer::timer(boot_profile& profile_)
+    : profile(profile_), start(clock::now()), last(start) {
+    profile.clear();
+}
+
+module::boot_profile::timer::~timer() {
+    profile.total = std::chrono::duration<double, std::milli>(clock::now() - start).count();
+}
+
+void module::boot_profile::timer::mark(std::atomic<double>& period) {
+    auto now = clock::now();
+    period = std::chrono::duration<double, std::milli>(now - last).count();
+    last = now;
+}
+
+module::boot_profile::boot_profile() {
+    clear();
+}
+
+module::boot_profile::boot_profile(const boot_profile& p)
+    : validate(p.validate.load()), comms(p.comms.load()), fippi(p.fippi.load()),
+      dsp(p.dsp.load()), init(p.init.load()), afe(p.afe.load()), total(p.total.load()) {
+}
+
+void module::boot_profile::clear() {
+    validate = 0;
+    comms = 0;
+    fippi = 0;
+    dsp = 0;
+    init = 0;
+    afe = 0;
+    total = 0;
+}
+
+module::param_transaction::param_transaction() {
+    clear();
+}
+
+void module::param_transaction::clear() {
+    active = false;
+    suspended = false;
+    program_fippi = false;
+    set_dacs = false;
+    sync_csrb = false;
+    flushed = false;
+    values.clear();
+    dirty.clear();
+}
+
+module::boot_profile& module::boot_profile::operator=(const boot_profile& p) {
+    validate = p.validate.load();
+    comms = p.comms.load();
+    fippi = p.fippi.load();
+    dsp = p.dsp.load();
+    init = p.init.load();
+    afe = p.afe.load();
+    total = p.total.load();
+    return *this;
+}
+
+std::string module::boot_profile::output() const {
+    std::ostringstream oss;
+    oss << std::fixed << std::setprecision(3)
+        << "validate=" << validate.load()
+        << "ms comms=" << comms.load()
+        << "ms fippi=" << fippi.load()
+        << "ms dsp=" << dsp.load()
+        << "ms init=" << init.load()
+        << "ms afe=" << afe.load()
+        << "ms total=" << total.load() << "ms";
+    return oss.str();
+}
+
+module::offsets_profile::offsets_profile() {
+    clear();
+}
+
+void module::offsets_profile::clear() {
+    runs = 0;
+    channels = 0;
+    converged = 0;
+    period = 0;
+}
+
+std::string module::offsets_profile::output() const {
+    std::ostringstream oss;
+    oss << std::fixed << std::setprecision(3)
+        << "runs=" << runs
+        << " channels=" << channels
+        << " converged=" << converged
+        << " period=" << period << "ms";
     return oss.str();
 }
 
@@ -669,15 +799,19 @@ module::module(backplane::backplane& backplane_)
     : slot(hw::slot_invalid), number(-1), serial_num(0), revision(0), major_revision(0),
       minor_revision(0), num_channels(0), max_channels(0), vmaddr(nullptr), open_count(0), backplane(backplane_),
       eeprom_format(-1), run_task(hw::run::run_task::nop), control_task(hw::run::control_task::nop),
+      last_control_task(hw::run::control_task::nop),
       fifo_buffers(default_fifo_buffers), fifo_run_wait_usecs(default_fifo_run_wait_usec),
       fifo_idle_wait_usecs(default_fifo_idle_wait_usec), fifo_hold_usecs(default_fifo_hold_usec),
       fifo_dma_trigger_level(default_fifo_dma_trigger_level), fifo_bandwidth(0),
-      crate_revision(-1), board_revision(-1), reg_trace(false), i2c_read_period(100),
+      fifo_dma_pipeline(false), fifo_dma_stuck(false),
+      crate_revision(-1), board_revision(-1), list_mode_revision(0), reg_trace(false),
+      i2c_read_period(100),
       io_cpld_version_old(false), fifo_worker_running(false), fifo_worker_finished(false),
       fifo_worker_req(fifo_worker_working), fifo_worker_resp(fifo_worker_working), in_use(0),
       opened_(false), online_(false), forced_offline_(false), pause_fifo_worker(true),
       comms_fpga(false), fippi_fpga(false), dsp_online(false), have_hardware(false),
-      vars_loaded(false), cfg_ctrlcs(0xaaa), device(std::make_unique<pci_bus_handle>()),
+      vars_loaded(false), vars_shadowed(false), cfg_ctrlcs(0xaaa),
+      device(std::make_unique<pci_bus_handle>()),
       test_mode(test::off) {
     std::call_once(devices.devices_found, []() {
         devices.get_pci_devices();
@@ -692,22 +826,27 @@ module::module(module&& m)
       module_vars(std::move(m.module_vars)),
       channel_var_descriptors(std::move(m.channel_var_descriptors)),
       channels(std::move(m.channels)), run_task(m.run_task.load()),
-      control_task(m.control_task.load()), fifo_buffers(m.fifo_buffers),
+      control_task(m.control_task.load()), last_control_task(m.last_control_task.load()),
+      fifo_buffers(m.fifo_buffers),
       fifo_run_wait_usecs(m.fifo_run_wait_usecs.load()),
       fifo_idle_wait_usecs(m.fifo_idle_wait_usecs.load()),
       fifo_hold_usecs(m.fifo_hold_usecs.load()),
       fifo_dma_trigger_level(m.fifo_dma_trigger_level.load()),
       fifo_bandwidth(m.fifo_bandwidth.load()),
-      run_stats(m.run_stats), crate_revision(m.crate_revision),
-      board_revision(m.board_revision), reg_trace(m.reg_trace), i2c_read_period(100),
+      fifo_dma_pipeline(m.fifo_dma_pipeline.load()), fifo_dma_stuck(m.fifo_dma_stuck.load()),
+      run_stats(m.run_stats), boot_stats(m.boot_stats), offsets_stats(m.offsets_stats),
+      crate_revision(m.crate_revision),
+      board_revision(m.board_revision), list_mode_revision(m.list_mode_revision),
+      reg_trace(m.reg_trace), i2c_read_period(100),
       io_cpld_version_old(false), fifo_worker_running(false), fifo_worker_finished(false),
       fifo_worker_req(fifo_worker_working), fifo_worker_resp(fifo_worker_working),
-      in_use(0), opened_(m.opened_.load()), online_(m.online_.load()),
+      spool(std::move(m.spool)), in_use(0), opened_(m.opened_.load()), online_(m.online_.load()),
       forced_offline_(m.forced_offline_.load()), pause_fifo_worker(m.pause_fifo_worker.load()),
       comms_fpga(m.comms_fpga), fippi_fpga(m.fippi_fpga), dsp_online(m.dsp_online),
-      have_hardware(m.have_hardware), vars_loaded(false), cfg_ctrlcs(0xaaa),
+      have_hardware(m.have_hardware), vars_loaded(false), vars_shadowed(false), cfg_ctrlcs(0xaaa),
       device(std::move(m.device)), test_mode(m.test_mode.load()), persistent(std::move(m.persistent)),
-      mibs_size_t_rw(std::move(m.mibs_size_t_rw)), mibs_double_rw(std::move(m.mibs_double_rw)) {
+      mibs_size_t_rw(std::move(m.mibs_size_t_rw)), mibs_double_rw(std::move(m.mibs_double_rw)),
+      mibs_boot(std::move(m.mibs_boot)) {
     m.slot = hw::slot_invalid;
     m.number = -1;
     m.serial_num = 0;
@@ -726,15 +865,21 @@ module::module(module&& m)
     m.channels.clear();
     m.run_task = hw::run::run_task::nop;
     m.control_task = hw::run::control_task::nop;
+    m.last_control_task = hw::run::control_task::nop;
     m.fifo_buffers = default_fifo_buffers;
     m.fifo_run_wait_usecs = default_fifo_run_wait_usec;
     m.fifo_idle_wait_usecs = default_fifo_idle_wait_usec;
     m.fifo_hold_usecs = default_fifo_hold_usec;
     m.fifo_dma_trigger_level = default_fifo_dma_trigger_level;
     m.fifo_bandwidth = 0;
+    m.fifo_dma_pipeline = false;
+    m.fifo_dma_stuck = false;
     m.run_stats.clear();
+    m.boot_stats.clear();
+    m.offsets_stats.clear();
     m.crate_revision = -1;
     m.board_revision = -1;
+    m.list_mode_revision = 0;
     m.reg_trace = false;
     m.opened_ = false;
     m.online_ = false;
@@ -745,10 +890,12 @@ module::module(module&& m)
     m.dsp_online = false;
     m.have_hardware = false;
     m.vars_loaded = false;
+    m.vars_shadowed = false;
     m.cfg_ctrlcs = 0xaaa;
     m.test_mode = test::off;
     m.mibs_size_t_rw.clear();
     m.mibs_double_rw.clear();
+    m.mibs_boot.clear();
     m.hw_word_read = nullptr;
     m.hw_word_write = nullptr;
 }
@@ -790,15 +937,22 @@ module& module::operator=(module&& m) {
     channels = std::move(m.channels);
     run_task = m.run_task.load();
     control_task = m.control_task.load();
+    last_control_task = m.last_control_task.load();
     fifo_buffers = m.fifo_buffers;
     fifo_run_wait_usecs = m.fifo_run_wait_usecs.load();
     fifo_idle_wait_usecs = m.fifo_idle_wait_usecs.load();
     fifo_hold_usecs = m.fifo_hold_usecs.load();
     fifo_dma_trigger_level = m.fifo_dma_trigger_level.load();
     fifo_bandwidth = m.fifo_bandwidth.load();
+    fifo_dma_pipeline = m.fifo_dma_pipeline.load();
+    fifo_dma_stuck = m.fifo_dma_stuck.load();
+    spool = std::move(m.spool);
     run_stats = m.run_stats;
+    boot_stats = m.boot_stats;
+    offsets_stats = m.offsets_stats;
     crate_revision = m.crate_revision;
     board_revision = m.board_revision;
+    list_mode_revision = m.list_mode_revision;
     reg_trace = m.reg_trace;
     i2c_read_period = m.i2c_read_period;
     io_cpld_version_old = m.io_cpld_version_old;
@@ -811,11 +965,13 @@ module& module::operator=(module&& m) {
     dsp_online = m.dsp_online;
     have_hardware = m.have_hardware;
     vars_loaded = m.vars_loaded;
+    vars_shadowed = false;
     cfg_ctrlcs = m.cfg_ctrlcs;
     test_mode = m.test_mode.load();
     persistent = std::move(m.persistent);
     mibs_size_t_rw = std::move(m.mibs_size_t_rw);
     mibs_double_rw = std::move(m.mibs_double_rw);
+    mibs_boot = std::move(m.mibs_boot);
 
     device = std::move(m.device);
 
@@ -832,15 +988,19 @@ module& module::operator=(module&& m) {
     m.eeprom_format = -1;
     m.run_task = hw::run::run_task::nop;
     m.control_task = hw::run::control_task::nop;
+    m.last_control_task = hw::run::control_task::nop;
     m.fifo_buffers = default_fifo_buffers;
     m.fifo_run_wait_usecs = default_fifo_run_wait_usec;
     m.fifo_idle_wait_usecs = default_fifo_idle_wait_usec;
     m.fifo_hold_usecs = default_fifo_hold_usec;
     m.fifo_dma_trigger_level = default_fifo_dma_trigger_level;
     m.fifo_bandwidth = 0;
+    m.fifo_dma_pipeline = false;
+    m.fifo_dma_stuck = false;
     m.run_stats.clear();
     m.crate_revision = -1;
     m.board_revision = -1;
+    m.list_mode_revision = 0;
     m.reg_trace = false;
     m.i2c_read_period = 100;
     m.io_cpld_version_old = false;
@@ -853,10 +1013,12 @@ module& module::operator=(module&& m) {
     m.dsp_online = false;
     m.have_hardware = false;
     m.vars_loaded = false;
+    m.vars_shadowed = false;
     m.cfg_ctrlcs = 0xaaa;
     m.test_mode = test::off;
     m.mibs_size_t_rw.clear();
     m.mibs_double_rw.clear();
+    m.mibs_boot.clear();
     m.hw_word_read = nullptr;
     m.hw_word_write = nullptr;
 
@@ -1111,6 +1273,7 @@ void module::open(size_t device_number) {
         mib::add_ro_int(mib_base + "pci.domain", device->pci_domain());
         mib::add_ro_int(mib_base + "pci.bus", device->pci_bus());
         mib::add_ro_int(mib_base + "pci.slot", device->pci_slot());
+        mib::add_ro_int(mib_base + "pci.numa-node", device->numa_node());
         mib::add_ro_int(mib_base + "pci.reset", device->reset());
 
         mib::add_ro_int(mib_base + "pci.plx.driver.major", drv_major);
@@ -1138,6 +1301,9 @@ void module::open(size_t device_number) {
         mibs_double_rw.emplace_back(mib_base + "run.bandwidth", run_stats.bandwidth);
         mibs_double_rw.emplace_back(mib_base + "run.max-bandwidth", run_stats.max_bandwidth);
         mibs_double_rw.emplace_back(mib_base + "run.min-bandwidth", run_stats.min_bandwidth);
+        mibs_double_rw.emplace_back(mib_base + "run.start-latency", run_stats.start_latency);
+
+        mib_boot_add();
     }
 }
 
@@ -1202,7 +1368,10 @@ void module::close() {
         mibs_size_t_rw.clear();
         mibs_double_rw.clear();
 
+        mib_boot_remove();
+
         mib::remove(mib_base + "run.min-bandwidth");
+        mib::remove(mib_base + "run.start-latency");
         mib::remove(mib_base + "run.max-bandwidth");
         mib::remove(mib_base + "run.bandwidth");
         mib::remove(mib_base + "run.hw-overflows");
@@ -1450,6 +1619,8 @@ void module::boot(
 
     mib_disable();
 
+    boot_profile::timer boot_timer(boot_stats);
+
     firmware_change_log(firmware.release);
 
     auto boot_comms = params.boot_comms;
@@ -1501,6 +1672,8 @@ void module::boot(
 
     load_vars(firmware);
 
+    boot_timer.mark(boot_stats.validate);
+
     int io_cpld_backoff = io_cpld_version_old ? 2 : 0;
 
     util::crc::crc32 crc;
@@ -1514,11 +1687,12 @@ void module::boot(
         comms_fpga = false;
         fw->load();
         fw->update_crc(crc);
-        comms.boot(fw->data, io_cpld_backoff);
+        comms.boot(*fw->data, io_cpld_backoff);
         comms_fpga = comms.done();
         if (comms_fpga) {
             fixtures->fpga_comms_loaded();
         }
+        boot_timer.mark(boot_stats.comms);
     }
 
     if (boot_fippi) {
@@ -1534,11 +1708,12 @@ void module::boot(
         fippi_fpga = false;
         fw->load();
         fw->update_crc(crc);
-        fippi.boot(fw->data, io_cpld_backoff);
+        fippi.boot(*fw->data, io_cpld_backoff);
         fippi_fpga = fippi.done();
         if (fippi_fpga) {
             fixtures->fpga_fippi_loaded();
         }
+        boot_timer.mark(boot_stats.fippi);
     }
 
     if (boot_dsp) {
@@ -1554,11 +1729,12 @@ void module::boot(
         dsp_online = false;
         fw->load();
         fw->update_crc(crc);
-        dsp.boot(fw->data);
+        dsp.boot(*fw->data);
         dsp_online = dsp.init_done();
         if (dsp_online) {
             fixtures->dsp_loaded();
         }
+        boot_timer.mark(boot_stats.dsp);
     }
 
     /*
@@ -1587,6 +1763,8 @@ void module::boot(
 
     start_fifo_services();
 
+    boot_timer.mark(boot_stats.init);
+
     xia_log(log::info) << std::boolalpha
                        << module_label(*this) << "boot: sys-fpga=" << comms_fpga
                        << " fippi-fpga=" << fippi_fpga << " dsp=" << dsp_online;
@@ -1599,6 +1777,8 @@ void module::boot(
         fixtures->online();
         mib_enable();
         write_var(param::module_var::SlotID, param::value_type(slot));
+        vars_shadow_load();
+        boot_timer.mark(boot_stats.afe);
     }
 }
 
@@ -1995,14 +2175,15 @@ param::value_type module::read_var(param::module_var var, size_t offset, bool io
     param::value_type value;
     {
         lock_guard guard(lock_);
-        if (hardware_accessible() && io) {
+        auto& var = module_vars[index].value[offset];
+        if (hardware_accessible() && io && !var_shadowed(desc.mode, var.dirty)) {
             hw::memory::dsp dsp(*this);
             hw::word mem = dsp.read(offset, desc.address);
             hw::convert(mem, value);
-            module_vars[index].value[offset].value = value;
-            module_vars[index].value[offset].dirty = false;
+            var.value = value;
+            var.dirty = false;
         } else {
-            value = module_vars[index].value[offset].value;
+            value = var.value;
         }
     }
     xia_log(log::debug) << module_label(*this) << "read_var: module var=" << desc.name << " value["
@@ -2037,13 +2218,14 @@ param::value_type module::read_var(param::channel_var var, size_t channel, size_
     param::value_type value;
     {
         lock_guard guard(lock_);
-        if (hardware_accessible() && io) {
+        auto& var = channels[channel].vars[index].value[offset];
+        if (hardware_accessible() && io && !var_shadowed(desc.mode, var.dirty)) {
             hw::memory::dsp dsp(*this);
             hw::convert(dsp.read(channel, offset, desc.address), value);
-            channels[channel].vars[index].value[offset].value = value;
-            channels[channel].vars[index].value[offset].dirty = false;
+            var.value = value;
+            var.dirty = false;
         } else {
-            value = channels[channel].vars[index].value[offset].value;
+            value = var.value;
         }
     }
     xia_log(log::debug) << module_label(*this) << "read_var: channel var=" << desc.name << " value["
@@ -2095,7 +2277,7 @@ void module::write_var(param::module_var var, param::value_type value, size_t of
     module_vars[index].value[offset].written_once = true;
     module_vars[index].value[offset].value = value;
     module_vars[index].value[offset].dirty = true;
-    if (hardware_accessible() && io) {
+    if (hardware_accessible() && io && !param_trans.active) {
         hw::word word;
         hw::convert(value, word);
         hw::memory::dsp dsp(*this);
@@ -2133,7 +2315,7 @@ void module::write_var(param::channel_var var, param::value_type value, size_t c
     lock_guard guard(lock_);
     channels[channel].vars[index].value[offset].value = value;
     channels[channel].vars[index].value[offset].dirty = true;
-    if (hardware_accessible() && io) {
+    if (hardware_accessible() && io && !param_trans.active) {
         hw::word word;
         hw::convert(value, word);
         hw::memory::dsp dsp(*this);
@@ -2142,58 +2324,209 @@ void module::write_var(param::channel_var var, param::value_type value, size_t c
     }
 }
 
-void module::sync_vars(const param::sync_mode sync_mode) {
-    online_check();
-    const char* sync_mode_label =
-        (char*) (sync_mode == param::sync_mode::to_hw ? "to hardware" : "from hardware");
-    xia_log(log::info) << module_label(*this) << "sync variables: mode: "
-                       << sync_mode_label;
-    if (!hardware_accessible()) {
-        return;
+/*
+ * A variable's word in DSP memory. The words are sorted by address and
+ * transferred in blocks of contiguous addresses.
+ */
+struct sync_word {
+    hw::address address;
+    param::value_type* value;
+    bool* dirty;
+
+    sync_word(hw::address address_, param::value_type& value_, bool& dirty_)
+        : address(address_), value(&value_), dirty(&dirty_) {}
+    bool operator<(const sync_word& other) const {
+        return address < other.address;
     }
-    lock_guard guard(lock_);
-    hw::memory::dsp dsp(*this);
-    for (auto& var : module_vars) {
+};
+
+using sync_words = std::vector<sync_word>;
+
+/*
+ * The number of unused words between variables a read from the DSP joins
+ * into a block. Reading DSP memory has no side effects so the cost of the
+ * extra words is less than another host bus request.
+ */
+static constexpr hw::address sync_read_gap_words = 8;
+
+static void sync_words_to_hw(hw::memory::dsp& dsp, sync_words& words) {
+    hw::words values;
+    values.reserve(words.size());
+    auto first = words.begin();
+    while (first != words.end()) {
+        auto last = first;
+        values.clear();
+        while (true) {
+            hw::word word;
+            hw::convert(*last->value, word);
+            values.push_back(word);
+            auto next = std::next(last);
+            if (next == words.end() || next->address != last->address + 1) {
+                break;
+            }
+            last = next;
+        }
+        dsp.write(first->address, values.data(), values.size());
+        first = std::next(last);
+    }
+}
+
+static void sync_words_from_hw(hw::memory::dsp& dsp, sync_words& words) {
+    hw::words values;
+    auto first = words.begin();
+    while (first != words.end()) {
+        auto last = first;
+        while (true) {
+            auto next = std::next(last);
+            if (next == words.end() || next->address > last->address + sync_read_gap_words + 1) {
+                break;
+            }
+            last = next;
+        }
+        values.resize(last->address - first->address + 1);
+        dsp.read(first->address, values.data(), values.size());
+        for (auto word = first; word != std::next(last); ++word) {
+            hw::convert(values[word->address - first->address], *word->value);
+        }
+        first = std::next(last);
+    }
+}
+
+/*
+ * Collect the words of the enabled read-write or read-only variables.
+ */
+static void collect_sync_words(module& mod, sync_words& words, bool read_only) {
+    for (auto& var : mod.module_vars) {
         const auto& desc = var.var;
-        if (desc.state == param::enable && desc.mode != param::ro) {
+        if (desc.state == param::enable && (desc.mode == param::ro) == read_only) {
             for (size_t v = 0; v < var.value.size(); ++v) {
                 auto& value = var.value[v];
-                if (sync_mode == param::sync_mode::to_hw) {
-                    if (value.dirty) {
-                        hw::word word;
-                        hw::convert(value.value, word);
-                        dsp.write(v, desc.address, word);
-                    }
-                } else {
-                    hw::convert(dsp.read(v, desc.address), value.value);
-                }
-                value.dirty = false;
+                words.emplace_back(hw::address(desc.address + v), value.value, value.dirty);
             }
         }
     }
-    for (auto& channel : channels) {
+    for (auto& channel : mod.channels) {
         for (auto& var : channel.vars) {
             const auto& desc = var.var;
-            if (desc.state == param::enable && desc.mode != param::ro) {
+            if (desc.state == param::enable && (desc.mode == param::ro) == read_only) {
+                if (channel.fixture->config.index < 0) {
+                    throw error(mod.number, mod.slot, error::code::channel_invalid_index,
+                                "dsp: invalid index: channel=" + std::to_string(channel.number));
+                }
+                const auto index = hw::address(channel.fixture->config.index);
                 for (size_t v = 0; v < var.value.size(); ++v) {
                     auto& value = var.value[v];
-                    if (sync_mode == param::sync_mode::to_hw) {
-                        if (value.dirty) {
-                            hw::word word;
-                            hw::convert(value.value, word);
-                            dsp.write(channel.number, v, desc.address, word);
-                        }
-                    } else {
-                        hw::convert(dsp.read(channel.number, v, desc.address), value.value);
-                    }
-                    value.dirty = false;
+                    words.emplace_back(
+                        hw::address(desc.address + index + v), value.value, value.dirty);
                 }
             }
         }
     }
+}
+
+void module::sync_vars(const param::sync_mode sync_mode) {
+    online_check();
+    const char* sync_mode_label =
+        (char*) (sync_mode == param::sync_mode::to_hw ? "to hardware" : "from hardware");
+    xia_log(log::info) << module_label(*this) << "sync variables: mode: "
+                       << sync_mode_label;
+    if (!hardware_accessible()) {
+        return;
+    }
+    lock_guard guard(lock_);
+    /*
+     * Collect the variables' words and move each block of contiguous
+     * addresses with a single transfer. A write only moves the dirty
+     * words.
+     */
+    sync_words words;
+    collect_sync_words(*this, words, false);
+    if (sync_mode == param::sync_mode::to_hw) {
+        words.erase(std::remove_if(words.begin(), words.end(),
+                                   [](const sync_word& word) { return !*word.dirty; }),
+                    words.end());
+    }
+    std::stable_sort(words.begin(), words.end());
+    hw::memory::dsp dsp(*this);
+    if (sync_mode == param::sync_mode::to_hw) {
+        sync_words_to_hw(dsp, words);
+    } else {
+        sync_words_from_hw(dsp, words);
+    }
+    for (auto& word : words) {
+        *word.dirty = false;
+    }
+    if (sync_mode == param::sync_mode::from_hw) {
+        vars_shadowed = true;
+    }
+    xia_log(log::debug) << module_label(*this) << "sync variables: words=" << words.size();
     fixtures->sync_vars(sync_mode);
 }
 
+void module::vars_shadow_load() {
+    online_check();
+    if (!hardware_accessible()) {
+        return;
+    }
+    lock_guard guard(lock_);
+    /*
+     * The dirty words hold values not written to the DSP so they are
+     * not loaded.
+     */
+    sync_words words;
+    collect_sync_words(*this, words, false);
+    words.erase(std::remove_if(words.begin(), words.end(),
+                               [](const sync_word& word) { return *word.dirty; }),
+                words.end());
+    std::stable_sort(words.begin(), words.end());
+    hw::memory::dsp dsp(*this);
+    sync_words_from_hw(dsp, words);
+    vars_shadowed = true;
+    xia_log(log::debug) << module_label(*this) << "variables shadow load: words=" << words.size();
+}
+
+void module::vars_shadow_invalidate() {
+    lock_guard guard(lock_);
+    vars_shadowed = false;
+}
+
+bool module::vars_shadow_valid() {
+    lock_guard guard(lock_);
+    return vars_shadowed;
+}
+
+void module::read_runtime_vars() {
+    online_check();
+    if (!hardware_accessible()) {
+        return;
+    }
+    lock_guard guard(lock_);
+    sync_words words;
+    collect_sync_words(*this, words, true);
+    std::stable_sort(words.begin(), words.end());
+    hw::memory::dsp dsp(*this);
+    sync_words_from_hw(dsp, words);
+    xia_log(log::debug) << module_label(*this) << "read run-time variables: words="
+                        << words.size();
+}
+
+bool module::var_shadowed(const param::rwrowr mode, const bool dirty) {
+    /*
+     * A transaction's written values are read from the module's copy.
+     */
+    if (param_trans.active && dirty) {
+        return true;
+    }
+    if (mode == param::ro || dirty || run_task != hw::run::run_task::nop ||
+        control_task != hw::run::control_task::nop) {
+        return false;
+    }
+    if (!vars_shadowed) {
+        vars_shadow_load();
+    }
+    return true;
+}
+
 void module::sync_hw(const bool program_fippi, const bool program_dacs) {
     online_check();
     xia_log(log::info) << module_label(*this) << std::boolalpha << "sync hardware: "
@@ -2222,6 +2555,165 @@ void module::sync_hw(const bool program_fippi, const bool program_dacs) {
     fixtures->sync_hw();
 }
 
+void module::param_transaction_begin() {
+    xia_log(log::info) << module_label(*this) << "param transaction: begin";
+    online_check();
+    lock_guard guard(lock_);
+    if (param_trans.active) {
+        throw error(number, slot, error::code::module_invalid_operation,
+                    "parameter transaction already active");
+    }
+    param_trans.clear();
+    sync_words words;
+    collect_sync_words(*this, words, false);
+    param_trans.values.reserve(words.size());
+    param_trans.dirty.reserve(words.size());
+    for (auto& word : words) {
+        param_trans.values.push_back(*word.value);
+        param_trans.dirty.push_back(*word.dirty);
+    }
+    param_trans.active = true;
+}
+
+void module::param_transaction_commit() {
+    online_check();
+    lock_guard guard(lock_);
+    if (!param_trans.active) {
+        throw error(number, slot, error::code::module_invalid_operation,
+                    "no parameter transaction active");
+    }
+    auto pending = param_trans;
+    xia_log(log::info) << module_label(*this) << std::boolalpha
+                       << "param transaction: commit: program_fippi=" << pending.program_fippi
+                       << " set_dacs=" << pending.set_dacs;
+    /*
+     * A failed flush leaves the transaction active so it can be retried
+     * or aborted. The DSP may hold some of the written values so it is
+     * flushed.
+     */
+    param_trans.active = false;
+    try {
+        param_transaction_flush(pending);
+    } catch (...) {
+        param_trans.active = true;
+        param_trans.flushed = true;
+        xia_log(log::error) << module_label(*this)
+                            << "param transaction: commit failed; transaction still active";
+        throw;
+    }
+    param_trans.clear();
+}
+
+void module::param_transaction_flush(param_transaction& pending) {
+    sync_vars(param::sync_mode::to_hw);
+    if (pending.program_fippi) {
+        hw::run::control(*this, hw::run::control_task::program_fippi);
+    }
+    if (pending.sync_csrb) {
+        sync_csrb();
+    }
+    if (pending.set_dacs) {
+        hw::run::control(*this, hw::run::control_task::set_dacs);
+    }
+}
+
+void module::param_transaction_abort() {
+    xia_log(log::info) << module_label(*this) << "param transaction: abort";
+    online_check();
+    lock_guard guard(lock_);
+    if (!param_trans.active) {
+        return;
+    }
+    auto pending = param_trans;
+    param_trans.clear();
+    /*
+     * Restore the variables. If the transaction was flushed the DSP
+     * holds written values so the restored values are written and the
+     * FIPPI and DACs are updated.
+     */
+    sync_words words;
+    collect_sync_words(*this, words, false);
+    if (words.size() != pending.values.size()) {
+        throw error(number, slot, error::code::internal_failure,
+                    "parameter transaction variables changed");
+    }
+    for (size_t w = 0; w < words.size(); ++w) {
+        auto& word = words[w];
+        if (pending.flushed) {
+            if (*word.value != pending.values[w]) {
+                *word.value = pending.values[w];
+                *word.dirty = true;
+            }
+        } else {
+            *word.value = pending.values[w];
+            *word.dirty = pending.dirty[w];
+        }
+    }
+    if (pending.flushed) {
+        pending.program_fippi = true;
+        pending.set_dacs = true;
+        param_transaction_flush(pending);
+    }
+}
+
+bool module::param_transaction_active() {
+    lock_guard guard(lock_);
+    return param_trans.active;
+}
+
+bool module::param_transaction_hold(hw::run::control_task task) {
+    lock_guard guard(lock_);
+    if (!param_trans.active) {
+        return false;
+    }
+    switch (task) {
+        case hw::run::control_task::program_fippi:
+            param_trans.program_fippi = true;
+            break;
+        case hw::run::control_task::set_dacs:
+            param_trans.set_dacs = true;
+            break;
+        default:
+            /*
+             * The task runs with the transaction's variables. The
+             * transaction remains active.
+             */
+            xia_log(log::debug) << module_label(*this)
+                                << "param transaction: flush for control task: " << int(task);
+            auto pending = param_trans;
+            param_trans.active = false;
+            try {
+                param_transaction_flush(pending);
+            } catch (...) {
+                param_trans.active = true;
+                throw;
+            }
+            /*
+             * The transaction is suspended while the task runs so the
+             * run variables and anything the task writes reach the DSP.
+             * The task resumes the transaction when it ends.
+             */
+            param_trans.suspended = true;
+            param_trans.program_fippi = false;
+            param_trans.set_dacs = false;
+            param_trans.sync_csrb = false;
+            param_trans.flushed = true;
+            return false;
+    }
+    xia_log(log::debug) << module_label(*this)
+                        << "param transaction: hold control task: " << int(task);
+    return true;
+}
+
+void module::param_transaction_resume() {
+    lock_guard guard(lock_);
+    if (param_trans.suspended) {
+        xia_log(log::debug) << module_label(*this) << "param transaction: resume";
+        param_trans.suspended = false;
+        param_trans.active = true;
+    }
+}
+
 void module::run_end() {
     online_check();
     lock_guard guard(lock_);
@@ -2245,6 +2737,9 @@ void module::run_end() {
      */
     hw::run::end(*this);
     run_interval.end();
+    if (hardware_accessible()) {
+        vars_shadow_load();
+    }
     sync_worker_run(true);
     pause_fifo_worker = true;
     run_stats.stop();
@@ -2272,7 +2767,16 @@ void module::adjust_offsets() {
     xia_log(log::info) << module_label(*this) << "adjust-offsets";
     online_check();
     lock_guard guard(lock_);
+    using msecs = std::chrono::duration<double, std::milli>;
+    auto start = std::chrono::steady_clock::now();
+    offsets_stats.clear();
     hw::run::control(*this, hw::run::control_task::adjust_offsets);
+    if (run_config.dsp_adjust_offsetdacs) {
+        offsets_stats.runs = 1;
+        offsets_stats.channels = num_channels;
+    }
+    offsets_stats.period = msecs(std::chrono::steady_clock::now() - start).count();
+    xia_log(log::info) << module_label(*this) << "adjust-offsets: " << offsets_stats.output();
 }
 
 void module::tau_finder() {
@@ -2300,10 +2804,15 @@ void module::start_histograms(hw::run::run_mode mode) {
     xia_log(log::info) << module_label(*this) << "start-histograms: mode=" << int(mode);
     online_check();
     lock_guard guard(lock_);
+    util::time::timepoint latency(true);
     if (run_active()) {
         throw error(number, slot, error::code::module_invalid_operation,
                     "module already running a task");
     }
+    if (param_trans.active) {
+        throw error(number, slot, error::code::module_invalid_operation,
+                    "parameter transaction active; cannot start a run task");
+    }
     if (test_mode.load() != test::off) {
         throw error(number, slot, error::code::module_test_invalid,
                     "test running; cannot start a run task");
@@ -2312,16 +2821,22 @@ void module::start_histograms(hw::run::run_mode mode) {
     run_stats.start();
     hw::run::run(*this, mode, hw::run::run_task::histogram);
     run_interval.restart();
+    run_started(latency);
 }
 
 void module::start_listmode(hw::run::run_mode mode) {
     xia_log(log::info) << module_label(*this) << "start-list-mode: mode=" << int(mode);
     online_check();
     lock_guard guard(lock_);
+    util::time::timepoint latency(true);
     if (run_task != hw::run::run_task::nop) {
         throw error(number, slot, error::code::module_invalid_operation,
                     "module already running a task");
     }
+    if (param_trans.active) {
+        throw error(number, slot, error::code::module_invalid_operation,
+                    "parameter transaction active; cannot start a run task");
+    }
     if (test_mode.load() != test::off) {
         throw error(number, slot, error::code::module_test_invalid,
                     "test running; cannot start a run task");
@@ -2332,6 +2847,13 @@ void module::start_listmode(hw::run::run_mode mode) {
     pause_fifo_worker = false;
     hw::run::run(*this, mode, hw::run::run_task::list_mode);
     run_interval.restart();
+    run_started(latency);
+}
+
+void module::run_started(util::time::timepoint& latency) {
+    latency.end();
+    run_stats.start_latency = double(latency.usecs()) / 1000;
+    xia_log(log::info) << module_label(*this) << "run started: latency=" << latency;
 }
 
 void module::read_adc(size_t channel, hw::adc_word* buffer, size_t size, bool run) {
@@ -2342,7 +2864,7 @@ void module::read_adc(size_t channel, hw::adc_word* buffer, size_t size, bool ru
     if (run) {
         get_traces();
     }
-    if (control_task != hw::run::control_task::get_traces) {
+    if (last_control_task != hw::run::control_task::get_traces) {
         throw error(number, slot, error::code::module_invalid_operation,
                     "control task not `get_traces`");
     }
@@ -2358,6 +2880,70 @@ void module::read_adc(size_t channel, hw::adc_trace& buffer, bool run) {
     read_adc(channel, buffer.data(), buffer.size(), run);
 }
 
+void module::read_adc_all(hw::adc_traces& traces, bool run) {
+    xia_log(log::debug) << module_label(*this) << "read-adc-all: run=" << std::boolalpha << run;
+    online_check();
+    lock_guard guard(lock_);
+    if (run) {
+        get_traces();
+    }
+    if (last_control_task != hw::run::control_task::get_traces) {
+        throw error(number, slot, error::code::module_invalid_operation,
+                    "control task not `get_traces`");
+    }
+    traces.resize(num_channels);
+    for (auto& chan : channels) {
+        auto& trace = traces[chan.number];
+        const size_t max_length = chan.fixture->config.max_adc_trace_length;
+        if (trace.empty()) {
+            trace.resize(max_length);
+        } else if (trace.size() > max_length) {
+            std::ostringstream oss;
+            oss << "ADC trace too long: channel=" << chan.number << " length=" << trace.size()
+                << " max=" << max_length;
+            throw error(number, slot, error::code::channel_invalid_param, oss.str());
+        }
+    }
+    if (!run_config.dsp_get_traces) {
+        for (auto& chan : channels) {
+            auto& trace = traces[chan.number];
+            chan.read_adc(trace.data(), trace.size());
+        }
+        return;
+    }
+    /*
+     * Read the span of the I/O buffer holding the channels' traces with
+     * one block read and unpack the two samples in each word. An odd
+     * length trace uses the low sample of its last word.
+     */
+    auto trace_words = [](const hw::adc_trace& trace) { return (trace.size() + 1) / 2; };
+    hw::address first = std::numeric_limits<hw::address>::max();
+    hw::address last = 0;
+    for (auto& chan : channels) {
+        const auto addr = chan.adc_trace_address();
+        first = std::min(first, addr);
+        last = std::max(last, hw::address(addr + trace_words(traces[chan.number])));
+    }
+    if (last <= first) {
+        return;
+    }
+    hw::words words(last - first);
+    hw::memory::dsp dsp(*this);
+    dsp.read(first, words.data(), words.size());
+    for (auto& chan : channels) {
+        auto& trace = traces[chan.number];
+        const auto* word = &words[chan.adc_trace_address() - first];
+        const auto size = trace.size() / 2;
+        for (size_t w = 0; w < size; ++w) {
+            trace[w * 2] = hw::adc_word(word[w] & 0xffff);
+            trace[w * 2 + 1] = hw::adc_word((word[w] >> 16) & 0xffff);
+        }
+        if (trace.size() % 2 != 0) {
+            trace[size * 2] = hw::adc_word(word[size] & 0xffff);
+        }
+    }
+}
+
 void module::bl_find_cut(channel::range& channels_, param::values& cuts) {
     xia_log(log::info) << module_label(*this) << "bl-find-cut: channels=" << channels.size();
     cuts.clear();
@@ -2372,7 +2958,7 @@ void module::bl_get(channel::range& channels_, channel::baseline::channels_value
     xia_log(log::info) << module_label(*this) << "bl-get: channels=" << channels.size();
     channel::baseline bl(*this, channels_);
     lock_guard guard(lock_);
-    if (control_task != hw::run::control_task::get_baselines) {
+    if (last_control_task != hw::run::control_task::get_baselines) {
         throw error(number, slot, error::code::module_invalid_operation,
                     "control task `get_baseline` has not run");
     }
@@ -2397,6 +2983,52 @@ void module::read_histogram(size_t channel, hw::words& values) {
     read_histogram(channel, values.data(), values.size());
 }
 
+size_t module::histograms_length() const {
+    return max_histogram_length * num_channels;
+}
+
+void module::read_histograms(hw::word_ptr values, const size_t size) {
+    xia_log(log::info) << module_label(*this) << "read-histograms: length=" << size;
+    online_check();
+    const auto length = histograms_length();
+    if (size < length) {
+        throw error(number, slot, error::code::invalid_value,
+                    "read-histograms: buffer too small: " + std::to_string(size) + " < " +
+                        std::to_string(length));
+    }
+    lock_guard guard(lock_);
+    /*
+     * The histograms are contiguous in the MCA memory if all channels have
+     * the module's histogram length. If not each channel is read into its
+     * place in the values.
+     */
+    bool contiguous = true;
+    for (auto& chan : channels) {
+        if (chan.fixture->config.max_histogram_length != max_histogram_length) {
+            contiguous = false;
+            break;
+        }
+    }
+    if (contiguous) {
+        hw::memory::mca mca(*this);
+        mca.read(hw::memory::HISTOGRAM_MEMORY, values, length);
+    } else {
+        std::fill(values, values + length, 0);
+        for (auto& chan : channels) {
+            chan.read_histogram(values + chan.number * max_histogram_length,
+                                std::min(chan.fixture->config.max_histogram_length,
+                                         max_histogram_length));
+        }
+    }
+}
+
+void module::read_histograms(hw::words& values) {
+    if (values.empty()) {
+        values.resize(histograms_length());
+    }
+    read_histograms(values.data(), values.size());
+}
+
 size_t module::read_list_mode_level() {
     xia_log(log::debug) << module_label(*this) << "read-list-mode-level";
     online_check();
@@ -2435,20 +3067,68 @@ size_t module::read_list_mode(hw::words& values) {
 }
 
 size_t module::read_list_mode(hw::word_ptr values, const size_t size) {
-    xia_log(log::info) << module_label(*this) << "read-list-mode: length=" << size
-                       << " fifo-size=" << fifo_data.size();
+    xia_log(log::debug) << module_label(*this) << "read-list-mode: length=" << size
+                        << " fifo-size=" << fifo_data.size();
     online_check();
+    if (!fifo_worker_running.load()) {
+        xia_log(log::warning) << module_label(*this) << "read-list-mode: FIFO worker not running";
+    }
+    lock_guard guard(lock_);
+    sync_worker_run();
     if (fifo_data.empty()) {
         return 0;
     }
-    lock_guard guard(lock_);
     auto out = fifo_data.copy(values, size);
-    run_stats.out += size;
+    run_stats.out += out;
     xia_log(log::debug) << module_label(*this) << "read-list-mode: values=" << size
                         << " out=" << out << " fifo-size=" << fifo_data.size();
     return out;
 }
 
+size_t module::read_list_mode_available(hw::word_ptr values, const size_t max_size) {
+    xia_log(log::debug) << module_label(*this) << "read-list-mode: available: max-size="
+                        << max_size << " fifo-size=" << fifo_data.size();
+    online_check();
+    if (!fifo_worker_running.load()) {
+        xia_log(log::warning) << module_label(*this) << "read-list-mode: FIFO worker not running";
+    }
+    lock_guard guard(lock_);
+    sync_worker_run();
+    /*
+     * The FIFO worker only adds data so the size can be read then copied.
+     */
+    auto size = std::min(fifo_data.size(), max_size);
+    if (size == 0) {
+        return 0;
+    }
+    auto out = fifo_data.copy(values, size);
+    run_stats.out += out;
+    xia_log(log::debug) << module_label(*this) << "read-list-mode: available: out=" << out
+                        << " fifo-size=" << fifo_data.size();
+    return out;
+}
+
+size_t module::read_list_mode(buffer::lent_buffers& buffers, const size_t max_buffers) {
+    xia_log(log::debug) << module_label(*this) << "read-list-mode: lend: max-buffers="
+                        << max_buffers << " fifo-size=" << fifo_data.size();
+    online_check();
+    if (!fifo_worker_running.load()) {
+        xia_log(log::warning) << module_label(*this) << "read-list-mode: FIFO worker not running";
+    }
+    lock_guard guard(lock_);
+    sync_worker_run();
+    if (fifo_data.empty()) {
+        return 0;
+    }
+    auto first = buffers.size();
+    auto out = fifo_data.lend(buffers, max_buffers);
+    run_stats.out += out;
+    xia_log(log::debug) << module_label(*this) << "read-list-mode: lend: buffers="
+                        << buffers.size() - first << " out=" << out
+                        << " fifo-size=" << fifo_data.size();
+    return out;
+}
+
 void module::read_stats(stats::stats& stats) {
     xia_log(log::info) << module_label(*this) << "read-stats: channels=" << channels.size();
     online_check();
@@ -2527,6 +3207,38 @@ void module::set_fifo_bandwidth(const size_t bandwidth) {
     fifo_bandwidth = bandwidth;
 }
 
+void module::set_fifo_dma_pipeline(const bool pipeline) {
+    xia_log(log::debug) << module_label(*this) << "fifo: dma-pipeline=" << std::boolalpha
+                        << pipeline;
+    fifo_dma_pipeline = pipeline;
+}
+
+void module::spool_attach(data::list_mode::spool_writer_ptr writer) {
+    if (!writer || !writer->is_open()) {
+        throw error(number, slot, error::code::module_invalid_operation,
+                    "spool: writer is not open");
+    }
+    xia_log(log::info) << module_label(*this) << "spool: attach: " << writer->path();
+    std::lock_guard<std::mutex> guard(spool_lock);
+    spool = writer;
+}
+
+data::list_mode::spool_writer_ptr module::spool_detach() {
+    std::lock_guard<std::mutex> guard(spool_lock);
+    data::list_mode::spool_writer_ptr writer;
+    if (spool) {
+        xia_log(log::info) << module_label(*this) << "spool: detach: frames=" << spool->frames()
+                           << " skipped=" << spool->skipped();
+        writer.swap(spool);
+    }
+    return writer;
+}
+
+bool module::spooling() {
+    std::lock_guard<std::mutex> guard(spool_lock);
+    return bool(spool);
+}
+
 void module::select_port(const int port) {
     bus_guard guard(*this);
     cfg_ctrlcs &= ~(7 << 19);
@@ -2579,6 +3291,21 @@ void module::dma_read(const hw::address source, hw::words& values) {
     dma_read(source, values.data(), values.size());
 }
 
+static void dma_read_params(PLX_DMA_PARAMS& dma_params, const hw::address source,
+                            hw::word_ptr values, const size_t size) {
+    memset(&dma_params, 0, sizeof(PLX_DMA_PARAMS));
+
+#if PLX_SDK_VERSION_MAJOR < 6
+    dma_params.u.UserVa = static_cast<PLX_UINT_PTR>(values);
+    dma_params.LocalToPciDma = 1;
+#else
+    dma_params.UserVa = PLX_PTR_TO_INT(values);
+    dma_params.Direction = PLX_DMA_LOC_TO_PCI;
+#endif
+    dma_params.LocalAddr = source;
+    dma_params.ByteCount = U32(size * sizeof(hw::words::value_type));
+}
+
 void module::dma_read(const hw::address source, hw::word_ptr values, const size_t size) {
     xia_log(log::debug) << module_label(*this) << "dma read: addr=0x" << std::hex << source
                         << " length=" << std::dec << size;
@@ -2594,18 +3321,7 @@ void module::dma_read(const hw::address source, hw::word_ptr values, const size_
     tp.start();
 
     PLX_DMA_PARAMS dma_params;
-
-    memset(&dma_params, 0, sizeof(PLX_DMA_PARAMS));
-
-#if PLX_SDK_VERSION_MAJOR < 6
-    dma_params.u.UserVa = static_cast<PLX_UINT_PTR>(values);
-    dma_params.LocalToPciDma = 1;
-#else
-    dma_params.UserVa = PLX_PTR_TO_INT(values);
-    dma_params.Direction = PLX_DMA_LOC_TO_PCI;
-#endif
-    dma_params.LocalAddr = source;
-    dma_params.ByteCount = U32(size * sizeof(hw::words::value_type));
+    dma_read_params(dma_params, source, values, size);
 
     /*
      * Wait while reading. The call will block until the interrupt happens.
@@ -2622,6 +3338,96 @@ void module::dma_read(const hw::address source, hw::word_ptr values, const size_
     xia_log(log::debug) << module_label(*this) << "dma read: done, period=" << tp;
 }
 
+void module::dma_read_start(const hw::address source, hw::word_ptr values, const size_t size) {
+    xia_log(log::debug) << module_label(*this) << "dma read start: addr=0x" << std::hex << source
+                        << " length=" << std::dec << size;
+
+    online_check();
+
+    if (bus_lock_.try_lock()) {
+        bus_lock_.unlock();
+        throw error(number, slot, error::code::device_dma_failure, "bus lock not held");
+    }
+
+    if (device->dma_pending) {
+        throw error(number, slot, error::code::device_dma_failure, "DMA read already in flight");
+    }
+
+    /*
+     * Register for the DMA done interrupt of the channel. If the driver
+     * cannot notify the caller the transfer is completed here.
+     */
+    PLX_INTERRUPT interrupt;
+    memset(&interrupt, 0, sizeof(PLX_INTERRUPT));
+    interrupt.DmaDone = 1;
+    PLX_STATUS ps = ::PlxPci_NotificationRegisterFor(&device->handle, &interrupt,
+                                                     &device->dma_notify);
+    if (ps != PLX_STATUS_OK) {
+        xia_log(log::debug) << module_label(*this)
+                            << "dma read start: no DMA notification: " << pci_error_text(ps);
+        dma_read(source, values, size);
+        return;
+    }
+
+    PLX_DMA_PARAMS dma_params;
+    dma_read_params(dma_params, source, values, size);
+
+    /*
+     * A timeout of 0 starts the transfer and returns.
+     */
+    ps = ::PlxPci_DmaTransferUserBuffer(&device->handle, 0, &dma_params, 0);
+    if (ps != PLX_STATUS_OK) {
+        ::PlxPci_NotificationCancel(&device->handle, &device->dma_notify);
+        std::ostringstream oss;
+        oss << "DMA read start: " << pci_error_text(ps);
+        throw error(number, slot, error::code::device_dma_failure, oss.str());
+    }
+
+    device->dma_pending = true;
+}
+
+void module::dma_read_wait() {
+    if (!device->dma_pending) {
+        return;
+    }
+
+    device->dma_pending = false;
+
+    util::time::timepoint tp;
+    tp.start();
+
+    PLX_STATUS ps = ::PlxPci_NotificationWait(&device->handle, &device->dma_notify, 5 * 1000);
+    ::PlxPci_NotificationCancel(&device->handle, &device->dma_notify);
+    if (ps != PLX_STATUS_OK) {
+        std::ostringstream oss;
+        oss << "DMA read wait: " << pci_error_text(ps);
+        throw error(number, slot, error::code::device_dma_failure, oss.str());
+    }
+
+    tp.end();
+
+    xia_log(log::debug) << module_label(*this) << "dma read wait: done, period=" << tp;
+}
+
+bool module::dma_read_busy() {
+    if (!device) {
+        return false;
+    }
+    bus_guard guard(*this);
+    return ::PlxPci_DmaStatus(&device->handle, 0) == PLX_STATUS_IN_PROGRESS;
+}
+
+bool module::dma_read_quiesce() {
+    for (int msecs = 0; msecs < 1000; ++msecs) {
+        if (!dma_read_busy()) {
+            return true;
+        }
+        hw::wait(1000);
+    }
+    xia_log(log::error) << module_label(*this) << "dma read: DMA did not stop";
+    return false;
+}
+
 hw::rev_tag module::get_rev_tag() const {
     return static_cast<hw::rev_tag>(revision);
 }
@@ -2733,7 +3539,27 @@ int module::get_bus_device_number() const {
     return device->device_number;
 }
 
+/*
+ * The FIPPI firmware sets the list-mode data format and its version is the
+ * firmware revision, for example `r42081`.
+ */
+static uint32_t fippi_revision(const firmware::firmware_set& firmware) {
+    for (auto& fw : firmware.firmwares) {
+        if (fw->device.name == "fippi") {
+            auto& version = fw->version;
+            if (version.size() > 1 && version[0] == 'r' &&
+                std::all_of(version.begin() + 1, version.end(),
+                            [](char c) { return std::isdigit(c) != 0; })) {
+                return uint32_t(std::stoul(version.substr(1)));
+            }
+            break;
+        }
+    }
+    return 0;
+}
+
 void module::load_vars(const firmware::firmware_set& firmware) {
+    list_mode_revision = fippi_revision(firmware);
     if (!vars_loaded) {
         firmware::firmware_ref vars = firmware.get("var");
         vars->load();
@@ -2767,6 +3593,7 @@ void module::init_values() {
                     "invalid number of channels configurations");
     }
     erase_values();
+    vars_shadowed = false;
     for (const auto& desc : module_var_descriptors) {
         module_vars.push_back(param::module_variable(desc));
     }
@@ -2827,12 +3654,44 @@ void module::mib_disable() {
     }
 }
 
+void module::mib_boot_add() {
+    /*
+     * The nodes reference their container's elements so reserve the
+     * space before adding them.
+     */
+    mibs_boot.clear();
+    mibs_boot.reserve(7);
+    mibs_boot.emplace_back(mib_base + "boot.validate", boot_stats.validate);
+    mibs_boot.emplace_back(mib_base + "boot.comms", boot_stats.comms);
+    mibs_boot.emplace_back(mib_base + "boot.fippi", boot_stats.fippi);
+    mibs_boot.emplace_back(mib_base + "boot.dsp", boot_stats.dsp);
+    mibs_boot.emplace_back(mib_base + "boot.init", boot_stats.init);
+    mibs_boot.emplace_back(mib_base + "boot.afe", boot_stats.afe);
+    mibs_boot.emplace_back(mib_base + "boot.total", boot_stats.total);
+}
+
+void module::mib_boot_remove() {
+    mibs_boot.clear();
+    mib::remove(mib_base + "boot.total");
+    mib::remove(mib_base + "boot.afe");
+    mib::remove(mib_base + "boot.init");
+    mib::remove(mib_base + "boot.dsp");
+    mib::remove(mib_base + "boot.fippi");
+    mib::remove(mib_base + "boot.comms");
+    mib::remove(mib_base + "boot.validate");
+}
+
 void module::module_csrb(param::value_type value, size_t offset, bool io) {
     backplane_csrb(value);
     write_var(param::module_var::ModCSRB, value, offset, io);
     if (hardware_accessible() && io) {
         hw::run::control(*this, hw::run::control_task::program_fippi);
-        sync_csrb();
+        lock_guard guard(lock_);
+        if (param_trans.active) {
+            param_trans.sync_csrb = true;
+        } else {
+            sync_csrb();
+        }
     }
 }
 
@@ -2984,7 +3843,9 @@ void module::start_fifo_services() {
         if (fippi.done()) {
             hw::csr::reset(*this);
             if (!fifo_pool.valid()) {
-                fifo_pool.create(fifo_buffers, 64 * 1024);
+                fifo_pool.create(
+                    fifo_buffers, 64 * 1024, device ? device->numa_node() : -1);
+                fifo_data.create(fifo_pool);
                 start_fifo_worker();
                 hw::run::end(*this);
             }
@@ -2994,13 +3855,23 @@ void module::start_fifo_services() {
 
 void module::stop_fifo_services() {
     stop_fifo_worker();
-    fifo_data.flush();
+    if (fifo_dma_stuck) {
+        xia_log(log::error) << module_label(*this)
+                            << "FIFO services: DMA did not stop, buffers not released; "
+                            << "module reboot required";
+        return;
+    }
+    fifo_data.destroy();
     fifo_pool.destroy();
 }
 
 void module::start_fifo_worker() {
     xia_log(log::debug) << module_label(*this) << std::boolalpha
                         << "FIFO worker: starting: running=" << fifo_worker_running.load();
+    if (fifo_dma_stuck) {
+        throw error(number, slot, error::code::device_dma_failure,
+                    "FIFO DMA did not stop; module reboot required");
+    }
     if (!fifo_worker_running.load()) {
         pause_fifo_worker = true;
         fifo_worker_finished = false;
@@ -3022,6 +3893,23 @@ void module::stop_fifo_worker() {
     }
 }
 
+/*
+ * A transfer from the FIFO by the worker. The words are the transfer's
+ * length and the data is in a pooled buffer or appended to the ring's
+ * newest buffer if there is no buffer.
+ */
+struct fifo_transfer {
+    buffer::buffer_ptr buf;
+    buffer::buffer_value_ptr data;
+    size_t words;
+    size_t level;
+    bool queue;
+    bool paused;
+
+    fifo_transfer()
+        : buf(nullptr), data(nullptr), words(0), level(0), queue(false), paused(false) {}
+};
+
 void module::fifo_worker() {
     hw::memory::fifo fifo(*this);
 
@@ -3029,6 +3917,67 @@ void module::fifo_worker() {
 
     xia_log(log::info) << module_label(*this) << "FIFO worker: running, level=" << level;
 
+    /*
+     * The transfer in flight and a pipelined transfer waiting to be
+     * queued.
+     */
+    fifo_transfer in_flight;
+    fifo_transfer pending;
+
+    /*
+     * Queue or drop a transfer's data.
+     */
+    auto queue_transfer = [this](fifo_transfer& xfer) {
+        if (xfer.words == 0) {
+            return;
+        }
+        /*
+         * Spool the data before it is queued and can be read. A dropped
+         * transfer uses a sequence number. The writer queues a copy of
+         * the data for its thread so the lock is held for the copy and
+         * a detach waits for the write.
+         */
+        {
+            std::lock_guard<std::mutex> guard(spool_lock);
+            if (spool) {
+                /*
+                 * A spool error stops spooling and not the run.
+                 */
+                try {
+                    if (xfer.queue) {
+                        spool->write(uint32_t(slot), xfer.data, xfer.words);
+                    } else {
+                        spool->skip(uint32_t(slot));
+                    }
+                } catch (pixie::error::error& e) {
+                    xia_log(log::error) << module_label(*this) << "spool: detached: " << e.what();
+                    spool.reset();
+                }
+            }
+        }
+        if (xfer.queue) {
+            run_stats.in += xfer.words;
+            if (xfer.buf == nullptr) {
+                fifo_data.commit(xfer.words);
+            } else {
+                fifo_data.push(xfer.buf, xfer.words);
+            }
+        } else {
+            run_stats.dropped += xfer.words;
+            fifo_pool.release(xfer.buf);
+            xia_log(log::debug) << module_label(*this)
+                                << std::boolalpha
+                                << "buffer drop: fifo-worker-paused="
+                                << xfer.paused;
+        }
+        xia_log(log::debug) << module_label(*this)
+                            << "FIFO read, level=" << xfer.level
+                            << " read-words=" << xfer.words
+                            << " data-fifo-buffers=" << fifo_data.count()
+                            << std::boolalpha << " queue-buf=" << xfer.queue;
+        xfer = fifo_transfer();
+    };
+
     /*
      * The worker must not hold the module's lock. That lock is for
      * front facing user calls only. The worker can only use atomics
@@ -3166,63 +4115,87 @@ void module::fifo_worker() {
                                         << " repeat read: " << level2;
                     break;
                 }
+                const size_t fifo_pool_count = fifo_pool.count();
+                const bool paused = pause_fifo_worker.load();
+                const bool pipeline = fifo_dma_pipeline.load();
                 /*
-                 * We do not bother compacting if we are less than 3
+                 * Read into the space left in the newest buffer in the
+                 * ring before using another buffer from the pool. Small
+                 * transfers share a buffer so partially filled buffers do
+                 * not use up the pool. A pending transfer may be in the
+                 * newest buffer so the next transfer uses a pooled buffer.
                  */
-                const size_t fifo_pool_count = fifo_pool.count();
-                if (fifo_pool_count < 4 && fifo_pool_count > 1) {
-                    if (!pool_empty_logged) {
-                        xia_log(log::warning) << module_label(*this) << "FIFO worker: pool empty,"
-                                              << " compacting queue ...";
-                    }
-                    fifo_data.compact();
-                }
+                const size_t space = paused || pending.words > 0 ? 0 : fifo_data.space();
                 /*
-                 * Queue the buffer if there is more than one
-                 * remaining in the pool and the worker has not been
-                 * paused.
+                 * Queue the data if it is appended or there is more than
+                 * one buffer remaining in the pool and the worker has not
+                 * been paused.
                  */
-                bool queue_buf = fifo_pool_count > 1 && !pause_fifo_worker.load();
+                bool queue_buf = space > 0 || (fifo_pool_count > 1 && !paused);
                 /*
-                 * If the pool is still empty after compacting wait
-                 * letting the FIFO fill.
+                 * If there is no space and the pool is empty wait letting
+                 * the FIFO fill.
                  */
-                if (!fifo_pool.empty()) {
-                    buffer::handle buf = fifo_pool.request();
-                    auto read_words = level;
-                    if (read_words > buf->capacity()) {
-                        read_words = buf->capacity();
-                    }
-                    buf->resize(read_words);
-                    fifo.read(*buf, read_words);
-                    run_stats.dma_in += read_words;
-                    if (queue_buf) {
-                        run_stats.in += read_words;
-                        fifo_data.push(buf);
+                if (space > 0 || !fifo_pool.empty()) {
+                    auto& xfer = in_flight;
+                    xfer.words = level;
+                    xfer.level = level;
+                    xfer.queue = queue_buf;
+                    xfer.paused = paused;
+                    if (space > 0) {
+                        if (xfer.words > space) {
+                            xfer.words = space;
+                        }
+                        xfer.data = fifo_data.space_data();
                     } else {
-                        run_stats.dropped += read_words;
-                        xia_log(log::debug) << module_label(*this)
-                                            << std::boolalpha
-                                            << "buffer drop: fifo_pool_count="
-                                            << (fifo_pool_count > 1)
-                                            << " fifo-worker-paused="
-                                            << pause_fifo_worker.load();
+                        xfer.buf = fifo_pool.request_buffer();
+                        if (xfer.words > xfer.buf->capacity()) {
+                            xfer.words = xfer.buf->capacity();
+                        }
+                        /*
+                         * A pooled buffer is raw storage and sizing it to
+                         * the transfer does not zero it. The ring keeps
+                         * the size as the buffer's fill level.
+                         */
+                        xfer.buf->resize(xfer.words);
+                        xfer.data = xfer.buf->data();
                     }
-                    /*
-                     * If the logging level is `debug` compute the CRC32 of the data
-                     * queued. This can be used to verify the data received by the
-                     * user API.
-                     */
-                    util::crc::crc32 crc;
-                    if (logging::level_logging(log::debug)) {
-                        crc.update(*buf);
+                    const auto read_words = xfer.words;
+                    try {
+                        if (pipeline) {
+                            /*
+                             * Queue the previous transfer while this
+                             * transfer is in flight.
+                             */
+                            fifo.read_start(xfer.data, xfer.words);
+                            queue_transfer(pending);
+                            fifo.read_wait();
+                            pending = xfer;
+                        } else {
+                            queue_transfer(pending);
+                            fifo.read(xfer.data, xfer.words);
+                            queue_transfer(xfer);
+                        }
+                    } catch (...) {
+                        /*
+                         * A failed DMA may still be writing the
+                         * transfer's buffer.
+                         */
+                        if (!dma_read_quiesce()) {
+                            fifo_dma_stuck = true;
+                        }
+                        /*
+                         * An append to the ring's newest buffer is not
+                         * committed.
+                         */
+                        if (xfer.buf == nullptr && xfer.words > 0) {
+                            fifo_data.abort_append();
+                            xfer = fifo_transfer();
+                        }
+                        throw;
                     }
-                    xia_log(log::debug) << module_label(*this)
-                                        << "FIFO read, level=" << level
-                                        << " read-words=" << read_words
-                                        << " data-fifo-words=" << fifo_data.count()
-                                        << " crc=0x" << std::hex << crc.value
-                                        << std::boolalpha << " queue-buf=" << queue_buf;
+                    xfer = fifo_transfer();
+                    run_stats.dma_in += read_words;
                     hold_time = 0;
                     pool_empty_logged = false;
                     fifo_full_logged = false;
@@ -3267,6 +4240,11 @@ void module::fifo_worker() {
                 }
             }
 
+            /*
+             * Queue a pipelined transfer before waiting.
+             */
+            queue_transfer(pending);
+
             /*
              * Wait for a request to run. If run has been requested
              * respond so the requester is notified the work has been
@@ -3302,17 +4280,10 @@ void module::fifo_worker() {
         }
 
         /*
-         * Flush the buffers from the queue back into the pool. Any user
-         * active calls should be done in a few seconds.
+         * The buffers in the ring are returned to the pool when the FIFO
+         * services are stopped. The worker is the producer and cannot
+         * empty the ring while a reader may be active.
          */
-        fifo_data.flush();
-        size_t wait_period = 5 * 1000 / 10;
-        while (wait_period-- > 0) {
-            if (fifo_pool.full()) {
-                break;
-            }
-            hw::wait(10000);
-        }
     } catch (pixie::error::error& e) {
         xia_log(log::error) << "FIFO worker: " << e;
     } catch (std::exception& e) {
@@ -3321,6 +4292,37 @@ void module::fifo_worker() {
         xia_log(log::error) << "FIFO worker: unhandled exception";
     }
 
+    /*
+     * Queue a pipelined transfer that completed and return the buffer of
+     * a failed transfer to the pool. A transfer still in flight has to
+     * finish first. The buffer of a failed DMA that did not stop is
+     * retired.
+     */
+    if (fifo.read_pending()) {
+        try {
+            fifo.read_wait();
+        } catch (...) {
+            if (!dma_read_quiesce()) {
+                fifo_dma_stuck = true;
+            }
+        }
+    }
+    try {
+        queue_transfer(pending);
+    } catch (...) {
+        xia_log(log::error) << module_label(*this) << "FIFO worker: pending transfer lost";
+    }
+    if (pending.buf != nullptr) {
+        fifo_pool.release(pending.buf);
+    }
+    if (in_flight.buf != nullptr) {
+        if (fifo_dma_stuck) {
+            xia_log(log::error) << module_label(*this) << "FIFO worker: DMA buffer retired";
+        } else {
+            fifo_pool.release(in_flight.buf);
+        }
+    }
+
     level = fifo.level();
     xia_log(log::info) << module_label(*this) << "FIFO worker: finishing, level=" << level;
 
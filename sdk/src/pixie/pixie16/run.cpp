@@ -119,6 +119,70 @@ static bool run_ended(module::module& module) {
     return valid_task && module.backplane.run.not_leader(module);
 }
 
+/*
+ * Clear the histograms that may hold data. A channel only histograms
+ * events when its good channel bit is set so a channel that has not run
+ * since it was cleared is skipped. Adjacent histograms are cleared with a
+ * single transfer.
+ */
+static void clear_histograms(module::module& module) {
+    memory::mca mca(module);
+    address start = 0;
+    size_t length = 0;
+    size_t cleared = 0;
+    for (auto& chan : module.channels) {
+        if (!chan.histogram_dirty) {
+            continue;
+        }
+        const auto chan_length = chan.fixture->config.max_histogram_length;
+        const auto addr = address(memory::HISTOGRAM_MEMORY + chan.number * chan_length);
+        if (length != 0 && addr != start + length) {
+            mca.clear(start, length);
+            cleared += length;
+            length = 0;
+        }
+        if (length == 0) {
+            start = addr;
+        }
+        length += chan_length;
+        chan.histogram_dirty = false;
+    }
+    if (length != 0) {
+        mca.clear(start, length);
+        cleared += length;
+    }
+    xia_log(log::debug) << module::module_label(module, "run") << "histograms cleared: words="
+                        << cleared;
+}
+
+/*
+ * Control tasks that do not change the DSP's variables. The DSP reads
+ * the variables these tasks use and writes nothing back to them:
+ *
+ *  - set_dacs loads the OFFSETDAC values into the DACs.
+ *  - program_fippi loads the values the SDK converted into the FiPPI
+ *    registers.
+ *  - get_traces and get_baselines write their results to the I/O buffer
+ *    which is not a variable.
+ *  - reset_adc resets the ADCs and is only used during a boot.
+ *
+ * The tasks that search for settings, adjust_offsets and tau_finder,
+ * write their results to variables and the offset DAC ramp changes the
+ * OFFSETDAC values so these invalidate the shadow.
+ */
+static bool control_task_keeps_vars(control_task control_tsk) {
+    switch (control_tsk) {
+        case control_task::set_dacs:
+        case control_task::get_traces:
+        case control_task::program_fippi:
+        case control_task::get_baselines:
+        case control_task::reset_adc:
+            return true;
+        default:
+            return false;
+    }
+}
+
 void start(module::module& module, run_mode mode, run_task run_tsk, control_task control_tsk) {
     xia_log(log::debug) << module::module_label(module, "run") << "start: run-mode=" << int(mode)
                         << " run-tsk=" << std::hex << int(run_tsk) << std::dec
@@ -126,17 +190,27 @@ void start(module::module& module, run_mode mode, run_task run_tsk, control_task
 
     end(module);
 
-    if (mode == run_mode::new_run && run_tsk != run_task::nop) {
-        static const size_t block_size = hw::large_histogram_length * 4;
-        static const size_t mca_end = module.max_histogram_length * module.num_channels;
-        words zero(block_size);
-        memory::mca mca(module);
-        for (address addr = 0; addr < mca_end; addr += block_size) {
-            mca.write(addr, zero);
+    if (run_tsk != run_task::nop || !control_task_keeps_vars(control_tsk)) {
+        module.vars_shadow_invalidate();
+    }
+
+    if (run_tsk != run_task::nop) {
+        if (mode == run_mode::new_run) {
+            clear_histograms(module);
+        }
+        /*
+         * The good channels histogram the run's events.
+         */
+        for (auto& chan : module.channels) {
+            auto csra = module.read_var(param::channel_var::ChanCSRa, chan.number, 0, false);
+            if ((csra & (1 << hw::bit::CCSRA_GOOD)) != 0) {
+                chan.histogram_dirty = true;
+            }
         }
         module.run_task = run_tsk;
     } else {
         module.control_task = control_tsk;
+        module.last_control_task = control_tsk;
     }
 
     module.write_var(param::module_var::RunTask, param::value_type(run_tsk));
@@ -248,6 +322,13 @@ void control_run_on_dsp(module::module& module, control_task control_tsk, int wa
             finished = true;
         }
     }
+    /*
+     * A finished task is no longer running. Its results are held by the
+     * last control task.
+     */
+    if (finished) {
+        module.control_task = control_task::nop;
+    }
     if (!finished) {
         std::ostringstream oss;
         oss << "control task failed to end: " << int(control_tsk);
@@ -258,6 +339,19 @@ void control_run_on_dsp(module::module& module, control_task control_tsk, int wa
 void control(module::module& module, control_task control_tsk, int wait_msecs) {
     xia_log(log::debug) << module::module_label(module, "run")
                         << "control=" << control_task_labels(control_tsk) << " wait=" << wait_msecs;
+    /*
+     * A parameter transaction holds the FIPPI and DAC updates for its
+     * commit.
+     */
+    if (module.param_transaction_hold(control_tsk)) {
+        return;
+    }
+    struct transaction_resume {
+        module::module& module;
+        ~transaction_resume() {
+            module.param_transaction_resume();
+        }
+    } resume{module};
     util::time::timepoint tp;
     tp.start();
     if (control_task_prerun(module, control_tsk, wait_msecs)) {
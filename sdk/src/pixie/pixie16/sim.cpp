@@ -21,6 +21,7 @@
  */
 
 #include <algorithm>
+#include <cmath>
 #include <cstring>
 #include <fstream>
 
@@ -29,6 +30,8 @@
 #include <pixie/utils/time.hpp>
 
 #include <pixie/pixie16/defs.hpp>
+#include <pixie/pixie16/hbr.hpp>
+#include <pixie/pixie16/memory.hpp>
 #include <pixie/pixie16/sim.hpp>
 
 namespace xia {
@@ -60,6 +63,154 @@ static const xia::pixie::sim::firmware_set_defs default_firmware_defs = {
      "version=n/a, revision=13, adc-msps=100, adc-bits=12, device=var, mask=1, file=dsp.var"},
 };
 
+/*
+ * The generator's default rate in events per second.
+ */
+static constexpr double default_list_mode_rate = 10000;
+
+list_mode_generator::config::config()
+    : revision(46540), frequency(0), rate(default_list_mode_rate), channel_mask(0),
+      energy_sums(false), qdc(false), external_time(false), trace_length(0), paced(true),
+      seed(1) {}
+
+list_mode_generator::list_mode_generator(
+    const config& cfg_, int crate_id, int slot, size_t num_channels, uint32_t adc_msps)
+    : cfg(cfg_), frequency(cfg_.frequency != 0 ? cfg_.frequency : adc_msps),
+      tick(frequency == 250 ? 8e-9 : 10e-9), random(cfg_.seed), energy(0, 0x7fff),
+      fifo_offset(0), start(clock::now()), events_(0), words_(0), overflows_(0) {
+    if (cfg.rate <= 0) {
+        throw error(error::code::invalid_value, "sim: list-mode: rate must be positive");
+    }
+    if (cfg.trace_length % 2 != 0) {
+        throw error(error::code::invalid_value, "sim: list-mode: trace length must be even");
+    }
+    for (size_t c = 0; c < num_channels; ++c) {
+        if (cfg.channel_mask == 0 || (cfg.channel_mask & (1U << c)) != 0) {
+            channels.push_back(uint32_t(c));
+        }
+    }
+    if (channels.empty()) {
+        throw error(error::code::invalid_value, "sim: list-mode: no channels enabled");
+    }
+
+    event.crate_id = uint32_t(crate_id);
+    event.slot_id = uint32_t(slot);
+    event.header_length = data::list_mode::header_length::header;
+    if (cfg.energy_sums) {
+        event.header_length += 4;
+        event.energy_sums = {1000, 2000, 3000};
+        event.filter_baseline = 100;
+    }
+    if (cfg.qdc) {
+        event.header_length += 8;
+        event.qdc = {10, 20, 30, 40, 50, 60, 70, 80};
+    }
+    if (cfg.external_time) {
+        event.header_length += 2;
+    }
+    /*
+     * A pulse a quarter of the way into the trace that decays over a quarter
+     * of the trace.
+     */
+    event.trace.resize(cfg.trace_length);
+    const auto rise = cfg.trace_length / 4;
+    const double decay = double(cfg.trace_length / 4 + 1);
+    for (size_t s = 0; s < cfg.trace_length; ++s) {
+        double value = 200;
+        if (s >= rise) {
+            value += 1000 * std::exp(-double(s - rise) / decay);
+        }
+        event.trace[s] = uint16_t(value);
+    }
+
+    /*
+     * Check the configuration encodes.
+     */
+    data::list_mode::buffer check;
+    data::list_mode::encode_record(event, cfg.revision, frequency, check);
+
+    interval = std::exponential_distribution<double>(cfg.rate / double(channels.size()));
+    next_time.resize(channels.size());
+    for (auto& next : next_time) {
+        next = interval(random);
+    }
+}
+
+void list_mode_generator::generate(const double until, const size_t capacity) {
+    if (fifo_offset > 0 && fifo_offset >= fifo.size() / 2) {
+        fifo.erase(fifo.begin(), fifo.begin() + ptrdiff_t(fifo_offset));
+        fifo_offset = 0;
+    }
+    while (true) {
+        auto next = std::min_element(next_time.begin(), next_time.end());
+        auto time = *next;
+        if (cfg.paced ? time > until : available() >= capacity) {
+            break;
+        }
+        auto ticks = std::floor(time / tick);
+        event.channel_number = channels[size_t(next - next_time.begin())];
+        event.energy = energy(random);
+        event.filter_time = data::list_mode::record::time_type(ticks * tick);
+        if (cfg.external_time) {
+            event.external_time = data::list_mode::record::time_type(ticks);
+        }
+        auto before = fifo.size();
+        data::list_mode::encode_record(event, cfg.revision, frequency, fifo);
+        if (available() > capacity) {
+            fifo.resize(before);
+            /*
+             * Unpaced generation fills the FIFO. The event is generated
+             * when there is space for it so it is not an overflow.
+             */
+            if (!cfg.paced) {
+                break;
+            }
+            ++overflows_;
+        } else {
+            ++events_;
+            words_ += fifo.size() - before;
+        }
+        *next += interval(random);
+    }
+}
+
+size_t list_mode_generator::level() {
+    std::lock_guard<std::mutex> guard(lock);
+    double until = 0;
+    if (cfg.paced) {
+        until = std::chrono::duration<double>(clock::now() - start).count();
+    }
+    generate(until, hw::fifo_size_words);
+    return std::min(available(), hw::fifo_size_words);
+}
+
+void list_mode_generator::read(hw::word_ptr values, const size_t size) {
+    std::lock_guard<std::mutex> guard(lock);
+    auto words = std::min(size, available());
+    std::memcpy(values, fifo.data() + fifo_offset, words * sizeof(hw::word));
+    std::memset(values + words, 0, (size - words) * sizeof(hw::word));
+    fifo_offset += words;
+    if (fifo_offset == fifo.size()) {
+        fifo.clear();
+        fifo_offset = 0;
+    }
+}
+
+size_t list_mode_generator::events() const {
+    std::lock_guard<std::mutex> guard(lock);
+    return events_;
+}
+
+size_t list_mode_generator::words() const {
+    std::lock_guard<std::mutex> guard(lock);
+    return words_;
+}
+
+size_t list_mode_generator::overflows() const {
+    std::lock_guard<std::mutex> guard(lock);
+    return overflows_;
+}
+
 struct assembly : public xia::pixie::fixture::assembly {
     assembly(xia::pixie::module::module& module_);
     virtual ~assembly() override;
@@ -112,10 +263,19 @@ static void load_module_eeprom(const eeprom_data& data, xia::pixie::module::modu
 
 module::module(xia::pixie::backplane::backplane& backplane_)
     : xia::pixie::module::module(backplane_), fw_release(firmware::not_released),
-      fw_type(firmware::firmware_set::set_type::undefined), init_online(true) {
+      fw_type(firmware::firmware_set::set_type::undefined), init_online(true),
+      dma_wait_fail(0), dma_busy(false), dsp_reads(0), list_mode_fifo_services(false),
+      dma_waits(0), dsp_model(false), dsp_bus(false), dsp_address(0), dsp_dma_address(0) {
 }
 
-module::~module() {}
+module::~module() {
+    try {
+        dma_read_wait();
+        list_mode_detach();
+    } catch (...) {
+        /* any error will be logged */
+    }
+}
 
 void module::open(size_t device_number) {
     if (vmaddr != nullptr) {
@@ -197,7 +357,10 @@ void module::open(size_t device_number) {
             var_defaults = mod_def.var_defaults;
 
             opened_ = true;
-            hw_word_read = [&self = *this](int reg) {
+            hw_word_read = [&self = *this](int reg) -> hw::word {
+                if (reg == hw::device::RD_WRT_FIFO_WML && self.list_mode) {
+                    return hw::word(self.list_mode->level());
+                }
                 return hw::read_word(self.vmaddr, reg);
             };
             hw_word_write = [&self = *this](int reg, hw::word val) {
@@ -237,6 +400,9 @@ void module::open(size_t device_number) {
             mibs_double_rw.emplace_back(mib_base + "run.bandwidth", run_stats.bandwidth);
             mibs_double_rw.emplace_back(mib_base + "run.max-bandwidth", run_stats.max_bandwidth);
             mibs_double_rw.emplace_back(mib_base + "run.min-bandwidth", run_stats.min_bandwidth);
+            mibs_double_rw.emplace_back(mib_base + "run.start-latency", run_stats.start_latency);
+
+            mib_boot_add();
 
             return;
         }
@@ -278,6 +444,49 @@ void module::sim_csr(hw::word val) {
     }
 }
 
+void module::list_mode_attach(const list_mode_generator::config& cfg) {
+    if (!online()) {
+        throw error(number, slot, error::code::module_offline, "sim: list-mode: not online");
+    }
+    {
+        bus_guard guard(*this);
+        list_mode = std::make_unique<list_mode_generator>(
+            cfg, 0, slot, num_channels, uint32_t(eeprom.configs[0].adc_msps));
+        /*
+         * The simulated firmware has no revision. The data is the
+         * generator's revision.
+         */
+        list_mode_revision = cfg.revision;
+    }
+    xia_log(log::info) << module_label(*this) << "sim: list-mode: attach: revision="
+                       << cfg.revision << " frequency=" << list_mode->frequency
+                       << " rate=" << cfg.rate << " trace-length=" << cfg.trace_length
+                       << " paced=" << std::boolalpha << cfg.paced;
+    /*
+     * The simulated FPGAs never report done so the FIFO services are not
+     * started by the open. Start them so the worker reads the generator.
+     */
+    if (!fifo_pool.valid()) {
+        fifo_pool.create(fifo_buffers, 64 * 1024);
+        fifo_data.create(fifo_pool);
+        start_fifo_worker();
+        list_mode_fifo_services = true;
+    }
+}
+
+void module::list_mode_detach() {
+    /*
+     * Stop the worker before taking the bus as the worker holds the bus
+     * when reading the FIFO.
+     */
+    if (list_mode_fifo_services) {
+        stop_fifo_services();
+        list_mode_fifo_services = false;
+    }
+    bus_guard guard(*this);
+    list_mode.reset();
+}
+
 void module::close() {
     if (opened()) {
         xia_log(log::info) << "sim: module: close";
@@ -296,6 +505,8 @@ void module::close() {
 
         force_offline();
 
+        list_mode_detach();
+
         if (vmaddr != nullptr) {
             pci_memory.release();
             vmaddr = nullptr;
@@ -314,7 +525,10 @@ void module::close() {
         mibs_size_t_rw.clear();
         mibs_double_rw.clear();
 
+        mib_boot_remove();
+
         mib::remove(mib_base + "run.min-bandwidth");
+        mib::remove(mib_base + "run.start-latency");
         mib::remove(mib_base + "run.max-bandwidth");
         mib::remove(mib_base + "run.bandwidth");
         mib::remove(mib_base + "run.hw-overflows");
@@ -369,23 +583,29 @@ void module::boot(const boot_params& params, const firmware::firmware_set& firmw
     }
     online_ = false;
     mib_disable();
+    boot_profile::timer boot_timer(boot_stats);
     auto boot_comms = params.boot_comms;
     auto boot_fippi = params.boot_fippi;
     auto boot_dsp = params.boot_dsp;
     init_values();
+    boot_timer.mark(boot_stats.validate);
     if (boot_comms) {
         comms_fpga = true;
         fixtures->fpga_comms_loaded();
+        boot_timer.mark(boot_stats.comms);
     }
     if (boot_fippi) {
         fippi_fpga = true;
         fixtures->fpga_fippi_loaded();
+        boot_timer.mark(boot_stats.fippi);
     }
     if (boot_dsp) {
         dsp_online = true;
         fixtures->dsp_loaded();
+        boot_timer.mark(boot_stats.dsp);
     }
     init_channels();
+    boot_timer.mark(boot_stats.init);
     online_ = comms_fpga && fippi_fpga && dsp_online;
     fw_release = firmware.release;
     fw_type = firmware.type();
@@ -394,6 +614,7 @@ void module::boot(const boot_params& params, const firmware::firmware_set& firmw
     mib_enable();
     write_var(param::module_var::SlotID, param::value_type(slot));
     write_word(hw::device::CSR, 1 << hw::bit::EXTFIFO_WML);
+    boot_timer.mark(boot_stats.afe);
 }
 
 void module::initialize() {}
@@ -416,6 +637,18 @@ void module::dma_read(const hw::address source, hw::word_ptr values, const size_
                         << " length=" << std::dec << size;
 
     online_check();
+    if (source == hw::memory::FIFO_MEM_DMA && list_mode) {
+        list_mode->read(values, size);
+        return;
+    }
+    if (source == hw::memory::DSP_MEM_DMA && dsp_model) {
+        for (size_t s = 0; s < size; ++s) {
+            auto word = dsp_memory.find(hw::address(dsp_dma_address + s));
+            values[s] = word == dsp_memory.end() ? 0 : word->second;
+        }
+        dsp_reads += size;
+        return;
+    }
     size_t s = 0;
     while (s++ < size) {
         *values = read_word(int(source + s));
@@ -423,6 +656,106 @@ void module::dma_read(const hw::address source, hw::word_ptr values, const size_
     }
 }
 
+void module::dma_read_start(const hw::address source, hw::word_ptr values, const size_t size) {
+    xia_log(log::debug) << module_label(*this) << "dma read start: addr=0x" << std::hex << source
+                        << " length=" << std::dec << size;
+
+    online_check();
+    if (dma_transfer.valid()) {
+        throw error(number, slot, error::code::device_dma_failure, "DMA read already in flight");
+    }
+    dma_transfer = std::async(std::launch::async, [this, source, values, size]() {
+        dma_read(source, values, size);
+    });
+}
+
+void module::dma_read_wait() {
+    if (dma_transfer.valid()) {
+        dma_transfer.get();
+        if (++dma_waits == dma_wait_fail) {
+            throw error(number, slot, error::code::device_dma_failure, "sim: DMA read wait failed");
+        }
+    }
+}
+
+bool module::dma_read_busy() {
+    return dma_busy;
+}
+
+void module::dsp_memory_attach() {
+    if (!online()) {
+        throw error(number, slot, error::code::module_offline, "sim: dsp-memory: not online");
+    }
+    {
+        bus_guard guard(*this);
+        if (dsp_model) {
+            return;
+        }
+        dsp_saved_read = hw_word_read;
+        dsp_saved_write = hw_word_write;
+        dsp_model = true;
+        dsp_bus = false;
+        dsp_reads = 0;
+        /*
+         * The host bus address register auto-increments on each access
+         * of the data register.
+         */
+        hw_word_read = [this](int reg) -> hw::word {
+            if (reg == hw::device::WRT_DSP_MMA && dsp_bus) {
+                ++dsp_reads;
+                auto word = dsp_memory.find(dsp_address++);
+                return word == dsp_memory.end() ? 0 : word->second;
+            }
+            return dsp_saved_read(reg);
+        };
+        hw_word_write = [this](int reg, hw::word val) {
+            switch (reg) {
+                case hw::device::REQUEST_HBR:
+                    dsp_bus = val == hw::hbr::dsp_access.request;
+                    break;
+                case hw::device::HBR_DONE:
+                    dsp_bus = false;
+                    break;
+                case hw::device::EXT_MEM_TEST:
+                    if (dsp_bus) {
+                        dsp_address = val;
+                        return;
+                    }
+                    break;
+                case hw::device::WRT_DSP_MMA:
+                    if (dsp_bus) {
+                        dsp_memory[dsp_address++] = val;
+                        return;
+                    }
+                    break;
+                case hw::device::WRT_DSP_II11:
+                    dsp_dma_address = val;
+                    break;
+                default:
+                    break;
+            }
+            dsp_saved_write(reg, val);
+        };
+        have_hardware = true;
+    }
+    vars_shadow_invalidate();
+}
+
+void module::dsp_memory_detach() {
+    {
+        bus_guard guard(*this);
+        if (!dsp_model) {
+            return;
+        }
+        hw_word_read = dsp_saved_read;
+        hw_word_write = dsp_saved_write;
+        dsp_model = false;
+        dsp_bus = false;
+        have_hardware = false;
+    }
+    vars_shadow_invalidate();
+}
+
 void module::load_var_defaults(std::istream& input) {
     for (std::string line; std::getline(input, line);) {
         line = line.substr(0, line.find('#', 0));
@@ -0,0 +1,107 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+
+/*
+ * Copyright 2021 XIA LLC, All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** @file snapshot.cpp
+ * @brief Implements a snapshot of a crate's histograms and run statistics.
+ */
+
+#include <pixie/log.hpp>
+#include <pixie/utils/thread.hpp>
+#include <pixie/utils/time.hpp>
+
+#include <pixie/pixie16/snapshot.hpp>
+
+namespace xia {
+namespace pixie {
+namespace crate {
+snapshot::module_snapshot::module_snapshot(module::module& module, size_t offset_)
+    : slot(module.slot), num_channels(module.num_channels),
+      histogram_length(module.max_histogram_length), offset(offset_), histograms(nullptr),
+      stats(module) {}
+
+hw::word_ptr snapshot::module_snapshot::histogram(size_t channel) const {
+    if (channel >= num_channels) {
+        throw error(pixie::error::code::channel_number_invalid,
+                    "snapshot: invalid channel: slot=" + std::to_string(slot) +
+                        " channel=" + std::to_string(channel));
+    }
+    if (histograms == nullptr) {
+        throw error(pixie::error::code::invalid_value, "snapshot: not read");
+    }
+    return histograms + channel * histogram_length;
+}
+
+snapshot::snapshot(crate& crate__) : period(0), crate_(crate__), words_(0) {
+    crate_.ready();
+    for (size_t slot = 0; slot < crate_.num_slots; ++slot) {
+        auto module = crate_.find(slot);
+        if (module->online()) {
+            modules.emplace_back(*module, words_);
+            words_ += module->histograms_length();
+        }
+    }
+    xia_log(log::info) << "snapshot: modules=" << modules.size() << " words=" << words_;
+}
+
+void snapshot::read(hw::word_ptr values, const size_t size) {
+    if (size < words_) {
+        throw error(pixie::error::code::invalid_value,
+                    "snapshot: buffer too small: " + std::to_string(size) + " < " +
+                        std::to_string(words_));
+    }
+    util::thread::workers workers;
+    workers.reserve(modules.size());
+    for (auto& mod_snapshot : modules) {
+        auto module = crate_.find(mod_snapshot.slot);
+        mod_snapshot.histograms = values + mod_snapshot.offset;
+        workers.emplace_back([module, &mod_snapshot]() {
+            module->read_histograms(mod_snapshot.histograms,
+                                    mod_snapshot.num_channels * mod_snapshot.histogram_length);
+            module->read_stats(mod_snapshot.stats);
+        });
+    }
+    util::time::timepoint tp(true);
+    time = clock::now();
+    for (auto& w : workers) {
+        w.start();
+    }
+    util::thread::wait_until_finished(workers, 1, "snapshot: module read error; see log");
+    tp.end();
+    period = tp.usecs();
+    xia_log(log::debug) << "snapshot: read: period=" << tp;
+}
+
+void snapshot::read(hw::words& values) {
+    if (values.empty()) {
+        values.resize(words_);
+    }
+    read(values.data(), values.size());
+}
+
+const snapshot::module_snapshot& snapshot::find(hw::slot_type slot) const {
+    for (auto& mod_snapshot : modules) {
+        if (mod_snapshot.slot == slot) {
+            return mod_snapshot;
+        }
+    }
+    throw error(pixie::error::code::module_number_invalid,
+                "snapshot: slot not found: " + std::to_string(slot));
+}
+}  // namespace crate
+}  // namespace pixie
+}  // namespace xia
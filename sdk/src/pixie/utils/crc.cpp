@@ -20,9 +20,11 @@
  * @brief Defines utility functions and data structures related to CRC32 useful throughout the SDK.
  */
 
+#include <algorithm>
 #include <cstring>
 #include <fstream>
 #include <iomanip>
+#include <iterator>
 
 #include <pixie/error.hpp>
 #include <pixie/utils/crc.hpp>
@@ -39,7 +41,7 @@ void crc32::clear() {
 }
 
 crc32& crc32::operator<<(const std::string& val) {
-    update(reinterpret_cast<const unsigned char*>(val.c_str()), int(val.length()));
+    update(reinterpret_cast<const unsigned char*>(val.c_str()), val.length());
     return *this;
 }
 
@@ -65,12 +67,113 @@ crc32::operator const std::string() const {
     return oss.str();
 }
 
-void crc32::update(const unsigned char* data, int len) {
-    value = ~value;
+/*
+ * Slicing-by-8 processes 8 bytes with 8 table lookups and no loop carried
+ * dependency between the lookups. The bytes are assembled little endian
+ * so the result does not depend on the host's byte order and the data
+ * does not need to be aligned. The tail is processed a byte at a time.
+ */
+void crc32::update(const unsigned char* data, size_t len) {
+    const value_type* t = slices();
+    value_type crc = ~value;
+    while (len >= 8) {
+        const value_type lo = crc ^
+            (value_type(data[0]) | (value_type(data[1]) << 8) |
+             (value_type(data[2]) << 16) | (value_type(data[3]) << 24));
+        const value_type hi =
+            value_type(data[4]) | (value_type(data[5]) << 8) |
+            (value_type(data[6]) << 16) | (value_type(data[7]) << 24);
+        crc = t[(7 * 256) + (lo & 0xff)] ^ t[(6 * 256) + ((lo >> 8) & 0xff)] ^
+            t[(5 * 256) + ((lo >> 16) & 0xff)] ^ t[(4 * 256) + (lo >> 24)] ^
+            t[(3 * 256) + (hi & 0xff)] ^ t[(2 * 256) + ((hi >> 8) & 0xff)] ^
+            t[256 + ((hi >> 16) & 0xff)] ^ t[hi >> 24];
+        data += 8;
+        len -= 8;
+    }
     while (len-- != 0) {
-        value = table[(value ^ *data++) & 0xff] ^ (value >> 8);
+        crc = table[(crc ^ *data++) & 0xff] ^ (crc >> 8);
+    }
+    value = ~crc;
+}
+
+const crc32::value_type* crc32::slices() {
+    struct tables {
+        value_type t[8 * 256];
+        tables() {
+            std::copy(std::begin(table), std::end(table), std::begin(t));
+            for (size_t s = 1; s < 8; ++s) {
+                for (size_t i = 0; i < 256; ++i) {
+                    auto prev = t[((s - 1) * 256) + i];
+                    t[(s * 256) + i] = (prev >> 8) ^ table[prev & 0xff];
+                }
+            }
+        }
+    };
+    static const tables slicing;
+    return slicing.t;
+}
+
+/*
+ * The combine uses the GF(2) matrix method. Appending zero bytes to the
+ * data is a linear operator on the CRC. The operator for `len` zero bytes
+ * is formed by squaring the operator for one zero bit.
+ */
+static uint32_t gf2_matrix_times(const uint32_t* mat, uint32_t vec) {
+    uint32_t sum = 0;
+    while (vec != 0) {
+        if ((vec & 1) != 0) {
+            sum ^= *mat;
+        }
+        vec >>= 1;
+        ++mat;
+    }
+    return sum;
+}
+
+static void gf2_matrix_square(uint32_t* square, const uint32_t* mat) {
+    for (size_t n = 0; n < 32; ++n) {
+        square[n] = gf2_matrix_times(mat, mat[n]);
+    }
+}
+
+void crc32::combine(const value_type crc, const size_t len) {
+    if (len == 0) {
+        return;
+    }
+    uint32_t even[32];
+    uint32_t odd[32];
+    /*
+     * The operator for one zero bit.
+     */
+    odd[0] = 0xedb88320UL;
+    uint32_t row = 1;
+    for (size_t n = 1; n < 32; ++n) {
+        odd[n] = row;
+        row <<= 1;
     }
-    value = ~value;
+    /*
+     * Two then four zero bits.
+     */
+    gf2_matrix_square(even, odd);
+    gf2_matrix_square(odd, even);
+    value_type crc1 = value;
+    size_t len2 = len;
+    do {
+        gf2_matrix_square(even, odd);
+        if ((len2 & 1) != 0) {
+            crc1 = gf2_matrix_times(even, crc1);
+        }
+        len2 >>= 1;
+        if (len2 == 0) {
+            break;
+        }
+        gf2_matrix_square(odd, even);
+        if ((len2 & 1) != 0) {
+            crc1 = gf2_matrix_times(odd, crc1);
+        }
+        len2 >>= 1;
+    } while (len2 != 0);
+    value = crc1 ^ crc;
 }
 
 const crc32::value_type crc32::table[256] = {
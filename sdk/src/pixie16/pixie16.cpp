@@ -20,15 +20,19 @@
  * @brief C wrappers for the C++ API that expose the same signature as the legacy code
  */
 
+#include <algorithm>
 #include <bitset>
 #include <cstring>
+#include <memory>
 #include <regex>
+#include <vector>
 
 #include <sys/stat.h>
 
 #include <pixie16/pixie16.h>
 
 #include <pixie/config.hpp>
+#include <pixie/data/list_mode_spool.hpp>
 #include <pixie/error.hpp>
 #include <pixie/fw.hpp>
 #include <pixie/log.hpp>
@@ -336,8 +340,8 @@ PIXIE_EXPORT int PIXIE_API Pixie16AcquireBaselines(unsigned short ModNum) {
                 if (*module == xia::pixie::hw::rev_H) {
                     return not_supported();
                 }
-                module->acquire_baselines();
             }
+            crate->acquire_baselines();
         } else {
             xia::pixie::crate::view::module_handle module(crate, ModNum);
             if (!crate.run_check_override) {
@@ -363,10 +367,7 @@ PIXIE_EXPORT int PIXIE_API Pixie16AdjustOffsets(unsigned short ModNum) {
             if (!crate.run_check_override) {
                 crate->check_active_run();
             }
-            for (size_t mod_num = 0; mod_num < crate.modules.num_modules; mod_num++) {
-                xia::pixie::crate::view::module_handle module(crate, mod_num);
-                module->adjust_offsets();
-            }
+            crate->adjust_offsets();
         } else {
             xia::pixie::crate::view::module_handle module(crate, ModNum);
             if (!crate.run_check_override) {
@@ -1101,16 +1102,153 @@ PIXIE_EXPORT int PIXIE_API Pixie16ReadDataFromExternalFIFO(unsigned int* ExtFIFO
         crate->ready();
         xia::pixie::crate::view::module_handle module(crate, ModNum);
 
-        xia::pixie::hw::words data(nFIFOWords);
-        auto copied = module->read_list_mode(data);
+        auto copied = module->read_list_mode(ExtFIFO_Data, nFIFOWords);
         if (copied != nFIFOWords) {
             xia_log(xia::log::error)
                 << "Failed to read FIFO words, requested nFIFOWords (" << nFIFOWords
                 << "), copied " << copied
                 << " for Module " << ModNum << ". Remaining values filled with zero.";
+            std::fill(ExtFIFO_Data + copied, ExtFIFO_Data + nFIFOWords, 0);
+        }
+        return 0;
+    };
+
+    return err_handler(call);
+}
+
+PIXIE_EXPORT int PIXIE_API PixieReadListModeData(unsigned short mod_num, unsigned int* data,
+                                                 unsigned int max_words,
+                                                 unsigned int* num_words) {
+    xia_log(xia::log::debug) << "PixieReadListModeData: mod_num=" << mod_num
+                             << " max_words=" << max_words;
+
+    auto call = [&mod_num, &data, &max_words, &num_words]() {
+        if (data == nullptr) {
+            throw xia_error(xia_error::code::invalid_value, "data is null");
+        }
+        if (num_words == nullptr) {
+            throw xia_error(xia_error::code::invalid_value, "num_words is null");
         }
-        for (size_t i = 0; i < copied; i++) {
-            ExtFIFO_Data[i] = data[i];
+
+        crate->ready();
+        xia::pixie::crate::view::module_handle module(crate, mod_num);
+        *num_words = static_cast<unsigned int>(module->read_list_mode_available(data, max_words));
+        return 0;
+    };
+
+    return err_handler(call);
+}
+
+PIXIE_EXPORT int PIXIE_API PixieBeginParameterTransaction(unsigned short mod_num) {
+    xia_log(xia::log::debug) << "PixieBeginParameterTransaction: mod_num=" << mod_num;
+
+    auto call = [&mod_num]() {
+        crate->ready();
+        if (mod_num == crate.modules.num_modules) {
+            if (!crate.run_check_override) {
+                crate->check_active_run();
+            }
+            crate->param_transaction_begin();
+        } else {
+            xia::pixie::crate::view::module_handle module(crate, mod_num);
+            if (!crate.run_check_override) {
+                module->run_check();
+            }
+            module->param_transaction_begin();
+        }
+        return 0;
+    };
+
+    return err_handler(call);
+}
+
+PIXIE_EXPORT int PIXIE_API PixieCommitParameterTransaction(unsigned short mod_num) {
+    xia_log(xia::log::debug) << "PixieCommitParameterTransaction: mod_num=" << mod_num;
+
+    auto call = [&mod_num]() {
+        crate->ready();
+        if (mod_num == crate.modules.num_modules) {
+            if (!crate.run_check_override) {
+                crate->check_active_run();
+            }
+            crate->param_transaction_commit();
+        } else {
+            xia::pixie::crate::view::module_handle module(crate, mod_num);
+            if (!crate.run_check_override) {
+                module->run_check();
+            }
+            module->param_transaction_commit();
+        }
+        return 0;
+    };
+
+    return err_handler(call);
+}
+
+PIXIE_EXPORT int PIXIE_API PixieAbortParameterTransaction(unsigned short mod_num) {
+    xia_log(xia::log::debug) << "PixieAbortParameterTransaction: mod_num=" << mod_num;
+
+    auto call = [&mod_num]() {
+        crate->ready();
+        if (mod_num == crate.modules.num_modules) {
+            crate->param_transaction_abort();
+        } else {
+            xia::pixie::crate::view::module_handle module(crate, mod_num);
+            module->param_transaction_abort();
+        }
+        return 0;
+    };
+
+    return err_handler(call);
+}
+
+PIXIE_EXPORT int PIXIE_API PixieListModeSpoolOpen(unsigned short mod_num, const char* path) {
+    xia_log(xia::log::debug) << "PixieListModeSpoolOpen: mod_num=" << mod_num
+                             << " path=" << (path == nullptr ? "null" : path);
+
+    auto call = [&mod_num, &path]() {
+        if (path == nullptr) {
+            throw xia_error(xia_error::code::invalid_value, "path is null");
+        }
+
+        crate->ready();
+        if (mod_num == crate.modules.num_modules) {
+            auto writer = std::make_shared<xia::pixie::data::list_mode::spool_writer>(path);
+            crate->spool_attach(writer);
+        } else {
+            xia::pixie::crate::view::module_handle module(crate, mod_num);
+            auto writer = std::make_shared<xia::pixie::data::list_mode::spool_writer>(path);
+            module->spool_attach(writer);
+        }
+        return 0;
+    };
+
+    return err_handler(call);
+}
+
+PIXIE_EXPORT int PIXIE_API PixieListModeSpoolClose(unsigned short mod_num) {
+    xia_log(xia::log::debug) << "PixieListModeSpoolClose: mod_num=" << mod_num;
+
+    auto call = [&mod_num]() {
+        crate->ready();
+        std::vector<xia::pixie::data::list_mode::spool_writer_ptr> writers;
+        if (mod_num == crate.modules.num_modules) {
+            for (size_t m = 0; m < crate.modules.num_modules; ++m) {
+                xia::pixie::crate::view::module_handle module(crate, m);
+                writers.push_back(module->spool_detach());
+            }
+        } else {
+            xia::pixie::crate::view::module_handle module(crate, mod_num);
+            writers.push_back(module->spool_detach());
+        }
+        /*
+         * The modules share a crate's writer. Closing a closed writer does
+         * nothing.
+         */
+        for (auto& writer : writers) {
+            if (writer) {
+                writer->close();
+            }
         }
         return 0;
     };
@@ -1839,6 +1977,98 @@ PIXIE_EXPORT int PIXIE_API PixieReadRunFifoStats(unsigned short mod_num,
     return err_handler(call);
 }
 
+PIXIE_EXPORT int PIXIE_API PixieReadFifoBuffers(unsigned short mod_num,
+                                                struct module_fifo_buffer* buffers,
+                                                unsigned int max_buffers,
+                                                unsigned int* num_buffers) {
+    xia_log(xia::log::debug) << "PixieReadFifoBuffers: Module=" << mod_num
+                             << " max_buffers=" << max_buffers;
+
+    auto call = [&mod_num, &buffers, &max_buffers, &num_buffers]() {
+        if (buffers == nullptr) {
+            throw xia_error(xia_error::code::invalid_value, "buffers is null");
+        }
+        if (num_buffers == nullptr) {
+            throw xia_error(xia_error::code::invalid_value, "num_buffers is null");
+        }
+        if (max_buffers == 0) {
+            throw xia_error(xia_error::code::invalid_value, "max_buffers is 0");
+        }
+
+        *num_buffers = 0;
+
+        crate->ready();
+        xia::pixie::crate::view::module_handle module(crate, mod_num);
+
+        static_assert(sizeof(unsigned int) == sizeof(xia::buffer::buffer_value),
+                      "FIFO buffer word size mismatch");
+
+        xia::buffer::lent_buffers lent;
+        module->read_list_mode(lent, max_buffers);
+        /*
+         * Hold the handles until every buffer has one so a failure
+         * returns them all to the pool. Publishing them cannot fail.
+         */
+        std::vector<std::unique_ptr<xia::buffer::lent>> handles;
+        handles.reserve(lent.size());
+        for (auto& buf : lent) {
+            handles.push_back(std::make_unique<xia::buffer::lent>(std::move(buf)));
+        }
+        for (auto& handle : handles) {
+            auto& out = buffers[*num_buffers];
+            out.data = reinterpret_cast<const unsigned int*>(handle->data());
+            out.words = handle->size();
+            out.handle = handle.release();
+            ++(*num_buffers);
+        }
+        return 0;
+    };
+    return err_handler(call);
+}
+
+PIXIE_EXPORT int PIXIE_API PixieReleaseFifoBuffers(struct module_fifo_buffer* buffers,
+                                                   unsigned int num_buffers) {
+    xia_log(xia::log::debug) << "PixieReleaseFifoBuffers: num_buffers=" << num_buffers;
+
+    auto call = [&buffers, &num_buffers]() {
+        if (buffers == nullptr) {
+            throw xia_error(xia_error::code::invalid_value, "buffers is null");
+        }
+        for (unsigned int b = 0; b < num_buffers; ++b) {
+            delete static_cast<xia::buffer::lent*>(buffers[b].handle);
+            buffers[b].data = nullptr;
+            buffers[b].words = 0;
+            buffers[b].handle = nullptr;
+        }
+        return 0;
+    };
+    return err_handler(call);
+}
+
+PIXIE_EXPORT int PIXIE_API PixieReadHistogramsFromModule(unsigned int* histograms,
+                                                         unsigned int num_words,
+                                                         unsigned short mod_num,
+                                                         unsigned int* hist_length) {
+    xia_log(xia::log::debug) << "PixieReadHistogramsFromModule: Module=" << mod_num
+                             << " num_words=" << num_words;
+
+    auto call = [&histograms, &num_words, &mod_num, &hist_length]() {
+        if (histograms == nullptr) {
+            throw xia_error(xia_error::code::invalid_value, "histograms is null");
+        }
+        if (hist_length == nullptr) {
+            throw xia_error(xia_error::code::invalid_value, "hist_length is null");
+        }
+
+        crate->ready();
+        xia::pixie::crate::view::module_handle module(crate, mod_num);
+        module->read_histograms(histograms, num_words);
+        *hist_length = static_cast<unsigned int>(module->max_histogram_length);
+        return 0;
+    };
+    return err_handler(call);
+}
+
 PIXIE_EXPORT const char* PIXIE_API PixieGetInstallationPath(const enum PIXIE_INSTALL_PATH opt, ...) {
     switch (opt) {
         case PIXIE_PATH_FIRMWARE_DEFAULT:
@@ -1849,8 +2079,14 @@ PIXIE_EXPORT const char* PIXIE_API PixieGetInstallationPath(const enum PIXIE_INS
     return nullptr;
 }
 
-PIXIE_EXPORT int PIXIE_API PixieSysControlOpen(const char* path, const enum PIXIE_SYSCTL_FORMAT format) {
-    auto call = [&path, &format]() {
+/*
+ * Open the system control output. A path walks only the MIBs under the
+ * path, otherwise the query is a regular expression searched for in
+ * every MIB name.
+ */
+static int sysctl_open(const char* query, const enum PIXIE_SYSCTL_FORMAT format,
+                       const bool is_path) {
+    auto call = [&query, &format, is_path]() {
         bool is_json;
         switch (format) {
             case PIXIE_SYSCTL_FORMAT_TEXT:
@@ -1862,18 +2098,21 @@ PIXIE_EXPORT int PIXIE_API PixieSysControlOpen(const char* path, const enum PIXI
             default:
                 throw xia_error(xia_error::code::invalid_value, "invalid system control format");
         }
-        std::string spath;
-        if (path != nullptr) {
-            spath = path;
+        std::string squery;
+        if (query != nullptr) {
+            squery = query;
         }
         crate.sysctl.create();
         crate.sysctl_reader.seek(0);
-        std::regex mib_match(spath);
+        std::regex mib_match;
+        if (!is_path) {
+            mib_match = std::regex(squery);
+        }
         xia::pixie::format::json json_out;
         xia::mib::mib_walk_func walker =
-            [&spath, is_json, &mib_match, &json_out](xia::mib::node& nod) {
+            [is_path, is_json, &mib_match, &json_out](xia::mib::node& nod) {
                 auto name = nod.name();
-                if (spath.empty() || std::regex_search(name, mib_match)) {
+                if (is_path || std::regex_search(name, mib_match)) {
                     if (is_json) {
                         xia::mib::mib_to_json(json_out, nod.str(), name);
                     } else {
@@ -1884,7 +2123,11 @@ PIXIE_EXPORT int PIXIE_API PixieSysControlOpen(const char* path, const enum PIXI
                     }
                 }
             };
-        xia::mib::walk(walker);
+        if (is_path) {
+            xia::mib::walk(squery, walker);
+        } else {
+            xia::mib::walk(walker);
+        }
         if (is_json) {
             auto s = json_out.dump();
             crate.sysctl.push(s);
@@ -1894,6 +2137,15 @@ PIXIE_EXPORT int PIXIE_API PixieSysControlOpen(const char* path, const enum PIXI
     return err_handler(call);
 }
 
+PIXIE_EXPORT int PIXIE_API PixieSysControlOpen(const char* path, const enum PIXIE_SYSCTL_FORMAT format) {
+    return sysctl_open(path, format, false);
+}
+
+PIXIE_EXPORT int PIXIE_API PixieSysControlOpenPath(const char* path,
+                                                   const enum PIXIE_SYSCTL_FORMAT format) {
+    return sysctl_open(path, format, true);
+}
+
 PIXIE_EXPORT int PIXIE_API PixieSysControlRead(char* buffer, size_t* size) {
     auto call = [&buffer, &size]() {
         if (size == nullptr) {
@@ -0,0 +1,164 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+
+/*
+ * Copyright 2021 XIA LLC, All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** @file fifo_read.cpp
+ * @brief Benchmarks the ways the C API copies a module's list-mode data into
+ * the caller's buffer.
+ *
+ * Rates are in MB/s of list-mode data. The FIFO data ring is filled with the
+ * pool's buffers and drained with reads of each size. The staged read is the
+ * previous `Pixie16ReadDataFromExternalFIFO`, which read into a vector
+ * allocated for each call and then copied the words to the caller. The
+ * direct read copies the words into the caller's buffer and the available
+ * read is `PixieReadListModeData`, which reads the words available up to the
+ * size.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include <args/args.hxx>
+
+#include <pixie/buffer.hpp>
+#include <pixie/error.hpp>
+#include <pixie/pixie16/hw.hpp>
+
+namespace buffer = xia::buffer;
+namespace hw = xia::pixie::hw;
+
+/*
+ * Fill the ring with all the pool's buffers. Not timed.
+ */
+static size_t fill(buffer::pool& pool, buffer::ring& ring) {
+    size_t words = 0;
+    while (pool.count() > 0) {
+        auto buf = pool.request_buffer();
+        buf->resize(buf->capacity());
+        std::fill(buf->begin(), buf->end(), buffer::buffer_value(words));
+        ring.push(buf, buf->size());
+        words += buf->size();
+    }
+    return words;
+}
+
+/*
+ * Fill and drain the ring `iterations` times and return the best rate in
+ * MB/s.
+ */
+static double measure(buffer::pool& pool, buffer::ring& ring, size_t iterations,
+                      const std::function<void()>& drain) {
+    double best = 0;
+    for (size_t i = 0; i < iterations; ++i) {
+        auto words = fill(pool, ring);
+        auto start = std::chrono::steady_clock::now();
+        drain();
+        std::chrono::duration<double> period = std::chrono::steady_clock::now() - start;
+        auto rate = double(words * sizeof(hw::word)) / period.count() / 1e6;
+        if (rate > best) {
+            best = rate;
+        }
+    }
+    return best;
+}
+
+int main(int argc, char** argv) {
+    args::ArgumentParser parser("Benchmarks the list-mode FIFO data reads.");
+    parser.LongSeparator("=");
+    args::HelpFlag help_flag(parser, "help", "Displays this message", {'h', "help"});
+    args::ValueFlag<size_t> buffers_flag(parser, "buffers", "The number of buffers in the pool",
+                                         {'b', "buffers"}, 64);
+    args::ValueFlag<size_t> iterations_flag(parser, "iterations",
+                                            "The number of times the ring is drained",
+                                            {'i', "iterations"}, 10);
+
+    try {
+        parser.ParseCLI(argc, argv);
+    } catch (args::Help&) {
+        std::cout << parser;
+        return EXIT_SUCCESS;
+    } catch (args::Error& e) {
+        std::cerr << "error: " << e.what() << std::endl << parser;
+        return EXIT_FAILURE;
+    }
+
+    auto buffers = args::get(buffers_flag);
+    auto iterations = args::get(iterations_flag);
+
+    /*
+     * The pool's buffers are the size of a FIFO DMA block and the read sizes
+     * divide the ring's data.
+     */
+    const size_t buffer_words = 32 * 1024;
+    const std::vector<size_t> read_sizes = {1024, 8192, 32768, 131072};
+
+    std::cout << "buffers: " << buffers << " words per buffer: " << buffer_words
+              << " iterations: " << iterations << std::endl
+              << std::endl;
+    std::cout << std::setw(10) << "words" << std::setw(10) << "staged" << std::setw(10)
+              << "direct" << std::setw(11) << "available" << std::setw(10) << "speedup"
+              << std::endl;
+
+    try {
+        buffer::pool pool;
+        pool.create(buffers, buffer_words);
+        buffer::ring ring;
+        ring.create(pool);
+
+        for (auto read_size : read_sizes) {
+            std::vector<unsigned int> caller(read_size);
+
+            auto staged = measure(pool, ring, iterations, [&] {
+                while (ring.size() >= read_size) {
+                    hw::words data(read_size);
+                    auto copied = ring.copy(data);
+                    for (size_t w = 0; w < copied; ++w) {
+                        caller[w] = data[w];
+                    }
+                }
+            });
+            auto direct = measure(pool, ring, iterations, [&] {
+                while (ring.size() >= read_size) {
+                    ring.copy(caller.data(), read_size);
+                }
+            });
+            auto available = measure(pool, ring, iterations, [&] {
+                while (!ring.empty()) {
+                    ring.copy(caller.data(), std::min(ring.size(), read_size));
+                }
+            });
+
+            std::cout << std::fixed << std::setprecision(1) << std::setw(10) << read_size
+                      << std::setw(10) << staged << std::setw(10) << direct << std::setw(11)
+                      << available << std::setw(10) << std::setprecision(2)
+                      << direct / staged << std::endl;
+        }
+
+        ring.destroy();
+        pool.destroy();
+    } catch (xia::pixie::error::error& e) {
+        std::cerr << "error: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
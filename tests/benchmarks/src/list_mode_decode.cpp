@@ -0,0 +1,185 @@
+/* SPDX-License-Identifier: Apache-2.0 */
+
+/*
+ * Copyright 2021 XIA LLC, All rights reserved.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/** @file list_mode_decode.cpp
+ * @brief Benchmarks the list-mode decoders on large synthetic data blocks for
+ * every supported firmware revision and frequency.
+ *
+ * Rates are in MB/s of list-mode data. The speedup compares the plan and
+ * interpreter header decoders when decoding into a record batch, where the
+ * header decoding is not hidden by the per-record memory allocations. The
+ * blocks have events of one length so the plan decoder fills the batch in
+ * uniform runs. The parallel rate decodes the records with all the hardware
+ * threads.
+ */
+
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include <args/args.hxx>
+
+#include <pixie/data/list_mode.hpp>
+#include <pixie/data/list_mode_parallel.hpp>
+
+namespace list_mode = xia::pixie::data::list_mode;
+
+/*
+ * The header words are valid for the revision and frequency and describe an
+ * event with energy sums, QDCs and a 30 sample trace. The layouts with
+ * external timestamps also have the external timestamp words.
+ */
+struct layout {
+    uint32_t revision;
+    uint32_t frequency;
+    list_mode::buffer header;
+    bool ets;
+};
+
+static const std::vector<layout> layouts = {
+    {17562, 100, {3225354282, 3735933136, 202182637, 1966560}, false},
+    {29432, 100, {2151612458, 3735933136, 202182637, 1999328}, false},
+    {30474, 100, {2151612458, 3735933136, 202182637, 1999328}, false},
+    {34688, 100, {2151882794, 3735933136, 202182637, 2149450208}, true},
+    {20466, 250, {3225354282, 3735933136, 202182637, 1966560}, false},
+    {27361, 250, {3225354282, 3735933136, 2349666285, 1966560}, false},
+    {29432, 250, {2151612458, 3735933136, 2349666285, 1999328}, false},
+    {30474, 250, {2151612458, 3735933136, 1275924461, 1999328}, false},
+    {34688, 250, {2151882794, 3735933136, 1275924461, 2149450208}, true},
+    {46540, 250, {2151882890, 3735933136, 1275924461, 2149450208}, true},
+    {29432, 500, {2151612458, 3735933136, 3423408109, 1999328}, false},
+    {34688, 500, {2151882794, 3735933136, 3423408109, 2149450208}, true}};
+
+static list_mode::buffer make_block(const layout& lo, size_t events) {
+    static const list_mode::buffer energy_sums = {123, 456, 789, 1126128484};
+    static const list_mode::buffer qdcs = {147, 258, 369, 963, 852, 741, 159, 357};
+    static const list_mode::buffer ets = {538060824, 33864};
+    static const list_mode::buffer packed_trace = {
+        2031645, 1966108, 1966107, 2031646, 1900572, 1966109, 5636132, 27918606,
+        5243148, 1900578, 2097179, 1900572, 2097183, 2162715, 1900572};
+
+    list_mode::buffer event(lo.header);
+    event.insert(event.end(), energy_sums.begin(), energy_sums.end());
+    event.insert(event.end(), qdcs.begin(), qdcs.end());
+    if (lo.ets) {
+        event.insert(event.end(), ets.begin(), ets.end());
+    }
+    event.insert(event.end(), packed_trace.begin(), packed_trace.end());
+
+    list_mode::buffer block;
+    block.reserve(event.size() * events);
+    for (size_t e = 0; e < events; ++e) {
+        block.insert(block.end(), event.begin(), event.end());
+    }
+    return block;
+}
+
+/*
+ * Run the decoder `iterations` times and return the best rate in MB/s.
+ */
+static double measure(const list_mode::buffer& block, size_t iterations,
+                      const std::function<void()>& decode) {
+    double best = 0;
+    for (size_t i = 0; i < iterations; ++i) {
+        auto start = std::chrono::steady_clock::now();
+        decode();
+        std::chrono::duration<double> period = std::chrono::steady_clock::now() - start;
+        auto rate = double(block.size() * sizeof(uint32_t)) / period.count() / 1e6;
+        if (rate > best) {
+            best = rate;
+        }
+    }
+    return best;
+}
+
+int main(int argc, char** argv) {
+    args::ArgumentParser parser("Benchmarks the list-mode data decoders.");
+    parser.LongSeparator("=");
+    args::HelpFlag help_flag(parser, "help", "Displays this message", {'h', "help"});
+    args::ValueFlag<size_t> events_flag(parser, "events", "The number of events in a block",
+                                        {'e', "events"}, 200000);
+    args::ValueFlag<size_t> iterations_flag(parser, "iterations",
+                                            "The number of times each block is decoded",
+                                            {'i', "iterations"}, 5);
+
+    try {
+        parser.ParseCLI(argc, argv);
+    } catch (args::Help&) {
+        std::cout << parser;
+        return EXIT_SUCCESS;
+    } catch (args::Error& e) {
+        std::cerr << "error: " << e.what() << std::endl << parser;
+        return EXIT_FAILURE;
+    }
+
+    auto events = args::get(events_flag);
+    auto iterations = args::get(iterations_flag);
+
+    std::cout << "events per block: " << events << " iterations: " << iterations << std::endl
+              << std::endl;
+    std::cout << std::setw(9) << "revision" << std::setw(6) << "freq" << std::setw(16)
+              << "records interp" << std::setw(14) << "records plan" << std::setw(14)
+              << "batch interp" << std::setw(12) << "batch plan" << std::setw(10) << "speedup"
+              << std::setw(10) << "parallel" << std::endl;
+
+    try {
+        for (const auto& lo : layouts) {
+            auto block = make_block(lo, events);
+            list_mode::records recs;
+            list_mode::record_batch batch;
+            list_mode::buffer leftovers;
+
+            auto run_records = [&](list_mode::header_decoder decoder) {
+                return measure(block, iterations, [&] {
+                    list_mode::decode_data_block(block.data(), block.size(), lo.revision,
+                                                 lo.frequency, recs, leftovers, decoder);
+                });
+            };
+            auto run_batch = [&](list_mode::header_decoder decoder) {
+                return measure(block, iterations, [&] {
+                    list_mode::decode_data_block(block.data(), block.size(), lo.revision,
+                                                 lo.frequency, batch, leftovers, decoder);
+                });
+            };
+
+            auto recs_interp = run_records(list_mode::header_decoder::interpreter);
+            auto recs_plan = run_records(list_mode::header_decoder::plan);
+            auto batch_interp = run_batch(list_mode::header_decoder::interpreter);
+            auto batch_plan = run_batch(list_mode::header_decoder::plan);
+            auto parallel = measure(block, iterations, [&] {
+                list_mode::decode_data_block_parallel(block.data(), block.size(), lo.revision,
+                                                      lo.frequency, recs, leftovers);
+            });
+
+            std::cout << std::fixed << std::setprecision(1) << std::setw(9) << lo.revision
+                      << std::setw(6) << lo.frequency << std::setw(16) << recs_interp
+                      << std::setw(14) << recs_plan << std::setw(14) << batch_interp
+                      << std::setw(12) << batch_plan << std::setw(10) << std::setprecision(2)
+                      << batch_plan / batch_interp << std::setw(10) << std::setprecision(1)
+                      << parallel << std::endl;
+        }
+    } catch (list_mode::error& e) {
+        std::cerr << "error: " << e.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -21,6 +21,7 @@
  */
 #include <math.h>
 #include <stdbool.h>
+#include <stdio.h>
 #include <stdlib.h>
 
 #include <pixie16/pixie16.h>
@@ -1113,6 +1114,50 @@ void list_mode(void) {
             TEST_MSG("Pixie16EndRun | %s", tst_msg(errmsg, MSGLEN, retval, 0));
         }
 
+        TEST_CASE("Online.Spool");
+        {
+            const char spool[] = "test-list-mode.spool";
+
+            retval = PixieListModeSpoolOpen(0, NULL);
+            TEST_CHECK(retval == -802);
+            TEST_MSG("PixieListModeSpoolOpen | %s", tst_msg(errmsg, MSGLEN, retval, -802));
+
+            retval = PixieListModeSpoolOpen(100, spool);
+            TEST_CHECK(retval == -200);
+            TEST_MSG("PixieListModeSpoolOpen | %s", tst_msg(errmsg, MSGLEN, retval, -200));
+
+            retval = PixieListModeSpoolOpen(NUM_TEST_MODULES, spool);
+            TEST_CHECK(retval == 0);
+            TEST_MSG("PixieListModeSpoolOpen | %s", tst_msg(errmsg, MSGLEN, retval, 0));
+
+            retval = Pixie16StartListModeRun(NUM_TEST_MODULES, 0x100, 1);
+            TEST_CHECK(retval == 0);
+            TEST_MSG("Pixie16StartListModeRun | %s", tst_msg(errmsg, MSGLEN, retval, 0));
+
+            retval = Pixie16EndRun(NUM_TEST_MODULES);
+            TEST_CHECK(retval == 0);
+            TEST_MSG("Pixie16EndRun | %s", tst_msg(errmsg, MSGLEN, retval, 0));
+
+            retval = PixieListModeSpoolClose(NUM_TEST_MODULES);
+            TEST_CHECK(retval == 0);
+            TEST_MSG("PixieListModeSpoolClose | %s", tst_msg(errmsg, MSGLEN, retval, 0));
+
+            retval = PixieListModeSpoolClose(0);
+            TEST_CHECK(retval == 0);
+            TEST_MSG("PixieListModeSpoolClose | %s", tst_msg(errmsg, MSGLEN, retval, 0));
+
+            unsigned int magic = 0;
+            FILE* file = fopen(spool, "rb");
+            TEST_CHECK(file != NULL);
+            if (file != NULL) {
+                TEST_CHECK(fread(&magic, sizeof(magic), 1, file) == 1);
+                fclose(file);
+            }
+            TEST_CHECK(magic == 0x4c505350);
+            TEST_MSG("spool magic | 0x%08x != 0x4c505350", magic);
+            remove(spool);
+        }
+
         TEST_CASE("Online.ReadTooMuchData");
         {
             unsigned int* dummy = malloc(1 * sizeof(unsigned int));
@@ -2663,6 +2708,62 @@ void sysctl_read(void) {
 
             free(buffer);
         }
+
+        TEST_CASE("Online.Unanchored Query");
+        {
+            retval = PixieSysControlOpen("serial-num", PIXIE_SYSCTL_FORMAT_TEXT);
+            TEST_CHECK(retval == 0);
+            TEST_MSG("PixieSysControlOpen | %s", tst_msg(errmsg, MSGLEN, retval, 0));
+
+            char buf[4096] = {'\0'};
+            size_t len = 4095;
+            retval = PixieSysControlRead(buf, &len);
+            TEST_CHECK(retval == 0);
+            TEST_MSG("PixieSysControlRead | %s", tst_msg(errmsg, MSGLEN, retval, 0));
+            TEST_CHECK(strstr(buf, expected) != NULL);
+            TEST_MSG("%s not in %s", expected, buf);
+
+            retval = PixieSysControlClose();
+            TEST_CHECK(retval == 0);
+            TEST_MSG("PixieSysControlClose | %s", tst_msg(errmsg, MSGLEN, retval, 0));
+        }
+
+        TEST_CASE("Online.Path");
+        {
+            retval = PixieSysControlOpenPath(query, PIXIE_SYSCTL_FORMAT_TEXT);
+            TEST_CHECK(retval == 0);
+            TEST_MSG("PixieSysControlOpenPath | %s", tst_msg(errmsg, MSGLEN, retval, 0));
+
+            char buf[4096] = {'\0'};
+            size_t len = 4095;
+            retval = PixieSysControlRead(buf, &len);
+            TEST_CHECK(retval == 0);
+            TEST_MSG("PixieSysControlRead | %s", tst_msg(errmsg, MSGLEN, retval, 0));
+            TEST_CHECK(strcmp(buf, expected) == 0);
+            TEST_MSG("%s != %s", buf, expected);
+
+            retval = PixieSysControlClose();
+            TEST_CHECK(retval == 0);
+            TEST_MSG("PixieSysControlClose | %s", tst_msg(errmsg, MSGLEN, retval, 0));
+
+            /*
+             * A path is anchored at the start of the MIB names.
+             */
+            retval = PixieSysControlOpenPath("serial-num", PIXIE_SYSCTL_FORMAT_TEXT);
+            TEST_CHECK(retval == 0);
+            TEST_MSG("PixieSysControlOpenPath | %s", tst_msg(errmsg, MSGLEN, retval, 0));
+
+            len = 0;
+            retval = PixieSysControlSize(&len);
+            TEST_CHECK(retval == 0);
+            TEST_MSG("PixieSysControlSize | %s", tst_msg(errmsg, MSGLEN, retval, 0));
+            TEST_CHECK(len == 0);
+            TEST_MSG("%zu != 0", len);
+
+            retval = PixieSysControlClose();
+            TEST_CHECK(retval == 0);
+            TEST_MSG("PixieSysControlClose | %s", tst_msg(errmsg, MSGLEN, retval, 0));
+        }
     }
 }
 
@@ -2,7 +2,7 @@
 import argparse
 import logging
 import os
-import re
+import struct
 import sys
 import zlib
 
@@ -22,77 +22,102 @@ See the License for the specific language governing permissions and
 limitations under the License.
 """
 
-""" list-mode-crc-validation.py validates the data contained within a 
-list-mode binary data file produced with the PixieSDK examples 
-against the DMA CRC-32 checksums in the Pixie16Msg.log
+""" list-mode-crc-validation.py validates a list-mode spool written by the
+PixieSDK. Each DMA transfer in the spool is a frame with the slot, a sequence
+number and the CRC-32 of the data. The frames are checked and, if a list-mode
+binary data file is provided, the slot's spooled data is compared to the file.
 
-**NOTE**: We expect that the only data run within the log file is the one that
-we are checking against! 
+The acq_list_mode example writes a spool with its `--spool` option, e.g.
+`acq_list_mode -s 2 --spool module0.spool` writes the data file
+`module0-listmode.lmd` and the spool `module0.spool`.
 """
 
 logging.basicConfig(stream=sys.stdout, level=logging.INFO, datefmt="%Y-%m-%dT%H:%M:%S",
                     format='%(asctime)s.%(msecs)03d - %(levelname)s - %(message)s')
 
-DEBUG_PATTERN = re.compile('^\[DEBUG\]')
-DMA_PATTERN = re.compile('read-words=(\d+)')
-CRC_PATTERN = re.compile('crc=(0x[A-Fa-f0-9]+)')
-
-
-def process_log(file):
-    log_data = []
-    with open(file, mode='r', newline='') as logfile:
-        for line in logfile.readlines():
-            if re.match(DEBUG_PATTERN, line):
-                dma = re.findall(DMA_PATTERN, line)
-                crc = re.findall(CRC_PATTERN, line)
-                if dma and crc:
-                    log_data.append({
-                        'len': int(dma[0], 10),
-                        'crc': int(crc[0], 16)
-                    })
-    return log_data
+FILE_MAGIC = 0x4c505350
+FRAME_MAGIC = 0x4d524650
+VERSION = 1
+FILE_HEADER = struct.Struct('<4I')
+FRAME_HEADER = struct.Struct('<8I')
+
+
+def process_spool(file):
+    frames = []
+    with open(file, mode='rb') as spool:
+        magic, version, header_words, _ = FILE_HEADER.unpack(spool.read(FILE_HEADER.size))
+        if magic != FILE_MAGIC or version != VERSION or header_words * 4 != FRAME_HEADER.size:
+            raise ValueError(f"{file} is not a list-mode spool!")
+        while True:
+            header = spool.read(FRAME_HEADER.size)
+            if not header:
+                break
+            if len(header) != FRAME_HEADER.size:
+                raise ValueError(f"Truncated frame header! Frame={len(frames)}")
+            words = FRAME_HEADER.unpack(header)
+            if words[0] != FRAME_MAGIC or words[7] != zlib.crc32(header[:28]):
+                raise ValueError(f"Invalid frame header! Frame={len(frames)}")
+            data = spool.read(words[3] * 4)
+            if len(data) != words[3] * 4:
+                raise ValueError(f"Truncated frame! Frame={len(frames)}")
+            frames.append({
+                'slot': words[1],
+                'seq': words[2],
+                'len': words[3],
+                'crc': words[6],
+                'data': data
+            })
+    return frames
 
 
 def main(cfg):
-    logging.info(f'Parsing log file: {cfg.log}')
-    log_data = process_log(cfg.log)
-    logging.info(f'Found {len(log_data)} DMA transfers and checksums.')
-    logging.info(f'Finished parsing log file: {cfg.log}')
-
-    logging.info(f"Starting to process {cfg.file}")
-    file_size_words = os.path.getsize(cfg.file) / cfg.bpw
-    total_dma_words = sum([x['len'] for x in log_data])
-    logging.info(f"DMA Word Total: {total_dma_words}")
-    logging.info(f"File Word Total: {file_size_words}")
-
-    if file_size_words != total_dma_words:
-        raise ValueError("The DMA word total does not match the File word total!")
-
-    with open(cfg.file, "rb") as file:
-        for idx, x in enumerate(log_data):
-            log_crc = x['crc']
-            file_crc = zlib.crc32(file.read(x['len'] * cfg.bpw))
-            if log_crc != file_crc:
-                logging.info(
-                    f"Total DMA Words Processed: {sum([x['len'] for x in log_data[:idx]])}")
-                raise ValueError(
-                    f"CRC check failed! Segment={idx} Len={x['len']} DMA={log_crc} FILE={file_crc}")
+    logging.info(f'Parsing spool: {cfg.spool}')
+    frames = process_spool(cfg.spool)
+    logging.info(f'Found {len(frames)} DMA transfers and checksums.')
+
+    sequences = {}
+    gaps = 0
+    for idx, x in enumerate(frames):
+        if zlib.crc32(x['data']) != x['crc']:
+            raise ValueError(
+                f"CRC check failed! Frame={idx} Slot={x['slot']} Seq={x['seq']} Len={x['len']}")
+        expected = sequences.get(x['slot'], 0)
+        if x['seq'] != expected:
+            logging.warning(f"Sequence gap! Slot={x['slot']} Expected={expected} Seq={x['seq']}")
+            gaps += 1
+        sequences[x['slot']] = x['seq'] + 1
+    logging.info(f"Slots: {sorted(sequences.keys())}")
     logging.info("All CRC checks passed!")
+    if gaps:
+        raise ValueError(f"Found {gaps} sequence gaps, DMA transfers were dropped!")
+
+    if cfg.file:
+        logging.info(f"Starting to process {cfg.file}")
+        slot_data = b''.join([x['data'] for x in frames if x['slot'] == cfg.slot])
+        file_size_words = os.path.getsize(cfg.file) / cfg.bpw
+        logging.info(f"DMA Word Total: {len(slot_data) / 4}")
+        logging.info(f"File Word Total: {file_size_words}")
+        with open(cfg.file, "rb") as file:
+            if file.read() != slot_data:
+                raise ValueError("The spooled data does not match the File data!")
+        logging.info("The spooled data matches the File data!")
 
 
 if __name__ == '__main__':
     try:
-        parser = argparse.ArgumentParser(description='Compares DMA CRCs to Files written to disk.')
+        parser = argparse.ArgumentParser(description='Validates the DMA CRCs in a list-mode spool.')
         parser.add_argument('-b', '--bytes-per-word', type=int, dest='bpw', default=4,
                             help="The number of bytes per data word for the list-mode file.")
-        parser.add_argument('-l', '--log', type=str, dest="log",
-                            required=True, help="The CSV file containing the read lengths and CRC.")
+        parser.add_argument('-s', '--spool', type=str, dest="spool",
+                            required=True, help="The list-mode spool written by the SDK.")
         parser.add_argument('-f', '--file', dest='file',
                             help="The binary data file containing the list-mode data.")
+        parser.add_argument('--slot', type=int, dest='slot', default=2,
+                            help="The slot of the module that wrote the list-mode file.")
         cfg = parser.parse_args()
 
         main(cfg)
-        logging.info(f"Finished processing {cfg.file}.")
+        logging.info(f"Finished processing {cfg.spool}.")
     except ValueError as ve:
         logging.error(ve)
     except KeyboardInterrupt:
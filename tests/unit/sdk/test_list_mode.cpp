@@ -20,13 +20,31 @@
  * @brief Tests related to the list_mode namespace
  */
 
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <utility>
+
 #include <doctest/doctest.h>
 
 #include <pixie/data/list_mode.hpp>
+#include <pixie/data/list_mode_merge.hpp>
+#include <pixie/data/list_mode_parallel.hpp>
+#include <pixie/data/list_mode_reader.hpp>
+#include <pixie/data/list_mode_spool.hpp>
 #include <pixie/error.hpp>
 
 using namespace xia::pixie::data::list_mode;
 
+static std::string temp_path(const std::string& name) {
+    return (std::filesystem::temp_directory_path() / name).string();
+}
+
 TEST_SUITE("xia::pixie::list_mode") {
     TEST_CASE("record") {
         static const std::string json_str = "{"
@@ -46,7 +64,7 @@ TEST_SUITE("xia::pixie::list_mode") {
                                             "\"qdc\":[],"
                                             "\"slot_id\":1,"
                                             "\"time\":4771708666967.0,"
-                                            "\"trace\":[196080109],"
+                                            "\"trace\":[61933],"
                                             "\"trace_out_of_range\":false}";
 
         record evt;
@@ -58,7 +76,7 @@ TEST_SUITE("xia::pixie::list_mode") {
         evt.external_time = record::time_type(4771708667090);
         evt.time = record::time_type(4771708666967);
         evt.header_length = 6;
-        evt.trace = std::vector<uint32_t>(1, 0xBAFF1ED);
+        evt.trace = record::trace_type(1, 0xF1ED);
 
         SUBCASE("Comparison operators") {
             record eventB = evt;
@@ -192,7 +210,7 @@ TEST_SUITE("xia::pixie::list_mode") {
 
     buffer generate_data(uint32_t word0, uint32_t word1, uint32_t word2, uint32_t word3, bool ets,
                          bool esum, bool qdc, bool trc) {
-        static const record::trace_type packed_trace = {
+        static const buffer packed_trace = {
             2031645, 1966108, 1966107, 2031646, 1900572, 1966109, 5636132, 27918606,
             5243148, 1900578, 2097179, 1900572, 2097183, 2162715, 1900572};
         static const record::energy_sums_type energy_sums = {123, 456, 789, 1126128484};
@@ -489,4 +507,761 @@ TEST_SUITE("xia::pixie::list_mode") {
         decode_data_block(data, 34688, 500, recs, leftover);
         check_decoded_data(recs[0], evt);
     }
-}
\ No newline at end of file
+    TEST_CASE("Plan and interpreter decoders match") {
+        struct layout {
+            uint32_t revision;
+            uint32_t frequency;
+            buffer header;
+            bool ets;
+        };
+        const std::vector<layout> layouts = {
+            {17562, 100, {3225354282, 3735933136, 202182637, 1966560}, false},
+            {29432, 100, {2151612458, 3735933136, 202182637, 1999328}, false},
+            {30474, 100, {2151612458, 3735933136, 202182637, 1999328}, false},
+            {34688, 100, {2151882794, 3735933136, 202182637, 2149450208}, true},
+            {20466, 250, {3225354282, 3735933136, 202182637, 1966560}, false},
+            {27361, 250, {3225354282, 3735933136, 2349666285, 1966560}, false},
+            {29432, 250, {2151612458, 3735933136, 2349666285, 1999328}, false},
+            {30474, 250, {2151612458, 3735933136, 1275924461, 1999328}, false},
+            {34688, 250, {2151882794, 3735933136, 1275924461, 2149450208}, true},
+            {46540, 250, {2151882890, 3735933136, 1275924461, 2149450208}, true},
+            {29432, 500, {2151612458, 3735933136, 3423408109, 1999328}, false},
+            {34688, 500, {2151882794, 3735933136, 3423408109, 2149450208}, true}};
+        for (const auto& lo : layouts) {
+            CAPTURE(lo.revision);
+            CAPTURE(lo.frequency);
+            auto data = generate_data(lo.header[0], lo.header[1], lo.header[2], lo.header[3],
+                                      lo.ets, true, true, true);
+            records plan_recs;
+            records interp_recs;
+            buffer plan_leftover;
+            buffer interp_leftover;
+            decode_data_block(data.data(), data.size(), lo.revision, lo.frequency, plan_recs,
+                              plan_leftover, header_decoder::plan);
+            decode_data_block(data.data(), data.size(), lo.revision, lo.frequency, interp_recs,
+                              interp_leftover, header_decoder::interpreter);
+            REQUIRE(plan_recs.size() == 1);
+            REQUIRE(interp_recs.size() == 1);
+            check_decoded_data(plan_recs[0], interp_recs[0]);
+            CHECK(plan_leftover == interp_leftover);
+        }
+        SUBCASE("Errors match") {
+            /*
+             * Decode with each decoder and return the error's message.
+             */
+            auto decode_error = [](buffer data, header_decoder decoder) {
+                records recs;
+                buffer leftover;
+                try {
+                    decode_data_block(data.data(), data.size(), 17562, 100, recs, leftover,
+                                      decoder);
+                } catch (xia::pixie::error::error& e) {
+                    return std::string(e.what());
+                }
+                return std::string();
+            };
+            const std::vector<std::pair<buffer, std::string>> bad = {
+                {generate_data(3223257130, 123456789, 202182637, 1966560, false, true, true,
+                               true),
+                 "event does not match header and trace: crate=0, slot=0, chan=0, event_length=15, header_length=16, trace_length=0"},
+                {{3221766394, 123456789, 202182637, 480}, "bad slot id: 15"}};
+            for (const auto& b : bad) {
+                auto plan_error = decode_error(b.first, header_decoder::plan);
+                auto interp_error = decode_error(b.first, header_decoder::interpreter);
+                CHECK(plan_error == b.second);
+                CHECK(interp_error == b.second);
+                CHECK(plan_error == interp_error);
+            }
+        }
+    }
+    TEST_CASE("Batch decoding") {
+        record_batch batch;
+        buffer leftover;
+        SUBCASE("Matches the records decoder") {
+            auto data = generate_data(2151882794, 3735933136, 1275924461, 2149450208, true, true,
+                                      true, true);
+            auto extra = generate_data(2149990442, 3735933136, 1275924461, 2149450208, false,
+                                       false, false, true);
+            data.insert(data.end(), extra.begin(), extra.end());
+            data.insert(data.end(), extra.begin(), extra.begin() + 4);
+
+            records recs;
+            buffer rec_leftover;
+            decode_data_block(data, 34688, 250, recs, rec_leftover);
+            decode_data_block(data.data(), data.size(), 34688, 250, batch, leftover);
+
+            REQUIRE(batch.size() == recs.size());
+            CHECK(leftover == rec_leftover);
+            for (size_t i = 0; i < batch.size(); ++i) {
+                record rec;
+                batch.get(i, rec);
+                check_decoded_data(rec, recs[i]);
+                CHECK(batch.trace_size(i) == recs[i].trace.size());
+            }
+            CHECK(batch.energy_sums_offset[1] == record_batch::no_offset);
+            CHECK(batch.qdc_offset[1] == record_batch::no_offset);
+            CHECK(batch.traces.size() == 60);
+            CHECK(batch.sums.size() == 11);
+        }
+        SUBCASE("Reuse keeps the capacity") {
+            auto data = generate_data(2151882794, 3735933136, 1275924461, 2149450208, true, true,
+                                      true, true);
+            decode_data_block(data.data(), data.size(), 34688, 250, batch, leftover);
+            auto* traces = batch.traces.data();
+            auto* slots = batch.slot_id.data();
+            decode_data_block(data.data(), data.size(), 34688, 250, batch, leftover);
+            CHECK(batch.size() == 1);
+            CHECK(batch.traces.data() == traces);
+            CHECK(batch.slot_id.data() == slots);
+        }
+        SUBCASE("Missing trace") {
+            buffer data = {2149990442, 3735933136, 1275924461, 2149450208};
+            decode_data_block(data.data(), data.size(), 34688, 250, batch, leftover);
+            CHECK(batch.empty());
+            CHECK(leftover == data);
+        }
+        SUBCASE("Uniform runs match the records decoder") {
+            auto full = generate_data(2151882794, 3735933136, 1275924461, 2149450208, true, true,
+                                      true, true);
+            auto forced = generate_data(2149990442, 3735933136, 3221229549, 2149450208, false,
+                                        false, false, true);
+            buffer data;
+            for (size_t e = 0; e < 40; ++e) {
+                const auto& evt = e < 20 || e % 3 == 0 ? full : forced;
+                data.insert(data.end(), evt.begin(), evt.end());
+            }
+            for (size_t e = 0; e < 10; ++e) {
+                data.insert(data.end(), forced.begin(), forced.end());
+            }
+            data.insert(data.end(), full.begin(), full.begin() + 7);
+
+            records recs;
+            buffer rec_leftover;
+            decode_data_block(data, 34688, 250, recs, rec_leftover);
+            decode_data_block(data.data(), data.size(), 34688, 250, batch, leftover);
+            REQUIRE(batch.size() == recs.size());
+            CHECK(leftover == rec_leftover);
+            for (size_t i = 0; i < batch.size(); ++i) {
+                record rec;
+                batch.get(i, rec);
+                check_decoded_data(rec, recs[i]);
+            }
+
+            data[full.size() * 12] = (data[full.size() * 12] & ~0xf0u) | 0xf0u;
+            CHECK_THROWS_WITH_AS(decode_data_block(data, 34688, 250, recs, rec_leftover),
+                                 "bad slot id: 15", xia::pixie::error::error);
+            CHECK_THROWS_WITH_AS(
+                decode_data_block(data.data(), data.size(), 34688, 250, batch, leftover),
+                "bad slot id: 15", xia::pixie::error::error);
+            CHECK(batch.size() == 12);
+            CHECK(recs.size() == 12);
+            CHECK(leftover == rec_leftover);
+        }
+        SUBCASE("Invalid slot") {
+            buffer data = {3221766394, 123456789, 202182637, 480};
+            CHECK_THROWS_WITH_AS(
+                decode_data_block(data.data(), data.size(), 17562, 100, batch, leftover),
+                "bad slot id: 15", xia::pixie::error::error);
+            CHECK(leftover == data);
+        }
+    }
+    TEST_CASE("Parallel decoding") {
+        /*
+         * Mix events of different lengths so the ranges do not split on
+         * event boundaries.
+         */
+        auto full = generate_data(2151882794, 3735933136, 1275924461, 2149450208, true, true, true,
+                                  true);
+        auto forced = generate_data(2149990442, 3735933136, 3221229549, 2149450208, false, false,
+                                    false, true);
+        auto header = generate_data(2148024362, 3735933136, 1275924461, 2147484128, false, false,
+                                    false, false);
+        buffer data;
+        for (size_t e = 0; e < 1500; ++e) {
+            const auto& evt = e % 3 == 0 ? full : (e % 3 == 1 ? forced : header);
+            data.insert(data.end(), evt.begin(), evt.end());
+        }
+        data.insert(data.end(), full.begin(), full.begin() + 10);
+        REQUIRE(data.size() > 4 * min_parallel_range_words);
+
+        records serial_recs;
+        buffer serial_leftover;
+        decode_data_block(data, 34688, 250, serial_recs, serial_leftover);
+
+        auto check_records = [](const records& result, const records& expected) {
+            REQUIRE(result.size() == expected.size());
+            for (size_t r = 0; r < result.size(); ++r) {
+                check_decoded_data(result[r], expected[r]);
+            }
+        };
+
+        SUBCASE("Matches the serial decoder") {
+            for (size_t threads : {1, 2, 3, 4, 7}) {
+                CAPTURE(threads);
+                records recs;
+                buffer leftover;
+                decode_data_block_parallel(data.data(), data.size(), 34688, 250, recs, leftover,
+                                           threads);
+                check_records(recs, serial_recs);
+                CHECK(leftover == serial_leftover);
+            }
+        }
+        SUBCASE("Finds a record start") {
+            CHECK(find_record_start(data.data(), data.size(), 34688, 250) == 0);
+            CHECK(find_record_start(&data[1], data.size() - 1, 34688, 250) ==
+                  full.size() - 1);
+            CHECK(find_record_start(&data[full.size() + 2], data.size() - full.size() - 2, 34688,
+                                    250) == forced.size() - 2);
+            CHECK(find_record_start(&data[data.size() - 8], 8, 34688, 250) == 8);
+        }
+        SUBCASE("Errors match the serial decoder") {
+            auto& word = data[(full.size() + forced.size() + header.size()) * 333];
+            word = (word & ~0xf0u) | 0xf0u;
+            records recs;
+            records par_recs;
+            buffer leftover;
+            buffer par_leftover;
+            CHECK_THROWS_WITH_AS(decode_data_block(data, 34688, 250, recs, leftover),
+                                 "bad slot id: 15", xia::pixie::error::error);
+            CHECK_THROWS_WITH_AS(decode_data_block_parallel(data.data(), data.size(), 34688, 250,
+                                                            par_recs, par_leftover, 4),
+                                 "bad slot id: 15", xia::pixie::error::error);
+            CHECK(recs.size() == 999);
+            check_records(par_recs, recs);
+            CHECK(par_leftover == leftover);
+        }
+        SUBCASE("Decodes a file") {
+            const std::string path = temp_path("test_list_mode_parallel.bin");
+            {
+                std::ofstream output(path, std::ios::out | std::ios::binary);
+                output.write(reinterpret_cast<const char*>(data.data()),
+                             std::streamsize(data.size() * sizeof(uint32_t)));
+            }
+            records recs;
+            buffer leftover;
+            size_t chunks = 0;
+            decode_file(
+                path, 34688, 250,
+                [&recs, &chunks](records& chunk) {
+                    recs.insert(recs.end(), chunk.begin(), chunk.end());
+                    ++chunks;
+                },
+                leftover, 4, 9999);
+            std::remove(path.c_str());
+            CHECK(chunks == (data.size() + 9998) / 9999);
+            check_records(recs, serial_recs);
+            CHECK(leftover == serial_leftover);
+            CHECK_THROWS_AS(decode_file("no-such-file.bin", 34688, 250, [](records&) {}, leftover),
+                            xia::pixie::error::error);
+        }
+    }
+    TEST_CASE("Record views") {
+        auto data = generate_data(2151882794, 3735933136, 1275924461, 2149450208, true, true, true,
+                                  true);
+        auto forced = generate_data(2149990442, 3735933136, 3221229549, 2149450208, false, false,
+                                    false, true);
+        records recs;
+        buffer leftover;
+        record_view view;
+        CHECK_FALSE(view.valid());
+
+        SUBCASE("Match the decoded records") {
+            data.insert(data.end(), forced.begin(), forced.end());
+            decode_data_block(data, 34688, 250, recs, leftover);
+            REQUIRE(recs.size() == 2);
+            size_t offset = 0;
+            for (const auto& rec : recs) {
+                REQUIRE(view_record(&data[offset], data.size() - offset, 34688, 250, view));
+                CHECK(view.data() == &data[offset]);
+                CHECK(view.crate_id() == rec.crate_id);
+                CHECK(view.slot_id() == rec.slot_id);
+                CHECK(view.channel_number() == rec.channel_number);
+                CHECK(view.header_length() == rec.header_length);
+                CHECK(view.event_length() == rec.event_length);
+                CHECK(view.trace_length() == rec.trace_length);
+                CHECK(view.cfd_trigger_source() == rec.cfd_trigger_source);
+                CHECK(view.cfd_forced_trigger() == rec.cfd_forced_trigger);
+                CHECK(view.finish_code() == rec.finish_code);
+                CHECK(view.trace_out_of_range() == rec.trace_out_of_range);
+                CHECK(view.energy() == rec.energy);
+                CHECK(view.time() == rec.time.count());
+                CHECK(view.filter_time() == rec.filter_time.count());
+                CHECK(view.cfd_fractional_time() == rec.cfd_fractional_time.count());
+                CHECK(view.external_time() == rec.external_time.count());
+                CHECK(view.filter_baseline() == rec.filter_baseline);
+                auto trace = view.trace();
+                CHECK(trace.size() == rec.trace.size());
+                CHECK(size_t(trace.end() - trace.begin()) == trace.size());
+                CHECK(record::trace_type(trace.begin(), trace.end()) == rec.trace);
+                for (size_t s = 0; s < trace.size(); ++s) {
+                    CHECK(trace[s] == rec.trace[s]);
+                }
+                record copy;
+                view.get(copy);
+                check_decoded_data(copy, rec);
+                offset += view.event_length();
+            }
+            CHECK(view.energy_sums() == nullptr);
+            CHECK(view.qdc() == nullptr);
+            REQUIRE(view_record(data.data(), data.size(), 34688, 250, view));
+            REQUIRE(view.energy_sums() != nullptr);
+            CHECK(record::energy_sums_type(view.energy_sums(), view.energy_sums() + 3) ==
+                  recs[0].energy_sums);
+            REQUIRE(view.qdc() != nullptr);
+            CHECK(record::qdc_type(view.qdc(), view.qdc() + 8) == recs[0].qdc);
+        }
+        SUBCASE("Incomplete event") {
+            CHECK_FALSE(view_record(data.data(), 3, 34688, 250, view));
+            CHECK_FALSE(view_record(data.data(), data.size() - 1, 34688, 250, view));
+            CHECK_FALSE(view.valid());
+        }
+        SUBCASE("Invalid header") {
+            buffer bad = {3221766394, 123456789, 202182637, 480};
+            CHECK_THROWS_WITH_AS(view_record(bad.data(), bad.size(), 17562, 100, view),
+                                 "bad slot id: 15", xia::pixie::error::error);
+            CHECK_THROWS_AS(view_record(nullptr, 4, 17562, 100, view), xia::pixie::error::error);
+        }
+    }
+    TEST_CASE("Mapped reader") {
+        auto full = generate_data(2151882794, 3735933136, 1275924461, 2149450208, true, true, true,
+                                  true);
+        auto forced = generate_data(2149990442, 3735933136, 3221229549, 2149450208, false, false,
+                                    false, true);
+        buffer data;
+        for (size_t e = 0; e < 10; ++e) {
+            const auto& evt = e % 2 == 0 ? full : forced;
+            data.insert(data.end(), evt.begin(), evt.end());
+        }
+        data.insert(data.end(), full.begin(), full.begin() + 5);
+        records recs;
+        buffer leftover;
+        decode_data_block(data, 34688, 250, recs, leftover);
+
+        const std::string path = temp_path("test_list_mode_reader.bin");
+        {
+            std::ofstream output(path, std::ios::out | std::ios::binary);
+            output.write(reinterpret_cast<const char*>(data.data()),
+                         std::streamsize(data.size() * sizeof(uint32_t)));
+        }
+
+        mapped_reader reader;
+        CHECK_FALSE(reader.is_open());
+        CHECK_THROWS_AS(reader.open("no-such-file.bin", 34688, 250), xia::pixie::error::error);
+
+        reader.open(path, 34688, 250);
+        CHECK(reader.is_open());
+        CHECK(reader.size() == data.size());
+
+        record_view view;
+        for (int pass = 0; pass < 2; ++pass) {
+            size_t count = 0;
+            while (reader.next(view)) {
+                REQUIRE(count < recs.size());
+                record rec;
+                view.get(rec);
+                check_decoded_data(rec, recs[count]);
+                ++count;
+            }
+            CHECK(count == recs.size());
+            CHECK(reader.remaining() == leftover.size());
+            reader.rewind();
+        }
+
+        reader.close();
+        CHECK_FALSE(reader.is_open());
+        CHECK(reader.data() == nullptr);
+        std::remove(path.c_str());
+    }
+    TEST_CASE("Spool") {
+        const std::string path = temp_path("test_list_mode_spool.bin");
+        buffer slot_2(100);
+        buffer slot_5(37);
+        for (size_t w = 0; w < slot_2.size(); ++w) {
+            slot_2[w] = uint32_t(w * 3);
+        }
+        for (size_t w = 0; w < slot_5.size(); ++w) {
+            slot_5[w] = uint32_t(~w);
+        }
+
+        spool_writer writer;
+        CHECK_FALSE(writer.is_open());
+        CHECK_THROWS_AS(writer.write(2, slot_2.data(), slot_2.size()), xia::pixie::error::error);
+        writer.open(path);
+        CHECK(writer.is_open());
+        writer.write(2, slot_2.data(), slot_2.size());
+        writer.write(5, slot_5.data(), slot_5.size());
+        writer.skip(2);
+        writer.write(2, slot_2.data(), slot_2.size());
+        writer.write(5, slot_5.data(), 0);
+        CHECK(writer.frames() == 4);
+        CHECK(writer.words() == 2 * slot_2.size() + slot_5.size());
+        CHECK(writer.skipped() == 1);
+        writer.close();
+        CHECK_FALSE(writer.is_open());
+
+        SUBCASE("Reader") {
+            spool_reader reader;
+            CHECK_THROWS_AS(reader.open("no-such-file.bin"), xia::pixie::error::error);
+            reader.open(path);
+            CHECK(reader.is_open());
+            struct expected {
+                uint32_t slot, sequence;
+                const buffer& data;
+                size_t words;
+            };
+            const std::vector<expected> frames = {{2, 0, slot_2, slot_2.size()},
+                                                  {5, 0, slot_5, slot_5.size()},
+                                                  {2, 2, slot_2, slot_2.size()},
+                                                  {5, 1, slot_5, 0}};
+            spool_frame frame;
+            for (int pass = 0; pass < 2; ++pass) {
+                size_t count = 0;
+                while (reader.next(frame)) {
+                    REQUIRE(count < frames.size());
+                    const auto& exp = frames[count];
+                    CHECK(frame.slot == exp.slot);
+                    CHECK(frame.sequence == exp.sequence);
+                    CHECK(frame.words == exp.words);
+                    CHECK(frame.timestamp != 0);
+                    CHECK(frame.valid());
+                    CHECK(std::equal(frame.data, frame.data + frame.words, exp.data.begin()));
+                    ++count;
+                }
+                CHECK(count == frames.size());
+                CHECK(reader.remaining() == 0);
+                reader.rewind();
+            }
+            reader.close();
+            CHECK_FALSE(reader.is_open());
+        }
+
+        SUBCASE("Verify") {
+            auto result = verify_spool(path);
+            CHECK(result.frames == 4);
+            CHECK(result.words == 2 * slot_2.size() + slot_5.size());
+            CHECK(result.slots == 2);
+            CHECK(result.crc_errors == 0);
+            CHECK(result.header_errors == 0);
+            CHECK(result.sequence_gaps == 1);
+            CHECK_FALSE(result.truncated);
+            CHECK_FALSE(result.ok());
+        }
+
+        SUBCASE("Queue limit") {
+            /*
+             * A write larger than the queue is skipped and seen as a gap.
+             */
+            spool_writer limited(path, slot_5.size());
+            limited.write(5, slot_2.data(), slot_2.size());
+            limited.write(5, slot_5.data(), slot_5.size());
+            CHECK(limited.frames() == 1);
+            CHECK(limited.skipped() == 1);
+            CHECK_NOTHROW(limited.flush());
+            limited.close();
+            auto result = verify_spool(path);
+            CHECK(result.frames == 1);
+            CHECK(result.words == slot_5.size());
+            CHECK(result.sequence_gaps == 1);
+        }
+
+        SUBCASE("Corrupt data") {
+            {
+                std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+                const uint32_t bad = 0xdeadbeef;
+                file.seekp(std::streamoff(
+                    (spool_file_header_words + spool_frame_header_words + 10) * sizeof(uint32_t)));
+                file.write(reinterpret_cast<const char*>(&bad), sizeof(bad));
+            }
+            auto result = verify_spool(path);
+            CHECK(result.frames == 4);
+            CHECK(result.crc_errors == 1);
+            CHECK(result.header_errors == 0);
+        }
+
+        SUBCASE("Corrupt header") {
+            {
+                std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+                const uint32_t bad = 99;
+                file.seekp(std::streamoff((spool_file_header_words + 1) * sizeof(uint32_t)));
+                file.write(reinterpret_cast<const char*>(&bad), sizeof(bad));
+            }
+            spool_reader reader(path);
+            spool_frame frame;
+            CHECK_THROWS_AS(reader.next(frame), xia::pixie::error::error);
+            auto result = verify_spool(path);
+            CHECK(result.frames == 3);
+            CHECK(result.header_errors == 1);
+            CHECK(result.crc_errors == 0);
+            CHECK_FALSE(result.truncated);
+        }
+
+        SUBCASE("Truncated") {
+            std::vector<char> bytes;
+            {
+                std::ifstream input(path, std::ios::in | std::ios::binary);
+                bytes.assign(std::istreambuf_iterator<char>(input),
+                             std::istreambuf_iterator<char>());
+            }
+            {
+                std::ofstream output(path, std::ios::out | std::ios::binary | std::ios::trunc);
+                output.write(bytes.data(),
+                             std::streamsize(bytes.size() - (12 * sizeof(uint32_t))));
+            }
+            auto result = verify_spool(path);
+            CHECK(result.frames == 2);
+            CHECK(result.truncated);
+            CHECK_FALSE(result.ok());
+        }
+
+        std::remove(path.c_str());
+    }
+    TEST_CASE("Encoding") {
+        struct encoded {
+            uint32_t words[4];
+            bool ets, esum, qdc, trc;
+            uint32_t revision, frequency;
+        };
+        static const std::vector<encoded> events = {
+            {{2151612458, 3735933136, 202182637, 1999328}, false, true, true, true, 29432, 100},
+            {{2151612458, 3735933136, 202182637, 1999328}, false, true, true, true, 30474, 100},
+            {{2151882794, 3735933136, 202182637, 2149450208}, true, true, true, true, 34688, 100},
+            {{3225354282, 3735933136, 202182637, 1966560}, false, true, true, true, 20466, 250},
+            {{3225354282, 3735933136, 2349666285, 1966560}, false, true, true, true, 27361, 250},
+            {{2151612458, 3735933136, 2349666285, 1999328}, false, true, true, true, 29432, 250},
+            {{2151612458, 3735933136, 1275924461, 1999328}, false, true, true, true, 30474, 250},
+            {{2148024362, 3735933136, 1275924461, 2147484128}, false, false, false, false, 34688,
+             250},
+            {{2149990442, 3735933136, 3221229549, 2149450208}, false, false, false, true, 34688,
+             250},
+            {{2151882890, 3735933136, 1275924461, 2149450208}, true, true, true, true, 46540, 250},
+            {{2151612458, 3735933136, 3423408109, 1999328}, false, true, true, true, 29432, 500},
+            {{2151882794, 3735933136, 3423408109, 2149450208}, true, true, true, true, 34688, 500},
+        };
+        records recs;
+        buffer leftover;
+        SUBCASE("Decodes to the same record") {
+            for (auto& evt : events) {
+                auto data = generate_data(evt.words[0], evt.words[1], evt.words[2], evt.words[3],
+                                          evt.ets, evt.esum, evt.qdc, evt.trc);
+                decode_data_block(data, evt.revision, evt.frequency, recs, leftover);
+                REQUIRE(recs.size() == 1);
+                auto rec = recs[0];
+                buffer encoded;
+                encode_record(rec, evt.revision, evt.frequency, encoded);
+                CHECK(encoded.size() == data.size());
+                decode_data_block(encoded, evt.revision, evt.frequency, recs, leftover);
+                REQUIRE(recs.size() == 1);
+                check_decoded_data(recs[0], rec);
+            }
+        }
+        SUBCASE("Appends") {
+            auto data = generate_data(2148024362, 3735933136, 1275924461, 2147484128, false,
+                                      false, false, false);
+            decode_data_block(data, 34688, 250, recs, leftover);
+            buffer encoded;
+            encode_record(recs[0], 34688, 250, encoded);
+            encode_record(recs[0], 34688, 250, encoded);
+            CHECK(encoded.size() == 2 * data.size());
+            decode_data_block(encoded, 34688, 250, recs, leftover);
+            CHECK(recs.size() == 2);
+        }
+        SUBCASE("Invalid records") {
+            record rec;
+            rec.slot_id = 2;
+            rec.header_length = 4;
+            buffer encoded;
+            CHECK_THROWS_AS(encode_record(rec, 100, 250, encoded), xia::pixie::error::error);
+            rec.header_length = 5;
+            CHECK_THROWS_AS(encode_record(rec, 34688, 250, encoded), xia::pixie::error::error);
+            rec.header_length = 4;
+            rec.slot_id = 1;
+            CHECK_THROWS_WITH_AS(encode_record(rec, 34688, 250, encoded), "bad slot id: 1",
+                                 xia::pixie::error::error);
+            rec.slot_id = 2;
+            rec.trace.resize(3);
+            CHECK_THROWS_AS(encode_record(rec, 34688, 250, encoded), xia::pixie::error::error);
+            rec.trace.clear();
+            rec.header_length = 8;
+            CHECK_THROWS_AS(encode_record(rec, 34688, 250, encoded), xia::pixie::error::error);
+            CHECK(encoded.empty());
+        }
+    }
+    TEST_CASE("Stream merging") {
+        auto event = [](uint32_t ticks) {
+            return generate_data(2148024362, ticks, 1275924461, 2147484128, false, false, false,
+                                 false);
+        };
+        records recs;
+        buffer leftover;
+        auto zero = event(0);
+        decode_data_block(zero, 34688, 250, recs, leftover);
+        auto t0 = recs[0].time;
+        auto one = event(1);
+        decode_data_block(one, 34688, 250, recs, leftover);
+        auto tick = recs[0].time - t0;
+
+        /*
+         * Each stream's events are out of order within 30 ticks.
+         */
+        static const size_t num_streams = 3;
+        static const size_t num_events = 200;
+        std::vector<buffer> streams(num_streams);
+        for (size_t s = 0; s < num_streams; ++s) {
+            for (size_t e = 0; e < num_events; ++e) {
+                auto ticks = uint32_t(1000 + (e ^ 1) * 30 + s * 10);
+                auto evt = event(ticks);
+                streams[s].insert(streams[s].end(), evt.begin(), evt.end());
+            }
+        }
+        auto sorted = [](const records& out) {
+            return std::is_sorted(out.begin(), out.end(),
+                                  [](const record& a, const record& b) { return a < b; });
+        };
+
+        SUBCASE("Time ordered") {
+            merger merge(100 * tick);
+            for (size_t s = 0; s < num_streams; ++s) {
+                CHECK(merge.add_stream(34688, 250) == s);
+            }
+            records out;
+            merge.push(0, streams[0].data(), 40);
+            CHECK(merge.pull(out) == 0);
+            static const size_t chunk = 7;
+            std::vector<size_t> pos = {40, 0, 0};
+            while (pos[1] < streams[1].size()) {
+                for (size_t s = 0; s < num_streams; ++s) {
+                    auto len = std::min(chunk, streams[s].size() - pos[s]);
+                    merge.push(s, streams[s].data() + pos[s], len);
+                    pos[s] += len;
+                }
+                merge.pull(out);
+                CHECK(merge.size() < 30);
+            }
+            CHECK(!out.empty());
+            for (size_t s = 0; s < num_streams; ++s) {
+                CHECK(merge.leftovers(s).empty());
+            }
+            for (size_t s = 0; s < num_streams; ++s) {
+                merge.finish(s);
+            }
+            merge.pull(out);
+            CHECK(merge.size() == 0);
+            CHECK(out.size() == num_streams * num_events);
+            CHECK(sorted(out));
+            CHECK(merge.late() == 0);
+            CHECK(merge.forced() == 0);
+            CHECK_THROWS_AS(merge.push(0, streams[0].data(), 4), xia::pixie::error::error);
+            CHECK_THROWS_AS(merge.push(num_streams, streams[0].data(), 4),
+                            xia::pixie::error::error);
+        }
+        SUBCASE("Bounded") {
+            merger merge(100 * tick, 50);
+            for (size_t s = 0; s < num_streams; ++s) {
+                merge.add_stream(34688, 250);
+            }
+            records out;
+            merge.push(0, streams[0].data(), streams[0].size());
+            merge.pull(out);
+            CHECK(merge.size() == 50);
+            CHECK(merge.forced() == num_events - 50);
+            merge.push(1, streams[1].data(), streams[1].size());
+            merge.push(2, streams[2].data(), streams[2].size());
+            merge.flush(out);
+            CHECK(out.size() == num_streams * num_events);
+            CHECK(merge.late() > 0);
+        }
+        SUBCASE("Late events") {
+            merger merge(record::time_type(0));
+            merge.add_stream(34688, 250);
+            merge.add_stream(34688, 250);
+            records out;
+            for (auto ticks : {100, 200}) {
+                auto evt = event(ticks);
+                merge.push(0, evt.data(), evt.size());
+            }
+            auto later = event(300);
+            merge.push(1, later.data(), later.size());
+            CHECK(merge.pull(out) == 2);
+            auto late = event(150);
+            merge.push(1, late.data(), late.size());
+            CHECK(merge.late() == 1);
+            CHECK(merge.flush(out) == 2);
+            CHECK_FALSE(sorted(out));
+        }
+        SUBCASE("Idle streams") {
+            merger merge(record::time_type(0), merger::default_max_events, 20);
+            merge.add_stream(34688, 250);
+            merge.add_stream(34688, 250);
+            records out;
+            for (auto ticks : {100, 200}) {
+                auto evt = event(ticks);
+                merge.push(0, evt.data(), evt.size());
+            }
+            CHECK(merge.pull(out) == 0);
+            std::this_thread::sleep_for(std::chrono::milliseconds(40));
+            auto evt = event(300);
+            merge.push(0, evt.data(), evt.size());
+            CHECK(merge.pull(out) == 3);
+            CHECK(merge.size() == 0);
+            CHECK(sorted(out));
+        }
+        SUBCASE("Watermark") {
+            merger merge(record::time_type(0), merger::default_max_events, 0);
+            merge.add_stream(34688, 250);
+            merge.add_stream(34688, 250);
+            records out;
+            for (auto ticks : {100, 200}) {
+                auto evt = event(ticks);
+                merge.push(0, evt.data(), evt.size());
+            }
+            CHECK(merge.pull(out) == 0);
+            merge.watermark(1, t0 + 150 * tick);
+            CHECK(merge.pull(out) == 1);
+            merge.watermark(1, t0 + 250 * tick);
+            CHECK(merge.pull(out) == 1);
+            CHECK(merge.size() == 0);
+            CHECK(merge.late() == 0);
+            merge.finish(1);
+            CHECK_THROWS_AS(merge.watermark(1, t0), xia::pixie::error::error);
+        }
+        SUBCASE("Bad data") {
+            merger merge(record::time_type(0));
+            merge.add_stream(34688, 250);
+            buffer bad;
+            for (auto ticks : {100, 200, 300}) {
+                auto evt = event(ticks);
+                bad.insert(bad.end(), evt.begin(), evt.end());
+            }
+            bad[2 * zero.size()] = 0;
+            CHECK_THROWS_AS(merge.push(0, bad.data(), bad.size()), xia::pixie::error::error);
+            CHECK(merge.leftovers(0).empty());
+            CHECK(merge.size() == 2);
+            auto good = event(400);
+            merge.push(0, good.data(), good.size() - 1);
+            merge.push(0, good.data() + good.size() - 1, 1);
+            CHECK(merge.leftovers(0).empty());
+            records out;
+            merge.finish(0);
+            CHECK(merge.flush(out) == 3);
+            CHECK(sorted(out));
+        }
+        SUBCASE("Coincidence groups") {
+            records ordered;
+            for (auto ticks : {0, 5, 8, 20, 21, 50}) {
+                auto evt = event(uint32_t(ticks));
+                decode_data_block(evt, 34688, 250, recs, leftover);
+                ordered.push_back(recs[0]);
+            }
+            coincidence_grouper grouper(10 * tick);
+            coincidence_grouper::groups groups;
+            CHECK(grouper.push(ordered, groups) == 2);
+            CHECK(ordered.empty());
+            CHECK(grouper.flush(groups) == 1);
+            CHECK(grouper.flush(groups) == 0);
+            REQUIRE(groups.size() == 3);
+            CHECK(groups[0].size() == 3);
+            CHECK(groups[1].size() == 2);
+            CHECK(groups[2].size() == 1);
+        }
+    }
+}
@@ -20,17 +20,30 @@
  * @brief
  */
 
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <thread>
+
 #include <doctest/doctest.h>
 
 #include <pixie/error.hpp>
 #include <pixie/log.hpp>
 
 #include <pixie/config.hpp>
+#include <pixie/data/list_mode_spool.hpp>
 #include <pixie/format.hpp>
+#include <pixie/mib.hpp>
 #include <pixie/pixie16/crate-view.hpp>
 #include <pixie/pixie16/defs.hpp>
+#include <pixie/pixie16/event_stream.hpp>
+#include <pixie/pixie16/histogram_monitor.hpp>
+#include <pixie/pixie16/memory.hpp>
 #include <pixie/pixie16/module.hpp>
 #include <pixie/pixie16/sim.hpp>
+#include <pixie/pixie16/snapshot.hpp>
 
 using crate_error = xia::pixie::crate::error;
 
@@ -328,6 +341,23 @@ static void test_setup() {
     }
 }
 
+/*
+ * The sim does not load the DSP's variable addresses. Lay the variables out
+ * so each word has its own address in the sim's DSP memory model.
+ */
+static void sim_var_addresses(xia::pixie::module::module& mod) {
+    using xia::pixie::hw::address;
+    address addr = 0x4a000;
+    for (auto& desc : mod.module_var_descriptors) {
+        desc.address = addr;
+        addr += address(desc.size);
+    }
+    for (auto& desc : mod.channel_var_descriptors) {
+        desc.address = addr;
+        addr += address(desc.size * xia::pixie::hw::max_channels);
+    }
+}
+
 TEST_SUITE("Crate: modules") {
     TEST_CASE("SETUP") {
         test_setup();
@@ -369,6 +399,20 @@ TEST_SUITE("Crate: modules") {
         CHECK(crate->num_online == test_modules);
         CHECK(crate->num_offline == 0);
         CHECK_NOTHROW(crate->check_active_run());
+        auto report = crate->get_boot_report();
+        CHECK(report.slots.size() == test_modules);
+        CHECK(report.total >= report.modules + report.backplane);
+        for (auto& sr : report.slots) {
+            CHECK(sr.online == true);
+            CHECK(sr.profile.total.load() > 0);
+            CHECK(sr.profile.total.load() >= sr.profile.dsp.load() + sr.profile.afe.load());
+            CHECK(sr.profile.total.load() <= report.modules);
+        }
+        CHECK(xia::mib::find("crate.boot.total").get<xia::mib::real>() == report.total);
+        auto slot_boot_total =
+            "module." + std::to_string(crate[0].slot) + ".boot.total";
+        CHECK(xia::mib::find(slot_boot_total).get<xia::mib::real>() ==
+              crate[0].boot_stats.total.load());
         firmware::release_type release;
         firmware::firmware_set::set_type type;
         crate[0].firmware_release(release, type);
@@ -435,6 +479,7 @@ TEST_SUITE("Crate: modules") {
             CHECK(crate[0].fifo_dma_trigger_level ==
                   module::module::default_fifo_dma_trigger_level);
             CHECK(crate[0].fifo_bandwidth == 0);
+            CHECK(crate[0].fifo_dma_pipeline == false);
         }
         SUBCASE("FIFO bandwidth") {
             CHECK_NOTHROW(crate[0].set_fifo_buffers(50));
@@ -499,6 +544,373 @@ TEST_SUITE("Crate: modules") {
                                  "module: num=0,slot=2: fifo: bandwidth value out of range",
                                  crate_error);
         }
+        SUBCASE("FIFO DMA pipeline") {
+            CHECK_NOTHROW(crate[0].set_fifo_dma_pipeline(true));
+            CHECK(crate[0].fifo_dma_pipeline == true);
+            hw::memory::fifo fifo(crate[0]);
+            hw::words sync_data(256);
+            hw::words async_data(256);
+            CHECK_NOTHROW(fifo.read(sync_data));
+            CHECK_NOTHROW(fifo.read_start(async_data.data(), async_data.size()));
+            CHECK(fifo.read_pending());
+            CHECK_THROWS_WITH_AS(fifo.read_start(async_data.data(), async_data.size()),
+                                 "module: num=0,slot=2: FIFO read already in flight",
+                                 crate_error);
+            CHECK_NOTHROW(fifo.read_wait());
+            CHECK(!fifo.read_pending());
+            CHECK(async_data == sync_data);
+            /*
+             * The bus is released by the wait.
+             */
+            CHECK_NOTHROW(fifo.level());
+            CHECK_NOTHROW(crate[0].set_fifo_dma_pipeline(false));
+        }
+        SUBCASE("Sim list-mode generator") {
+            auto& sim_module = dynamic_cast<sim::module&>(crate[0]);
+            sim::list_mode_generator::config cfg;
+            cfg.trace_length = 7;
+            CHECK_THROWS_AS(sim_module.list_mode_attach(cfg), crate_error);
+            cfg.trace_length = 8;
+            cfg.paced = false;
+            CHECK_NOTHROW(sim_module.list_mode_attach(cfg));
+            CHECK(sim_module.list_mode_revision == cfg.revision);
+            hw::words words;
+            CHECK_NOTHROW(crate[0].start_test(module::module::test::lm_fifo));
+            for (int tries = 0; tries < 1000 && words.size() < 1024; ++tries) {
+                hw::words data(crate[0].read_list_mode_level());
+                if (!data.empty()) {
+                    crate[0].read_list_mode(data);
+                    words.insert(words.end(), data.begin(), data.end());
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            hw::words available(16);
+            size_t read = 0;
+            CHECK_NOTHROW(
+                read = crate[0].read_list_mode_available(available.data(), available.size()));
+            CHECK(read <= available.size());
+            CHECK_NOTHROW(crate[0].end_test());
+            REQUIRE(words.size() >= 1024);
+            data::list_mode::records recs;
+            data::list_mode::buffer leftovers;
+            data::list_mode::buffer block(words.begin(), words.end());
+            CHECK_NOTHROW(data::list_mode::decode_data_block(block, cfg.revision,
+                                                             sim_module.eeprom.configs[0].adc_msps,
+                                                             recs, leftovers));
+            REQUIRE(!recs.empty());
+            CHECK(std::is_sorted(recs.begin(), recs.end()));
+            for (auto& rec : recs) {
+                CHECK(rec.slot_id == sim_module.slot);
+                CHECK(rec.trace.size() == cfg.trace_length);
+            }
+            CHECK(sim_module.list_mode->events() >= recs.size());
+            CHECK_NOTHROW(sim_module.list_mode_detach());
+            CHECK(sim_module.list_mode.get() == nullptr);
+        }
+        SUBCASE("Sim event stream") {
+            auto& sim_module = dynamic_cast<sim::module&>(crate[0]);
+            sim::list_mode_generator::config cfg;
+            cfg.revision = 42081;
+            cfg.trace_length = 8;
+            cfg.paced = false;
+            CHECK_NOTHROW(sim_module.list_mode_attach(cfg));
+            crate::event_stream stream(*crate);
+            size_t index = 1;
+            CHECK_NOTHROW(index = stream.add(sim_module.slot));
+            CHECK(index == 0);
+            CHECK_NOTHROW(crate[0].start_test(module::module::test::lm_fifo));
+            data::list_mode::records recs;
+            for (int tries = 0; tries < 1000 && recs.size() < 100; ++tries) {
+                CHECK_NOTHROW(stream.read(recs));
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            CHECK_NOTHROW(crate[0].end_test());
+            CHECK_NOTHROW(stream.finish(recs));
+            REQUIRE(recs.size() >= 100);
+            CHECK(std::is_sorted(recs.begin(), recs.end()));
+            CHECK(stream.merged().late() == 0);
+            CHECK_NOTHROW(sim_module.list_mode_detach());
+        }
+        SUBCASE("Sim list-mode generator pipelined") {
+            auto& sim_module = dynamic_cast<sim::module&>(crate[0]);
+            CHECK_NOTHROW(crate[0].set_fifo_dma_pipeline(true));
+            sim::list_mode_generator::config cfg;
+            cfg.trace_length = 8;
+            cfg.paced = false;
+            CHECK_NOTHROW(sim_module.list_mode_attach(cfg));
+            hw::words words;
+            CHECK_NOTHROW(crate[0].start_test(module::module::test::lm_fifo));
+            for (int tries = 0; tries < 1000 && words.size() < 4096; ++tries) {
+                hw::words data(crate[0].read_list_mode_level());
+                if (!data.empty()) {
+                    crate[0].read_list_mode(data);
+                    words.insert(words.end(), data.begin(), data.end());
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            CHECK_NOTHROW(crate[0].end_test());
+            REQUIRE(words.size() >= 4096);
+            data::list_mode::records recs;
+            data::list_mode::buffer leftovers;
+            data::list_mode::buffer block(words.begin(), words.end());
+            CHECK_NOTHROW(data::list_mode::decode_data_block(block, cfg.revision,
+                                                             sim_module.eeprom.configs[0].adc_msps,
+                                                             recs, leftovers));
+            REQUIRE(!recs.empty());
+            CHECK(std::is_sorted(recs.begin(), recs.end()));
+            CHECK(crate[0].run_stats.in.load() >= words.size());
+            CHECK(sim_module.fifo_worker_active());
+            CHECK_NOTHROW(sim_module.list_mode_detach());
+            CHECK_NOTHROW(crate[0].set_fifo_dma_pipeline(false));
+        }
+        SUBCASE("Sim pipelined DMA failure") {
+            auto& sim_module = dynamic_cast<sim::module&>(crate[0]);
+            CHECK_NOTHROW(crate[0].set_fifo_dma_pipeline(true));
+            sim::list_mode_generator::config cfg;
+            cfg.trace_length = 8;
+            cfg.paced = false;
+            bool stuck = false;
+            SUBCASE("Idle") {
+                stuck = false;
+            }
+            SUBCASE("Stuck") {
+                stuck = true;
+            }
+            sim_module.dma_wait_fail = 3;
+            sim_module.dma_busy = stuck;
+            CHECK_NOTHROW(sim_module.list_mode_attach(cfg));
+            CHECK_NOTHROW(crate[0].start_test(module::module::test::lm_fifo));
+            for (int tries = 0; tries < 5000 && sim_module.fifo_worker_active(); ++tries) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            CHECK_FALSE(sim_module.fifo_worker_active());
+            CHECK(crate[0].fifo_dma_stuck.load() == stuck);
+            /*
+             * The transfers completed before the failure are queued.
+             */
+            hw::words data(crate[0].read_list_mode_level());
+            CHECK(!data.empty());
+            CHECK(data.size() == crate[0].run_stats.in.load());
+            CHECK_NOTHROW(crate[0].read_list_mode(data));
+            CHECK_NOTHROW(crate[0].end_test());
+            /*
+             * The failed transfer's buffer is returned to the pool only if
+             * the DMA stopped.
+             */
+            const auto held = sim_module.fifo_buffers_held();
+            CHECK(held == crate[0].fifo_buffers - (stuck ? 1 : 0));
+            CHECK_NOTHROW(sim_module.list_mode_detach());
+            sim_module.dma_wait_fail = 0;
+            sim_module.dma_busy = false;
+            CHECK_NOTHROW(crate[0].set_fifo_dma_pipeline(false));
+        }
+        SUBCASE("Sim list-mode spool") {
+            auto& sim_module = dynamic_cast<sim::module&>(crate[0]);
+            const auto path =
+                (std::filesystem::temp_directory_path() / "test_pixie16_module_spool.bin").string();
+            auto writer = std::make_shared<data::list_mode::spool_writer>(path);
+            CHECK_NOTHROW(crate->spool_attach(writer));
+            CHECK(crate[0].spooling());
+            sim::list_mode_generator::config cfg;
+            cfg.trace_length = 8;
+            cfg.paced = false;
+            CHECK_NOTHROW(sim_module.list_mode_attach(cfg));
+            CHECK_NOTHROW(crate[0].start_test(module::module::test::lm_fifo));
+            /*
+             * Do not read the data until the pool is used and the worker
+             * drops a transfer. Reading frees the buffers so the transfers
+             * after the drop are spooled.
+             */
+            for (int tries = 0; tries < 5000 && crate[0].run_stats.dropped.load() == 0;
+                 ++tries) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            REQUIRE(crate[0].run_stats.dropped.load() > 0);
+            hw::words words;
+            auto read_data = [&crate, &words]() {
+                hw::words data(crate[0].read_list_mode_level());
+                if (!data.empty()) {
+                    crate[0].read_list_mode(data);
+                    words.insert(words.end(), data.begin(), data.end());
+                }
+            };
+            read_data();
+            const auto frames = writer->frames();
+            for (int tries = 0; tries < 5000 && writer->frames() <= frames; ++tries) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+            CHECK_NOTHROW(crate[0].end_test());
+            CHECK_NOTHROW(crate->spool_detach());
+            CHECK_FALSE(crate[0].spooling());
+            CHECK_NOTHROW(sim_module.list_mode_detach());
+            read_data();
+            CHECK(writer->skipped() > 0);
+            CHECK_NOTHROW(writer->close());
+            auto result = data::list_mode::verify_spool(path);
+            CHECK(result.frames == writer->frames());
+            CHECK(result.words == writer->words());
+            CHECK(result.slots == 1);
+            CHECK(result.crc_errors == 0);
+            CHECK(result.header_errors == 0);
+            CHECK(result.sequence_gaps > 0);
+            CHECK(result.sequence_gaps <= writer->skipped());
+            CHECK_FALSE(result.truncated);
+            /*
+             * The data read is the spooled data. A transfer in flight when
+             * the test ended can be spooled and not yet read.
+             */
+            data::list_mode::spool_reader reader(path);
+            data::list_mode::spool_frame frame;
+            hw::words spooled;
+            while (reader.next(frame)) {
+                CHECK(frame.slot == uint32_t(sim_module.slot));
+                spooled.insert(spooled.end(), frame.data, frame.data + frame.words);
+            }
+            reader.close();
+            REQUIRE(spooled.size() >= words.size());
+            CHECK(std::equal(words.begin(), words.end(), spooled.begin()));
+            std::remove(path.c_str());
+        }
+        SUBCASE("Sim list-mode generator fill") {
+            /*
+             * A 54 word event does not divide the FIFO's size.
+             */
+            sim::list_mode_generator::config cfg;
+            cfg.trace_length = 100;
+            cfg.paced = false;
+            sim::list_mode_generator generator(cfg, 0, 2, 16, 100);
+            const size_t event_words = data::list_mode::header_length::header + 50;
+            REQUIRE(hw::fifo_size_words % event_words != 0);
+            auto level = generator.level();
+            CHECK(level <= hw::fifo_size_words);
+            CHECK(level > hw::fifo_size_words - event_words);
+            CHECK(generator.overflows() == 0);
+            CHECK(generator.words() == level);
+            CHECK(generator.events() == level / event_words);
+            hw::words data(event_words);
+            CHECK_NOTHROW(generator.read(data.data(), data.size()));
+            CHECK(generator.level() == level);
+            CHECK(generator.overflows() == 0);
+        }
+    }
+    TEST_CASE("snapshot") {
+        using namespace xia::pixie;
+        sim::crate sim_crate;
+        sim::load_firmware_sets(sim_crate.firmware, firmware_defs);
+        crate::view::module crate(sim_crate);
+        CHECK_NOTHROW(crate->initialize());
+        CHECK_NOTHROW(crate->probe());
+        CHECK_NOTHROW(crate->boot());
+        SUBCASE("Module histograms") {
+            hw::words histograms;
+            CHECK_NOTHROW(crate[0].read_histograms(histograms));
+            CHECK(histograms.size() == crate[0].histograms_length());
+            CHECK(crate[0].histograms_length() ==
+                  crate[0].num_channels * crate[0].max_histogram_length);
+            hw::words small(crate[0].histograms_length() - 1);
+            CHECK_THROWS_AS(crate[0].read_histograms(small), crate_error);
+        }
+        SUBCASE("Crate") {
+            crate::snapshot snapshot(sim_crate);
+            CHECK(snapshot.modules.size() == test_modules);
+            size_t words = 0;
+            for (auto& mod : snapshot.modules) {
+                CHECK(mod.offset == words);
+                words += mod.num_channels * mod.histogram_length;
+            }
+            CHECK(snapshot.words() == words);
+            hw::words histograms;
+            CHECK_NOTHROW(snapshot.read(histograms));
+            CHECK(histograms.size() == words);
+            auto& mod = snapshot.find(crate[1].slot);
+            CHECK(mod.histogram(1) == histograms.data() + mod.offset + mod.histogram_length);
+            CHECK(mod.stats.chans.size() == mod.num_channels);
+            CHECK_THROWS_AS(mod.histogram(mod.num_channels), crate_error);
+            CHECK_THROWS_AS(snapshot.find(1), crate_error);
+            hw::words small(words - 1);
+            CHECK_THROWS_AS(snapshot.read(small), crate_error);
+        }
+    }
+    TEST_CASE("histogram monitor") {
+        using namespace xia::pixie;
+        using monitor = crate::histogram_monitor;
+        SUBCASE("Diff") {
+            hw::words previous(64, 1);
+            hw::words current = previous;
+            monitor::ranges changes;
+            CHECK(monitor::diff(previous, current, changes) == 0);
+            CHECK(changes.empty());
+            current[3] = 2;
+            current[6] = 2;
+            current[40] = 5;
+            current[63] = 7;
+            CHECK(monitor::diff(previous, current, changes, 2) == 6);
+            REQUIRE(changes.size() == 3);
+            CHECK(changes[0].start == 3);
+            CHECK(changes[0].counts == hw::words{2, 1, 1, 2});
+            CHECK(changes[1].start == 40);
+            CHECK(changes[1].counts == hw::words{5});
+            CHECK(changes[2].start == 63);
+            CHECK(changes[2].counts == hw::words{7});
+            changes.clear();
+            CHECK(monitor::diff(previous, current, changes, 1) == 4);
+            CHECK(changes.size() == 4);
+            hw::words shorter(10);
+            CHECK_THROWS_AS(monitor::diff(previous, shorter, changes), crate_error);
+        }
+        sim::crate sim_crate;
+        sim::load_firmware_sets(sim_crate.firmware, firmware_defs);
+        crate::view::module crate(sim_crate);
+        CHECK_NOTHROW(crate->initialize());
+        CHECK_NOTHROW(crate->probe());
+        CHECK_NOTHROW(crate->boot());
+        SUBCASE("Poll") {
+            monitor mon(sim_crate, monitor::clock::duration(0), monitor::clock::duration(0));
+            std::vector<monitor::delta> deltas;
+            auto handle = mon.subscribe([&deltas](const monitor::delta& d) {
+                deltas.push_back(d);
+            });
+            CHECK_NOTHROW(mon.watch(crate[0].slot));
+            CHECK_NOTHROW(mon.watch(crate[1].slot, 2));
+            CHECK_THROWS_AS(mon.watch(crate[1].slot, 100), crate_error);
+            const auto channels = crate[0].num_channels + 1;
+            CHECK(mon.poll() == channels);
+            REQUIRE(deltas.size() == channels);
+            for (auto& d : deltas) {
+                CHECK(d.sequence == 0);
+                CHECK(d.bins == d.length);
+                REQUIRE(d.changes.size() == 1);
+                CHECK(d.changes[0].counts.size() == d.length);
+            }
+            CHECK(deltas.back().slot == crate[1].slot);
+            CHECK(deltas.back().channel == 2);
+            /*
+             * The simulated histograms do not change.
+             */
+            CHECK(mon.poll() == 0);
+            CHECK(deltas.size() == channels);
+            CHECK(mon.words_read() > mon.words_published());
+            mon.unsubscribe(handle);
+            CHECK_NOTHROW(mon.start());
+            CHECK(mon.running());
+            CHECK_NOTHROW(mon.stop());
+            CHECK(!mon.running());
+        }
+    }
+    TEST_CASE("hw poll") {
+        using namespace xia::pixie;
+        size_t checks = 0;
+        CHECK(hw::poll([&checks] { return ++checks == 1; }, 0) == true);
+        CHECK(checks == 1);
+        checks = 0;
+        CHECK(hw::poll([&checks] { return ++checks == 5; }, 1000000) == true);
+        CHECK(checks == 5);
+        checks = 0;
+        auto start = std::chrono::steady_clock::now();
+        CHECK(hw::poll([&checks] { ++checks; return false; }, 5000) == false);
+        auto period = std::chrono::steady_clock::now() - start;
+        CHECK(period >= std::chrono::microseconds(5000));
+        CHECK(checks > 1);
     }
     TEST_CASE("boot out of range slot") {
         using namespace xia::pixie;
@@ -612,6 +1024,29 @@ TEST_SUITE("Crate: modules") {
         CHECK_NOTHROW(crate[2].run_end());
         CHECK_NOTHROW(crate[1].run_end());
         CHECK_NOTHROW(crate[3].run_end());
+        SUBCASE("Histogram clear") {
+            auto& mod = crate[0];
+            const auto good = param::value_type(1 << hw::bit::CCSRA_GOOD);
+            for (auto& chan : mod.channels) {
+                auto csra = mod.read_var(param::channel_var::ChanCSRa, chan.number, 0, false);
+                mod.write_var(param::channel_var::ChanCSRa,
+                              chan.number == 0 ? csra | good : csra & ~good, chan.number);
+            }
+            for (auto& chan : mod.channels) {
+                chan.histogram_dirty = true;
+            }
+            CHECK_NOTHROW(mod.start_histograms(hw::run::run_mode::new_run));
+            CHECK(mod.run_stats.start_latency.load() >= 0);
+            CHECK_NOTHROW(mod.run_end());
+            CHECK(mod.channels[0].histogram_dirty);
+            for (size_t c = 1; c < mod.channels.size(); ++c) {
+                CHECK(!mod.channels[c].histogram_dirty);
+            }
+            CHECK_NOTHROW(mod.start_listmode(hw::run::run_mode::resume));
+            CHECK_NOTHROW(mod.run_end());
+            CHECK(mod.channels[0].histogram_dirty);
+            CHECK(!mod.channels[1].histogram_dirty);
+        }
     }
     TEST_CASE("backplane") {
         using namespace xia::pixie;
@@ -883,6 +1318,336 @@ TEST_SUITE("Crate: modules") {
         CHECK(crate[0].read("SLOW_FILTER_RANGE") == 6);
         /* fast filter range can only be set to 0 currently */
         CHECK(crate[0].read("FAST_FILTER_RANGE") == 0);
+        /* the variables shadow needs the hardware */
+        CHECK_NOTHROW(crate[0].vars_shadow_load());
+        CHECK(crate[0].vars_shadow_valid() == false);
+        CHECK_NOTHROW(crate[0].read_runtime_vars());
+        CHECK(crate[0].read("SLOW_FILTER_RANGE") == 6);
+    }
+    TEST_CASE("sim variables shadow") {
+        using namespace xia::pixie;
+        using namespace xia::pixie::param;
+        namespace run = xia::pixie::hw::run;
+        sim::crate sim_crate;
+        sim::load_firmware_sets(sim_crate.firmware, firmware_defs);
+        crate::view::module crate(sim_crate);
+        CHECK_NOTHROW(crate->initialize());
+        CHECK_NOTHROW(crate->probe());
+        CHECK_NOTHROW(crate->boot());
+        auto& mod = dynamic_cast<sim::module&>(crate[0]);
+        sim_var_addresses(mod);
+        const auto& csra_desc = mod.channel_var_descriptors[size_t(channel_var::ChanCSRa)];
+        const auto csra_addr =
+            xia::pixie::hw::address(csra_desc.address + mod.channels[1].fixture->config.index);
+        const auto& csrb_desc = mod.module_var_descriptors[size_t(module_var::ModCSRB)];
+        CHECK_NOTHROW(mod.dsp_memory_attach());
+        mod.dsp_memory[csra_addr] = 0x1234;
+        mod.dsp_memory[csrb_desc.address] = 0x5;
+        SUBCASE("Reads served from the shadow") {
+            CHECK(mod.vars_shadow_valid() == false);
+            CHECK(mod.read_var(channel_var::ChanCSRa, 1, 0) == 0x1234);
+            CHECK(mod.vars_shadow_valid() == true);
+            auto reads = mod.dsp_reads;
+            CHECK(reads != 0);
+            CHECK(mod.read_var(module_var::ModCSRB, 0) == 0x5);
+            CHECK(mod.read_var(channel_var::ChanCSRa, 1, 0) == 0x1234);
+            CHECK(mod.dsp_reads == reads);
+            /* the DSP changes a variable; the shadow is not reloaded */
+            mod.dsp_memory[csra_addr] = 0x4321;
+            CHECK(mod.read_var(channel_var::ChanCSRa, 1, 0) == 0x1234);
+            CHECK(mod.dsp_reads == reads);
+            /* a write updates the DSP and the shadow */
+            CHECK_NOTHROW(mod.write_var(channel_var::ChanCSRa, 0x2222, 1, 0));
+            CHECK(mod.dsp_memory[csra_addr] == 0x2222);
+            CHECK(mod.read_var(channel_var::ChanCSRa, 1, 0) == 0x2222);
+            CHECK(mod.dsp_reads == reads);
+        }
+        SUBCASE("Control tasks keep the shadow") {
+            CHECK_NOTHROW(mod.vars_shadow_load());
+            CHECK(mod.vars_shadow_valid() == true);
+            mod.dsp_memory[csra_addr] = 0x4321;
+            for (auto task : {run::control_task::set_dacs, run::control_task::get_traces,
+                              run::control_task::program_fippi, run::control_task::get_baselines,
+                              run::control_task::reset_adc}) {
+                CAPTURE(int(task));
+                CHECK_NOTHROW(run::start(mod, run::run_mode::new_run, run::run_task::nop, task));
+                CHECK_NOTHROW(run::end(mod));
+                CHECK(mod.vars_shadow_valid() == true);
+                CHECK(mod.read_var(channel_var::ChanCSRa, 1, 0) == 0x1234);
+            }
+        }
+        SUBCASE("Control tasks run to the end keep the shadow") {
+            CHECK_NOTHROW(mod.vars_shadow_load());
+            mod.dsp_memory[csra_addr] = 0x4321;
+            for (auto task : {run::control_task::program_fippi, run::control_task::set_dacs,
+                              run::control_task::get_traces}) {
+                CAPTURE(int(task));
+                CHECK_NOTHROW(run::control(mod, task));
+                CHECK(mod.control_task.load() == run::control_task::nop);
+                CHECK(mod.last_control_task.load() == task);
+                auto reads = mod.dsp_reads;
+                CHECK(mod.read_var(channel_var::ChanCSRa, 1, 0) == 0x1234);
+                CHECK(mod.dsp_reads == reads);
+            }
+            /* the task's results can be read once it has finished */
+            hw::adc_trace trace;
+            CHECK_NOTHROW(mod.read_adc(0, trace, false));
+            CHECK_NOTHROW(run::control(mod, run::control_task::adjust_offsets));
+            CHECK(mod.vars_shadow_valid() == false);
+            CHECK(mod.read_var(channel_var::ChanCSRa, 1, 0) == 0x4321);
+            CHECK(mod.vars_shadow_valid() == true);
+        }
+        SUBCASE("Control tasks invalidate the shadow") {
+            for (auto task : {run::control_task::adjust_offsets, run::control_task::tau_finder,
+                              run::control_task::ramp_offsetdacs}) {
+                CAPTURE(int(task));
+                CHECK_NOTHROW(mod.vars_shadow_load());
+                CHECK(mod.vars_shadow_valid() == true);
+                CHECK_NOTHROW(run::start(mod, run::run_mode::new_run, run::run_task::nop, task));
+                CHECK(mod.vars_shadow_valid() == false);
+                CHECK_NOTHROW(run::end(mod));
+                /* the next read loads the DSP's values */
+                mod.dsp_memory[csra_addr] = 0x1000 + int(task);
+                CHECK(mod.read_var(channel_var::ChanCSRa, 1, 0) == 0x1000 + int(task));
+                CHECK(mod.vars_shadow_valid() == true);
+            }
+        }
+        SUBCASE("Run start invalidates the shadow") {
+            CHECK_NOTHROW(mod.vars_shadow_load());
+            CHECK(mod.vars_shadow_valid() == true);
+            CHECK_NOTHROW(
+                run::start(mod, run::run_mode::resume, run::run_task::list_mode,
+                           run::control_task::nop));
+            CHECK(mod.vars_shadow_valid() == false);
+            /* a run's reads go to the DSP */
+            auto reads = mod.dsp_reads;
+            mod.dsp_memory[csra_addr] = 0x4321;
+            CHECK(mod.read_var(channel_var::ChanCSRa, 1, 0) == 0x4321);
+            CHECK(mod.dsp_reads > reads);
+            reads = mod.dsp_reads;
+            CHECK(mod.read_var(channel_var::ChanCSRa, 1, 0) == 0x4321);
+            CHECK(mod.dsp_reads > reads);
+            CHECK(mod.vars_shadow_valid() == false);
+            CHECK_NOTHROW(run::end(mod));
+        }
+        CHECK_NOTHROW(mod.dsp_memory_detach());
+        CHECK(mod.vars_shadow_valid() == false);
+    }
+    TEST_CASE("sim read ADC traces") {
+        using namespace xia::pixie;
+        namespace run = xia::pixie::hw::run;
+        sim::crate sim_crate;
+        sim::load_firmware_sets(sim_crate.firmware, firmware_defs);
+        crate::view::module crate(sim_crate);
+        CHECK_NOTHROW(crate->initialize());
+        CHECK_NOTHROW(crate->probe());
+        CHECK_NOTHROW(crate->boot());
+        auto& mod = dynamic_cast<sim::module&>(crate[0]);
+        CHECK_NOTHROW(mod.dsp_memory_attach());
+        /*
+         * Two samples per word, the first in the low half.
+         */
+        auto sample = [](size_t channel, size_t s) {
+            return hw::adc_word(channel * 1000 + s + 1);
+        };
+        for (auto& chan : mod.channels) {
+            const auto addr = chan.adc_trace_address();
+            for (size_t w = 0; w < 4; ++w) {
+                mod.dsp_memory[hw::address(addr + w)] =
+                    hw::word(sample(chan.number, w * 2)) |
+                    (hw::word(sample(chan.number, w * 2 + 1)) << 16);
+            }
+        }
+        CHECK_NOTHROW(run::start(mod, run::run_mode::new_run, run::run_task::nop,
+                                 run::control_task::get_traces));
+        hw::adc_traces traces(mod.num_channels);
+        for (auto& trace : traces) {
+            trace.assign(5, 0xffff);
+        }
+        traces[0].clear();
+        CHECK_NOTHROW(mod.read_adc_all(traces, false));
+        REQUIRE(traces.size() == mod.num_channels);
+        CHECK(traces[0].size() == mod.channels[0].fixture->config.max_adc_trace_length);
+        for (size_t s = 0; s < 8; ++s) {
+            CHECK(traces[0][s] == sample(0, s));
+        }
+        CHECK(traces[0][8] == 0);
+        for (size_t ch = 1; ch < traces.size(); ++ch) {
+            CAPTURE(ch);
+            REQUIRE(traces[ch].size() == 5);
+            for (size_t s = 0; s < 5; ++s) {
+                CHECK(traces[ch][s] == sample(ch, s));
+            }
+        }
+        SUBCASE("Too long") {
+            traces[1].assign(mod.channels[1].fixture->config.max_adc_trace_length + 2, 0xffff);
+            CHECK_THROWS_AS(mod.read_adc_all(traces, false), crate_error);
+            CHECK(traces[1].back() == 0xffff);
+        }
+        CHECK_NOTHROW(run::end(mod));
+        CHECK_NOTHROW(mod.dsp_memory_detach());
+    }
+    TEST_CASE("param transaction") {
+        using namespace xia::pixie;
+        using namespace xia::pixie::param;
+        sim::crate sim_crate;
+        sim::load_firmware_sets(sim_crate.firmware, firmware_defs);
+        crate::view::module crate(sim_crate);
+        CHECK_NOTHROW(crate->initialize());
+        CHECK_NOTHROW(crate->probe());
+        CHECK_NOTHROW(crate->boot());
+        SUBCASE("Module") {
+            auto& mod = crate[0];
+            CHECK(mod.param_transaction_active() == false);
+            CHECK_THROWS_AS(mod.param_transaction_commit(), crate_error);
+            CHECK_NOTHROW(mod.param_transaction_begin());
+            CHECK(mod.param_transaction_active() == true);
+            CHECK_THROWS_AS(mod.param_transaction_begin(), crate_error);
+            CHECK_NOTHROW(mod.write("SLOW_FILTER_RANGE", 6));
+            CHECK_NOTHROW(mod.write_var(channel_var::ChanCSRa, 4, 0));
+            CHECK_NOTHROW(mod.write(channel_param::voffset, 0, 0.5));
+            CHECK(mod.read("SLOW_FILTER_RANGE") == 6);
+            CHECK(mod.read_var(channel_var::ChanCSRa, 0, 0) == 4);
+            CHECK_NOTHROW(mod.param_transaction_commit());
+            CHECK(mod.param_transaction_active() == false);
+            CHECK(mod.read("SLOW_FILTER_RANGE") == 6);
+            CHECK(mod.read_var(channel_var::ChanCSRa, 0, 0) == 4);
+        }
+        SUBCASE("Abort") {
+            auto& mod = crate[1];
+            const auto range = mod.read("SLOW_FILTER_RANGE");
+            const auto csra = mod.read_var(channel_var::ChanCSRa, 0, 0);
+            CHECK_NOTHROW(mod.param_transaction_abort());
+            CHECK_NOTHROW(mod.param_transaction_begin());
+            CHECK_NOTHROW(mod.write("SLOW_FILTER_RANGE", range + 1));
+            CHECK_NOTHROW(mod.write_var(channel_var::ChanCSRa, csra ^ 4, 0));
+            CHECK(mod.read("SLOW_FILTER_RANGE") == range + 1);
+            CHECK_NOTHROW(mod.param_transaction_abort());
+            CHECK(mod.param_transaction_active() == false);
+            CHECK(mod.read("SLOW_FILTER_RANGE") == range);
+            CHECK(mod.read_var(channel_var::ChanCSRa, 0, 0) == csra);
+        }
+        SUBCASE("Held control tasks") {
+            auto& mod = crate[0];
+            /*
+             * Count the program FIPPI control tasks started.
+             */
+            size_t program_fippi = 0;
+            auto sim_write = mod.hw_word_write;
+            mod.hw_word_write = [&mod, &program_fippi, sim_write](int reg, hw::word val) {
+                if (reg == hw::device::CSR && (val & (1 << hw::bit::RUNENA)) != 0 &&
+                    mod.control_task == hw::run::control_task::program_fippi) {
+                    ++program_fippi;
+                }
+                sim_write(reg, val);
+            };
+            CHECK_NOTHROW(mod.param_transaction_begin());
+            CHECK_NOTHROW(hw::run::control(mod, hw::run::control_task::program_fippi));
+            CHECK_NOTHROW(hw::run::control(mod, hw::run::control_task::program_fippi));
+            CHECK(program_fippi == 0);
+            CHECK_NOTHROW(mod.param_transaction_commit());
+            CHECK(program_fippi == 1);
+            /*
+             * A control task that is not held flushes the held tasks
+             * first and the transaction stays active.
+             */
+            const auto range = mod.read("SLOW_FILTER_RANGE");
+            CHECK_NOTHROW(mod.param_transaction_begin());
+            CHECK_NOTHROW(mod.write("SLOW_FILTER_RANGE", range + 1));
+            CHECK_NOTHROW(hw::run::control(mod, hw::run::control_task::program_fippi));
+            CHECK_NOTHROW(hw::run::control(mod, hw::run::control_task::get_baselines));
+            CHECK(program_fippi == 2);
+            CHECK(mod.param_transaction_active() == true);
+            CHECK(mod.read("SLOW_FILTER_RANGE") == range + 1);
+            /*
+             * Aborting a flushed transaction restores the variables and
+             * programs the FIPPI with them.
+             */
+            CHECK_NOTHROW(mod.param_transaction_abort());
+            CHECK(program_fippi == 3);
+            CHECK(mod.read("SLOW_FILTER_RANGE") == range);
+            mod.hw_word_write = sim_write;
+        }
+        SUBCASE("Control task on the DSP") {
+            namespace run = hw::run;
+            auto& mod = dynamic_cast<sim::module&>(crate[0]);
+            REQUIRE(mod.run_config.dsp_get_traces);
+            const auto& ctl_desc = mod.module_var_descriptors[size_t(module_var::ControlTask)];
+            const auto& run_desc = mod.module_var_descriptors[size_t(module_var::RunTask)];
+            sim_var_addresses(mod);
+            CHECK_NOTHROW(mod.dsp_memory_attach());
+            mod.dsp_memory[ctl_desc.address] = hw::word(run::control_task::nop);
+            mod.dsp_memory[run_desc.address] = hw::word(run::run_task::list_mode);
+            CHECK_NOTHROW(mod.param_transaction_begin());
+            CHECK_NOTHROW(mod.write("SLOW_FILTER_RANGE", 5));
+            /*
+             * The task's run variables are written to the DSP and the
+             * transaction is active once the task ends.
+             */
+            CHECK_NOTHROW(run::control(mod, run::control_task::get_traces));
+            CHECK(mod.dsp_memory[ctl_desc.address] == hw::word(run::control_task::get_traces));
+            CHECK(mod.dsp_memory[run_desc.address] == hw::word(run::run_task::nop));
+            CHECK(mod.param_transaction_active() == true);
+            CHECK(mod.control_task.load() == run::control_task::nop);
+            CHECK_THROWS_AS(mod.start_listmode(run::run_mode::new_run), crate_error);
+            CHECK_THROWS_AS(mod.start_histograms(run::run_mode::new_run), crate_error);
+            CHECK(mod.run_active() == false);
+            /* a variable written after the task is held for the commit */
+            CHECK_NOTHROW(mod.write("SLOW_FILTER_RANGE", 4));
+            CHECK(mod.read("SLOW_FILTER_RANGE") == 4);
+            CHECK_NOTHROW(mod.param_transaction_commit());
+            CHECK(mod.param_transaction_active() == false);
+            CHECK(mod.read("SLOW_FILTER_RANGE") == 4);
+            CHECK_NOTHROW(mod.dsp_memory_detach());
+        }
+        SUBCASE("Commit failure") {
+            auto& mod = crate[0];
+            auto sim_write = mod.hw_word_write;
+            mod.hw_word_write = [&mod, sim_write](int reg, hw::word val) {
+                if (reg == hw::device::CSR && (val & (1 << hw::bit::RUNENA)) != 0 &&
+                    mod.control_task == hw::run::control_task::program_fippi) {
+                    throw xia::pixie::error::error(xia::pixie::error::code::module_task_timeout,
+                                                   "program fippi failed");
+                }
+                sim_write(reg, val);
+            };
+            CHECK_NOTHROW(mod.param_transaction_begin());
+            CHECK_NOTHROW(mod.write("SLOW_FILTER_RANGE", 6));
+            CHECK_NOTHROW(hw::run::control(mod, hw::run::control_task::program_fippi));
+            CHECK_THROWS_AS(mod.param_transaction_commit(), crate_error);
+            CHECK(mod.param_transaction_active() == true);
+            CHECK(mod.read("SLOW_FILTER_RANGE") == 6);
+            mod.hw_word_write = sim_write;
+            mod.control_task = hw::run::control_task::nop;
+            CHECK_NOTHROW(mod.param_transaction_commit());
+            CHECK(mod.param_transaction_active() == false);
+            CHECK(mod.read("SLOW_FILTER_RANGE") == 6);
+        }
+        SUBCASE("Crate") {
+            CHECK_NOTHROW(crate->param_transaction_begin());
+            for (size_t m = 0; m < crate.num_modules; ++m) {
+                CHECK(crate[m].param_transaction_active() == true);
+                CHECK_NOTHROW(crate[m].write("SLOW_FILTER_RANGE", 2));
+            }
+            CHECK_NOTHROW(crate->param_transaction_commit());
+            for (size_t m = 0; m < crate.num_modules; ++m) {
+                CHECK(crate[m].param_transaction_active() == false);
+                CHECK(crate[m].read("SLOW_FILTER_RANGE") == 2);
+            }
+            /*
+             * A failed begin aborts the transactions it began.
+             */
+            CHECK_NOTHROW(crate[2].param_transaction_begin());
+            CHECK_THROWS_AS(crate->param_transaction_begin(), crate_error);
+            for (size_t m = 0; m < crate.num_modules; ++m) {
+                CAPTURE(m);
+                CHECK(crate[m].param_transaction_active() == (m == 2));
+            }
+            CHECK_NOTHROW(crate->param_transaction_abort());
+            for (size_t m = 0; m < crate.num_modules; ++m) {
+                CHECK(crate[m].param_transaction_active() == false);
+            }
+        }
     }
     TEST_CASE("sim run/control tasks") {
         using namespace xia::pixie;
@@ -911,6 +1676,53 @@ TEST_SUITE("Crate: modules") {
         CHECK_NOTHROW(crate[0].run_end());
         CHECK(crate[0].run_active() == false);
         CHECK(crate[0].control_task.load() == hw::run::control_task::nop);
+
+        CHECK_NOTHROW(crate->acquire_baselines());
+        CHECK_NOTHROW(crate->adjust_offsets());
+        auto report = crate->get_offsets_report();
+        REQUIRE(report.slots.size() == test_modules);
+        for (size_t m = 0; m < report.slots.size(); ++m) {
+            auto& sr = report.slots[m];
+            CAPTURE(m);
+            CHECK(sr.slot == crate[m].slot);
+            CHECK(sr.ok);
+            CHECK(sr.profile.period > 0);
+            CHECK(sr.profile.period <= report.total);
+            if (crate[m].run_config.dsp_adjust_offsetdacs) {
+                /* the DSP adjusts all channels in one run */
+                CHECK(sr.profile.runs == 1);
+                CHECK(sr.profile.channels == crate[m].num_channels);
+                CHECK(sr.profile.converged == 0);
+            } else {
+                CHECK(sr.profile.runs > 0);
+                CHECK(sr.profile.channels == crate[m].num_channels);
+                CHECK(sr.profile.converged == sr.profile.channels);
+            }
+        }
+
+        /*
+         * Fail a module's adjustment when its control task is started.
+         */
+        auto& failing = crate[1];
+        auto sim_write = failing.hw_word_write;
+        failing.hw_word_write = [&failing, sim_write](int reg, hw::word val) {
+            if (reg == hw::device::CSR && (val & (1 << hw::bit::RUNENA)) != 0 &&
+                failing.control_task == hw::run::control_task::adjust_offsets) {
+                throw xia::pixie::error::error(xia::pixie::error::code::module_task_timeout,
+                                               "adjust offsets failed");
+            }
+            sim_write(reg, val);
+        };
+        CHECK_THROWS_AS(crate->adjust_offsets(), crate_error);
+        failing.hw_word_write = sim_write;
+        failing.control_task = hw::run::control_task::nop;
+        report = crate->get_offsets_report();
+        REQUIRE(report.slots.size() == test_modules);
+        for (size_t m = 0; m < report.slots.size(); ++m) {
+            CAPTURE(m);
+            CHECK(report.slots[m].slot == crate[m].slot);
+            CHECK(report.slots[m].ok == (m != 1));
+        }
     }
     TEST_CASE("TEARDOWN") {
         xia::logging::stop("log");
@@ -20,7 +20,9 @@
  * @brief Defines tests for the threaded FIFO buffer readout.
  */
 
+#include <atomic>
 #include <cstring>
+#include <thread>
 
 #include <doctest/doctest.h>
 #include <pixie/buffer.hpp>
@@ -123,6 +125,63 @@ TEST_SUITE("xia::buffer") {
                 remaining.push_back(pool.request());
             }
         }
+        SUBCASE("slab") {
+            std::vector<xia::buffer::handle> handles;
+            for (size_t b = 0; b < pool.number; ++b) {
+                handles.push_back(pool.request());
+                auto& buf = handles.back();
+                CHECK(uintptr_t(buf->data()) % 64 == 0);
+                for (size_t h = 0; h < b; ++h) {
+                    CHECK(handles[h]->data() != buf->data());
+                }
+            }
+            auto data = handles[0]->data();
+            handles[0]->resize(pool.size);
+            CHECK(handles[0]->data() == data);
+            xia::buffer::buffer outside;
+            CHECK_THROWS_WITH_AS(pool.release(&outside), "buffer is not from the pool",
+                                 xia::buffer::error);
+            xia::buffer::buffer copy(*handles[0]);
+            CHECK(copy.data() != data);
+            CHECK(copy.size() == pool.size);
+        }
+        SUBCASE("threads") {
+            static const size_t loops = 20000;
+            std::atomic_size_t errors(0);
+            auto worker = [&pool, &errors]() {
+                std::vector<xia::buffer::buffer_ptr> held;
+                for (size_t l = 0; l < loops; ++l) {
+                    if (held.size() < 10 && !pool.empty()) {
+                        try {
+                            held.push_back(pool.request_buffer());
+                            held.back()->push_back(xia::buffer::buffer_value(l));
+                        } catch (xia::buffer::error&) {
+                        }
+                    } else if (!held.empty()) {
+                        if (held.back()->size() != 1) {
+                            ++errors;
+                        }
+                        pool.release(held.back());
+                        held.pop_back();
+                    }
+                }
+                for (auto buf : held) {
+                    pool.release(buf);
+                }
+            };
+            std::thread t1(worker);
+            std::thread t2(worker);
+            worker();
+            t1.join();
+            t2.join();
+            CHECK(errors == 0);
+            CHECK(pool.full());
+            std::vector<xia::buffer::handle> handles;
+            while (!pool.empty()) {
+                handles.push_back(pool.request());
+            }
+            CHECK(handles.size() == pool.number);
+        }
         pool.destroy();
     }
     TEST_CASE("queue") {
@@ -392,4 +451,318 @@ TEST_SUITE("xia::buffer") {
         }
         pool.destroy();
     }
+    TEST_CASE("ring") {
+        xia::buffer::pool pool;
+        pool.create(10, 1024);
+        xia::buffer::ring ring;
+        /*
+         * Push a buffer of `size` words numbered from `value`.
+         */
+        auto push = [&pool, &ring](size_t size, xia::buffer::buffer_value& value) {
+            auto buf = pool.request_buffer();
+            buf->resize(size);
+            for (auto& word : *buf) {
+                word = value++;
+            }
+            ring.push(buf, size);
+        };
+        auto sequential = [](const xia::buffer::buffer& buf, xia::buffer::buffer_value value) {
+            for (auto word : buf) {
+                if (word != value++) {
+                    return false;
+                }
+            }
+            return true;
+        };
+        SUBCASE("create/destroy") {
+            CHECK(!ring.valid());
+            ring.create(pool);
+            CHECK(ring.valid());
+            CHECK(ring.empty());
+            CHECK(ring.size() == 0);
+            CHECK(ring.count() == 0);
+            CHECK(ring.space() == 0);
+            CHECK_THROWS_WITH_AS(ring.create(pool), "ring is already created", xia::buffer::error);
+            xia::buffer::buffer_value value = 0;
+            push(100, value);
+            ring.destroy();
+            CHECK(!ring.valid());
+            CHECK(pool.full());
+        }
+        SUBCASE("partial copies") {
+            ring.create(pool);
+            xia::buffer::buffer_value value = 0;
+            push(100, value);
+            push(300, value);
+            CHECK(ring.size() == 400);
+            CHECK(ring.count() == 2);
+            xia::buffer::buffer out(150);
+            CHECK(ring.copy(out) == 150);
+            CHECK(sequential(out, 0));
+            CHECK(ring.size() == 250);
+            CHECK(ring.count() == 1);
+            CHECK(pool.count() == pool.number - 1);
+            out.resize(10);
+            CHECK(ring.copy(out.data(), out.size()) == 10);
+            CHECK(sequential(out, 150));
+            out.resize(1000);
+            CHECK_THROWS_WITH_AS(ring.copy(out), "not enough data in queue", xia::buffer::error);
+            out.clear();
+            CHECK(ring.copy(out) == 240);
+            CHECK(sequential(out, 160));
+            CHECK(ring.empty());
+            /*
+             * The newest buffer is kept for the producer to append to.
+             */
+            CHECK(ring.count() == 1);
+            CHECK(ring.space() == 1024 - 300);
+        }
+        SUBCASE("append") {
+            ring.create(pool);
+            xia::buffer::buffer_value value = 0;
+            push(1000, value);
+            /*
+             * The pushed buffer is not resized to its capacity.
+             */
+            xia::buffer::lent_buffers lent;
+            CHECK(ring.lend(lent) == 1000);
+            REQUIRE(lent.size() == 1);
+            CHECK(lent[0].buf->size() == 1000);
+            lent.clear();
+            value = 0;
+            push(1000, value);
+            CHECK(ring.space() == 24);
+            auto* data = ring.space_data();
+            for (size_t w = 0; w < 20; ++w) {
+                data[w] = value++;
+            }
+            ring.commit(20);
+            CHECK(ring.space() == 4);
+            ring.abort_append();
+            CHECK(ring.size() == 1020);
+            CHECK(ring.count() == 1);
+            CHECK(ring.lend(lent) == 1020);
+            REQUIRE(lent.size() == 1);
+            CHECK(lent[0].buf->size() == 1020);
+            lent.clear();
+            value = 0;
+            push(1000, value);
+            ring.space();
+            ring.commit(0);
+            ring.space();
+            for (size_t w = 0; w < 20; ++w) {
+                ring.space_data()[w] = value++;
+            }
+            ring.commit(20);
+            CHECK(ring.size() == 1020);
+            xia::buffer::buffer out;
+            ring.copy(out);
+            CHECK(out.size() == 1020);
+            CHECK(sequential(out, 0));
+            push(10, value);
+            out.clear();
+            ring.copy(out);
+            CHECK(sequential(out, 1020));
+            CHECK(ring.count() == 1);
+            CHECK(pool.count() == pool.number - 1);
+        }
+        SUBCASE("flush") {
+            ring.create(pool);
+            xia::buffer::buffer_value value = 0;
+            push(100, value);
+            push(100, value);
+            push(100, value);
+            ring.flush();
+            CHECK(ring.empty());
+            CHECK(ring.count() == 1);
+            push(100, value);
+            xia::buffer::buffer out;
+            ring.copy(out);
+            CHECK(out.size() == 100);
+            CHECK(sequential(out, 300));
+        }
+        auto lent_sequential = [](const xia::buffer::lent& buf,
+                                  xia::buffer::buffer_value value) {
+            for (size_t w = 0; w < buf.size(); ++w) {
+                if (buf.data()[w] != value++) {
+                    return false;
+                }
+            }
+            return true;
+        };
+        SUBCASE("lend") {
+            ring.create(pool);
+            xia::buffer::buffer_value value = 0;
+            push(100, value);
+            push(300, value);
+            xia::buffer::buffer out(30);
+            ring.copy(out);
+            xia::buffer::lent_buffers lent;
+            CHECK(ring.lend(lent, 1) == 70);
+            REQUIRE(lent.size() == 1);
+            CHECK(lent[0].size() == 70);
+            CHECK(lent_sequential(lent[0], 30));
+            CHECK(ring.size() == 300);
+            CHECK(ring.count() == 1);
+            /*
+             * The newest buffer is sealed and lent.
+             */
+            CHECK(ring.lend(lent) == 300);
+            REQUIRE(lent.size() == 2);
+            CHECK(lent_sequential(lent[1], 100));
+            CHECK(ring.empty());
+            CHECK(ring.count() == 0);
+            CHECK(ring.space() == 0);
+            CHECK(ring.lend(lent) == 0);
+            CHECK(pool.count() == pool.number - 2);
+            lent.clear();
+            CHECK(pool.full());
+            /*
+             * A sealed buffer is not appended to.
+             */
+            push(10, value);
+            out.resize(5);
+            ring.copy(out);
+            CHECK(ring.lend(lent) == 5);
+            CHECK(lent_sequential(lent[0], 405));
+            push(10, value);
+            CHECK(ring.space() == 1024 - 10);
+            out.clear();
+            ring.copy(out);
+            CHECK(sequential(out, 410));
+            lent.clear();
+            CHECK(pool.count() == pool.number - 1);
+        }
+        SUBCASE("abort append") {
+            ring.create(pool);
+            xia::buffer::buffer_value value = 0;
+            push(100, value);
+            CHECK(ring.space() == 1024 - 100);
+            ring.space_data()[0] = 12345;
+            ring.abort_append();
+            CHECK(ring.size() == 100);
+            /*
+             * The aborted append does not hold the newest buffer.
+             */
+            xia::buffer::lent_buffers lent;
+            CHECK(ring.lend(lent) == 100);
+            REQUIRE(lent.size() == 1);
+            CHECK(lent[0].buf->size() == 100);
+            CHECK(lent_sequential(lent[0], 0));
+            lent.clear();
+            /*
+             * A push after an unfinished append sizes the newest buffer to
+             * its fill level.
+             */
+            push(100, value);
+            CHECK(ring.space() == 1024 - 100);
+            push(50, value);
+            CHECK(ring.lend(lent) == 150);
+            REQUIRE(lent.size() == 2);
+            CHECK(lent[0].buf->size() == 100);
+            CHECK(lent[1].buf->size() == 50);
+            CHECK(lent_sequential(lent[0], 100));
+            CHECK(lent_sequential(lent[1], 200));
+            lent.clear();
+            CHECK(pool.full());
+        }
+        SUBCASE("producer and consumer threads") {
+            ring.create(pool);
+            const xia::buffer::buffer_value total = 1000000;
+            std::thread producer([&]() {
+                xia::buffer::buffer_value value = 0;
+                size_t step = 0;
+                while (value < total) {
+                    size_t words = std::min(size_t(total - value), (++step * 37) % 700 + 1);
+                    if (ring.space() >= words) {
+                        auto* data = ring.space_data();
+                        for (size_t w = 0; w < words; ++w) {
+                            data[w] = value++;
+                        }
+                        ring.commit(words);
+                    } else if (!pool.empty()) {
+                        push(words, value);
+                    } else {
+                        std::this_thread::yield();
+                    }
+                }
+            });
+            xia::buffer::buffer_value expected = 0;
+            bool matched = true;
+            size_t step = 0;
+            xia::buffer::buffer out;
+            while (expected < total) {
+                auto available = ring.size();
+                if (available == 0) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                out.resize(std::min(available, (++step * 53) % 900 + 1));
+                ring.copy(out);
+                matched = matched && sequential(out, expected);
+                expected += xia::buffer::buffer_value(out.size());
+            }
+            producer.join();
+            CHECK(matched);
+            CHECK(ring.empty());
+            ring.destroy();
+            CHECK(pool.full());
+        }
+        SUBCASE("lending producer and consumer threads") {
+            ring.create(pool);
+            const xia::buffer::buffer_value total = 1000000;
+            std::thread producer([&]() {
+                xia::buffer::buffer_value value = 0;
+                size_t step = 0;
+                while (value < total) {
+                    size_t words = std::min(size_t(total - value), (++step * 37) % 700 + 1);
+                    if (ring.space() >= words) {
+                        auto* data = ring.space_data();
+                        for (size_t w = 0; w < words; ++w) {
+                            data[w] = value++;
+                        }
+                        ring.commit(words);
+                    } else if (!pool.empty()) {
+                        push(words, value);
+                    } else {
+                        std::this_thread::yield();
+                    }
+                }
+            });
+            xia::buffer::buffer_value expected = 0;
+            bool matched = true;
+            size_t step = 0;
+            xia::buffer::buffer out;
+            xia::buffer::lent_buffers lent;
+            while (expected < total) {
+                auto available = ring.size();
+                if (available == 0) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                if (++step % 3 == 0) {
+                    out.resize(std::min(available, (step * 53) % 900 + 1));
+                    ring.copy(out);
+                    matched = matched && sequential(out, expected);
+                    expected += xia::buffer::buffer_value(out.size());
+                } else {
+                    lent.clear();
+                    ring.lend(lent, step % 4);
+                    for (auto& buf : lent) {
+                        matched = matched && lent_sequential(buf, expected);
+                        expected += xia::buffer::buffer_value(buf.size());
+                    }
+                }
+            }
+            producer.join();
+            lent.clear();
+            CHECK(matched);
+            CHECK(expected == total);
+            CHECK(ring.empty());
+            ring.destroy();
+            CHECK(pool.full());
+        }
+        ring.destroy();
+        pool.destroy();
+    }
 }
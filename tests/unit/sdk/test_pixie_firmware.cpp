@@ -19,6 +19,8 @@
 /** @file test_pixie_firmware.cpp
  * @brief
  */
+#include <cstdio>
+#include <fstream>
 #include <vector>
 
 #include <doctest/doctest.h>
@@ -1030,4 +1032,89 @@ TEST_SUITE("Firmware") {
         CHECK(fw_set.firmwares[0]->release == r333);
         CHECK(fw_set.firmwares[1]->release == r333);
     }
+    TEST_CASE("image cache") {
+        using namespace xia::pixie;
+        auto write_image = [](const std::string& name, const std::string& contents) {
+            std::ofstream out(name, std::ios::out | std::ios::binary | std::ios::trunc);
+            out << contents;
+        };
+        const std::string image_a = "test-fw-cache-a.bin";
+        const std::string image_b = "test-fw-cache-b.bin";
+        const std::string contents = "0123456789abcdef0123456789abcdef";
+        write_image(image_a, contents);
+        write_image(image_b, contents);
+        xia::util::crc::crc32 expected;
+        expected << contents;
+
+        firmware::release_type fw_release;
+        auto fw_def = firmware::parse(fw_release, fw_defs_good.back()[0], ',');
+        firmware::firmware fw_1(fw_def.device, fw_def.version, fw_def.mask);
+        firmware::firmware fw_2(fw_def.device, fw_def.version, fw_def.mask);
+        firmware::firmware fw_3(fw_def.device, fw_def.version, fw_def.mask);
+        fw_1.filename = image_a;
+        fw_2.filename = image_a;
+        fw_3.filename = image_b;
+        fw_1.crc = expected.value;
+        fw_2.crc = expected.value + 1;
+
+        firmware::clear_image_cache();
+        auto before = firmware::get_image_cache_stats();
+
+        SUBCASE("Shared") {
+            CHECK(fw_1.validate_firmware() == true);
+            CHECK(fw_1.image_crc == expected.value);
+            CHECK(fw_1.words() == contents.size() / sizeof(firmware::image_value_type));
+            fw_2.load();
+            fw_3.load();
+            CHECK(fw_2.data == fw_1.data);
+            CHECK(fw_3.data == fw_1.data);
+            auto stats = firmware::get_image_cache_stats();
+            CHECK(stats.images == 1);
+            CHECK(stats.bytes == contents.size());
+            CHECK(stats.hits - before.hits == 1);
+            CHECK(stats.misses - before.misses == 2);
+            CHECK(stats.shared - before.shared == 1);
+            CHECK(fw_2.validate_firmware() == false);
+            CHECK(fw_2.data == nullptr);
+            xia::util::crc::crc32 combined;
+            fw_1.update_crc(combined);
+            fw_3.update_crc(combined);
+            xia::util::crc::crc32 joined;
+            joined << contents << contents;
+            CHECK(combined.value == joined.value);
+        }
+        SUBCASE("Changed") {
+            fw_1.load();
+            write_image(image_a, contents + contents);
+            fw_2.load();
+            CHECK(fw_2.data != fw_1.data);
+            CHECK(fw_2.data->size() == contents.size() * 2);
+            CHECK(fw_1.data->size() == contents.size());
+        }
+        SUBCASE("Unloaded") {
+            fw_1.load();
+            fw_3.load();
+            CHECK(firmware::get_image_cache_stats().images == 1);
+            fw_1.unload();
+            CHECK(firmware::get_image_cache_stats().images == 1);
+            fw_3.unload();
+            auto stats = firmware::get_image_cache_stats();
+            CHECK(stats.images == 0);
+            CHECK(stats.bytes == 0);
+            fw_1.load();
+            stats = firmware::get_image_cache_stats();
+            CHECK(stats.misses - before.misses == 3);
+            CHECK(stats.images == 1);
+        }
+        SUBCASE("Missing") {
+            firmware::firmware fw_4(fw_def.device, fw_def.version, fw_def.mask);
+            fw_4.filename = "test-fw-cache-missing.bin";
+            CHECK_THROWS_AS(fw_4.load(), fw_error);
+            CHECK(fw_4.data == nullptr);
+        }
+
+        firmware::clear_image_cache();
+        std::remove(image_a.c_str());
+        std::remove(image_b.c_str());
+    }
 }
@@ -22,6 +22,8 @@
 
 
 #include <iostream>
+#include <sstream>
+#include <thread>
 
 #include <doctest/doctest.h>
 #include <pixie/error.hpp>
@@ -313,6 +315,96 @@ TEST_SUITE("xia::logging") {
                              xia::pixie::error::error);
         xia::logging::stop("set_level_stamp");
     }
+    TEST_CASE("async") {
+        test_setup();
+        std::stringstream test_stream;
+        std::streambuf* old = std::cout.rdbuf();
+        std::cout.rdbuf(test_stream.rdbuf());
+        xia::logging::start("async", "", false);
+        xia::logging::set_datetime_stamp("async", false);
+        std::cout.rdbuf(old);
+        auto lines = [&test_stream]() {
+            log_entries entries;
+            std::string line;
+            while (std::getline(test_stream, line)) {
+                entries.push_back(line);
+            }
+            test_stream.str("");
+            test_stream.clear();
+            return entries;
+        };
+        SUBCASE("Block") {
+            CHECK_NOTHROW(xia::logging::start_async(4, xia::logging::overflow_policy::block));
+            CHECK(xia::logging::async_logging());
+            for (size_t m = 0; m < 500; ++m) {
+                xia::log(xia::log::level::info) << "message " << m;
+            }
+            CHECK_NOTHROW(xia::logging::stop_async());
+            CHECK(xia::logging::async_logging() == false);
+            auto stats = xia::logging::get_async_stats();
+            CHECK(stats.queued == 500);
+            CHECK(stats.written == 500);
+            CHECK(stats.dropped == 0);
+            CHECK(stats.batches > 0);
+            CHECK(xia::mib::find("log.async.written").get<size_t>() == 500);
+            auto entries = lines();
+            REQUIRE(entries.size() == 500);
+            for (size_t m = 0; m < entries.size(); ++m) {
+                CHECK(entries[m] == "[INFO ] message " + std::to_string(m));
+            }
+        }
+        SUBCASE("Drop") {
+            CHECK_NOTHROW(xia::logging::start_async(2, xia::logging::overflow_policy::drop));
+            for (size_t m = 0; m < 1000; ++m) {
+                xia::log(xia::log::level::info) << "message " << m;
+            }
+            CHECK_NOTHROW(xia::logging::stop_async());
+            auto stats = xia::logging::get_async_stats();
+            CHECK(stats.queued + stats.dropped == 1000);
+            CHECK(stats.written == stats.queued);
+            CHECK(stats.blocked == 0);
+            CHECK(xia::mib::find("log.async.dropped").get<size_t>() == stats.dropped);
+            CHECK(lines().size() == stats.written);
+        }
+        SUBCASE("Threads") {
+            CHECK_NOTHROW(xia::logging::start_async(64, xia::logging::overflow_policy::block));
+            std::vector<std::thread> threads;
+            for (size_t t = 0; t < 4; ++t) {
+                threads.emplace_back([t]() {
+                    for (size_t m = 0; m < 100; ++m) {
+                        xia::log(xia::log::level::info) << "thread " << t << " message " << m;
+                    }
+                });
+            }
+            for (auto& thread : threads) {
+                thread.join();
+            }
+            CHECK_NOTHROW(xia::logging::stop_async());
+            CHECK(xia::logging::get_async_stats().written == 400);
+            CHECK(lines().size() == 400);
+        }
+        SUBCASE("Outputs changed while draining") {
+            CHECK_NOTHROW(xia::logging::start_async(64, xia::logging::overflow_policy::block));
+            std::thread logger([]() {
+                for (size_t m = 0; m < 2000; ++m) {
+                    xia::log(xia::log::level::info) << "message " << m;
+                }
+            });
+            for (size_t s = 0; s < 50; ++s) {
+                CHECK_NOTHROW(xia::logging::start("async-extra", "test-log-extra.txt", true));
+                CHECK_NOTHROW(xia::logging::stop("async-extra"));
+            }
+            logger.join();
+            CHECK_NOTHROW(xia::logging::stop_async());
+            CHECK(xia::logging::get_async_stats().written == 2000);
+            CHECK(lines().size() == 2000);
+        }
+        SUBCASE("Stopped") {
+            xia::log(xia::log::level::error) << test_message;
+            CHECK(test_stream.str() == "[ERROR] " + test_message + "\n");
+        }
+        xia::logging::stop("async");
+    }
     TEST_CASE("Log MIB") {
         test_setup();
         xia::mib::node cmd;
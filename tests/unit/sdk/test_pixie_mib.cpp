@@ -20,6 +20,11 @@
  * @brief Provides test coverage for the MIB.
  */
 
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
 #include <doctest/doctest.h>
 #include <pixie/mib.hpp>
 
@@ -343,6 +348,11 @@ TEST_SUITE("xia::pixie::mib") {
             "b.2.ro",
             "i.1",
             "i.2.ro",
+            "log.async.batches",
+            "log.async.blocked",
+            "log.async.dropped",
+            "log.async.queued",
+            "log.async.written",
             "log.command",
             "r.1",
             "r.2.ro",
@@ -377,6 +387,11 @@ TEST_SUITE("xia::pixie::mib") {
             "b.2.ro",
             "i.1",
             "i.2.ro",
+            "log.async.batches",
+            "log.async.blocked",
+            "log.async.dropped",
+            "log.async.queued",
+            "log.async.written",
             "log.command",
             "r.1",
             "r.2.ro",
@@ -412,6 +427,11 @@ TEST_SUITE("xia::pixie::mib") {
         const char* mib_enable_list[] = {
             "b.2.ro",
             "i.2.ro",
+            "log.async.batches",
+            "log.async.blocked",
+            "log.async.dropped",
+            "log.async.queued",
+            "log.async.written",
             "r.2.ro",
             "s.2.ro",
             "t.2.ro",
@@ -476,6 +496,11 @@ TEST_SUITE("xia::pixie::mib") {
             "b.2.ro",
             "i.1",
             "i.2.ro",
+            "log.async.batches",
+            "log.async.blocked",
+            "log.async.dropped",
+            "log.async.queued",
+            "log.async.written",
             "log.command",
             "r.1",
             "r.2",
@@ -553,6 +578,81 @@ TEST_SUITE("xia::pixie::mib") {
         CHECK(n.read_only());
         CHECK(n.write_locked());
     }
+    TEST_CASE("MIB: path walk, multi-find") {
+        const char* path_list[] = {
+            "p.1.run.in",
+            "p.1.run.out",
+            "p.1.status",
+            "p.2.run.in",
+            "p.10.run.in",
+            "p.1x.run",
+        };
+        for (auto n : path_list) {
+            CHECK_NOTHROW(xia::mib::add(n, xia::mib::type::uinteger));
+        }
+        std::vector<std::string> mibs;
+        xia::mib::mib_walk_func walker =
+            [&mibs](xia::mib::node& nod) {
+                mibs.push_back(nod.name());
+            };
+        CHECK_NOTHROW(xia::mib::walk("p.1", walker));
+        CHECK(mibs == std::vector<std::string>{"p.1.run.in", "p.1.run.out", "p.1.status"});
+        mibs.clear();
+        CHECK_NOTHROW(xia::mib::walk("p.1.run.", walker));
+        CHECK(mibs == std::vector<std::string>{"p.1.run.in", "p.1.run.out"});
+        mibs.clear();
+        CHECK_NOTHROW(xia::mib::walk("p.10.run.in", walker));
+        CHECK(mibs == std::vector<std::string>{"p.10.run.in"});
+        mibs.clear();
+        CHECK_NOTHROW(xia::mib::walk("p.3", walker));
+        CHECK(mibs.empty());
+        CHECK_NOTHROW(xia::mib::walk("p", walker));
+        CHECK(mibs.size() == 6);
+        xia::mib::names names = {"p.1.run.in", "p.missing", "p.2.run.in"};
+        xia::mib::nodes found;
+        CHECK_NOTHROW(xia::mib::find(names, found));
+        REQUIRE(found.size() == 3);
+        CHECK(found[0].name() == "p.1.run.in");
+        CHECK(found[1].valid() == false);
+        CHECK(found[2].name() == "p.2.run.in");
+        CHECK_NOTHROW(found[0] = 5U);
+        xia::mib::values vals;
+        CHECK_NOTHROW(xia::mib::get(names, vals));
+        CHECK(vals == xia::mib::values{"5", "", "0"});
+        found.clear();
+        CHECK_NOTHROW(xia::mib::add("p.3.run.in", xia::mib::type::uinteger));
+        CHECK(xia::mib::contains("p.3.run.in"));
+        CHECK_NOTHROW(xia::mib::remove("p.3.run.in"));
+        CHECK(xia::mib::contains("p.3.run.in") == false);
+        for (auto n : path_list) {
+            CHECK_NOTHROW(xia::mib::remove(n));
+        }
+        CHECK(xia::mib::contains("p.1.run.in") == false);
+    }
+    TEST_CASE("MIB: remove with concurrent lookups") {
+        CHECK_NOTHROW(xia::mib::add("q.lookup", xia::mib::type::uinteger));
+        std::atomic_bool running(true);
+        std::thread looker([&running] {
+            while (running) {
+                xia::mib::contains("q.node");
+                xia::mib::contains("q.lookup");
+            }
+        });
+        size_t failures = 0;
+        for (int i = 0; i < 1000; ++i) {
+            try {
+                xia::mib::add("q.node", xia::mib::type::uinteger);
+                xia::mib::remove("q.node");
+            } catch (xia::mib::error&) {
+                ++failures;
+            }
+        }
+        running = false;
+        looker.join();
+        CHECK(failures == 0);
+        CHECK(xia::mib::contains("q.node") == false);
+        CHECK_NOTHROW(xia::mib::remove("q.lookup"));
+    }
     TEST_CASE("MIB: remove nodes") {
         xia::mib::node n1;
         xia::mib::node n2;
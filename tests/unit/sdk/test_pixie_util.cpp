@@ -365,6 +365,43 @@ TEST_SUITE("xia::util") {
             chksum3.clear();
             CHECK(chksum3.value == 0);
         }
+        SUBCASE("Slicing") {
+            std::vector<unsigned char> data(4099);
+            for (size_t i = 0; i < data.size(); ++i) {
+                data[i] = static_cast<unsigned char>((i * 131) ^ (i >> 3));
+            }
+            for (size_t offset = 0; offset < 8; ++offset) {
+                for (size_t len : {size_t(0), size_t(1), size_t(7), size_t(8), size_t(9),
+                                   size_t(63), size_t(4091)}) {
+                    auto bytewise = xia::util::crc::crc32();
+                    for (size_t i = 0; i < len; ++i) {
+                        bytewise << data[offset + i];
+                    }
+                    auto sliced = xia::util::crc::crc32();
+                    sliced.update(&data[offset], len);
+                    CHECK(sliced.value == bytewise.value);
+                }
+            }
+        }
+        SUBCASE("Combine") {
+            std::vector<unsigned char> data(1000);
+            for (size_t i = 0; i < data.size(); ++i) {
+                data[i] = static_cast<unsigned char>(i * 7);
+            }
+            auto whole = xia::util::crc::crc32();
+            whole.update(data);
+            for (size_t split : {size_t(0), size_t(1), size_t(500), size_t(999), size_t(1000)}) {
+                auto first = xia::util::crc::crc32();
+                first.update(data.data(), split);
+                auto second = xia::util::crc::crc32();
+                second.update(data.data() + split, data.size() - split);
+                first.combine(second.value, data.size() - split);
+                CHECK(first.value == whole.value);
+            }
+            auto chksum4 = xia::util::crc::crc32();
+            chksum4.combine(expected, vec_val.size());
+            CHECK(chksum4.value == expected);
+        }
     }
 
     TEST_CASE("ISO-8601 Timestamps") {
@@ -68,11 +68,12 @@ void adc_save(command::context& context) {
         pixie::channel::range channels;
         command::channels_option(
             channels, chans_opt, crate[mod_num].num_channels);
+        pixie::hw::adc_traces adc_traces(
+            crate[mod_num].num_channels, pixie::hw::adc_trace(length));
+        crate[mod_num].read_adc_all(adc_traces, false);
         std::vector<pixie::hw::adc_trace> traces;
         for (auto channel : channels) {
-            pixie::hw::adc_trace adc_trace(length);
-            crate[mod_num].read_adc(channel, adc_trace, false);
-            traces.push_back(adc_trace);
+            traces.push_back(std::move(adc_traces[channel]));
         }
         std::ostringstream name;
         name << name_opt << '-' << std::setfill('0') << omnitool::adc_prefix
@@ -400,7 +400,8 @@ void offset_sweep_worker::set_module_mean_deltas(
 void offset_sweep_worker::worker(
     command::context& , pixie::module::module& module) {
     try {
-        pixie::hw::adc_trace adc_trace(pixie::hw::max_adc_trace_length);
+        pixie::hw::adc_traces adc_traces(
+            module.num_channels, pixie::hw::adc_trace(pixie::hw::max_adc_trace_length));
         module_results mod_results(channels.size());
         for (size_t idx = 0; idx < channels.size(); idx++) {
             mod_results[idx].channel = channels[idx];
@@ -417,9 +418,9 @@ void offset_sweep_worker::worker(
              * This is set by looking at Rev F
              */
             pixie::hw::wait(dac_settle_usec);
-            module.get_traces();
+            module.read_adc_all(adc_traces);
             for (size_t idx = 0; idx < channels.size(); idx++) {
-                module.read_adc(channels[idx], adc_trace, false);
+                auto& adc_trace = adc_traces[channels[idx]];
                 auto mean = adc_mean(adc_trace);
                 auto stddev = adc_stddev(adc_trace, mean);
                 mod_results[idx].results.emplace_back(offset, mean, stddev);